@@ -24,6 +24,42 @@ bool Config::getGraphicsTripleBuffering() {
 	return tripleBuffering;
 }
 
+uint32_t Config::getGraphicsFramesInFlight() {
+	return tripleBuffering ? 3 : 2;
+}
+
+void Config::setGraphicsRecordPipelines(bool recordPipelines) {
+	this->recordPipelines = recordPipelines;
+}
+
+bool Config::getGraphicsRecordPipelines() {
+	return recordPipelines;
+}
+
+void Config::setGraphicsHeadless(bool headless) {
+	this->headless = headless;
+}
+
+bool Config::getGraphicsHeadless() {
+	return headless;
+}
+
+void Config::setGraphicsHeadlessFrames(uint32_t headlessFrames) {
+	this->headlessFrames = headlessFrames;
+}
+
+uint32_t Config::getGraphicsHeadlessFrames() {
+	return headlessFrames;
+}
+
+void Config::setGraphicsCapturePath(const std::string& capturePath) {
+	this->capturePath = capturePath;
+}
+
+const std::string& Config::getGraphicsCapturePath() {
+	return capturePath;
+}
+
 void Config::setGraphicsTextureQuality(Quality textureQuality) {
 	this->textureQuality = textureQuality;
 }
@@ -63,3 +99,19 @@ void Config::setWindowMode(WindowMode mode) {
 WindowMode Config::getWindowMode() {
 	return windowMode;
 }
+
+void Config::setSceneModelPath(const std::string& modelPath) {
+	this->modelPath = modelPath;
+}
+
+const std::string& Config::getSceneModelPath() {
+	return modelPath;
+}
+
+void Config::setThreadsWorkerPolicy(const WorkerPolicy& workerPolicy) {
+	this->workerPolicy = workerPolicy;
+}
+
+const WorkerPolicy& Config::getThreadsWorkerPolicy() {
+	return workerPolicy;
+}
@@ -24,6 +24,11 @@ SOFTWARE.
 
 #pragma once
 
+#include <cstdint>
+#include <string>
+
+#include "util/cpu_topology.hpp"
+
 enum class Quality {
 	eLow,
 	eMedium,
@@ -63,6 +68,23 @@ public:
 	bool getGraphicsVsync();
 	void setGraphicsTripleBuffering(bool tripleBuffering);
 	bool getGraphicsTripleBuffering();
+	/// Number of frames the CPU may record ahead of the GPU, three with triple buffering and
+	/// two without.
+	uint32_t getGraphicsFramesInFlight();
+	/// When enabled, every pipeline created during the session is written to the driver's
+	/// pipeline manifest on shutdown, to be compiled while loading the next session.
+	void setGraphicsRecordPipelines(bool recordPipelines);
+	bool getGraphicsRecordPipelines();
+	/// Renders into offscreen images without creating a window, for running on machines 
+	/// without a display. Only supported by the Vulkan driver.
+	void setGraphicsHeadless(bool headless);
+	bool getGraphicsHeadless();
+	/// Number of frames rendered before a headless session exits.
+	void setGraphicsHeadlessFrames(uint32_t headlessFrames);
+	uint32_t getGraphicsHeadlessFrames();
+	/// File the final frame of a headless session is written to, nothing is written when empty.
+	void setGraphicsCapturePath(const std::string& capturePath);
+	const std::string& getGraphicsCapturePath();
 	void setGraphicsTextureQuality(Quality textureQuality);
 	Quality getGraphicsTextureQuality();
 	void setGraphicsTextureFiltering(TextureFiltering textureFiltering);
@@ -73,12 +95,24 @@ public:
 	int getWindowHeight();
 	void setWindowMode(WindowMode mode);
 	WindowMode getWindowMode();
+	/// OBJ file loaded into the scene once the GPU is selected, nothing is loaded when empty.
+	void setSceneModelPath(const std::string& modelPath);
+	const std::string& getSceneModelPath();
+	/// Layout of the driver threadpool across the processors of the machine.
+	void setThreadsWorkerPolicy(const WorkerPolicy& workerPolicy);
+	const WorkerPolicy& getThreadsWorkerPolicy();
 private:
-	int volume;
-	bool vsync;
-	bool tripleBuffering;
-	Quality textureQuality;
-	TextureFiltering textureFiltering;
-	int windowWidth, windowHeight;
-	WindowMode windowMode;
+	int volume = 100;
+	bool vsync = true;
+	bool tripleBuffering = false;
+	bool recordPipelines = false;
+	bool headless = false;
+	uint32_t headlessFrames = 500;
+	std::string capturePath = "headless.ppm";
+	Quality textureQuality = Quality::eHigh;
+	TextureFiltering textureFiltering = TextureFiltering::e16x;
+	int windowWidth = 1024, windowHeight = 768;
+	WindowMode windowMode = WindowMode::eWindowed;
+	std::string modelPath;
+	WorkerPolicy workerPolicy;
 };
\ No newline at end of file
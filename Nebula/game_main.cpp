@@ -22,6 +22,8 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include <cstdlib>
+#include <cstring>
 #include <vector>
 
 #include "renderer/renderer.hpp"
@@ -49,14 +51,36 @@ int main(int argc, char** argv) {
 	std::vector<const char*> args;
 	args.insert(args.begin(), argv, argv + argc);
 	RendererDriver driver = RendererDriver::eAutodetect;
-	for (const char* arg : args) {
+	Config config;
+	WorkerPolicy workerPolicy;
+	for (size_t i = 0; i < args.size(); i++) {
+		const char* arg = args[i];
 		if (std::strcmp(arg, "--dx") == 0)
 			driver = RendererDriver::eDirectX12;
 		if (std::strcmp(arg, "--vk") == 0)
 			driver = RendererDriver::eVulkan;
+		if (std::strcmp(arg, "--headless") == 0)
+			config.setGraphicsHeadless(true);
+		if (std::strcmp(arg, "--frames") == 0 && i + 1 < args.size())
+			config.setGraphicsHeadlessFrames(static_cast<uint32_t>(std::strtoul(args[++i], nullptr, 10)));
+		if (std::strcmp(arg, "--capture") == 0 && i + 1 < args.size())
+			config.setGraphicsCapturePath(args[++i]);
+		if (std::strcmp(arg, "--triple-buffering") == 0)
+			config.setGraphicsTripleBuffering(true);
+		if (std::strcmp(arg, "--record-pipelines") == 0)
+			config.setGraphicsRecordPipelines(true);
+		if (std::strcmp(arg, "--model") == 0 && i + 1 < args.size())
+			config.setSceneModelPath(args[++i]);
+		if (std::strcmp(arg, "--smt-workers") == 0)
+			workerPolicy.physicalCoresOnly = false;
+		if (std::strcmp(arg, "--pin-threads") == 0)
+			workerPolicy.pinThreads = true;
+		if (std::strcmp(arg, "--numa-local") == 0)
+			workerPolicy.numaLocal = true;
 	}
+	config.setThreadsWorkerPolicy(workerPolicy);
 
-	Renderer engine(driver);
+	Renderer engine(driver, config);
 	if (!engine.initialize())
 		return false;
 	return engine.executeEventLoop();
@@ -5,6 +5,11 @@ Asset::Asset(Driver* pDriver) : m_pDriver(pDriver) {}
 
 Asset::~Asset() {}
 
+AsyncTask<bool> Asset::loadAsync(ThreadPool* pPool, std::string filename) {
+	co_await resumeOn(pPool, TaskPriority::eBackground);
+	co_return load(filename.c_str());
+}
+
 Driver* Asset::getDriver() const {
 	return m_pDriver;
 }
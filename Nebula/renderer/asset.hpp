@@ -1,11 +1,19 @@
 #pragma once
 
+#include <string>
+
+#include "util/async_task.hpp"
+
 class Driver;
 class Asset {
 public:
 	explicit Asset(Driver* pDriver);
 	virtual ~Asset();
 	virtual bool load(const char* pFilename) = 0;
+
+	/// Loads the asset on the background lane of pPool. By default this runs load on a 
+	/// worker, assets which can split reading, decoding and uploading should override it.
+	virtual AsyncTask<bool> loadAsync(ThreadPool* pPool, std::string filename);
 protected:
 	Driver* getDriver() const;
 private:
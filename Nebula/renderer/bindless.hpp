@@ -0,0 +1,49 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+/// Tables of the bindless model. Every resource of a type lives in a single large table and
+/// is referenced from shaders by its index in that table.
+enum class BindlessResourceType {
+	eTexture,
+	eSampler,
+	eBuffer,
+};
+
+constexpr uint32_t kInvalidBindlessIndex = UINT32_MAX;
+
+/// Pushed with every draw as push constants on Vulkan and root constants on DirectX 12.
+/// Shaders reach everything else through these indices, see shaders/bindless.hlsli.
+struct DrawConstants {
+	/// Buffer table index of the material parameters.
+	uint32_t materialIndex = kInvalidBindlessIndex;
+	uint32_t textureIndex = kInvalidBindlessIndex;
+	uint32_t samplerIndex = kInvalidBindlessIndex;
+	/// Buffer table index of per-instance data.
+	uint32_t instanceIndex = kInvalidBindlessIndex;
+};
+static_assert(sizeof(DrawConstants) == 16, "DrawConstants must match the shader declaration.");
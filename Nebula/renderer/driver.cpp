@@ -26,9 +26,24 @@ SOFTWARE.
 
 #include <iostream>
 
-Driver::Driver(const SDL_Window* pWindow) : m_pWindow(pWindow) {
-    m_ThreadCount = std::thread::hardware_concurrency();
-    m_ThreadPool = std::make_unique<ThreadPool>(m_ThreadCount);
+#include "thirdparty/loguru/loguru.hpp"
+#include "util/cpu_topology.hpp"
+
+Driver::Driver(const SDL_Window* pWindow, const Config& config) : m_pWindow(pWindow), m_Config(config) {
+    // By default one worker is placed per physical core, leaving the core of the main thread
+    // to SDL and frame submission.
+    WorkerPolicy policy = m_Config.getThreadsWorkerPolicy();
+    CpuTopology topology = CpuTopology::query();
+    std::vector<uint32_t> processors = topology.selectWorkers(policy);
+    if (policy.pinThreads && policy.reserveMainThread)
+        CpuTopology::pinCurrentThread(CpuTopology::getCurrentProcessor());
+    LOG_F(INFO, "Threadpool layout: %s", topology.describe(processors).c_str());
+
+    m_ThreadCount = static_cast<uint32_t>(processors.size());
+    m_ThreadPool = std::make_unique<ThreadPool>(processors, policy.pinThreads);
+    m_FrameGraph = std::make_unique<TaskGraph>(m_ThreadPool.get());
+    m_FrameArenas = std::make_unique<FrameArenas>(m_ThreadPool.get(), m_Config.getGraphicsFramesInFlight());
+    m_StatisticsReportedAt = std::chrono::steady_clock::now();
 }
 
 const std::vector<Gpu>& Driver::getGpus() {
@@ -39,6 +54,10 @@ const SDL_Window* Driver::getWindow() {
     return m_pWindow;
 }
 
+Config& Driver::getConfig() {
+    return m_Config;
+}
+
 void Driver::addGpu(Gpu gpu) {
     m_Gpus.push_back(gpu);
 }
@@ -50,3 +69,21 @@ uint32_t Driver::getThreadCount() {
 ThreadPool* Driver::getThreadPool() {
     return m_ThreadPool.get();
 }
+
+TaskGraph* Driver::getFrameGraph() {
+    return m_FrameGraph.get();
+}
+
+FrameArenas* Driver::getFrameArenas() {
+    return m_FrameArenas.get();
+}
+
+void Driver::reportThreadPoolStatistics() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_StatisticsReportedAt < std::chrono::seconds(5))
+        return;
+    m_ThreadPool->logStatistics();
+    if (m_FrameGraph->getNodeCount() > 0)
+        m_FrameGraph->logTimings();
+    m_StatisticsReportedAt = now;
+}
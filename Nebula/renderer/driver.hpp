@@ -24,11 +24,17 @@ SOFTWARE.
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
+#include "game_config.hpp"
+#include "renderable.hpp"
+#include "util/frame_arena.hpp"
+#include "util/task_graph.hpp"
 #include "util/thread_pool.hpp"
 
 struct Gpu {
@@ -52,10 +58,9 @@ struct Display {
 };
 
 struct SDL_Window;
-class Renderable;
 class Driver {
 public:
-    explicit Driver(const SDL_Window* pWindow);
+    Driver(const SDL_Window* pWindow, const Config& config);
     virtual ~Driver() {}
 
     /// Initializes all of the driver specific state in order for it to properly function.
@@ -71,7 +76,9 @@ public:
     /// Gpu and see if it succeeds otherwise.
     virtual bool selectGpu(uint32_t id) = 0;
 
-	/// Prepares the frame for presentation.
+	/// Prepares the frame for presentation. Returns false when there is nothing to present
+	/// this frame, such as while the window is minimized, in which case presentFrame must not
+	/// be called.
 	virtual bool prepareFrame() = 0;
 
     /// Submits all of the gathered command buffers/lists to the GPU for execution.
@@ -79,20 +86,53 @@ public:
     /// all information executed in the queue to the swapchain for presentation.
     virtual bool presentFrame() = 0;
 
+    /// Notifies the driver that the window has changed size. Size dependent resources are 
+    /// recreated at the start of the next frame.
+    virtual void resize(uint32_t width, uint32_t height) {}
+
+    /// Copies the most recently presented frame back from the GPU and writes it to path as a 
+    /// binary PPM once the copy completes, without stalling the frames which follow. Returns 
+    /// false when the driver cannot capture frames.
+    virtual bool captureFrame(const std::string& path) { return false; }
+
+    /// Blocks until all submitted GPU work has completed and every capture has been written.
+    virtual void finish() {}
+
+    /// Creates a renderable drawn with the driver's geometry shaders, which may be replaced with
+    /// attachShader before it is built. Returns nothing when the driver cannot draw indexed
+    /// meshes, which DirectX 12 cannot yet.
+    virtual std::unique_ptr<Renderable> createRenderable() { return nullptr; }
+
     /// Returns a list of all GPUs along with information about each one of them.
     /// id - The identifier of this GPU.
     /// name - The name of this GPU.
     /// memory - The maximum amount of video memory for this GPU.
     /// software - A boolean of whether this GPU is a software rasterizer and not a physical graphics card. 
     const std::vector<Gpu>& getGpus();
+
+    /// Workers shared by the driver and everything it creates, such as renderables preparing
+    /// their data.
+    ThreadPool* getThreadPool();
 protected:
     const SDL_Window* getWindow();
+    Config& getConfig();
     void addGpu(Gpu gpu);
     uint32_t getThreadCount();
-    ThreadPool* getThreadPool();
+    /// Graph describing the CPU work of a frame, executed on the driver threadpool. Backends
+    /// build it once the device is ready and execute it from prepareFrame.
+    TaskGraph* getFrameGraph();
+    /// Per-thread linear allocators for transient frame data, reset as each frame begins.
+    FrameArenas* getFrameArenas();
+    /// Logs a summary of threadpool activity and of the frame graph's critical path every few
+    /// seconds. Called once per frame.
+    void reportThreadPoolStatistics();
 private:
     const SDL_Window* m_pWindow;
+    Config m_Config;
     std::vector<Gpu> m_Gpus;
     uint32_t m_ThreadCount;
     std::unique_ptr<ThreadPool> m_ThreadPool;
+    std::unique_ptr<TaskGraph> m_FrameGraph;
+    std::unique_ptr<FrameArenas> m_FrameArenas;
+    std::chrono::steady_clock::time_point m_StatisticsReportedAt;
 };
\ No newline at end of file
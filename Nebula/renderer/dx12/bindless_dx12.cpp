@@ -0,0 +1,151 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bindless_dx12.hpp"
+
+#include <algorithm>
+
+#include "thirdparty/d3dx12/d3dx12.h"
+#include "thirdparty/loguru/loguru.hpp"
+
+#include "helper_dx12.hpp"
+
+namespace {
+	constexpr uint32_t kMaxTextures = 65536;
+	constexpr uint32_t kMaxBuffers = 65536;
+	/// Largest shader visible sampler heap.
+	constexpr uint32_t kMaxSamplers = 2048;
+
+	/// Resource binding tier 1 only allows a stage to reach 128 SRVs and 16 samplers.
+	constexpr uint32_t kTier1Textures = 96;
+	constexpr uint32_t kTier1Buffers = 32;
+	constexpr uint32_t kTier1Samplers = 16;
+}
+
+BindlessDX12::BindlessDX12(ID3D12Device* pDevice) : m_pDevice(pDevice), m_RecordingFenceValue(0) {
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	bool tier1 = FAILED(m_pDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options))) ||
+		options.ResourceBindingTier == D3D12_RESOURCE_BINDING_TIER_1;
+	m_Indices[static_cast<size_t>(BindlessResourceType::eTexture)] = std::make_unique<IndexAllocator>(tier1 ? kTier1Textures : kMaxTextures);
+	m_Indices[static_cast<size_t>(BindlessResourceType::eSampler)] = std::make_unique<IndexAllocator>(tier1 ? kTier1Samplers : kMaxSamplers);
+	m_Indices[static_cast<size_t>(BindlessResourceType::eBuffer)] = std::make_unique<IndexAllocator>(tier1 ? kTier1Buffers : kMaxBuffers);
+
+	D3D12_DESCRIPTOR_HEAP_DESC resourceHeapDesc = {};
+	resourceHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	resourceHeapDesc.NumDescriptors = getCapacity(BindlessResourceType::eTexture) + getCapacity(BindlessResourceType::eBuffer);
+	resourceHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	if (FAILED(m_pDevice->CreateDescriptorHeap(&resourceHeapDesc, IID_PPV_ARGS(&m_pResourceHeap))))
+		LOG_F(ERROR, "Failed to create the bindless resource heap.");
+
+	D3D12_DESCRIPTOR_HEAP_DESC samplerHeapDesc = {};
+	samplerHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
+	samplerHeapDesc.NumDescriptors = getCapacity(BindlessResourceType::eSampler);
+	samplerHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	if (FAILED(m_pDevice->CreateDescriptorHeap(&samplerHeapDesc, IID_PPV_ARGS(&m_pSamplerHeap))))
+		LOG_F(ERROR, "Failed to create the bindless sampler heap.");
+
+	m_ResourceDescriptorSize = m_pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	m_SamplerDescriptorSize = m_pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+	LOG_F(INFO, "Bindless tables hold %u textures, %u samplers and %u buffers.", getCapacity(BindlessResourceType::eTexture),
+		getCapacity(BindlessResourceType::eSampler), getCapacity(BindlessResourceType::eBuffer));
+}
+
+std::optional<ComPtr<ID3D12RootSignature>> BindlessDX12::createRootSignature() const {
+	return HelperDX12::createRootSignature(m_pDevice.Get(), getCapacity(BindlessResourceType::eTexture),
+		getCapacity(BindlessResourceType::eBuffer), getCapacity(BindlessResourceType::eSampler));
+}
+
+uint32_t BindlessDX12::getCapacity(BindlessResourceType type) const {
+	return m_Indices[static_cast<size_t>(type)]->getCapacity();
+}
+
+std::optional<uint32_t> BindlessDX12::addTexture(ID3D12Resource* pTexture, const D3D12_SHADER_RESOURCE_VIEW_DESC* pViewDesc) {
+	std::optional<uint32_t> index = m_Indices[static_cast<size_t>(BindlessResourceType::eTexture)]->allocate();
+	if (!index.has_value()) {
+		LOG_F(ERROR, "Bindless texture table is full.");
+		return std::nullopt;
+	}
+	m_pDevice->CreateShaderResourceView(pTexture, pViewDesc, getCpuHandle(BindlessResourceType::eTexture, index.value()));
+	return index;
+}
+
+std::optional<uint32_t> BindlessDX12::addSampler(const D3D12_SAMPLER_DESC& samplerDesc) {
+	std::optional<uint32_t> index = m_Indices[static_cast<size_t>(BindlessResourceType::eSampler)]->allocate();
+	if (!index.has_value()) {
+		LOG_F(ERROR, "Bindless sampler table is full.");
+		return std::nullopt;
+	}
+	m_pDevice->CreateSampler(&samplerDesc, getCpuHandle(BindlessResourceType::eSampler, index.value()));
+	return index;
+}
+
+std::optional<uint32_t> BindlessDX12::addBuffer(ID3D12Resource* pBuffer, UINT64 offset, UINT size) {
+	std::optional<uint32_t> index = m_Indices[static_cast<size_t>(BindlessResourceType::eBuffer)]->allocate();
+	if (!index.has_value()) {
+		LOG_F(ERROR, "Bindless buffer table is full.");
+		return std::nullopt;
+	}
+
+	// Raw views address the buffer in 32-bit elements, matching ByteAddressBuffer.
+	D3D12_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+	viewDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	viewDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+	viewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	viewDesc.Buffer.FirstElement = offset / 4;
+	viewDesc.Buffer.NumElements = size / 4;
+	viewDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+	m_pDevice->CreateShaderResourceView(pBuffer, &viewDesc, getCpuHandle(BindlessResourceType::eBuffer, index.value()));
+	return index;
+}
+
+void BindlessDX12::remove(BindlessResourceType type, uint32_t index) {
+	m_Indices[static_cast<size_t>(type)]->free(index, m_RecordingFenceValue.load(std::memory_order_relaxed));
+}
+
+void BindlessDX12::beginFrame(UINT64 recordingFenceValue, UINT64 completedFenceValue) {
+	for (auto& pIndices : m_Indices)
+		pIndices->collect(completedFenceValue);
+	m_RecordingFenceValue.store(recordingFenceValue, std::memory_order_relaxed);
+}
+
+void BindlessDX12::bind(ID3D12GraphicsCommandList* pCommandList) const {
+	std::array<ID3D12DescriptorHeap*, 2> heaps = { m_pResourceHeap.Get(), m_pSamplerHeap.Get() };
+	pCommandList->SetDescriptorHeaps(static_cast<UINT>(heaps.size()), heaps.data());
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE textures(m_pResourceHeap->GetGPUDescriptorHandleForHeapStart());
+	CD3DX12_GPU_DESCRIPTOR_HANDLE buffers(textures, getCapacity(BindlessResourceType::eTexture), m_ResourceDescriptorSize);
+	pCommandList->SetGraphicsRootDescriptorTable(static_cast<UINT>(RootParameterDX12::eTextures), textures);
+	pCommandList->SetGraphicsRootDescriptorTable(static_cast<UINT>(RootParameterDX12::eBuffers), buffers);
+	pCommandList->SetGraphicsRootDescriptorTable(static_cast<UINT>(RootParameterDX12::eSamplers), 
+		m_pSamplerHeap->GetGPUDescriptorHandleForHeapStart());
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE BindlessDX12::getCpuHandle(BindlessResourceType type, uint32_t index) const {
+	// Buffers follow the textures in the resource heap.
+	if (type == BindlessResourceType::eSampler)
+		return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_pSamplerHeap->GetCPUDescriptorHandleForHeapStart(), index, m_SamplerDescriptorSize);
+	if (type == BindlessResourceType::eBuffer)
+		index += getCapacity(BindlessResourceType::eTexture);
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_pResourceHeap->GetCPUDescriptorHandleForHeapStart(), index, m_ResourceDescriptorSize);
+}
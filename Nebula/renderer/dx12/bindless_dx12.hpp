@@ -0,0 +1,91 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include <d3d12.h>
+#include <wrl/client.h>
+using Microsoft::WRL::ComPtr;
+
+#include "renderer/bindless.hpp"
+#include "util/index_allocator.hpp"
+
+/// Parameters of the root signature shared by every pipeline.
+enum class RootParameterDX12 : UINT {
+	eDrawConstants,
+	eTextures,
+	eBuffers,
+	eSamplers,
+};
+
+/// Bindless descriptor tables. Textures and buffers share a single shader visible heap, split
+/// into one range per table, and samplers have their own heap. The tables are bound once per
+/// command list and resources keep their index for as long as they are registered.
+///
+/// On resource binding tier 1 hardware the tables are limited to what a stage may access at 
+/// once, and shaders must only index slots which hold a live resource.
+///
+/// Descriptors are written straight into the shader visible heaps. Removed slots are recycled
+/// once every frame which could have referenced them has completed.
+class BindlessDX12 {
+public:
+	explicit BindlessDX12(ID3D12Device* pDevice);
+
+	/// Creates a root signature with tables sized to match.
+	std::optional<ComPtr<ID3D12RootSignature>> createRootSignature() const;
+	uint32_t getCapacity(BindlessResourceType type) const;
+
+	/// Register a resource and return its index, or nothing once the table is full. Safe to
+	/// call from any thread. Buffers are exposed as raw buffers.
+	std::optional<uint32_t> addTexture(ID3D12Resource* pTexture, const D3D12_SHADER_RESOURCE_VIEW_DESC* pViewDesc = nullptr);
+	std::optional<uint32_t> addSampler(const D3D12_SAMPLER_DESC& samplerDesc);
+	std::optional<uint32_t> addBuffer(ID3D12Resource* pBuffer, UINT64 offset, UINT size);
+
+	/// Unregisters a resource. The resource must stay alive until the frames which were 
+	/// recorded before this call have completed.
+	void remove(BindlessResourceType type, uint32_t index);
+
+	/// Recycles indices released by frames up to completedFenceValue. recordingFenceValue is 
+	/// the value the frame about to be recorded will signal.
+	void beginFrame(UINT64 recordingFenceValue, UINT64 completedFenceValue);
+
+	/// Sets the descriptor heaps and tables on a command list using the shared root signature.
+	void bind(ID3D12GraphicsCommandList* pCommandList) const;
+private:
+	D3D12_CPU_DESCRIPTOR_HANDLE getCpuHandle(BindlessResourceType type, uint32_t index) const;
+
+	ComPtr<ID3D12Device> m_pDevice;
+	ComPtr<ID3D12DescriptorHeap> m_pResourceHeap;
+	ComPtr<ID3D12DescriptorHeap> m_pSamplerHeap;
+	UINT m_ResourceDescriptorSize;
+	UINT m_SamplerDescriptorSize;
+	std::array<std::unique_ptr<IndexAllocator>, 3> m_Indices;
+	std::atomic<UINT64> m_RecordingFenceValue;
+};
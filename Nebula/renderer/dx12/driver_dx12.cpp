@@ -24,6 +24,7 @@ SOFTWARE.
 
 #include "driver_dx12.hpp"
 
+#include <filesystem>
 #include <iostream>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_syswm.h>
@@ -34,10 +35,10 @@ SOFTWARE.
 
 #include "helper_dx12.hpp"
 
-DriverDX12::DriverDX12(const SDL_Window* pWindow) : Driver(pWindow) {
+DriverDX12::DriverDX12(const SDL_Window* pWindow, const Config& config) : Driver(pWindow, config) {
 	m_FrameIndex = 0;
 	m_renderTargetHeapSize = 0;
-	m_RenderTargetCount = 2;
+	m_RenderTargetCount = getConfig().getGraphicsFramesInFlight();
 	m_pRenderTargets = std::vector<ComPtr<ID3D12Resource>>(m_RenderTargetCount);
 	m_pCommandAllocators = std::vector<ComPtr<ID3D12CommandAllocator>>(m_RenderTargetCount);
 	m_FenceValues = std::vector<UINT64>(m_RenderTargetCount);
@@ -53,8 +54,14 @@ DriverDX12::DriverDX12(const SDL_Window* pWindow) : Driver(pWindow) {
 }
 
 DriverDX12::~DriverDX12() {
+	// Background compiles run createPipeline, which uses the device and the root signature.
+	if (m_pPipelineStates)
+		m_pPipelineStates->wait();
+
 	waitOnFence();
 	CloseHandle(m_pFenceEvent);
+	if (m_pPipelineManifest && getConfig().getGraphicsRecordPipelines())
+		m_pPipelineManifest->save();
 	LOG_F(INFO, "DirectX 12 driver shutting down.");
 }
 
@@ -156,16 +163,38 @@ bool DriverDX12::selectGpu(uint32_t id) {
 	}
 
 	build();
+	if (!createFrameTasks()) {
+		LOG_F(FATAL, "Failed to create the task graph of a frame.");
+		return false;
+	}
 	LOG_F(INFO, "DirectX 12 driver was successfully initialized.");
 	return true;
 }
 
 bool DriverDX12::prepareFrame() {
+	reportThreadPoolStatistics();
+	getFrameArenas()->beginFrame();
+	getFrameGraph()->execute();
+	return true;
+}
+
+bool DriverDX12::createFrameTasks() {
+	TaskGraph* pTasks = getFrameGraph();
+	TaskGraph::NodeId bindless = pTasks->addNode("Bindless", [this] {
+		m_pBindless->beginFrame(m_FenceValues[m_FrameIndex], m_pFence->GetCompletedValue());
+	});
+	TaskGraph::NodeId record = pTasks->addNode("Record", [this] { recordFrame(); });
+	pTasks->addEdge(bindless, record);
+	return pTasks->compile();
+}
+
+void DriverDX12::recordFrame() {
 	m_pCommandAllocators[m_FrameIndex]->Reset();
-	m_pCommandList->Reset(m_pCommandAllocators[m_FrameIndex].Get(), m_pPipelineState.Get());
+	m_pCommandList->Reset(m_pCommandAllocators[m_FrameIndex].Get(), nullptr);
 
 	// Set typical command list state.
 	m_pCommandList->SetGraphicsRootSignature(m_pRootSignature.Get());
+	m_pBindless->bind(m_pCommandList.Get());
 	m_pCommandList->RSSetViewports(1, &m_Viewport);
 	m_pCommandList->RSSetScissorRects(1, &m_ScissorRect);
 
@@ -176,15 +205,21 @@ bool DriverDX12::prepareFrame() {
 	m_pCommandList->OMSetRenderTargets(1, &descriptorHandle, false, nullptr);
 	m_pCommandList->ClearRenderTargetView(descriptorHandle, glm::value_ptr(m_ClearColor), 0, nullptr);
 
-	m_pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	m_pCommandList->IASetVertexBuffers(0, 1, &m_VertexBufferView);
-	m_pCommandList->DrawInstanced(3, 1, 0, 0);
+	// The triangle is skipped until its pipeline has finished compiling.
+	if (m_pPipelineState->isReady()) {
+		m_pCommandList->SetPipelineState(m_pPipelineState->get().Get());
+		DrawConstants drawConstants;
+		m_pCommandList->SetGraphicsRoot32BitConstants(static_cast<UINT>(RootParameterDX12::eDrawConstants), sizeof(DrawConstants) / 4,
+			&drawConstants, 0);
+		m_pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		m_pCommandList->IASetVertexBuffers(0, 1, &m_VertexBufferView);
+		m_pCommandList->DrawInstanced(3, 1, 0, 0);
+	}
 
 	m_pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_pRenderTargets[m_FrameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET,
 		D3D12_RESOURCE_STATE_PRESENT));
 
 	m_pCommandList->Close();
-	return true;
 }
 
 bool DriverDX12::presentFrame() {
@@ -228,42 +263,29 @@ void DriverDX12::nextFrame() {
 }
 
 void DriverDX12::build() {
-	if (auto rootSignature = HelperDX12::createRootSignature(m_pDevice.Get()); rootSignature.has_value())
+	m_pBindless = std::make_unique<BindlessDX12>(m_pDevice.Get());
+	if (auto rootSignature = m_pBindless->createRootSignature(); rootSignature.has_value())
 		m_pRootSignature.Swap(rootSignature.value());
 	else {
 		LOG_F(FATAL, "Failed to create root signature");
 		return;
 	}
 
-	auto path = L"C:\\Users\\Ben\\nebula\\nebula\\shaders\\shaders.hlsl";
-	HRESULT vert = D3DCompileFromFile(path, nullptr, nullptr, "VSMain", "vs_5_0",
-		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &m_pVertexShader, nullptr);
-	HRESULT frag = D3DCompileFromFile(path, nullptr, nullptr, "PSMain", "ps_5_0",
-		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &m_pPixelShader, nullptr);
+	m_pPipelineStates = std::make_unique<PipelineStateCacheDX12>(getThreadPool(),
+		[this](const PipelineDescription& description) { return createPipeline(description); });
+	m_pPipelineManifest = std::make_unique<PipelineManifest>("pipelines_dx12.manifest");
+	if (getConfig().getGraphicsRecordPipelines())
+		m_pPipelineStates->setManifest(m_pPipelineManifest.get());
 
-	// Define the vertex input layout.
-	std::vector<D3D12_INPUT_ELEMENT_DESC> inputElementDescs = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-	};
+	// Compile everything the previous sessions drew before the first frame.
+	m_pPipelineStates->warmUp(m_pPipelineManifest->load());
 
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-	psoDesc.InputLayout = { inputElementDescs.data(), inputElementDescs.size() };
-	psoDesc.pRootSignature = m_pRootSignature.Get();
-	psoDesc.VS = CD3DX12_SHADER_BYTECODE(m_pVertexShader.Get());
-	psoDesc.PS = CD3DX12_SHADER_BYTECODE(m_pPixelShader.Get());
-	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-	psoDesc.DepthStencilState.DepthEnable = FALSE;
-	psoDesc.DepthStencilState.StencilEnable = FALSE;
-	psoDesc.SampleMask = UINT_MAX;
-	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-	psoDesc.NumRenderTargets = 1;
-	psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-	psoDesc.SampleDesc.Count = 1;
-	m_pDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pPipelineState));
+	PipelineDescription pipelineDesc;
+	pipelineDesc.setShader("C:\\Users\\Ben\\nebula\\nebula\\shaders\\shaders.hlsl", ShaderStage::Vertex);
+	pipelineDesc.setShader("C:\\Users\\Ben\\nebula\\nebula\\shaders\\shaders.hlsl", ShaderStage::Fragment);
+	m_pPipelineState = m_pPipelineStates->acquire(pipelineDesc);
 
-	m_pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_pCommandAllocators[m_FrameIndex].Get(), m_pPipelineState.Get(), IID_PPV_ARGS(&m_pCommandList));
+	m_pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_pCommandAllocators[m_FrameIndex].Get(), nullptr, IID_PPV_ARGS(&m_pCommandList));
 	m_pCommandList->Close();
 
 	VERTEX vertices[] = {
@@ -308,6 +330,72 @@ void DriverDX12::build() {
 	waitOnFence();
 }
 
+ComPtr<ID3D12PipelineState> DriverDX12::createPipeline(const PipelineDescription& description) {
+	UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+	ComPtr<ID3DBlob> pVertexShader, pPixelShader, pError;
+	if (FAILED(D3DCompileFromFile(std::filesystem::path(description.vertexShader.path).c_str(), nullptr, nullptr, 
+		description.vertexShader.entryPoint.c_str(), "vs_5_0", compileFlags, 0, &pVertexShader, &pError))) {
+		LOG_F(ERROR, "Failed to compile vertex shader '%s': %s", description.vertexShader.path.c_str(), 
+			pError ? static_cast<const char*>(pError->GetBufferPointer()) : "file not found");
+		return nullptr;
+	}
+	if (FAILED(D3DCompileFromFile(std::filesystem::path(description.fragmentShader.path).c_str(), nullptr, nullptr, 
+		description.fragmentShader.entryPoint.c_str(), "ps_5_0", compileFlags, 0, &pPixelShader, &pError))) {
+		LOG_F(ERROR, "Failed to compile pixel shader '%s': %s", description.fragmentShader.path.c_str(),
+			pError ? static_cast<const char*>(pError->GetBufferPointer()) : "file not found");
+		return nullptr;
+	}
+
+	// VertexLayout::ePositionColor
+	std::array<D3D12_INPUT_ELEMENT_DESC, 2> inputElementDescs = {{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	}};
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+	if (description.vertexLayout != VertexLayout::eNone)
+		psoDesc.InputLayout = { inputElementDescs.data(), static_cast<UINT>(inputElementDescs.size()) };
+	psoDesc.pRootSignature = m_pRootSignature.Get();
+	psoDesc.VS = CD3DX12_SHADER_BYTECODE(pVertexShader.Get());
+	psoDesc.PS = CD3DX12_SHADER_BYTECODE(pPixelShader.Get());
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	switch (description.cullMode) {
+	case CullMode::eNone: psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; break;
+	case CullMode::eFront: psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_FRONT; break;
+	case CullMode::eBack: psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK; break;
+	}
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	if (description.blendMode != BlendMode::eOpaque) {
+		D3D12_RENDER_TARGET_BLEND_DESC& blendDesc = psoDesc.BlendState.RenderTarget[0];
+		blendDesc.BlendEnable = TRUE;
+		blendDesc.SrcBlend = D3D12_BLEND_SRC_ALPHA;
+		blendDesc.DestBlend = description.blendMode == BlendMode::eAlpha ? D3D12_BLEND_INV_SRC_ALPHA : D3D12_BLEND_ONE;
+		blendDesc.BlendOp = D3D12_BLEND_OP_ADD;
+		blendDesc.SrcBlendAlpha = D3D12_BLEND_ONE;
+		blendDesc.DestBlendAlpha = D3D12_BLEND_INV_SRC_ALPHA;
+		blendDesc.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+	}
+	psoDesc.DepthStencilState.DepthEnable = description.depthTest ? TRUE : FALSE;
+	psoDesc.DepthStencilState.DepthWriteMask = description.depthWrite ? D3D12_DEPTH_WRITE_MASK_ALL : D3D12_DEPTH_WRITE_MASK_ZERO;
+	psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
+	psoDesc.DepthStencilState.StencilEnable = FALSE;
+	psoDesc.SampleMask = UINT_MAX;
+	switch (description.topology) {
+	case PrimitiveTopology::eTriangleList:
+	case PrimitiveTopology::eTriangleStrip: psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE; break;
+	case PrimitiveTopology::eLineList: psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE; break;
+	case PrimitiveTopology::ePointList: psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT; break;
+	}
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	psoDesc.SampleDesc.Count = 1;
+
+	ComPtr<ID3D12PipelineState> pPipelineState;
+	if (FAILED(m_pDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pPipelineState))))
+		return nullptr;
+	return pPipelineState;
+}
+
 const ComPtr<ID3D12Device>& DriverDX12::getDevice() const {
     return m_pDevice;
 }
@@ -323,3 +411,11 @@ const ComPtr<ID3D12CommandAllocator>& DriverDX12::getBundledAllocator() const {
 const ComPtr<ID3D12RootSignature>& DriverDX12::getRootSignature() const {
 	return m_pRootSignature;
 }
+
+BindlessDX12* DriverDX12::getBindless() const {
+	return m_pBindless.get();
+}
+
+PipelineStateCacheDX12* DriverDX12::getPipelineStates() const {
+	return m_pPipelineStates.get();
+}
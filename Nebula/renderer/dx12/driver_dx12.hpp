@@ -36,21 +36,26 @@ SOFTWARE.
 using Microsoft::WRL::ComPtr;
 
 #include "renderer/driver.hpp"
+#include "renderer/pipeline_state_cache.hpp"
 #include "thirdparty/glm/glm.hpp"
 
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 #include "renderer/renderable.hpp"
+#include "bindless_dx12.hpp"
 
 struct VERTEX {
 	DirectX::XMFLOAT3 position;
 	DirectX::XMFLOAT4 color;
 };
 
+using PipelineStateDX12 = PipelineState<ComPtr<ID3D12PipelineState>>;
+using PipelineStateCacheDX12 = PipelineStateCache<ComPtr<ID3D12PipelineState>>;
+
 class RenderableDX12;
 class DriverDX12 : public Driver {
 public:
-    DriverDX12(const SDL_Window* pWindow);
+    DriverDX12(const SDL_Window* pWindow, const Config& config);
 	~DriverDX12();
 
     // Inherited via IDriver
@@ -65,7 +70,18 @@ public:
 	const ComPtr<ID3D12GraphicsCommandList>& getCommandList() const;
 	const ComPtr<ID3D12CommandAllocator>& getBundledAllocator() const;
 	const ComPtr<ID3D12RootSignature>& getRootSignature() const;
+	BindlessDX12* getBindless() const;
+	/// Pipelines shared between renderables, compiled on the threadpool.
+	PipelineStateCacheDX12* getPipelineStates() const;
 private:
+	/// Adds the CPU work of a frame to the driver's task graph, executed by prepareFrame.
+	bool createFrameTasks();
+	/// Records the command list of the current frame. Runs as a frame task.
+	void recordFrame();
+	/// Compiles the shaders of a description and creates its pipeline state. Called on
+	/// threadpool workers by the pipeline state cache.
+	ComPtr<ID3D12PipelineState> createPipeline(const PipelineDescription& description);
+
 #ifdef _DEBUG
 	ComPtr<ID3D12Debug1> m_pDebug;
 #endif
@@ -79,6 +95,7 @@ private:
 	std::vector<UINT64> m_FenceValues;
 	ComPtr<ID3D12CommandAllocator> m_pBundleAllocator;
 	ComPtr<ID3D12RootSignature> m_pRootSignature;
+	std::unique_ptr<BindlessDX12> m_pBindless;
 	ComPtr<ID3D12DescriptorHeap> m_pRenderTargetHeap;
 	ComPtr<ID3D12DescriptorHeap> m_pDepthStencilHeap;
 	D3D12_VIEWPORT m_Viewport;
@@ -92,9 +109,9 @@ private:
 	UINT m_RenderTargetCount;
 	glm::vec4 m_ClearColor;
 
-	ComPtr<ID3D12PipelineState> m_pPipelineState;
-	ComPtr<ID3DBlob> m_pVertexShader;
-	ComPtr<ID3DBlob> m_pPixelShader;
+	std::unique_ptr<PipelineManifest> m_pPipelineManifest;
+	std::unique_ptr<PipelineStateCacheDX12> m_pPipelineStates;
+	std::shared_ptr<const PipelineStateDX12> m_pPipelineState;
 	ComPtr<ID3D12Resource> m_pVertexBuffer;
 	D3D12_VERTEX_BUFFER_VIEW m_VertexBufferView;
 	float aspectRatio;
@@ -1,6 +1,9 @@
 #include "helper_dx12.hpp"
 
+#include <array>
+
 #include "thirdparty/d3dx12/d3dx12.h"
+#include "bindless_dx12.hpp"
 
 std::optional<ComPtr<IDXGISwapChain1>> HelperDX12::createSwapchain(IDXGIFactory5* pFactory, ID3D12CommandQueue* pCommandQueue, 
 	HWND hWnd, UINT renderTargets, BOOL windowed, IDXGIOutput* pOutput, DXGI_MODE_DESC mode) {
@@ -25,9 +28,22 @@ std::optional<ComPtr<IDXGISwapChain1>> HelperDX12::createSwapchain(IDXGIFactory5
 	return pSwapchain;
 }
 
-std::optional<ComPtr<ID3D12RootSignature>> HelperDX12::createRootSignature(ID3D12Device* pDevice) {
+std::optional<ComPtr<ID3D12RootSignature>> HelperDX12::createRootSignature(ID3D12Device* pDevice, UINT textureCount, UINT bufferCount,
+	UINT samplerCount) {
+	// Register spaces keep the two SRV tables apart, matching shaders/bindless.hlsli.
+	CD3DX12_DESCRIPTOR_RANGE textureRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, textureCount, 0, 0);
+	CD3DX12_DESCRIPTOR_RANGE bufferRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, bufferCount, 0, 1);
+	CD3DX12_DESCRIPTOR_RANGE samplerRange(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, samplerCount, 0, 0);
+
+	std::array<CD3DX12_ROOT_PARAMETER, 4> rootParameters;
+	rootParameters[static_cast<size_t>(RootParameterDX12::eDrawConstants)].InitAsConstants(sizeof(DrawConstants) / 4, 0);
+	rootParameters[static_cast<size_t>(RootParameterDX12::eTextures)].InitAsDescriptorTable(1, &textureRange);
+	rootParameters[static_cast<size_t>(RootParameterDX12::eBuffers)].InitAsDescriptorTable(1, &bufferRange);
+	rootParameters[static_cast<size_t>(RootParameterDX12::eSamplers)].InitAsDescriptorTable(1, &samplerRange);
+
 	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
-	rootSignatureDesc.Init(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	rootSignatureDesc.Init(static_cast<UINT>(rootParameters.size()), rootParameters.data(), 0, nullptr, 
+		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
 	ComPtr<ID3DBlob> pSignature;
 	ComPtr<ID3DBlob> pError;
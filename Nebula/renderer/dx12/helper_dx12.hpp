@@ -13,5 +13,8 @@ struct HelperDX12 {
 public:
 	static std::optional<ComPtr<IDXGISwapChain1>> createSwapchain(IDXGIFactory5* pFactory, ID3D12CommandQueue* pCommandQueue,
 		HWND hWnd, UINT renderTargets, BOOL windowed = true, IDXGIOutput* pOutput = nullptr, DXGI_MODE_DESC mode = {});
-	static std::optional<ComPtr<ID3D12RootSignature>> createRootSignature(ID3D12Device* pDevice);
+	/// Creates the root signature shared by every pipeline: the draw constants followed by the
+	/// bindless texture, buffer and sampler tables, see RootParameterDX12.
+	static std::optional<ComPtr<ID3D12RootSignature>> createRootSignature(ID3D12Device* pDevice, UINT textureCount, UINT bufferCount,
+		UINT samplerCount);
 };
\ No newline at end of file
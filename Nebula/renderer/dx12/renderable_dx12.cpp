@@ -35,61 +35,35 @@ RenderableDX12::~RenderableDX12() {
 }
 
 bool RenderableDX12::build() {
-	if (m_pBundle) {
-		if (FAILED(m_pBundle->Reset(m_pDriver->getBundledAllocator().Get(), nullptr)))
-			return false;
-	}
+	// Renderables with the same state share a pipeline, which may still be compiling.
+	m_pPipelineState = m_pDriver->getPipelineStates()->acquire(m_PipelineDescription);
+	m_pBundle.Reset();
+	return !m_pPipelineState->isFailed();
+}
 
-	// Define the vertex input layout.
-	std::vector<D3D12_INPUT_ELEMENT_DESC> inputElementDescs = {
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-	};
-
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-	psoDesc.InputLayout = { inputElementDescs.data(), inputElementDescs.size() };
-	psoDesc.pRootSignature = m_pDriver->getRootSignature().Get();
-	psoDesc.VS = CD3DX12_SHADER_BYTECODE(m_pVertexShader.Get());
-	psoDesc.PS = CD3DX12_SHADER_BYTECODE(m_pPixelShader.Get());
-	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-	psoDesc.DepthStencilState.DepthEnable = FALSE;
-	psoDesc.DepthStencilState.StencilEnable = FALSE;
-	psoDesc.SampleMask = UINT_MAX;
-	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-	psoDesc.NumRenderTargets = 1;
-	psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-	psoDesc.SampleDesc.Count = 1;
-
-	// Create pipeline state.
-	if (FAILED(m_pDriver->getDevice()->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pPipelineState))))
-		return false;
-	
+bool RenderableDX12::recordBundle() {
 	// Create bundle with pipeline state.
 	if (FAILED(m_pDriver->getDevice()->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_BUNDLE,
-		m_pDriver->getBundledAllocator().Get(), m_pPipelineState.Get(), IID_PPV_ARGS(&m_pBundle))))
+		m_pDriver->getBundledAllocator().Get(), m_pPipelineState->get().Get(), IID_PPV_ARGS(&m_pBundle))))
 		return false;
 
-	// Set bundle state and draw.
-	//m_pBundle->SetGraphicsRootSignature(m_pDriver->getRootSignature().Get());
+	// Set bundle state and draw. The bindless tables are inherited from the calling command list.
+	m_pBundle->SetGraphicsRootSignature(m_pDriver->getRootSignature().Get());
+	m_pBundle->SetGraphicsRoot32BitConstants(static_cast<UINT>(RootParameterDX12::eDrawConstants), sizeof(DrawConstants) / 4,
+		&m_DrawConstants, 0);
 	m_pBundle->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	m_pBundle->IASetVertexBuffers(0, 1, &m_VertexBufferView);
 	m_pBundle->DrawInstanced(3, 1, 0, 0);
 	
-	if (FAILED(m_pBundle->Close()))
+	if (FAILED(m_pBundle->Close())) {
+		m_pBundle.Reset();
 		return false;
+	}
 	return true;
 }
 
 bool RenderableDX12::attachShader(const char* pFilename, ShaderStage stage) {
-	ComPtr<ID3DBlob> pError;
-	auto path = L"C:\\Users\\Ben\\Ivy3\\Engine\\shaders\\shaders.hlsl";
-	if (FAILED(D3DCompileFromFile(path, nullptr, nullptr, "VSMain", "vs_5_0",
-		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &m_pVertexShader, &pError)))
-		return false;
-	if (FAILED(D3DCompileFromFile(path, nullptr, nullptr, "PSMain", "ps_5_0",
-		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, 0, &m_pPixelShader, &pError)))
-		return false;
+	m_PipelineDescription.setShader(pFilename, stage);
 	return true;
 }
 
@@ -119,10 +93,22 @@ bool RenderableDX12::setVertices(std::vector<Vertex> vertices) {
     return true;
 }
 
-const ComPtr<ID3D12GraphicsCommandList>& RenderableDX12::getBundle() const {
+void RenderableDX12::setDrawPass(DrawPass pass) {
+	m_PipelineDescription.drawPass = pass;
+}
+
+void RenderableDX12::setDrawConstants(const DrawConstants& constants) {
+	// The constants are baked into the bundle, so it is recorded again.
+	m_DrawConstants = constants;
+	m_pBundle.Reset();
+}
+
+const ComPtr<ID3D12GraphicsCommandList>& RenderableDX12::getBundle() {
+	if (!m_pBundle && m_pPipelineState && m_pPipelineState->isReady())
+		recordBundle();
 	return m_pBundle;
 }
 
-const ComPtr<ID3D12PipelineState>& RenderableDX12::getPipelineState() const {
+const std::shared_ptr<const PipelineState<ComPtr<ID3D12PipelineState>>>& RenderableDX12::getPipelineState() const {
 	return m_pPipelineState;
 }
@@ -24,6 +24,7 @@ SOFTWARE.
 
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <d3d12.h>
 #include <d3dcompiler.h>
@@ -32,6 +33,8 @@ SOFTWARE.
 #include <wrl/client.h>
 using Microsoft::WRL::ComPtr;
 
+#include "renderer/pipeline_description.hpp"
+#include "renderer/pipeline_state_cache.hpp"
 #include "renderer/renderable.hpp"
 
 class DriverDX12;
@@ -43,14 +46,20 @@ public:
     bool attachShader(const char* pFilename, ShaderStage stage) override;
     bool setIndices(std::vector<uint16_t> indices) override;
     bool setVertices(std::vector<Vertex> vertices) override;
-	const ComPtr<ID3D12GraphicsCommandList>& getBundle() const;
-	const ComPtr<ID3D12PipelineState>& getPipelineState() const;
+	void setDrawConstants(const DrawConstants& constants) override;
+	void setDrawPass(DrawPass pass) override;
+	/// Returns the bundle drawing this renderable, recording it the first time it is requested
+	/// after the pipeline has finished compiling. Empty until then.
+	const ComPtr<ID3D12GraphicsCommandList>& getBundle();
+	const std::shared_ptr<const PipelineState<ComPtr<ID3D12PipelineState>>>& getPipelineState() const;
 private:
+	bool recordBundle();
+
     DriverDX12* m_pDriver;
 	ComPtr<ID3D12GraphicsCommandList> m_pBundle;
-	ComPtr<ID3D12PipelineState> m_pPipelineState;
-	ComPtr<ID3DBlob> m_pVertexShader;
-	ComPtr<ID3DBlob> m_pPixelShader; 
+	PipelineDescription m_PipelineDescription;
+	std::shared_ptr<const PipelineState<ComPtr<ID3D12PipelineState>>> m_pPipelineState;
 	ComPtr<ID3D12Resource> m_pVertexBuffer;
 	D3D12_VERTEX_BUFFER_VIEW m_VertexBufferView;
+	DrawConstants m_DrawConstants;
 };
\ No newline at end of file
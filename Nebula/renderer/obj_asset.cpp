@@ -1,21 +1,99 @@
 #include "obj_asset.hpp"
+#include "driver.hpp"
+
+#include <filesystem>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
 
 #include "thirdparty/loguru/loguru.hpp"
 #include "thirdparty/tinyobjloader/tiny_obj_loader.h"
 
+namespace {
+	/// Decodes an OBJ file already in memory into one vertex per distinct position and material.
+	bool decode(const std::vector<char>& data, const std::string& filename, std::vector<Vertex>& vertices, 
+		std::vector<uint16_t>& indices) {
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string error;
+		// Material libraries are named relative to the file.
+		std::string directory = std::filesystem::path(filename).parent_path().generic_string();
+		tinyobj::MaterialFileReader materialReader(directory.empty() ? directory : directory + "/");
+		std::istringstream stream(std::string(data.begin(), data.end()));
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &error, &stream, &materialReader)) {
+			LOG_F(ERROR, "%s - %s", filename.c_str(), error.c_str());
+			return false;
+		}
+		if (!error.empty())
+			LOG_F(WARNING, "%s - %s", filename.c_str(), error.c_str());
+
+		std::unordered_map<uint64_t, uint16_t> remap;
+		for (const tinyobj::shape_t& shape : shapes) {
+			// Faces are triangulated while loading.
+			for (size_t i = 0; i < shape.mesh.indices.size(); i++) {
+				int position = shape.mesh.indices[i].vertex_index;
+				int material = shape.mesh.material_ids.empty() ? -1 : shape.mesh.material_ids[i / 3];
+				uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(material)) << 32) | static_cast<uint32_t>(position);
+				auto [it, inserted] = remap.try_emplace(key, static_cast<uint16_t>(vertices.size()));
+				if (inserted) {
+					if (vertices.size() > std::numeric_limits<uint16_t>::max()) {
+						LOG_F(ERROR, "%s has more vertices than 16 bit indices can address.", filename.c_str());
+						return false;
+					}
+					Vertex vertex;
+					vertex.position = glm::fvec3(attrib.vertices[3 * position], attrib.vertices[3 * position + 1], 
+						attrib.vertices[3 * position + 2]);
+					vertex.color = glm::fvec4(1.0f);
+					if (attrib.colors.size() == attrib.vertices.size())
+						vertex.color = glm::fvec4(attrib.colors[3 * position], attrib.colors[3 * position + 1], 
+							attrib.colors[3 * position + 2], 1.0f);
+					if (material >= 0 && material < static_cast<int>(materials.size()))
+						vertex.color *= glm::fvec4(materials[material].diffuse[0], materials[material].diffuse[1], 
+							materials[material].diffuse[2], 1.0f);
+					vertices.push_back(vertex);
+				}
+				indices.push_back(it->second);
+			}
+		}
+		return !indices.empty();
+	}
+}
+
 ObjAsset::ObjAsset(Driver* pDriver) : Asset(pDriver) {}
 
 bool ObjAsset::load(const char* pFilename) {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string error;
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &error, pFilename))
+	ThreadPool* pPool = getDriver()->getThreadPool();
+	return syncWait(pPool, loadAsync(pPool, pFilename)) && upload();
+}
+
+AsyncTask<bool> ObjAsset::loadAsync(ThreadPool* pPool, std::string filename) {
+	// The read finishes on a background worker, decoding continues there.
+	std::optional<std::vector<char>> data = co_await readFileAsync(pPool, filename);
+	if (!data) {
+		LOG_F(ERROR, "Failed to read %s.", filename.c_str());
+		co_return false;
+	}
+	m_Vertices.clear();
+	m_Indices.clear();
+	co_return decode(*data, filename, m_Vertices, m_Indices);
+}
+
+bool ObjAsset::upload() {
+	m_pRenderable = getDriver()->createRenderable();
+	if (!m_pRenderable) {
+		LOG_F(ERROR, "The driver cannot draw meshes.");
 		return false;
-	if(!error.empty())
-		LOG_F(WARNING, "%s - %s", pFilename, error.c_str());
-	for (size_t s = 0; s < attrib.vertices.size() / 3; s++) {
-		
 	}
-	return true;
+	bool built = m_pRenderable->setVertices(std::move(m_Vertices)) && m_pRenderable->setIndices(std::move(m_Indices)) && 
+		m_pRenderable->build();
+	m_Vertices.clear();
+	m_Indices.clear();
+	if (!built)
+		m_pRenderable.reset();
+	return built;
 }
+
+Renderable* ObjAsset::getRenderable() const {
+	return m_pRenderable.get();
+}
\ No newline at end of file
@@ -1,9 +1,29 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "asset.hpp"
+#include "renderable.hpp"
 
+/// Wavefront OBJ mesh. Faces are colored with the diffuse color of their material, multiplied by
+/// any vertex colors of the file.
 class ObjAsset : public Asset {
 public:
 	ObjAsset(Driver* pDriver);
+	/// Runs loadAsync on the driver threadpool and uploads the mesh once it completes. Must be
+	/// called from the thread recording frames.
 	virtual bool load(const char* pFilename) override;
+	/// Reads the file and decodes it on the background lane of pPool, keeping the mesh until upload
+	/// is called. Nothing touches the GPU, so any number of assets may load at once.
+	virtual AsyncTask<bool> loadAsync(ThreadPool* pPool, std::string filename) override;
+	/// Builds a renderable from the mesh decoded by loadAsync. Must be called from the thread 
+	/// recording frames.
+	bool upload();
+	/// Empty until upload succeeds.
+	Renderable* getRenderable() const;
+private:
+	std::vector<Vertex> m_Vertices;
+	std::vector<uint16_t> m_Indices;
+	std::unique_ptr<Renderable> m_pRenderable;
 };
\ No newline at end of file
@@ -0,0 +1,76 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "pipeline_description.hpp"
+
+namespace {
+	constexpr uint64_t kFnvOffset = 14695981039346656037ull;
+	constexpr uint64_t kFnvPrime = 1099511628211ull;
+
+	void hashBytes(uint64_t& hash, const void* pData, size_t size) {
+		const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+		for (size_t i = 0; i < size; i++) {
+			hash ^= pBytes[i];
+			hash *= kFnvPrime;
+		}
+	}
+
+	/// Values are hashed a byte at a time from the least significant end so the result does
+	/// not depend on the endianness of the machine.
+	void hashValue(uint64_t& hash, uint32_t value) {
+		for (uint32_t i = 0; i < 4; i++) {
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= kFnvPrime;
+		}
+	}
+
+	/// Strings are prefixed with their length so that adjacent fields cannot run into each other.
+	void hashString(uint64_t& hash, const std::string& string) {
+		hashValue(hash, static_cast<uint32_t>(string.size()));
+		hashBytes(hash, string.data(), string.size());
+	}
+}
+
+void PipelineDescription::setShader(const char* pPath, ShaderStage stage) {
+	if (stage == ShaderStage::Vertex)
+		vertexShader = { pPath, "VSMain" };
+	else
+		fragmentShader = { pPath, "PSMain" };
+}
+
+uint64_t PipelineDescription::hash() const {
+	uint64_t hash = kFnvOffset;
+	hashString(hash, vertexShader.path);
+	hashString(hash, vertexShader.entryPoint);
+	hashString(hash, fragmentShader.path);
+	hashString(hash, fragmentShader.entryPoint);
+	hashValue(hash, static_cast<uint32_t>(vertexLayout));
+	hashValue(hash, static_cast<uint32_t>(topology));
+	hashValue(hash, static_cast<uint32_t>(cullMode));
+	hashValue(hash, static_cast<uint32_t>(blendMode));
+	hashValue(hash, depthTest ? 1 : 0);
+	hashValue(hash, depthWrite ? 1 : 0);
+	hashValue(hash, static_cast<uint32_t>(drawPass));
+	return hash;
+}
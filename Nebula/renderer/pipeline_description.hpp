@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "renderable.hpp"
+
+enum class PrimitiveTopology {
+	eTriangleList,
+	eTriangleStrip,
+	eLineList,
+	ePointList,
+};
+
+enum class CullMode {
+	eNone,
+	eFront,
+	eBack,
+};
+
+enum class BlendMode {
+	eOpaque,
+	eAlpha,
+	eAdditive,
+};
+
+/// Layout of the vertex buffer a pipeline reads from.
+enum class VertexLayout {
+	/// Vertex from renderable.hpp.
+	ePositionColor,
+	/// No vertex buffer, vertices are generated from their index in the shader.
+	eNone,
+};
+
+/// A single shader of a pipeline. The path names the HLSL source on DirectX 12 and the
+/// compiled SPIR-V on Vulkan.
+struct ShaderDescription {
+	std::string path;
+	std::string entryPoint;
+
+	bool operator==(const ShaderDescription& other) const = default;
+};
+
+/// Backend independent description of everything which goes into a graphics pipeline.
+/// Renderables with equal descriptions share the same pipeline object.
+struct PipelineDescription {
+	ShaderDescription vertexShader;
+	ShaderDescription fragmentShader;
+	VertexLayout vertexLayout = VertexLayout::ePositionColor;
+	PrimitiveTopology topology = PrimitiveTopology::eTriangleList;
+	CullMode cullMode = CullMode::eNone;
+	BlendMode blendMode = BlendMode::eOpaque;
+	bool depthTest = false;
+	bool depthWrite = false;
+	DrawPass drawPass = DrawPass::eForward;
+
+	/// Sets the shader used for stage, using the default entry point for that stage.
+	void setShader(const char* pPath, ShaderStage stage);
+
+	/// Hashes every field by value. The result does not depend on the process, compiler or
+	/// platform, so it is safe to store on disk.
+	uint64_t hash() const;
+
+	bool operator==(const PipelineDescription& other) const = default;
+};
+
+struct PipelineDescriptionHash {
+	size_t operator()(const PipelineDescription& description) const {
+		return static_cast<size_t>(description.hash());
+	}
+};
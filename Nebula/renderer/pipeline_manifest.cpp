@@ -0,0 +1,163 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "pipeline_manifest.hpp"
+
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+namespace {
+	constexpr const char* kManifestHeader = "nebula-pipelines 2";
+	constexpr size_t kFieldCount = 12;
+
+	std::vector<std::string_view> split(std::string_view line, char separator) {
+		std::vector<std::string_view> fields;
+		size_t begin = 0;
+		for (size_t end = line.find(separator); end != std::string_view::npos; end = line.find(separator, begin)) {
+			fields.push_back(line.substr(begin, end - begin));
+			begin = end + 1;
+		}
+		fields.push_back(line.substr(begin));
+		return fields;
+	}
+
+	bool parse(std::string_view field, uint64_t& value, int base = 10) {
+		auto result = std::from_chars(field.data(), field.data() + field.size(), value, base);
+		return result.ec == std::errc() && result.ptr == field.data() + field.size();
+	}
+
+	/// Reads an enumeration, rejecting values past its last enumerator.
+	template<typename Enum>
+	bool parseEnum(std::string_view field, Enum last, Enum& value) {
+		uint64_t raw;
+		if (!parse(field, raw) || raw > static_cast<uint64_t>(last))
+			return false;
+		value = static_cast<Enum>(raw);
+		return true;
+	}
+
+	bool parseBool(std::string_view field, bool& value) {
+		uint64_t raw;
+		if (!parse(field, raw) || raw > 1)
+			return false;
+		value = raw == 1;
+		return true;
+	}
+}
+
+PipelineManifest::PipelineManifest(std::string filename) : m_Filename(std::move(filename)) {}
+
+std::vector<PipelineDescription> PipelineManifest::load() const {
+	std::vector<PipelineDescription> descriptions;
+	std::ifstream stream(m_Filename);
+	std::string line;
+	if (!stream || !std::getline(stream, line))
+		return descriptions;
+	if (line != kManifestHeader) {
+		LOG_F(WARNING, "Ignoring pipeline manifest %s with an unknown header.", m_Filename.c_str());
+		return descriptions;
+	}
+
+	size_t lineNumber = 1;
+	while (std::getline(stream, line)) {
+		lineNumber++;
+		if (line.empty())
+			continue;
+
+		// The trailing hash catches descriptions whose layout changed since they were written.
+		std::vector<std::string_view> fields = split(line, '\t');
+		PipelineDescription description;
+		uint64_t hash;
+		if (fields.size() != kFieldCount ||
+			!parseEnum(fields[4], VertexLayout::eNone, description.vertexLayout) ||
+			!parseEnum(fields[5], PrimitiveTopology::ePointList, description.topology) ||
+			!parseEnum(fields[6], CullMode::eBack, description.cullMode) ||
+			!parseEnum(fields[7], BlendMode::eAdditive, description.blendMode) ||
+			!parseBool(fields[8], description.depthTest) ||
+			!parseBool(fields[9], description.depthWrite) ||
+			!parseEnum(fields[10], DrawPass::eLighting, description.drawPass) ||
+			!parse(fields[11], hash, 16)) {
+			LOG_F(WARNING, "Skipping malformed line %zu of pipeline manifest %s.", lineNumber, m_Filename.c_str());
+			continue;
+		}
+		description.vertexShader = { std::string(fields[0]), std::string(fields[1]) };
+		description.fragmentShader = { std::string(fields[2]), std::string(fields[3]) };
+		if (description.hash() != hash) {
+			LOG_F(WARNING, "Skipping stale line %zu of pipeline manifest %s.", lineNumber, m_Filename.c_str());
+			continue;
+		}
+		descriptions.push_back(std::move(description));
+	}
+	return descriptions;
+}
+
+void PipelineManifest::record(const PipelineDescription& description) {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_Recorded.insert(description).second)
+		m_Descriptions.push_back(description);
+}
+
+bool PipelineManifest::save() const {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	std::string temporary = m_Filename + ".tmp";
+	{
+		std::ofstream stream(temporary, std::ios::trunc);
+		stream << kManifestHeader << '\n';
+		for (const PipelineDescription& description : m_Descriptions) {
+			stream << description.vertexShader.path << '\t' << description.vertexShader.entryPoint << '\t' 
+				<< description.fragmentShader.path << '\t' << description.fragmentShader.entryPoint << '\t'
+				<< static_cast<uint32_t>(description.vertexLayout) << '\t' << static_cast<uint32_t>(description.topology) << '\t'
+				<< static_cast<uint32_t>(description.cullMode) << '\t' << static_cast<uint32_t>(description.blendMode) << '\t'
+				<< (description.depthTest ? 1 : 0) << '\t' << (description.depthWrite ? 1 : 0) << '\t'
+				<< static_cast<uint32_t>(description.drawPass) << '\t'
+				<< std::hex << description.hash() << std::dec << '\n';
+		}
+		if (!stream) {
+			LOG_F(WARNING, "Failed to write pipeline manifest to %s.", temporary.c_str());
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, m_Filename, error);
+	if (error) {
+		LOG_F(WARNING, "Failed to replace %s: %s", m_Filename.c_str(), error.message().c_str());
+		return false;
+	}
+	LOG_F(INFO, "Recorded %zu pipelines to %s.", m_Descriptions.size(), m_Filename.c_str());
+	return true;
+}
+
+size_t PipelineManifest::getCount() const {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Descriptions.size();
+}
+
+const std::string& PipelineManifest::getFilename() const {
+	return m_Filename;
+}
@@ -0,0 +1,60 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "pipeline_description.hpp"
+
+/// Records the pipeline descriptions used during a session so that the next session can 
+/// compile all of them while loading, rather than the first time each one is drawn. The 
+/// manifest is a text file with one tab separated description per line.
+class PipelineManifest {
+public:
+	explicit PipelineManifest(std::string filename);
+
+	/// Reads the descriptions recorded by a previous session. Lines which cannot be parsed
+	/// are skipped, and a missing manifest yields no descriptions.
+	std::vector<PipelineDescription> load() const;
+
+	/// Adds a description to the manifest unless it is already present. Safe to call from 
+	/// multiple threads.
+	void record(const PipelineDescription& description);
+
+	/// Writes every recorded description, replacing the previous manifest only once the new
+	/// one is complete.
+	bool save() const;
+
+	size_t getCount() const;
+	const std::string& getFilename() const;
+private:
+	std::string m_Filename;
+	mutable std::mutex m_Mutex;
+	std::vector<PipelineDescription> m_Descriptions;
+	std::unordered_set<PipelineDescription, PipelineDescriptionHash> m_Recorded;
+};
@@ -0,0 +1,225 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "pipeline_description.hpp"
+#include "pipeline_manifest.hpp"
+#include "thirdparty/loguru/loguru.hpp"
+#include "util/thread_pool.hpp"
+#include "util/wait_group.hpp"
+
+template<typename Pipeline>
+class PipelineStateCache;
+
+/// Pipeline shared by every renderable with the same description. It is compiled on the 
+/// threadpool, so it must not be used until isReady returns true.
+template<typename Pipeline>
+class PipelineState {
+public:
+	explicit PipelineState(PipelineDescription description) : m_Description(std::move(description)), 
+		m_Status(Status::ePending) {}
+
+	const PipelineDescription& getDescription() const {
+		return m_Description;
+	}
+
+	bool isReady() const {
+		return m_Status.load(std::memory_order_acquire) == Status::eReady;
+	}
+
+	/// Returns true when compilation failed. Failed pipelines are never retried.
+	bool isFailed() const {
+		return m_Status.load(std::memory_order_acquire) == Status::eFailed;
+	}
+
+	/// Only valid once isReady returns true.
+	const Pipeline& get() const {
+		return m_Pipeline;
+	}
+private:
+	friend class PipelineStateCache<Pipeline>;
+
+	enum class Status : uint32_t {
+		ePending,
+		eReady,
+		eFailed,
+	};
+
+	PipelineDescription m_Description;
+	Pipeline m_Pipeline;
+	std::atomic<Status> m_Status;
+};
+
+/// Deduplicates pipelines across renderables by their description. The first request for a
+/// description queues its compilation on the threadpool and returns straight away, later
+/// requests share the same state. Pipelines live for as long as the cache.
+///
+/// The compiler is called from worker threads and must return an empty pipeline on failure.
+template<typename Pipeline>
+class PipelineStateCache {
+public:
+	using Compiler = std::function<Pipeline(const PipelineDescription&)>;
+	using StatePointer = std::shared_ptr<const PipelineState<Pipeline>>;
+	/// Receives the number of finished compilations and the total during a warm-up.
+	using Progress = std::function<void(size_t, size_t)>;
+
+	PipelineStateCache(ThreadPool* pPool, Compiler compiler) : m_pPool(pPool), m_Compiler(std::move(compiler)),
+		m_pManifest(nullptr), m_CompiledCount(0), m_FailedCount(0) {}
+
+	/// Compilations still running reference the cache.
+	~PipelineStateCache() {
+		wait();
+	}
+
+	PipelineStateCache(const PipelineStateCache&) = delete;
+	PipelineStateCache& operator=(const PipelineStateCache&) = delete;
+
+	/// Returns the shared pipeline state for the description. Never blocks on compilation,
+	/// which happens on the given lane of the threadpool. Safe to call from any thread.
+	StatePointer acquire(const PipelineDescription& description, TaskPriority priority = TaskPriority::eBackground) {
+		{
+			std::shared_lock<std::shared_mutex> lock(m_Mutex);
+			if (auto it = m_States.find(description); it != m_States.end())
+				return it->second;
+		}
+
+		std::shared_ptr<PipelineState<Pipeline>> pState;
+		{
+			std::unique_lock<std::shared_mutex> lock(m_Mutex);
+			// Another thread may have inserted it while the lock was released.
+			auto [it, inserted] = m_States.try_emplace(description, nullptr);
+			if (!inserted)
+				return it->second;
+			pState = std::make_shared<PipelineState<Pipeline>>(description);
+			it->second = pState;
+		}
+
+		if (m_pManifest)
+			m_pManifest->record(description);
+
+		m_pPool->enqueue([this, pState]() {
+			compile(*pState);
+		}, m_CompileGroup, priority);
+		return pState;
+	}
+
+	/// Compiles every description on the normal lane and blocks until all of them have 
+	/// finished, running compilations on the calling thread as well. Progress is logged at 
+	/// every tenth of the way and reported to the callback whenever it changes.
+	void warmUp(const std::vector<PipelineDescription>& descriptions, const Progress& progress = nullptr) {
+		if (descriptions.empty())
+			return;
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<StatePointer> states;
+		states.reserve(descriptions.size());
+		for (const PipelineDescription& description : descriptions)
+			states.push_back(acquire(description, TaskPriority::eNormal));
+
+		size_t total = states.size();
+		size_t finished = 0;
+		size_t reported = 0;
+		size_t logged = 0;
+		LOG_F(INFO, "Compiling %zu pipelines from previous sessions.", total);
+		while (finished < total) {
+			if (!m_pPool->runPendingTask(TaskPriority::eNormal))
+				std::this_thread::yield();
+
+			// States finish out of order, so count all of them again.
+			finished = 0;
+			for (const StatePointer& pState : states)
+				finished += pState->isReady() || pState->isFailed() ? 1 : 0;
+			if (finished != reported && progress)
+				progress(finished, total);
+			reported = finished;
+			if (finished * 10 / total > logged) {
+				logged = finished * 10 / total;
+				LOG_F(INFO, "Compiled %zu of %zu pipelines.", finished, total);
+			}
+		}
+
+		auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		LOG_F(INFO, "Pipeline warm-up finished in %lldms.", static_cast<long long>(milliseconds));
+	}
+
+	/// Records every description requested from now on into the manifest. Must be set before
+	/// pipelines are acquired from other threads.
+	void setManifest(PipelineManifest* pManifest) {
+		m_pManifest = pManifest;
+	}
+
+	/// Blocks until every queued compilation has finished, helping out on the threadpool.
+	void wait() {
+		m_pPool->wait(m_CompileGroup);
+	}
+
+	/// Returns the number of distinct pipelines requested so far.
+	size_t getCount() const {
+		std::shared_lock<std::shared_mutex> lock(m_Mutex);
+		return m_States.size();
+	}
+
+	/// Returns the number of pipelines which have finished compiling, including failures.
+	size_t getCompiledCount() const {
+		return m_CompiledCount.load(std::memory_order_relaxed);
+	}
+
+	size_t getFailedCount() const {
+		return m_FailedCount.load(std::memory_order_relaxed);
+	}
+private:
+	void compile(PipelineState<Pipeline>& state) {
+		state.m_Pipeline = m_Compiler(state.m_Description);
+		if (state.m_Pipeline)
+			state.m_Status.store(PipelineState<Pipeline>::Status::eReady, std::memory_order_release);
+		else {
+			LOG_F(ERROR, "Failed to compile the pipeline for %s and %s.", state.m_Description.vertexShader.path.c_str(),
+				state.m_Description.fragmentShader.path.c_str());
+			m_FailedCount.fetch_add(1, std::memory_order_relaxed);
+			state.m_Status.store(PipelineState<Pipeline>::Status::eFailed, std::memory_order_release);
+		}
+		m_CompiledCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	ThreadPool* m_pPool;
+	Compiler m_Compiler;
+	mutable std::shared_mutex m_Mutex;
+	std::unordered_map<PipelineDescription, std::shared_ptr<PipelineState<Pipeline>>, PipelineDescriptionHash> m_States;
+	WaitGroup m_CompileGroup;
+	PipelineManifest* m_pManifest;
+	std::atomic<size_t> m_CompiledCount;
+	std::atomic<size_t> m_FailedCount;
+};
@@ -0,0 +1,541 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "render_graph.hpp"
+
+#include <algorithm>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+namespace {
+	/// Whether a use depends on the contents of the texture before the pass.
+	bool readsContents(const RenderGraph::Use& use) {
+		return !RenderGraph::isWriteAccess(use.access) || use.load == RenderLoad::eLoad;
+	}
+
+	double toMegabytes(uint64_t bytes) {
+		return static_cast<double>(bytes) / (1024.0 * 1024.0);
+	}
+}
+
+RenderGraph::ResourceId RenderGraph::createTexture(std::string name, const RenderTextureDescription& description) {
+	Resource resource;
+	resource.name = std::move(name);
+	resource.description = description;
+	m_Resources.push_back(std::move(resource));
+	return static_cast<ResourceId>(m_Resources.size() - 1);
+}
+
+RenderGraph::ResourceId RenderGraph::importTexture(std::string name, const RenderTextureDescription& description,
+	RenderAccess initialAccess, RenderAccess finalAccess) {
+	Resource resource;
+	resource.name = std::move(name);
+	resource.description = description;
+	resource.imported = true;
+	resource.initialAccess = initialAccess;
+	resource.finalAccess = finalAccess;
+	m_Resources.push_back(std::move(resource));
+	return static_cast<ResourceId>(m_Resources.size() - 1);
+}
+
+RenderGraph::PassId RenderGraph::addPass(std::string name) {
+	Pass pass;
+	pass.name = std::move(name);
+	m_Passes.push_back(std::move(pass));
+	return static_cast<PassId>(m_Passes.size() - 1);
+}
+
+void RenderGraph::read(PassId pass, ResourceId resource, RenderAccess access) {
+	m_Passes[pass].uses.push_back({ resource, access, RenderLoad::eLoad });
+}
+
+void RenderGraph::write(PassId pass, ResourceId resource, RenderAccess access, RenderLoad load) {
+	m_Passes[pass].uses.push_back({ resource, access, load });
+}
+
+void RenderGraph::setSideEffects(PassId pass) {
+	m_Passes[pass].sideEffects = true;
+}
+
+bool RenderGraph::compile() {
+	// Transient textures are undefined at the start of every frame, so reading one before it is 
+	// written can only be a mistake in the order passes were declared in.
+	std::vector<bool> written(m_Resources.size(), false);
+	for (const Pass& pass : m_Passes) {
+		for (const Use& use : pass.uses) {
+			if (readsContents(use) && !m_Resources[use.resource].imported && !written[use.resource]) {
+				LOG_F(ERROR, "Render pass '%s' reads '%s' before it has been written.", pass.name.c_str(), 
+					m_Resources[use.resource].name.c_str());
+				return false;
+			}
+		}
+		for (const Use& use : pass.uses) {
+			if (isWriteAccess(use.access))
+				written[use.resource] = true;
+		}
+	}
+
+	for (Pass& pass : m_Passes) {
+		pass.culled = false;
+		pass.group = kInvalid;
+		pass.subpass = 0;
+	}
+	for (Resource& resource : m_Resources) {
+		resource.accesses.clear();
+		resource.firstGroup = kInvalid;
+		resource.lastGroup = kInvalid;
+		resource.lastAccess = RenderAccess::eUndefined;
+		resource.slot = kInvalid;
+		resource.tileLocal = false;
+		resource.size = 0;
+	}
+	m_Groups.clear();
+	m_FinalBarriers.clear();
+	m_Slots.clear();
+	m_Statistics = Statistics();
+
+	cullPasses();
+	groupPasses();
+	planBarriers();
+	return true;
+}
+
+void RenderGraph::cullPasses() {
+	// Walk backwards from the passes producing results, a pass survives when something after it
+	// needs what it writes. Overwriting a texture ends the need for whatever wrote it before.
+	std::vector<bool> needed(m_Resources.size(), false);
+	for (size_t i = m_Passes.size(); i-- > 0;) {
+		Pass& pass = m_Passes[i];
+		bool alive = pass.sideEffects;
+		for (const Use& use : pass.uses) {
+			if (isWriteAccess(use.access) && (m_Resources[use.resource].imported || needed[use.resource]))
+				alive = true;
+		}
+		if (!alive) {
+			pass.culled = true;
+			m_Statistics.culledPassCount++;
+			continue;
+		}
+
+		for (const Use& use : pass.uses) {
+			if (isWriteAccess(use.access) && use.load != RenderLoad::eLoad)
+				needed[use.resource] = false;
+		}
+		for (const Use& use : pass.uses) {
+			if (readsContents(use))
+				needed[use.resource] = true;
+		}
+	}
+
+	for (const Pass& pass : m_Passes) {
+		if (pass.culled)
+			continue;
+		m_Statistics.passCount++;
+		for (const Use& use : pass.uses) {
+			std::vector<RenderAccess>& accesses = m_Resources[use.resource].accesses;
+			if (std::find(accesses.begin(), accesses.end(), use.access) == accesses.end())
+				accesses.push_back(use.access);
+		}
+	}
+}
+
+bool RenderGraph::usesAttachments(const Pass& pass) const {
+	return std::any_of(pass.uses.begin(), pass.uses.end(), [](const Use& use) { return isAttachmentAccess(use.access); });
+}
+
+bool RenderGraph::canMerge(const Group& group, const Pass& pass, const std::vector<RenderAccess>& states) const {
+	if (!group.renderPass || !usesAttachments(pass))
+		return false;
+
+	// Every attachment of a render pass shares its extent.
+	const RenderTextureDescription* pExtent = nullptr;
+	for (PassId member : group.passes) {
+		for (const Use& use : m_Passes[member].uses) {
+			if (isAttachmentAccess(use.access)) {
+				pExtent = &m_Resources[use.resource].description;
+				break;
+			}
+		}
+		if (pExtent)
+			break;
+	}
+
+	for (const Use& use : pass.uses) {
+		const RenderTextureDescription& description = m_Resources[use.resource].description;
+		if (isAttachmentAccess(use.access)) {
+			if (pExtent && (description.width != pExtent->width || description.height != pExtent->height))
+				return false;
+			continue;
+		}
+
+		// Anything else is synchronized by barriers outside the render pass, which can neither
+		// touch the group's own textures nor be placed between subpasses.
+		for (PassId member : group.passes) {
+			for (const Use& memberUse : m_Passes[member].uses) {
+				if (memberUse.resource == use.resource)
+					return false;
+			}
+		}
+		if (states[use.resource] != use.access || isWriteAccess(use.access))
+			return false;
+	}
+	return true;
+}
+
+void RenderGraph::groupPasses() {
+	std::vector<RenderAccess> states(m_Resources.size());
+	for (size_t i = 0; i < m_Resources.size(); i++)
+		states[i] = m_Resources[i].imported ? m_Resources[i].initialAccess : RenderAccess::eUndefined;
+
+	for (size_t i = 0; i < m_Passes.size(); i++) {
+		Pass& pass = m_Passes[i];
+		if (pass.culled)
+			continue;
+
+		if (m_Groups.empty() || !canMerge(m_Groups.back(), pass, states)) {
+			Group group;
+			group.renderPass = usesAttachments(pass);
+			m_Groups.push_back(std::move(group));
+		}
+		Group& group = m_Groups.back();
+		pass.group = static_cast<uint32_t>(m_Groups.size() - 1);
+		pass.subpass = static_cast<uint32_t>(group.passes.size());
+		group.passes.push_back(static_cast<PassId>(i));
+
+		for (const Use& use : pass.uses)
+			states[use.resource] = use.access;
+	}
+
+	for (const Group& group : m_Groups) {
+		if (group.renderPass) {
+			m_Statistics.renderPassCount++;
+			m_Statistics.subpassCount += static_cast<uint32_t>(group.passes.size());
+		}
+	}
+}
+
+void RenderGraph::planBarriers() {
+	std::vector<RenderAccess> states(m_Resources.size());
+	for (size_t i = 0; i < m_Resources.size(); i++)
+		states[i] = m_Resources[i].imported ? m_Resources[i].initialAccess : RenderAccess::eUndefined;
+
+	for (uint32_t groupIndex = 0; groupIndex < m_Groups.size(); groupIndex++) {
+		Group& group = m_Groups[groupIndex];
+		for (PassId passId : group.passes) {
+			for (const Use& use : m_Passes[passId].uses) {
+				Resource& resource = m_Resources[use.resource];
+				RenderAccess& state = states[use.resource];
+				// Contents which are about to be overwritten entirely need no transition from their
+				// previous layout.
+				RenderAccess before = readsContents(use) ? state : RenderAccess::eUndefined;
+
+				if (group.renderPass && isAttachmentAccess(use.access)) {
+					auto it = std::find_if(group.attachments.begin(), group.attachments.end(), 
+						[&](const Attachment& attachment) { return attachment.resource == use.resource; });
+					if (it == group.attachments.end())
+						group.attachments.push_back({ use.resource, before, use.access, use.load, false });
+					else
+						it->finalAccess = use.access;
+				}
+				// Read-only accesses can follow each other without waiting.
+				else if (state != use.access || isWriteAccess(use.access) || state == RenderAccess::eUndefined)
+					group.barriers.push_back({ use.resource, before, use.access });
+
+				state = use.access;
+				if (resource.firstGroup == kInvalid)
+					resource.firstGroup = groupIndex;
+				resource.lastGroup = groupIndex;
+				resource.lastAccess = use.access;
+			}
+		}
+		m_Statistics.barrierCount += static_cast<uint32_t>(group.barriers.size());
+	}
+
+	for (uint32_t groupIndex = 0; groupIndex < m_Groups.size(); groupIndex++) {
+		for (Attachment& attachment : m_Groups[groupIndex].attachments) {
+			Resource& resource = m_Resources[attachment.resource];
+			attachment.store = resource.imported || resource.lastGroup > groupIndex;
+			resource.tileLocal = !attachment.store && std::all_of(resource.accesses.begin(), resource.accesses.end(), 
+				[](RenderAccess access) { return isAttachmentAccess(access); });
+			if (resource.tileLocal)
+				m_Statistics.tileLocalCount++;
+		}
+	}
+
+	// Imported textures end the frame in their final access. When a render pass is the last to
+	// use one it performs the transition itself.
+	for (size_t i = 0; i < m_Resources.size(); i++) {
+		Resource& resource = m_Resources[i];
+		if (!resource.imported || resource.lastGroup == kInvalid || states[i] == resource.finalAccess)
+			continue;
+
+		std::vector<Attachment>& attachments = m_Groups[resource.lastGroup].attachments;
+		auto it = std::find_if(attachments.begin(), attachments.end(), 
+			[&](const Attachment& attachment) { return attachment.resource == i; });
+		if (it != attachments.end())
+			it->finalAccess = resource.finalAccess;
+		else {
+			m_FinalBarriers.push_back({ static_cast<ResourceId>(i), states[i], resource.finalAccess });
+			m_Statistics.barrierCount++;
+		}
+	}
+
+	// Textures are reused by the next frame, so the first use waits for the last one.
+	for (Resource& resource : m_Resources) {
+		if (resource.imported)
+			resource.lastAccess = resource.finalAccess;
+		resource.previousAccess = resource.lastAccess;
+	}
+}
+
+void RenderGraph::alias(const std::function<RenderMemoryRequirements(ResourceId)>& getRequirements) {
+	m_Slots.clear();
+	m_Statistics.transientCount = 0;
+	m_Statistics.unaliasedBytes = 0;
+	m_Statistics.aliasedBytes = 0;
+
+	std::vector<std::pair<ResourceId, RenderMemoryRequirements>> transients;
+	for (size_t i = 0; i < m_Resources.size(); i++) {
+		Resource& resource = m_Resources[i];
+		resource.slot = kInvalid;
+		if (resource.firstGroup == kInvalid)
+			continue;
+
+		RenderMemoryRequirements requirements = getRequirements(static_cast<ResourceId>(i));
+		resource.size = requirements.size;
+		if (!resource.imported) {
+			transients.emplace_back(static_cast<ResourceId>(i), requirements);
+			m_Statistics.transientCount++;
+			m_Statistics.unaliasedBytes += requirements.size;
+		}
+	}
+
+	// Placing the largest textures first means a slot is always large enough for whatever joins it.
+	std::stable_sort(transients.begin(), transients.end(), 
+		[](const auto& a, const auto& b) { return a.second.size > b.second.size; });
+	for (const auto& [id, requirements] : transients) {
+		Resource& resource = m_Resources[id];
+		for (uint32_t i = 0; i < m_Slots.size() && resource.slot == kInvalid; i++) {
+			MemorySlot& slot = m_Slots[i];
+			if ((slot.requirements.typeBits & requirements.typeBits) == 0 || 
+				m_Resources[slot.resources.front()].tileLocal != resource.tileLocal)
+				continue;
+
+			bool overlaps = std::any_of(slot.resources.begin(), slot.resources.end(), [&](ResourceId other) {
+				const Resource& placed = m_Resources[other];
+				return !(placed.lastGroup < resource.firstGroup || resource.lastGroup < placed.firstGroup);
+			});
+			if (overlaps)
+				continue;
+
+			slot.requirements.alignment = std::max(slot.requirements.alignment, requirements.alignment);
+			slot.requirements.typeBits &= requirements.typeBits;
+			slot.resources.push_back(id);
+			resource.slot = i;
+		}
+
+		if (resource.slot == kInvalid) {
+			resource.slot = static_cast<uint32_t>(m_Slots.size());
+			m_Slots.push_back({ requirements, { id } });
+		}
+	}
+
+	// Each texture waits for the one before it in the slot, the first for the last of the previous frame.
+	for (MemorySlot& slot : m_Slots) {
+		std::sort(slot.resources.begin(), slot.resources.end(), [&](ResourceId a, ResourceId b) {
+			return m_Resources[a].firstGroup < m_Resources[b].firstGroup;
+		});
+		for (size_t i = 0; i < slot.resources.size(); i++) {
+			ResourceId previous = slot.resources[i == 0 ? slot.resources.size() - 1 : i - 1];
+			m_Resources[slot.resources[i]].previousAccess = m_Resources[previous].lastAccess;
+		}
+		m_Statistics.aliasedBytes += slot.requirements.size;
+	}
+
+	estimateBandwidth();
+}
+
+void RenderGraph::estimateBandwidth() {
+	m_Statistics.bandwidthBytes = 0;
+	m_Statistics.unmergedBandwidthBytes = 0;
+	for (const Group& group : m_Groups) {
+		for (const Attachment& attachment : group.attachments) {
+			uint64_t size = m_Resources[attachment.resource].size;
+			if (attachment.load == RenderLoad::eLoad && attachment.initialAccess != RenderAccess::eUndefined)
+				m_Statistics.bandwidthBytes += size;
+			if (attachment.store)
+				m_Statistics.bandwidthBytes += size;
+		}
+
+		for (PassId pass : group.passes) {
+			for (const Use& use : m_Passes[pass].uses) {
+				uint64_t size = m_Resources[use.resource].size;
+				bool attachment = group.renderPass && isAttachmentAccess(use.access);
+				if (!attachment) {
+					// Outside a render pass textures are read and written in full.
+					uint64_t bytes = (readsContents(use) ? size : 0) + (isWriteAccess(use.access) ? size : 0);
+					m_Statistics.bandwidthBytes += bytes;
+					m_Statistics.unmergedBandwidthBytes += bytes;
+					continue;
+				}
+
+				// As a render pass of its own, every attachment is loaded unless it is cleared and 
+				// stored whenever it is written.
+				if (readsContents(use))
+					m_Statistics.unmergedBandwidthBytes += size;
+				if (isWriteAccess(use.access))
+					m_Statistics.unmergedBandwidthBytes += size;
+			}
+		}
+	}
+}
+
+const std::vector<RenderGraph::Group>& RenderGraph::getGroups() const {
+	return m_Groups;
+}
+
+const std::vector<RenderGraph::Barrier>& RenderGraph::getFinalBarriers() const {
+	return m_FinalBarriers;
+}
+
+const std::vector<RenderGraph::MemorySlot>& RenderGraph::getMemorySlots() const {
+	return m_Slots;
+}
+
+const std::string& RenderGraph::getPassName(PassId pass) const {
+	return m_Passes[pass].name;
+}
+
+const std::vector<RenderGraph::Use>& RenderGraph::getPassUses(PassId pass) const {
+	return m_Passes[pass].uses;
+}
+
+bool RenderGraph::isPassCulled(PassId pass) const {
+	return m_Passes[pass].culled;
+}
+
+uint32_t RenderGraph::getPassGroup(PassId pass) const {
+	return m_Passes[pass].group;
+}
+
+uint32_t RenderGraph::getPassSubpass(PassId pass) const {
+	return m_Passes[pass].subpass;
+}
+
+uint32_t RenderGraph::getPassCount() const {
+	return static_cast<uint32_t>(m_Passes.size());
+}
+
+const std::string& RenderGraph::getResourceName(ResourceId resource) const {
+	return m_Resources[resource].name;
+}
+
+const RenderTextureDescription& RenderGraph::getResourceDescription(ResourceId resource) const {
+	return m_Resources[resource].description;
+}
+
+bool RenderGraph::isResourceImported(ResourceId resource) const {
+	return m_Resources[resource].imported;
+}
+
+bool RenderGraph::isResourceUsed(ResourceId resource) const {
+	return m_Resources[resource].firstGroup != kInvalid;
+}
+
+bool RenderGraph::isResourceTileLocal(ResourceId resource) const {
+	return m_Resources[resource].tileLocal;
+}
+
+uint32_t RenderGraph::getResourceSlot(ResourceId resource) const {
+	return m_Resources[resource].slot;
+}
+
+uint32_t RenderGraph::getResourceFirstGroup(ResourceId resource) const {
+	return m_Resources[resource].firstGroup;
+}
+
+uint32_t RenderGraph::getResourceLastGroup(ResourceId resource) const {
+	return m_Resources[resource].lastGroup;
+}
+
+const std::vector<RenderAccess>& RenderGraph::getResourceAccesses(ResourceId resource) const {
+	return m_Resources[resource].accesses;
+}
+
+RenderAccess RenderGraph::getLastAccess(ResourceId resource) const {
+	return m_Resources[resource].lastAccess;
+}
+
+RenderAccess RenderGraph::getPreviousAccess(ResourceId resource) const {
+	return m_Resources[resource].previousAccess;
+}
+
+uint32_t RenderGraph::getResourceCount() const {
+	return static_cast<uint32_t>(m_Resources.size());
+}
+
+const RenderGraph::Statistics& RenderGraph::getStatistics() const {
+	return m_Statistics;
+}
+
+void RenderGraph::logStatistics() const {
+	LOG_F(INFO, "Render graph: %u passes (%u culled) in %u render passes with %u subpasses, %u barriers.", 
+		m_Statistics.passCount, m_Statistics.culledPassCount, m_Statistics.renderPassCount, m_Statistics.subpassCount, 
+		m_Statistics.barrierCount);
+	for (size_t i = 0; i < m_Groups.size(); i++) {
+		std::string passes;
+		for (PassId pass : m_Groups[i].passes)
+			passes += (passes.empty() ? "" : ", ") + m_Passes[pass].name;
+		LOG_F(1, "\t[%zu]: %s%s", i, passes.c_str(), m_Groups[i].renderPass ? "" : " (no render pass)");
+	}
+	LOG_F(INFO, "Render graph: %u transient textures take %.2fMB, %.2fMB once aliased into %zu slots, saving %.2fMB.", 
+		m_Statistics.transientCount, toMegabytes(m_Statistics.unaliasedBytes), toMegabytes(m_Statistics.aliasedBytes),
+		m_Slots.size(), toMegabytes(m_Statistics.unaliasedBytes - m_Statistics.aliasedBytes));
+	LOG_F(INFO, "Render graph: %u textures stay in tile memory, about %.2fMB of bandwidth per frame (%.2fMB without subpasses).", 
+		m_Statistics.tileLocalCount, toMegabytes(m_Statistics.bandwidthBytes), toMegabytes(m_Statistics.unmergedBandwidthBytes));
+}
+
+bool RenderGraph::isWriteAccess(RenderAccess access) {
+	switch (access) {
+	case RenderAccess::eColorAttachment:
+	case RenderAccess::eDepthAttachment:
+	case RenderAccess::eStorageWrite:
+	case RenderAccess::eTransferDestination:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool RenderGraph::isAttachmentAccess(RenderAccess access) {
+	switch (access) {
+	case RenderAccess::eColorAttachment:
+	case RenderAccess::eDepthAttachment:
+	case RenderAccess::eDepthRead:
+	case RenderAccess::eInputAttachment:
+		return true;
+	default:
+		return false;
+	}
+}
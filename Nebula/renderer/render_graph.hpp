@@ -0,0 +1,273 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// How a pass uses a texture. Backends translate each access into image layouts, pipeline 
+/// stages and memory access masks.
+enum class RenderAccess {
+	/// Contents are undefined, the state of every transient texture before its first write.
+	eUndefined,
+	eColorAttachment,
+	eDepthAttachment,
+	/// Depth test without depth writes.
+	eDepthRead,
+	/// Read from an attachment written by an earlier subpass of the same render pass.
+	eInputAttachment,
+	eSampled,
+	eStorageRead,
+	eStorageWrite,
+	eTransferSource,
+	eTransferDestination,
+	ePresent,
+};
+
+/// What a pass does with the previous contents of a texture it writes.
+enum class RenderLoad {
+	eLoad,
+	eClear,
+	eDontCare,
+};
+
+/// Size and format of a texture in the graph.
+struct RenderTextureDescription {
+	/// Zero sizes follow the extent the graph is rendered at.
+	uint32_t width = 0;
+	uint32_t height = 0;
+	/// Backend format, a vk::Format on Vulkan.
+	uint32_t format = 0;
+	bool depthStencil = false;
+	/// Color to clear to, or depth and stencil in the first two components.
+	std::array<float, 4> clearValue = {};
+};
+
+/// Memory a texture needs, as reported by the backend once the textures exist.
+struct RenderMemoryRequirements {
+	uint64_t size = 0;
+	uint64_t alignment = 1;
+	/// Memory types the texture can be placed in, textures only share memory when these overlap.
+	uint32_t typeBits = UINT32_MAX;
+};
+
+/// Describes a frame as passes which declare the textures they read and write, leaving the 
+/// backend to work out everything in between. Compiling the graph
+///   - culls passes whose results are never used,
+///   - merges neighbouring passes which only exchange attachments into subpasses of a single
+///     render pass,
+///   - computes the minimal set of barriers and layout transitions between passes, and
+///   - places transient textures whose lifetimes do not overlap in the same memory, and
+///   - finds the textures which never leave a render pass, and so never need to leave tile memory.
+/// The graph is compiled once and executed every frame, it only needs to be compiled again
+/// when its passes change. Passes are declared in execution order.
+class RenderGraph {
+public:
+	using ResourceId = uint32_t;
+	using PassId = uint32_t;
+	static constexpr uint32_t kInvalid = UINT32_MAX;
+
+	/// A texture read or written by a pass.
+	struct Use {
+		ResourceId resource;
+		RenderAccess access;
+		RenderLoad load;
+	};
+
+	/// Transition of a texture outside of a render pass.
+	struct Barrier {
+		ResourceId resource;
+		RenderAccess before;
+		RenderAccess after;
+	};
+
+	/// A texture attached to a render pass. Transitions into and out of the render pass are 
+	/// part of the attachment rather than separate barriers.
+	struct Attachment {
+		ResourceId resource;
+		/// State before the render pass, eUndefined when the previous contents are discarded.
+		RenderAccess initialAccess;
+		/// State the render pass leaves the texture in.
+		RenderAccess finalAccess;
+		RenderLoad load;
+		/// Whether anything after the render pass reads the contents.
+		bool store;
+	};
+
+	/// Passes executed back to back. Groups of passes using attachments become a render pass
+	/// with one subpass per pass, any other pass is a group of its own.
+	struct Group {
+		std::vector<PassId> passes;
+		/// Executed before the group begins.
+		std::vector<Barrier> barriers;
+		std::vector<Attachment> attachments;
+		bool renderPass = false;
+	};
+
+	/// Transient textures sharing the same memory, in order of their lifetimes.
+	struct MemorySlot {
+		RenderMemoryRequirements requirements;
+		std::vector<ResourceId> resources;
+	};
+
+	struct Statistics {
+		uint32_t passCount = 0;
+		uint32_t culledPassCount = 0;
+		uint32_t renderPassCount = 0;
+		uint32_t subpassCount = 0;
+		uint32_t barrierCount = 0;
+		uint32_t transientCount = 0;
+		uint32_t tileLocalCount = 0;
+		/// Bytes the transient textures would take up each in their own memory.
+		uint64_t unaliasedBytes = 0;
+		/// Bytes the transient textures take up once aliased.
+		uint64_t aliasedBytes = 0;
+		/// Estimated bytes moved between memory and the GPU by every pass of a frame, counting
+		/// attachment loads and stores and whole texture reads and writes outside render passes.
+		/// Attachments are assumed to stay on chip within a render pass, as on tiled GPUs.
+		uint64_t bandwidthBytes = 0;
+		/// The same estimate with every pass in a render pass of its own.
+		uint64_t unmergedBandwidthBytes = 0;
+	};
+
+	/// Adds a texture which only lives for the duration of a frame. Its contents are undefined
+	/// until a pass writes it.
+	ResourceId createTexture(std::string name, const RenderTextureDescription& description);
+
+	/// Adds a texture owned outside the graph, such as a swapchain image. It is assumed to be in
+	/// initialAccess when the frame begins and is left in finalAccess once it ends. Passes 
+	/// writing imported textures are never culled.
+	ResourceId importTexture(std::string name, const RenderTextureDescription& description,
+		RenderAccess initialAccess, RenderAccess finalAccess);
+
+	PassId addPass(std::string name);
+
+	/// Declares that pass reads resource.
+	void read(PassId pass, ResourceId resource, RenderAccess access);
+
+	/// Declares that pass writes resource. Loading the previous contents also reads them.
+	void write(PassId pass, ResourceId resource, RenderAccess access, RenderLoad load = RenderLoad::eLoad);
+
+	/// Keeps a pass even when nothing reads what it writes.
+	void setSideEffects(PassId pass);
+
+	/// Culls, groups and orders the passes and plans the barriers between them. Returns false
+	/// when a pass reads a transient texture before anything has written it.
+	bool compile();
+
+	/// Assigns every transient texture used by the compiled graph to a memory slot, sharing slots
+	/// between textures whose lifetimes do not overlap, and estimates the bandwidth of a frame. 
+	/// getRequirements is asked about every used texture, imported ones only for their size. Called
+	/// again whenever the requirements change, such as when the graph is resized.
+	void alias(const std::function<RenderMemoryRequirements(ResourceId)>& getRequirements);
+
+	const std::vector<Group>& getGroups() const;
+	/// Barriers moving imported textures into their final access after the last group.
+	const std::vector<Barrier>& getFinalBarriers() const;
+	const std::vector<MemorySlot>& getMemorySlots() const;
+
+	const std::string& getPassName(PassId pass) const;
+	const std::vector<Use>& getPassUses(PassId pass) const;
+	bool isPassCulled(PassId pass) const;
+	/// Group the pass was placed in, and its subpass within that group.
+	uint32_t getPassGroup(PassId pass) const;
+	uint32_t getPassSubpass(PassId pass) const;
+	uint32_t getPassCount() const;
+
+	const std::string& getResourceName(ResourceId resource) const;
+	const RenderTextureDescription& getResourceDescription(ResourceId resource) const;
+	bool isResourceImported(ResourceId resource) const;
+	/// Whether any pass which survived culling uses the resource.
+	bool isResourceUsed(ResourceId resource) const;
+	/// Whether a transient texture is only used as an attachment of a single render pass which
+	/// does not store it. Its contents never leave the render pass, so backends can keep it in 
+	/// tile memory. Tile local textures only share memory slots with each other.
+	bool isResourceTileLocal(ResourceId resource) const;
+	/// Memory slot of a transient texture, kInvalid for imported or unused ones.
+	uint32_t getResourceSlot(ResourceId resource) const;
+	/// First and last group using the resource, kInvalid when it is unused.
+	uint32_t getResourceFirstGroup(ResourceId resource) const;
+	uint32_t getResourceLastGroup(ResourceId resource) const;
+	/// Every access the resource is used with, for backends deciding how to create it.
+	const std::vector<RenderAccess>& getResourceAccesses(ResourceId resource) const;
+	/// State the resource is left in at the end of a frame.
+	RenderAccess getLastAccess(ResourceId resource) const;
+	/// Last access to the memory of a resource before its first use in a frame. This is the 
+	/// texture it aliases, or the end of the previous frame, and what the first use must wait for.
+	RenderAccess getPreviousAccess(ResourceId resource) const;
+	uint32_t getResourceCount() const;
+
+	const Statistics& getStatistics() const;
+
+	/// Writes the compiled groups and the memory saved by aliasing to the log.
+	void logStatistics() const;
+
+	static bool isWriteAccess(RenderAccess access);
+	/// Accesses performed through a render pass attachment.
+	static bool isAttachmentAccess(RenderAccess access);
+private:
+	struct Resource {
+		std::string name;
+		RenderTextureDescription description;
+		bool imported = false;
+		RenderAccess initialAccess = RenderAccess::eUndefined;
+		RenderAccess finalAccess = RenderAccess::eUndefined;
+		std::vector<RenderAccess> accesses;
+		uint32_t firstGroup = kInvalid;
+		uint32_t lastGroup = kInvalid;
+		RenderAccess lastAccess = RenderAccess::eUndefined;
+		uint32_t slot = kInvalid;
+		RenderAccess previousAccess = RenderAccess::eUndefined;
+		bool tileLocal = false;
+		uint64_t size = 0;
+	};
+
+	struct Pass {
+		std::string name;
+		std::vector<Use> uses;
+		bool sideEffects = false;
+		bool culled = false;
+		uint32_t group = kInvalid;
+		uint32_t subpass = 0;
+	};
+
+	void cullPasses();
+	void groupPasses();
+	void planBarriers();
+	/// Whether pass can become the next subpass of group.
+	bool canMerge(const Group& group, const Pass& pass, const std::vector<RenderAccess>& states) const;
+	bool usesAttachments(const Pass& pass) const;
+	void estimateBandwidth();
+
+	std::vector<Resource> m_Resources;
+	std::vector<Pass> m_Passes;
+	std::vector<Group> m_Groups;
+	std::vector<Barrier> m_FinalBarriers;
+	std::vector<MemorySlot> m_Slots;
+	Statistics m_Statistics;
+};
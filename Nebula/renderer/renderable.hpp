@@ -26,12 +26,24 @@ SOFTWARE.
 
 #include <vector>
 #include "thirdparty/glm/glm.hpp"
+#include "bindless.hpp"
 
 enum class ShaderStage {
     Fragment,
     Vertex,
 };
 
+/// Pass a renderable is drawn in.
+enum class DrawPass {
+	/// Shaded straight into the backbuffer after lighting, for blended or unlit geometry.
+	eForward,
+	/// Writes surface attributes into the G-buffer, which the lighting pass shades. DirectX 12
+	/// has no G-buffer yet and draws these forward.
+	eGeometry,
+	/// Full screen pass reading the G-buffer, only drawn by the drivers themselves.
+	eLighting,
+};
+
 struct Vertex {
 	glm::fvec3 position;
 	glm::fvec4 color;
@@ -47,4 +59,9 @@ public:
 	virtual bool attachShader(const char* pFilename, ShaderStage stage) = 0;
 	virtual bool setIndices(std::vector<uint16_t> indices) = 0;
 	virtual bool setVertices(std::vector<Vertex> vertices) = 0;
+	/// Selects the pass the renderable is drawn in, DrawPass::eForward unless set. Must be called
+	/// before build.
+	virtual void setDrawPass(DrawPass pass) = 0;
+	/// Sets the bindless indices pushed with the draw of this renderable.
+	virtual void setDrawConstants(const DrawConstants& constants) = 0;
 };
\ No newline at end of file
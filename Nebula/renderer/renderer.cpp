@@ -26,27 +26,44 @@ SOFTWARE.
 #include "renderer/dx12/driver_dx12.hpp"
 #include "renderer/vk/driver_vk.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <vector>
+
 #include <SDL2/SDL.h>
 #include "thirdparty/loguru/loguru.hpp"
 
-Renderer::Renderer(RendererDriver driver) : m_Driver(driver) {}
+Renderer::Renderer(RendererDriver driver, const Config& config) : m_Driver(driver), m_Config(config) {}
 
 bool Renderer::initialize() {
-	SDL_Init(SDL_INIT_VIDEO);
-	m_pWindow = SDL_CreateWindow("Nebula", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1024, 768, SDL_WINDOW_SHOWN);
-	if (!m_pWindow) {
-		LOG_F(FATAL, "SDL window is invalid!");
-		SDL_Quit();
-		return false;
+	m_pWindow = nullptr;
+	if (m_Config.getGraphicsHeadless()) {
+		// Only the Vulkan driver can render without a surface.
+		if (m_Driver == RendererDriver::eAutodetect)
+			m_Driver = RendererDriver::eVulkan;
+		if (m_Driver != RendererDriver::eVulkan) {
+			LOG_F(FATAL, "Headless rendering is only supported by the Vulkan driver.");
+			return false;
+		}
+	} else {
+		SDL_Init(SDL_INIT_VIDEO);
+		m_pWindow = SDL_CreateWindow("Nebula", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, m_Config.getWindowWidth(), 
+			m_Config.getWindowHeight(), SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+		if (!m_pWindow) {
+			LOG_F(FATAL, "SDL window is invalid!");
+			SDL_Quit();
+			return false;
+		}
 	}
 
 	// TODO: If autodetect is enabled, we will need to enumerate 
 	// both drivers and select the best one.
 	if (m_Driver == RendererDriver::eDirectX12) {
-		m_pDriver = std::make_unique<DriverDX12>(m_pWindow);
+		m_pDriver = std::make_unique<DriverDX12>(m_pWindow, m_Config);
 		LOG_F(INFO, "DirectX 12 driver was selected.");
 	} else if (m_Driver == RendererDriver::eVulkan) {
-		m_pDriver = std::make_unique<DriverVk>(m_pWindow);
+		m_pDriver = std::make_unique<DriverVk>(m_pWindow, m_Config);
 		LOG_F(INFO, "Vulkan driver was selected.");
 	} else
 		return false;
@@ -62,7 +79,15 @@ bool Renderer::initialize() {
 		LOG_F(FATAL, "Failed to select GPU for operation!");
         return false;
     }
+
+	const std::string& modelPath = m_Config.getSceneModelPath();
+	if (!modelPath.empty()) {
+		m_pModel = std::make_unique<ObjAsset>(m_pDriver.get());
+		if (!m_pModel->load(modelPath.c_str()))
+			LOG_F(ERROR, "Failed to load the model %s.", modelPath.c_str());
+	}
 	m_Running = true;
+	m_Minimized = false;
     return true;
 }
 
@@ -72,6 +97,7 @@ RendererDriver Renderer::getRendererDriver() {
 
 bool Renderer::setRendererDriver(RendererDriver driver) {
     if (driver != m_Driver) {
+        m_pModel.reset();
         m_pDriver.reset();
     }
     return false;
@@ -82,8 +108,14 @@ void Renderer::onKeyPress() {
 }
 
 int Renderer::executeEventLoop() {
+	if (m_Config.getGraphicsHeadless())
+		return executeHeadless();
+
 	while (m_Running) {
 		SDL_Event event;
+		// Nothing is drawn while minimized, so sleep until something happens.
+		if (m_Minimized && SDL_WaitEvent(nullptr) == 0)
+			continue;
 		while (SDL_PollEvent(&event) != false) {
 			// Dispatch appropriate callback
 			switch (event.type) {
@@ -93,13 +125,17 @@ int Renderer::executeEventLoop() {
 
 			if (event.type == SDL_WINDOWEVENT) {
 				switch (event.window.event) {
-				case SDL_WINDOWEVENT_RESIZED: break;
+				case SDL_WINDOWEVENT_SIZE_CHANGED: 
+					m_pDriver->resize(static_cast<uint32_t>(event.window.data1), static_cast<uint32_t>(event.window.data2)); 
+					break;
+				case SDL_WINDOWEVENT_MINIMIZED: m_Minimized = true; break;
+				case SDL_WINDOWEVENT_RESTORED: m_Minimized = false; break;
 				}
 			}
+		}
 
-			m_pDriver->prepareFrame();
+		if (m_Running && !m_Minimized && m_pDriver->prepareFrame())
 			m_pDriver->presentFrame();
-		}
 	}
 
 	SDL_DestroyWindow(m_pWindow);
@@ -109,4 +145,42 @@ int Renderer::executeEventLoop() {
 
 void Renderer::shutdown() {
 	m_Running = false;
+}
+
+int Renderer::executeHeadless() {
+	uint32_t frameCount = m_Config.getGraphicsHeadlessFrames();
+	std::vector<double> frameTimes;
+	frameTimes.reserve(frameCount);
+	LOG_F(INFO, "Rendering %u frames headless.", frameCount);
+
+	auto start = std::chrono::steady_clock::now();
+	auto previous = start;
+	for (uint32_t i = 0; i < frameCount && m_Running; i++) {
+		if (m_pDriver->prepareFrame())
+			m_pDriver->presentFrame();
+		auto now = std::chrono::steady_clock::now();
+		frameTimes.push_back(std::chrono::duration<double, std::milli>(now - previous).count());
+		previous = now;
+	}
+
+	// The capture is written on the threadpool while the remaining frames drain.
+	const std::string& capturePath = m_Config.getGraphicsCapturePath();
+	if (!capturePath.empty() && !frameTimes.empty() && !m_pDriver->captureFrame(capturePath))
+		LOG_F(ERROR, "Failed to capture the final frame.");
+	m_pDriver->finish();
+	double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (frameTimes.empty())
+		return 1;
+	std::vector<double> sorted = frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&](double fraction) { 
+		return sorted[std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()))]; 
+	};
+	double sum = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+	double mean = sum / sorted.size();
+	LOG_F(INFO, "Rendered %zu frames in %.1fms (%.1f frames per second).", sorted.size(), total, 1000.0 * sorted.size() / total);
+	LOG_F(INFO, "Frame times: min %.3fms, mean %.3fms, median %.3fms, 95th %.3fms, 99th %.3fms, max %.3fms.", 
+		sorted.front(), mean, percentile(0.5), percentile(0.95), percentile(0.99), sorted.back());
+	return 0;
 }
\ No newline at end of file
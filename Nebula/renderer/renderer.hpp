@@ -26,7 +26,9 @@ SOFTWARE.
 
 #include <memory>
 
+#include "game_config.hpp"
 #include "driver.hpp"
+#include "obj_asset.hpp"
 #include "renderable.hpp"
 
 enum class RendererDriver {
@@ -44,7 +46,7 @@ public:
     /// Constructs a renderer with the specified rendering driver.
     /// After instantiation you will need to call createRendererForWindow
     /// to complete object creation.
-    explicit Renderer(RendererDriver driver);
+    explicit Renderer(RendererDriver driver, const Config& config = Config());
 
     /// This function initializes the renderer class for the given GLFW window.
     /// This must be the first function called after creating the object. This 
@@ -72,8 +74,16 @@ public:
 	void shutdown();
 
 private:
+	/// Renders the configured number of frames without a window, then captures the final
+	/// frame and logs frame time statistics.
+	int executeHeadless();
+
 	SDL_Window* m_pWindow;
 	bool m_Running;
+	bool m_Minimized;
     std::unique_ptr<Driver> m_pDriver;
+	/// Declared after the driver so that it is destroyed first.
+	std::unique_ptr<ObjAsset> m_pModel;
     RendererDriver m_Driver;
+    Config m_Config;
 };
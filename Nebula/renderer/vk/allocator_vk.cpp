@@ -0,0 +1,267 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "allocator_vk.hpp"
+
+#include <algorithm>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+AllocatorVk::Block::Block(vk::DeviceMemory memory, std::byte* pMapped, vk::DeviceSize size) 
+	: memory(memory), pMapped(pMapped), ranges(size) {}
+
+AllocatorVk::AllocatorVk(vk::PhysicalDevice physicalDevice, vk::Device device, vk::DeviceSize blockSize) 
+	: m_Device(device), m_AllocationCount(0) {
+	vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+	m_BufferImageGranularity = properties.limits.bufferImageGranularity;
+	m_NonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+	m_MaxAllocationCount = properties.limits.maxMemoryAllocationCount;
+	m_MemoryProperties = physicalDevice.getMemoryProperties();
+
+	// Small heaps, such as the host visible window into video memory, get smaller blocks
+	// so that a single block cannot claim most of the heap.
+	m_MemoryTypes.resize(m_MemoryProperties.memoryTypeCount);
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+		vk::DeviceSize heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[i].heapIndex].size;
+		m_MemoryTypes[i].blockSize = heapSize <= 1024 * 1024 * 1024 ? std::min(blockSize, heapSize / 8) : blockSize;
+	}
+}
+
+AllocatorVk::~AllocatorVk() {
+	for (MemoryType& type : m_MemoryTypes) {
+		for (auto& blocks : type.blocks) {
+			for (auto& pBlock : blocks) {
+				if (pBlock->ranges.getAllocationCount() > 0)
+					LOG_F(WARNING, "Freeing a memory block which still holds %u allocations.", pBlock->ranges.getAllocationCount());
+				m_Device.freeMemory(pBlock->memory);
+			}
+		}
+		for (vk::DeviceMemory memory : type.dedicated)
+			m_Device.freeMemory(memory);
+	}
+}
+
+std::optional<AllocationVk> AllocatorVk::allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, 
+	ResourceTilingVk tiling) {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	// Try every memory type which fits, in the order the driver reports them, so that a full
+	// heap falls back to the next suitable one.
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+		vk::MemoryPropertyFlags typeProperties = m_MemoryProperties.memoryTypes[i].propertyFlags;
+		if (!(requirements.memoryTypeBits & (1u << i)) || (typeProperties & properties) != properties)
+			continue;
+
+		// Keep non-coherent allocations on their own atoms so they can be flushed separately.
+		vk::DeviceSize alignment = requirements.alignment;
+		if ((typeProperties & vk::MemoryPropertyFlagBits::eHostVisible) && !(typeProperties & vk::MemoryPropertyFlagBits::eHostCoherent))
+			alignment = std::max(alignment, m_NonCoherentAtomSize);
+
+		if (auto allocation = allocateFromType(i, requirements.size, alignment, tiling); allocation.has_value())
+			return allocation;
+	}
+	LOG_F(ERROR, "Failed to allocate %llu bytes of device memory.", static_cast<unsigned long long>(requirements.size));
+	return std::nullopt;
+}
+
+bool AllocatorVk::hasMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties) const {
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+		if ((typeBits & (1u << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return true;
+	}
+	return false;
+}
+
+std::optional<AllocationVk> AllocatorVk::allocateForBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags properties) {
+	auto allocation = allocate(m_Device.getBufferMemoryRequirements(buffer), properties, ResourceTilingVk::eLinear);
+	if (allocation.has_value())
+		m_Device.bindBufferMemory(buffer, allocation->memory, allocation->offset);
+	return allocation;
+}
+
+std::optional<AllocationVk> AllocatorVk::allocateForImage(vk::Image image, vk::MemoryPropertyFlags properties, ResourceTilingVk tiling) {
+	auto allocation = allocate(m_Device.getImageMemoryRequirements(image), properties, tiling);
+	if (allocation.has_value())
+		m_Device.bindImageMemory(image, allocation->memory, allocation->offset);
+	return allocation;
+}
+
+void AllocatorVk::free(const AllocationVk& allocation) {
+	if (!allocation.memory)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	MemoryType& type = m_MemoryTypes[allocation.memoryTypeIndex];
+	if (allocation.dedicated) {
+		auto it = std::find(type.dedicated.begin(), type.dedicated.end(), allocation.memory);
+		if (it != type.dedicated.end()) {
+			type.dedicated.erase(it);
+			type.dedicatedSize -= allocation.size;
+			m_Device.freeMemory(allocation.memory);
+			m_AllocationCount--;
+		}
+		return;
+	}
+
+	auto& blocks = type.blocks[getTilingIndex(allocation.tiling)];
+	auto it = std::find_if(blocks.begin(), blocks.end(), [&](const std::unique_ptr<Block>& pBlock) {
+		return pBlock->memory == allocation.memory;
+	});
+	if (it == blocks.end()) {
+		LOG_F(ERROR, "Attempted to free an allocation which does not belong to the allocator.");
+		return;
+	}
+	(*it)->ranges.free(allocation.offset);
+
+	// Keep one empty block around so that a resource being recreated does not cause a block
+	// to be freed and allocated again.
+	if ((*it)->ranges.getAllocationCount() == 0 && blocks.size() > 1) {
+		m_Device.freeMemory((*it)->memory);
+		blocks.erase(it);
+		m_AllocationCount--;
+	}
+}
+
+MemoryStatisticsVk AllocatorVk::getStatistics(uint32_t memoryTypeIndex) const {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return gatherStatistics(memoryTypeIndex, memoryTypeIndex);
+}
+
+MemoryStatisticsVk AllocatorVk::getStatistics() const {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_MemoryTypes.empty())
+		return {};
+	return gatherStatistics(0, static_cast<uint32_t>(m_MemoryTypes.size()) - 1);
+}
+
+void AllocatorVk::logStatistics() const {
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+		MemoryStatisticsVk statistics = getStatistics(i);
+		if (statistics.reserved == 0)
+			continue;
+		LOG_F(INFO, "Memory type %u: %u blocks, %u dedicated, %u allocations, %.2fMB used of %.2fMB, %.2fKB wasted, "
+			"%u free regions, %.1f%% fragmented", i, statistics.blockCount, statistics.dedicatedCount, statistics.allocationCount,
+			statistics.used / (1024.0 * 1024.0), statistics.reserved / (1024.0 * 1024.0), statistics.wasted / 1024.0,
+			statistics.freeRegionCount, statistics.fragmentation * 100.0f);
+	}
+}
+
+std::optional<AllocationVk> AllocatorVk::allocateFromType(uint32_t memoryTypeIndex, vk::DeviceSize size, vk::DeviceSize alignment,
+	ResourceTilingVk tiling) {
+	MemoryType& type = m_MemoryTypes[memoryTypeIndex];
+	AllocationVk allocation;
+	allocation.memoryTypeIndex = memoryTypeIndex;
+	allocation.tiling = tiling;
+	allocation.size = size;
+
+	// Large resources would mostly waste a shared block, give them their own memory.
+	if (size > type.blockSize / 2) {
+		std::byte* pMapped = nullptr;
+		auto memory = allocateMemory(memoryTypeIndex, size, pMapped);
+		if (!memory.has_value())
+			return std::nullopt;
+		type.dedicated.push_back(memory.value());
+		type.dedicatedSize += size;
+		allocation.memory = memory.value();
+		allocation.pMapped = pMapped;
+		allocation.dedicated = true;
+		return allocation;
+	}
+
+	auto& blocks = type.blocks[getTilingIndex(tiling)];
+	for (auto& pBlock : blocks) {
+		if (auto offset = pBlock->ranges.allocate(size, alignment); offset.has_value()) {
+			allocation.memory = pBlock->memory;
+			allocation.offset = offset.value();
+			allocation.pMapped = pBlock->pMapped ? pBlock->pMapped + offset.value() : nullptr;
+			return allocation;
+		}
+	}
+
+	std::byte* pMapped = nullptr;
+	auto memory = allocateMemory(memoryTypeIndex, type.blockSize, pMapped);
+	if (!memory.has_value())
+		return std::nullopt;
+	blocks.push_back(std::make_unique<Block>(memory.value(), pMapped, type.blockSize));
+	allocation.memory = memory.value();
+	allocation.offset = blocks.back()->ranges.allocate(size, alignment).value();
+	allocation.pMapped = pMapped ? pMapped + allocation.offset : nullptr;
+	return allocation;
+}
+
+std::optional<vk::DeviceMemory> AllocatorVk::allocateMemory(uint32_t memoryTypeIndex, vk::DeviceSize size, std::byte*& pMapped) {
+	if (m_AllocationCount >= m_MaxAllocationCount) {
+		LOG_F(ERROR, "Reached the device limit of %u memory allocations.", m_MaxAllocationCount);
+		return std::nullopt;
+	}
+
+	vk::MemoryAllocateInfo allocateInfo;
+	allocateInfo.allocationSize = size;
+	allocateInfo.memoryTypeIndex = memoryTypeIndex;
+	vk::DeviceMemory memory;
+	if (m_Device.allocateMemory(&allocateInfo, nullptr, &memory) != vk::Result::eSuccess) {
+		LOG_F(WARNING, "Failed to allocate a %llu byte block from memory type %u.", static_cast<unsigned long long>(size), memoryTypeIndex);
+		return std::nullopt;
+	}
+	m_AllocationCount++;
+
+	pMapped = nullptr;
+	if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+		pMapped = static_cast<std::byte*>(m_Device.mapMemory(memory, 0, VK_WHOLE_SIZE));
+	return memory;
+}
+
+size_t AllocatorVk::getTilingIndex(ResourceTilingVk tiling) const {
+	// Without a granularity restriction linear and optimal resources can share blocks.
+	return m_BufferImageGranularity > 1 ? static_cast<size_t>(tiling) : 0;
+}
+
+MemoryStatisticsVk AllocatorVk::gatherStatistics(uint32_t firstType, uint32_t lastType) const {
+	MemoryStatisticsVk statistics;
+	vk::DeviceSize blockFree = 0;
+	vk::DeviceSize largestFree = 0;
+	for (uint32_t i = firstType; i <= lastType; i++) {
+		const MemoryType& type = m_MemoryTypes[i];
+		for (const auto& blocks : type.blocks) {
+			for (const auto& pBlock : blocks) {
+				const RangeAllocator& ranges = pBlock->ranges;
+				statistics.blockCount++;
+				statistics.allocationCount += ranges.getAllocationCount();
+				statistics.reserved += ranges.getSize();
+				statistics.used += ranges.getUsed();
+				statistics.wasted += ranges.getWasted();
+				statistics.freeRegionCount += ranges.getFreeRegionCount();
+				statistics.largestFreeRegion = std::max(statistics.largestFreeRegion, ranges.getLargestFreeRegion());
+				blockFree += ranges.getSize() - ranges.getUsed();
+				largestFree += ranges.getLargestFreeRegion();
+			}
+		}
+		statistics.dedicatedCount += static_cast<uint32_t>(type.dedicated.size());
+		statistics.allocationCount += static_cast<uint32_t>(type.dedicated.size());
+		statistics.reserved += type.dedicatedSize;
+		statistics.used += type.dedicatedSize;
+	}
+	if (blockFree > 0)
+		statistics.fragmentation = 1.0f - static_cast<float>(largestFree) / static_cast<float>(blockFree);
+	return statistics;
+}
@@ -0,0 +1,142 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "util/range_allocator.hpp"
+
+/// Tiling of the resource placed in an allocation. Linear and optimally tiled resources are
+/// kept in separate blocks so that neighbours never share a bufferImageGranularity page.
+enum class ResourceTilingVk {
+	eLinear,
+	eOptimal,
+};
+
+/// A range of device memory handed out by AllocatorVk.
+struct AllocationVk {
+	vk::DeviceMemory memory;
+	vk::DeviceSize offset = 0;
+	vk::DeviceSize size = 0;
+	/// Points at offset when the memory is host visible, otherwise null.
+	void* pMapped = nullptr;
+	uint32_t memoryTypeIndex = 0;
+	ResourceTilingVk tiling = ResourceTilingVk::eLinear;
+	/// Whether the allocation owns its device memory rather than sharing a block.
+	bool dedicated = false;
+};
+
+/// Memory usage of a single memory type, or of every memory type combined.
+struct MemoryStatisticsVk {
+	uint32_t blockCount = 0;
+	uint32_t dedicatedCount = 0;
+	uint32_t allocationCount = 0;
+	/// Bytes of device memory allocated from the driver.
+	vk::DeviceSize reserved = 0;
+	/// Bytes covered by live allocations.
+	vk::DeviceSize used = 0;
+	/// Bytes lost to allocations being rounded up.
+	vk::DeviceSize wasted = 0;
+	uint32_t freeRegionCount = 0;
+	vk::DeviceSize largestFreeRegion = 0;
+	/// Zero when the free memory of each block is contiguous, approaching one as it splinters.
+	float fragmentation = 0.0f;
+};
+
+/// Sub-allocates buffers and images from large blocks of device memory, one set of blocks
+/// per memory type, instead of making a driver allocation for each resource. Resources 
+/// larger than half a block receive a dedicated allocation. Host visible blocks are mapped
+/// once when created and stay mapped. Safe to use from multiple threads.
+class AllocatorVk {
+public:
+	AllocatorVk(vk::PhysicalDevice physicalDevice, vk::Device device, vk::DeviceSize blockSize = 64 * 1024 * 1024);
+	~AllocatorVk();
+	AllocatorVk(const AllocatorVk&) = delete;
+	AllocatorVk& operator=(const AllocatorVk&) = delete;
+
+	/// Allocates memory satisfying requirements from a memory type with the given properties.
+	std::optional<AllocationVk> allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, 
+		ResourceTilingVk tiling);
+
+	/// Allocates memory for buffer and binds it.
+	std::optional<AllocationVk> allocateForBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags properties);
+
+	/// Allocates memory for image and binds it.
+	std::optional<AllocationVk> allocateForImage(vk::Image image, vk::MemoryPropertyFlags properties,
+		ResourceTilingVk tiling = ResourceTilingVk::eOptimal);
+
+	/// Whether any of the memory types in typeBits has every one of properties.
+	bool hasMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties) const;
+
+	/// Returns the memory of an allocation. The resource bound to it must no longer be in use.
+	void free(const AllocationVk& allocation);
+
+	/// Returns the usage of a single memory type.
+	MemoryStatisticsVk getStatistics(uint32_t memoryTypeIndex) const;
+
+	/// Returns the combined usage of every memory type.
+	MemoryStatisticsVk getStatistics() const;
+
+	/// Logs the usage of every memory type in use.
+	void logStatistics() const;
+private:
+	static constexpr size_t kTilingCount = 2;
+
+	struct Block {
+		vk::DeviceMemory memory;
+		std::byte* pMapped;
+		RangeAllocator ranges;
+
+		Block(vk::DeviceMemory memory, std::byte* pMapped, vk::DeviceSize size);
+	};
+
+	struct MemoryType {
+		std::array<std::vector<std::unique_ptr<Block>>, kTilingCount> blocks;
+		std::vector<vk::DeviceMemory> dedicated;
+		vk::DeviceSize dedicatedSize = 0;
+		vk::DeviceSize blockSize = 0;
+	};
+
+	std::optional<AllocationVk> allocateFromType(uint32_t memoryTypeIndex, vk::DeviceSize size, vk::DeviceSize alignment,
+		ResourceTilingVk tiling);
+	std::optional<vk::DeviceMemory> allocateMemory(uint32_t memoryTypeIndex, vk::DeviceSize size, std::byte*& pMapped);
+	size_t getTilingIndex(ResourceTilingVk tiling) const;
+	MemoryStatisticsVk gatherStatistics(uint32_t firstType, uint32_t lastType) const;
+
+	vk::Device m_Device;
+	vk::PhysicalDeviceMemoryProperties m_MemoryProperties;
+	vk::DeviceSize m_BufferImageGranularity;
+	vk::DeviceSize m_NonCoherentAtomSize;
+	uint32_t m_MaxAllocationCount;
+	uint32_t m_AllocationCount;
+	mutable std::mutex m_Mutex;
+	std::vector<MemoryType> m_MemoryTypes;
+};
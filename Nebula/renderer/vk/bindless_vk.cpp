@@ -0,0 +1,213 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bindless_vk.hpp"
+
+#include <algorithm>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+namespace {
+	/// Upper bounds for each table, the device limits usually allow far more.
+	constexpr uint32_t kMaxTextures = 65536;
+	constexpr uint32_t kMaxSamplers = 256;
+	constexpr uint32_t kMaxBuffers = 65536;
+
+	/// Splits a per-stage resource limit between the tables, keeping every sampler.
+	void fitResourceLimit(uint32_t limit, uint32_t& textures, uint32_t samplers, uint32_t& buffers) {
+		if (textures + samplers + buffers <= limit)
+			return;
+		uint32_t remaining = limit > samplers ? limit - samplers : 0;
+		textures = std::min(textures, remaining - remaining / 2);
+		buffers = std::min(buffers, remaining / 2);
+	}
+}
+
+BindlessVk::BindlessVk(vk::PhysicalDevice physicalDevice, vk::Device device, bool descriptorIndexing, uint32_t frameCount) : 
+	m_Device(device), m_DescriptorIndexing(descriptorIndexing), m_RecordingFrameNumber(0) {
+	const vk::PhysicalDeviceLimits& limits = physicalDevice.getProperties().limits;
+	uint32_t textures = std::min({ kMaxTextures, limits.maxPerStageDescriptorSampledImages, limits.maxDescriptorSetSampledImages });
+	uint32_t samplers = std::min({ kMaxSamplers, limits.maxPerStageDescriptorSamplers, limits.maxDescriptorSetSamplers });
+	uint32_t buffers = std::min({ kMaxBuffers, limits.maxPerStageDescriptorStorageBuffers, limits.maxDescriptorSetStorageBuffers });
+	uint32_t resourceLimit = limits.maxPerStageResources;
+#ifdef VK_EXT_descriptor_indexing
+	if (m_DescriptorIndexing) {
+		auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDescriptorIndexingPropertiesEXT>();
+		const auto& indexing = properties.get<vk::PhysicalDeviceDescriptorIndexingPropertiesEXT>();
+		textures = std::min({ kMaxTextures, indexing.maxPerStageDescriptorUpdateAfterBindSampledImages, 
+			indexing.maxDescriptorSetUpdateAfterBindSampledImages });
+		samplers = std::min({ kMaxSamplers, indexing.maxPerStageDescriptorUpdateAfterBindSamplers, 
+			indexing.maxDescriptorSetUpdateAfterBindSamplers });
+		buffers = std::min({ kMaxBuffers, indexing.maxPerStageDescriptorUpdateAfterBindStorageBuffers, 
+			indexing.maxDescriptorSetUpdateAfterBindStorageBuffers });
+		resourceLimit = indexing.maxPerStageUpdateAfterBindResources;
+	}
+#else
+	m_DescriptorIndexing = false;
+#endif
+	fitResourceLimit(resourceLimit, textures, samplers, buffers);
+
+	m_Tables[static_cast<size_t>(BindlessResourceType::eTexture)] = std::make_unique<Table>(textures, vk::DescriptorType::eSampledImage);
+	m_Tables[static_cast<size_t>(BindlessResourceType::eSampler)] = std::make_unique<Table>(samplers, vk::DescriptorType::eSampler);
+	m_Tables[static_cast<size_t>(BindlessResourceType::eBuffer)] = std::make_unique<Table>(buffers, vk::DescriptorType::eStorageBuffer);
+
+	// The binding of each table is its resource type.
+	std::array<vk::DescriptorSetLayoutBinding, 3> bindings;
+	std::array<vk::DescriptorPoolSize, 3> poolSizes;
+	uint32_t setCount = m_DescriptorIndexing ? 1 : frameCount;
+	for (uint32_t i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = m_Tables[i]->descriptorType;
+		bindings[i].descriptorCount = m_Tables[i]->indices.getCapacity();
+		bindings[i].stageFlags = vk::ShaderStageFlagBits::eAll;
+		poolSizes[i].type = m_Tables[i]->descriptorType;
+		poolSizes[i].descriptorCount = bindings[i].descriptorCount * setCount;
+	}
+
+	vk::DescriptorSetLayoutCreateInfo layoutInfo;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+	vk::DescriptorPoolCreateInfo poolInfo;
+	poolInfo.maxSets = setCount;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+#ifdef VK_EXT_descriptor_indexing
+	// Slots may be empty or written while earlier frames using other slots are in flight.
+	std::array<vk::DescriptorBindingFlagsEXT, 3> bindingFlags;
+	bindingFlags.fill(vk::DescriptorBindingFlagBitsEXT::ePartiallyBound | vk::DescriptorBindingFlagBitsEXT::eUpdateAfterBind |
+		vk::DescriptorBindingFlagBitsEXT::eUpdateUnusedWhilePending);
+	vk::DescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+	if (m_DescriptorIndexing) {
+		layoutInfo.pNext = &bindingFlagsInfo;
+		layoutInfo.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPoolEXT;
+		poolInfo.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBindEXT;
+	}
+#endif
+	m_pLayout = m_Device.createDescriptorSetLayoutUnique(layoutInfo);
+	m_pPool = m_Device.createDescriptorPoolUnique(poolInfo);
+
+	std::vector<vk::DescriptorSetLayout> setLayouts(setCount, m_pLayout.get());
+	vk::DescriptorSetAllocateInfo allocateInfo;
+	allocateInfo.descriptorPool = m_pPool.get();
+	allocateInfo.descriptorSetCount = setCount;
+	allocateInfo.pSetLayouts = setLayouts.data();
+	m_Sets = m_Device.allocateDescriptorSets(allocateInfo);
+	m_PendingWrites.resize(setCount);
+
+	LOG_F(INFO, "Bindless tables hold %u textures, %u samplers and %u buffers%s.", textures, samplers, buffers,
+		m_DescriptorIndexing ? " with descriptor indexing" : ", one set per frame");
+}
+
+vk::DescriptorSetLayout BindlessVk::getLayout() const {
+	return m_pLayout.get();
+}
+
+vk::DescriptorSet BindlessVk::getDescriptorSet(uint32_t frameIndex) const {
+	return m_Sets[m_DescriptorIndexing ? 0 : frameIndex];
+}
+
+uint32_t BindlessVk::getCapacity(BindlessResourceType type) const {
+	return m_Tables[static_cast<size_t>(type)]->indices.getCapacity();
+}
+
+std::optional<uint32_t> BindlessVk::addTexture(vk::ImageView view, vk::ImageLayout layout) {
+	vk::DescriptorImageInfo imageInfo(nullptr, view, layout);
+	return add(BindlessResourceType::eTexture, &imageInfo, nullptr);
+}
+
+std::optional<uint32_t> BindlessVk::addSampler(vk::Sampler sampler) {
+	vk::DescriptorImageInfo imageInfo(sampler, nullptr, vk::ImageLayout::eUndefined);
+	return add(BindlessResourceType::eSampler, &imageInfo, nullptr);
+}
+
+std::optional<uint32_t> BindlessVk::addBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range) {
+	vk::DescriptorBufferInfo bufferInfo(buffer, offset, range);
+	return add(BindlessResourceType::eBuffer, nullptr, &bufferInfo);
+}
+
+std::optional<uint32_t> BindlessVk::add(BindlessResourceType type, const vk::DescriptorImageInfo* pImageInfo,
+	const vk::DescriptorBufferInfo* pBufferInfo) {
+	Table& table = *m_Tables[static_cast<size_t>(type)];
+	std::optional<uint32_t> index = table.indices.allocate();
+	if (!index.has_value()) {
+		LOG_F(ERROR, "Bindless table %u is full.", static_cast<uint32_t>(type));
+		return std::nullopt;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (pImageInfo) {
+		if (table.imageInfos.size() <= index.value())
+			table.imageInfos.resize(index.value() + 1);
+		table.imageInfos[index.value()] = *pImageInfo;
+	}
+	else {
+		if (table.bufferInfos.size() <= index.value())
+			table.bufferInfos.resize(index.value() + 1);
+		table.bufferInfos[index.value()] = *pBufferInfo;
+	}
+	for (auto& pendingWrites : m_PendingWrites)
+		pendingWrites.emplace_back(type, index.value());
+	return index;
+}
+
+void BindlessVk::remove(BindlessResourceType type, uint32_t index) {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	// A write which has not been applied yet would point at a resource about to be destroyed.
+	for (auto& pendingWrites : m_PendingWrites) {
+		pendingWrites.erase(std::remove(pendingWrites.begin(), pendingWrites.end(), std::make_pair(type, index)), 
+			pendingWrites.end());
+	}
+	m_Tables[static_cast<size_t>(type)]->indices.free(index, m_RecordingFrameNumber);
+}
+
+void BindlessVk::beginFrame(uint32_t frameIndex, uint64_t recordingFrameNumber, uint64_t completedFrameNumber) {
+	for (auto& pTable : m_Tables)
+		pTable->indices.collect(completedFrameNumber);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_RecordingFrameNumber = recordingFrameNumber;
+	uint32_t setIndex = m_DescriptorIndexing ? 0 : frameIndex;
+	auto& pendingWrites = m_PendingWrites[setIndex];
+	if (pendingWrites.empty())
+		return;
+
+	std::vector<vk::WriteDescriptorSet> writes(pendingWrites.size());
+	for (size_t i = 0; i < pendingWrites.size(); i++) {
+		auto [type, index] = pendingWrites[i];
+		const Table& table = *m_Tables[static_cast<size_t>(type)];
+		writes[i].dstSet = m_Sets[setIndex];
+		writes[i].dstBinding = static_cast<uint32_t>(type);
+		writes[i].dstArrayElement = index;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = table.descriptorType;
+		if (type == BindlessResourceType::eBuffer)
+			writes[i].pBufferInfo = &table.bufferInfos[index];
+		else
+			writes[i].pImageInfo = &table.imageInfos[index];
+	}
+	m_Device.updateDescriptorSets(writes, nullptr);
+	pendingWrites.clear();
+}
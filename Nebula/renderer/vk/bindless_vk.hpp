@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "renderer/bindless.hpp"
+#include "util/index_allocator.hpp"
+
+/// Bindless descriptor tables. A single descriptor set holds one large array per resource 
+/// type, and resources keep the index they were given for as long as they are registered.
+///
+/// With VK_EXT_descriptor_indexing the arrays are partially bound and updated after bind, so 
+/// there is one set for the whole device and the arrays can be as large as the update after
+/// bind limits allow. Without it, every frame in flight gets its own set sized to the regular
+/// per-stage limits, and shaders must only index slots which hold a live resource.
+///
+/// Changes are applied to a set when its frame begins. Removed slots are recycled once every
+/// frame which could have referenced them has completed.
+class BindlessVk {
+public:
+	BindlessVk(vk::PhysicalDevice physicalDevice, vk::Device device, bool descriptorIndexing, uint32_t frameCount);
+
+	vk::DescriptorSetLayout getLayout() const;
+	/// Returns the set to bind for draws recorded in the given frame context.
+	vk::DescriptorSet getDescriptorSet(uint32_t frameIndex) const;
+	uint32_t getCapacity(BindlessResourceType type) const;
+
+	/// Register a resource and return its index, or nothing once the table is full. Safe to
+	/// call from any thread.
+	std::optional<uint32_t> addTexture(vk::ImageView view, vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+	std::optional<uint32_t> addSampler(vk::Sampler sampler);
+	std::optional<uint32_t> addBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+
+	/// Unregisters a resource. The resource must stay alive until the frames which were 
+	/// recorded before this call have completed.
+	void remove(BindlessResourceType type, uint32_t index);
+
+	/// Applies pending changes to the set of the frame context which is about to be recorded
+	/// and recycles indices released by frames up to completedFrameNumber. recordingFrameNumber
+	/// is the number the frame will be submitted with.
+	void beginFrame(uint32_t frameIndex, uint64_t recordingFrameNumber, uint64_t completedFrameNumber);
+private:
+	struct Table {
+		IndexAllocator indices;
+		vk::DescriptorType descriptorType;
+		std::vector<vk::DescriptorImageInfo> imageInfos;
+		std::vector<vk::DescriptorBufferInfo> bufferInfos;
+
+		Table(uint32_t capacity, vk::DescriptorType type) : indices(capacity), descriptorType(type) {}
+	};
+
+	std::optional<uint32_t> add(BindlessResourceType type, const vk::DescriptorImageInfo* pImageInfo,
+		const vk::DescriptorBufferInfo* pBufferInfo);
+
+	vk::Device m_Device;
+	bool m_DescriptorIndexing;
+	vk::UniqueDescriptorSetLayout m_pLayout;
+	vk::UniqueDescriptorPool m_pPool;
+	std::vector<vk::DescriptorSet> m_Sets;
+	std::array<std::unique_ptr<Table>, 3> m_Tables;
+	std::mutex m_Mutex;
+	/// Slots written since each set was last brought up to date.
+	std::vector<std::vector<std::pair<BindlessResourceType, uint32_t>>> m_PendingWrites;
+	uint64_t m_RecordingFrameNumber;
+};
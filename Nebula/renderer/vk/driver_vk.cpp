@@ -24,42 +24,90 @@ SOFTWARE.
 
 #include "driver_vk.hpp"
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <thread>
 
 #include <SDL2/SDL_syswm.h>
 #include "thirdparty/loguru/loguru.hpp"
 
 #include "helper_vk.hpp"
+#include "renderable_vk.hpp"
+
+namespace {
+	/// Full screen lighting pass, compiled from shaders/lighting.hlsl by the project.
+	constexpr const char* kLightingVertexShader = "shaders/lighting.vs.spv";
+	constexpr const char* kLightingFragmentShader = "shaders/lighting.ps.spv";
+	/// G-buffer pass of the renderables, compiled from shaders/gbuffer.hlsl by the project.
+	constexpr const char* kGeometryVertexShader = "shaders/gbuffer.vs.spv";
+	constexpr const char* kGeometryFragmentShader = "shaders/gbuffer.ps.spv";
+}
 
-DriverVk::DriverVk(const SDL_Window* pWindow) : Driver(pWindow) {
+DriverVk::DriverVk(const SDL_Window* pWindow, const Config& config) : Driver(pWindow, config) {
 	m_ColorFormat = vk::Format::eUndefined;
 	m_DepthStencilFormat = vk::Format::eUndefined;
-	m_ImageCount = 2;
+	m_ImageCount = getConfig().getGraphicsFramesInFlight();
 	m_CurrentImage = 0;
+	m_FrameIndex = 0;
+	m_FrameNumber = 0;
+	m_SwapchainOutdated = false;
+	m_Headless = getConfig().getGraphicsHeadless();
 	m_pColorImageViews = std::vector<vk::UniqueImageView>(m_ImageCount);
-	m_pFramebuffers = std::vector<vk::UniqueFramebuffer>(m_ImageCount);
+	m_Backbuffer = RenderGraph::kInvalid;
+	m_GBuffer = { RenderGraph::kInvalid, RenderGraph::kInvalid, RenderGraph::kInvalid };
+	m_GeometryPass = RenderGraph::kInvalid;
+	m_LightingPass = RenderGraph::kInvalid;
+	m_ForwardPass = RenderGraph::kInvalid;
 	m_ClearColor = { 0.1f, 0.3f, 0.5f, 1.0f };
 }
 
 DriverVk::~DriverVk() {
-	// Free image we allocated.
-	m_pDevice->destroyImage(m_pDepthStencilImage);
+	// Background compiles run createPipeline, which uses the frame graph and the device.
+	if (m_pPipelineStates)
+		m_pPipelineStates->wait();
+
+	// Frames and captures may still be executing.
+	if (m_pDevice)
+		finish();
+
+	// Free images we allocated.
+	if (m_pDevice) {
+		releaseSwapchains(UINT64_MAX);
+		m_pFrameGraph.reset();
+		m_pScene.reset();
+		m_pColorImageViews.clear();
+		m_pRenderFinished.clear();
+		for (size_t i = 0; i < m_OffscreenImages.size(); i++) {
+			m_pDevice->destroyImage(m_OffscreenImages[i]);
+			m_pAllocator->free(m_OffscreenAllocations[i]);
+		}
+		m_pAllocator->logStatistics();
+	}
+	if (m_pPipelineManifest && getConfig().getGraphicsRecordPipelines())
+		m_pPipelineManifest->save();
 	LOG_F(INFO, "Vulkan driver shutting down.");
 }
 
 bool DriverVk::initialize() {
 	LOG_F(INFO, "Vulkan driver initializing.");
 
-	if (!HelperVk::hasRequiredInstanceExtensions())
-		return false;
+	// Headless rendering has no window, so it needs neither surface extensions nor a surface.
+	if (m_Headless)
+		m_pInstance = HelperVk::createInstance(nullptr);
+	else {
+		if (!HelperVk::hasRequiredInstanceExtensions())
+			return false;
 
-	SDL_SysWMinfo wmInfo;
-	SDL_VERSION(&wmInfo.version);
-	if (!SDL_GetWindowWMInfo(const_cast<SDL_Window*>(getWindow()), &wmInfo))
-		return false;
+		SDL_SysWMinfo wmInfo;
+		SDL_VERSION(&wmInfo.version);
+		if (!SDL_GetWindowWMInfo(const_cast<SDL_Window*>(getWindow()), &wmInfo))
+			return false;
 
-	m_pInstance = HelperVk::createInstance(wmInfo);
-	m_pSurface = HelperVk::createSurface(m_pInstance.get(), wmInfo);
+		m_pInstance = HelperVk::createInstance(&wmInfo);
+		m_pSurface = HelperVk::createSurface(m_pInstance.get(), wmInfo);
+	}
 
 	m_PhysicalDevices = m_pInstance->enumeratePhysicalDevices();
 
@@ -100,8 +148,10 @@ bool DriverVk::selectGpu(uint32_t id) {
 
 	// Grab physical device and verify support.
 	vk::PhysicalDevice physicalDevice = m_PhysicalDevices[id];
-	if (!HelperVk::hasRequiredDeviceExtensionsAndFeatures(physicalDevice))
+	if (!HelperVk::hasRequiredDeviceExtensionsAndFeatures(physicalDevice, !m_Headless))
 		return false;
+	anisotropy = physicalDevice.getFeatures().samplerAnisotropy;
+	maxAnisotropy = anisotropy ? physicalDevice.getProperties().limits.maxSamplerAnisotropy : 1.0f;
 
 	// Grab queue family index which supports graphics and surface operations.
 	if (auto queueFamilyIndex = HelperVk::selectQueueFamilyIndex(physicalDevice, m_pSurface.get()); queueFamilyIndex.has_value())
@@ -111,17 +161,80 @@ bool DriverVk::selectGpu(uint32_t id) {
 		return false;
 	}
 
-	m_pDevice = HelperVk::createDevice(physicalDevice, m_QueueFamilyIndex);
-	m_ColorFormat = HelperVk::selectColorFormat(physicalDevice, m_pSurface.get());
-	vk::PresentModeKHR presentMode = HelperVk::selectPresentMode(physicalDevice, m_pSurface.get());
-	vk::SurfaceCapabilitiesKHR surfaceCapabilities = physicalDevice.getSurfaceCapabilitiesKHR(m_pSurface.get());
-	m_SurfaceDimensions = surfaceCapabilities.currentExtent;
-	m_pSwapchain = HelperVk::createSwapchain(m_pDevice.get(), m_pSurface.get(), m_SurfaceDimensions, m_ImageCount, m_ColorFormat, presentMode);
-
-	// Grab image views for color buffer.
-	m_pColorImageViews = std::move(HelperVk::createImageViews(m_pDevice.get(), m_pSwapchain.get(), nullptr, m_ColorFormat));
-	if (m_pColorImageViews.empty())
-		return false;
+	// Copies go through a dedicated transfer queue when the device has one.
+	std::optional<uint32_t> transferQueueFamilyIndex = HelperVk::selectTransferQueueFamilyIndex(physicalDevice, m_QueueFamilyIndex);
+	if (transferQueueFamilyIndex.has_value())
+		LOG_F(INFO, "Using queue family %u for transfers.", transferQueueFamilyIndex.value());
+
+	std::vector<const char*> extensions;
+	if (!m_Headless)
+		extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+	// Creation feedback tells us whether pipelines were served from the pipeline cache.
+	bool creationFeedback = false;
+#ifdef VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME
+	if (HelperVk::hasDeviceExtension(physicalDevice, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME)) {
+		extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+		creationFeedback = true;
+	}
+#endif
+
+	// Descriptor indexing lets the bindless tables be large and partially filled.
+	bool descriptorIndexing = HelperVk::supportsDescriptorIndexing(physicalDevice);
+	void* pFeatureChain = nullptr;
+#ifdef VK_EXT_descriptor_indexing
+	vk::PhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures;
+	if (descriptorIndexing) {
+		extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		indexingFeatures.runtimeDescriptorArray = true;
+		indexingFeatures.descriptorBindingPartiallyBound = true;
+		indexingFeatures.descriptorBindingUpdateUnusedWhilePending = true;
+		indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = true;
+		indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = true;
+		indexingFeatures.shaderSampledImageArrayNonUniformIndexing = true;
+		indexingFeatures.shaderStorageBufferArrayNonUniformIndexing = true;
+		pFeatureChain = &indexingFeatures;
+	}
+#endif
+
+	// The scene's draw counts are read on the GPU when VK_KHR_draw_indirect_count is available.
+	bool drawIndirectCount = HelperVk::supportsDrawIndirectCount(physicalDevice);
+#ifdef VK_KHR_draw_indirect_count
+	if (drawIndirectCount)
+		extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+#endif
+
+	// Timeline semaphores count completed work per queue, otherwise fences stand in for them.
+	bool timelineSemaphore = HelperVk::supportsTimelineSemaphore(physicalDevice);
+#ifdef VK_KHR_timeline_semaphore
+	vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures;
+	if (timelineSemaphore) {
+		extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		timelineFeatures.timelineSemaphore = true;
+		timelineFeatures.pNext = pFeatureChain;
+		pFeatureChain = &timelineFeatures;
+	}
+#endif
+
+	m_pDevice = HelperVk::createDevice(physicalDevice, m_QueueFamilyIndex, transferQueueFamilyIndex, extensions, pFeatureChain);
+	m_pAllocator = std::make_unique<AllocatorVk>(physicalDevice, m_pDevice.get());
+	m_pPipelineCache = std::make_unique<PipelineCacheVk>(physicalDevice, m_pDevice.get(), creationFeedback);
+	m_pBindless = std::make_unique<BindlessVk>(physicalDevice, m_pDevice.get(), descriptorIndexing, 
+		getConfig().getGraphicsFramesInFlight());
+	m_pProfiler = std::make_unique<GpuProfilerVk>(physicalDevice, m_pDevice.get(), m_QueueFamilyIndex, 
+		getConfig().getGraphicsFramesInFlight());
+	m_pGraphicsTimeline = std::make_unique<GpuTimelineVk>(m_pDevice.get(), timelineSemaphore);
+	if (transferQueueFamilyIndex.has_value())
+		m_pTransferTimeline = std::make_unique<GpuTimelineVk>(m_pDevice.get(), timelineSemaphore);
+	LOG_F(INFO, "Synchronizing with %s.", m_pGraphicsTimeline->hasTimelineSemaphore() ? "timeline semaphores" : "fences");
+	m_pFenceWatcher = std::make_unique<FenceWatcherVk>(m_pDevice.get(), getThreadPool());
+	m_PhysicalDevice = physicalDevice;
+	if (m_Headless)
+		m_ColorFormat = vk::Format::eR8G8B8A8Unorm;
+	else {
+		m_ColorFormat = HelperVk::selectColorFormat(physicalDevice, m_pSurface.get());
+		m_PresentMode = HelperVk::selectPresentMode(physicalDevice, m_pSurface.get());
+	}
 
 	// Grab depth stencil format.
 	if (auto depthStencilFormat = HelperVk::selectDepthStencilFormat(physicalDevice); depthStencilFormat.has_value())
@@ -131,184 +244,681 @@ bool DriverVk::selectGpu(uint32_t id) {
 		return false;
 	}
 
+	// Grab a queue related to our device.
+	m_Queue = m_pDevice->getQueue(m_QueueFamilyIndex, 0);
+	uint32_t uploadQueueFamilyIndex = transferQueueFamilyIndex.value_or(m_QueueFamilyIndex);
+	m_pUpload = std::make_unique<UploadVk>(m_pDevice.get(), m_pAllocator.get(), m_pDevice->getQueue(uploadQueueFamilyIndex, 0), 
+		uploadQueueFamilyIndex, m_QueueFamilyIndex, m_pTransferTimeline ? m_pTransferTimeline.get() : m_pGraphicsTimeline.get());
+	m_pScene = std::make_unique<GpuSceneVk>(physicalDevice, m_pDevice.get(), m_pAllocator.get(), m_pUpload.get(), m_pBindless.get(),
+		m_pPipelineCache.get(), drawIndirectCount);
+
+	// Create the command pool for command buffers which outlive a frame.
+	vk::CommandPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+	poolInfo.queueFamilyIndex = m_QueueFamilyIndex;
+	m_pCommandPool = m_pDevice->createCommandPoolUnique(poolInfo);
+
+	// Create a context for each frame in flight. Their pools are reset as a whole when the 
+	// frame comes around again, after waiting for the timeline value of their previous frame.
+	m_Frames = std::vector<FrameContext>(getConfig().getGraphicsFramesInFlight());
+	for (FrameContext& frame : m_Frames) {
+		vk::CommandPoolCreateInfo framePoolInfo;
+		framePoolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+		framePoolInfo.queueFamilyIndex = m_QueueFamilyIndex;
+		frame.pCommandPool = m_pDevice->createCommandPoolUnique(framePoolInfo);
+
+		vk::CommandBufferAllocateInfo allocateInfo;
+		allocateInfo.commandBufferCount = 1;
+		allocateInfo.commandPool = frame.pCommandPool.get();
+		allocateInfo.level = vk::CommandBufferLevel::ePrimary;
+		frame.pCommandBuffer = std::move(m_pDevice->allocateCommandBuffersUnique(allocateInfo).front());
+
+		frame.pImageAcquired = m_pDevice->createSemaphoreUnique(vk::SemaphoreCreateInfo());
+	}
+	LOG_F(INFO, "Recording up to %zu frames ahead of the GPU.", m_Frames.size());
+
+	if (!createFrameGraph()) {
+		LOG_F(FATAL, "Failed to compile the frame graph.");
+		return false;
+	}
+
+	// The lighting pass reads the G-buffer through input attachments in a set of its own, one per 
+	// frame context so that it is only rewritten once the frame which last used it has completed.
+	std::array<vk::DescriptorSetLayoutBinding, 3> inputBindings;
+	for (uint32_t i = 0; i < inputBindings.size(); i++)
+		inputBindings[i] = vk::DescriptorSetLayoutBinding(i, vk::DescriptorType::eInputAttachment, 1, vk::ShaderStageFlagBits::eFragment);
+	vk::DescriptorSetLayoutCreateInfo inputLayoutInfo;
+	inputLayoutInfo.bindingCount = static_cast<uint32_t>(inputBindings.size());
+	inputLayoutInfo.pBindings = inputBindings.data();
+	m_pInputAttachmentLayout = m_pDevice->createDescriptorSetLayoutUnique(inputLayoutInfo);
+	vk::DescriptorPoolSize inputPoolSize(vk::DescriptorType::eInputAttachment, static_cast<uint32_t>(inputBindings.size() * m_Frames.size()));
+	vk::DescriptorPoolCreateInfo inputPoolInfo;
+	inputPoolInfo.maxSets = static_cast<uint32_t>(m_Frames.size());
+	inputPoolInfo.poolSizeCount = 1;
+	inputPoolInfo.pPoolSizes = &inputPoolSize;
+	m_pInputAttachmentPool = m_pDevice->createDescriptorPoolUnique(inputPoolInfo);
+	std::vector<vk::DescriptorSetLayout> inputSetLayouts(m_Frames.size(), m_pInputAttachmentLayout.get());
+	vk::DescriptorSetAllocateInfo inputSetInfo(m_pInputAttachmentPool.get(), static_cast<uint32_t>(inputSetLayouts.size()), 
+		inputSetLayouts.data());
+	std::vector<vk::DescriptorSet> inputSets = m_pDevice->allocateDescriptorSets(inputSetInfo);
+	for (size_t i = 0; i < m_Frames.size(); i++)
+		m_Frames[i].inputAttachmentSet = inputSets[i];
+
+	// Every pipeline shares one layout, resources are reached through the bindless set using
+	// the indices in the draw constants.
+	std::array<vk::DescriptorSetLayout, 2> setLayouts = { m_pBindless->getLayout(), m_pInputAttachmentLayout.get() };
+	vk::PushConstantRange constantRange(vk::ShaderStageFlagBits::eAllGraphics, 0, sizeof(DrawConstants));
+	vk::PipelineLayoutCreateInfo layoutInfo;
+	layoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	layoutInfo.pSetLayouts = setLayouts.data();
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &constantRange;
+	m_pPipelineLayout = m_pDevice->createPipelineLayoutUnique(layoutInfo);
+	m_pPipelineStates = std::make_unique<PipelineStateCacheVk>(getThreadPool(), 
+		[this](const PipelineDescription& description) { return createPipeline(description); });
+	m_pPipelineManifest = std::make_unique<PipelineManifest>("pipelines_vk.manifest");
+	if (getConfig().getGraphicsRecordPipelines())
+		m_pPipelineStates->setManifest(m_pPipelineManifest.get());
+
+	// Without the lighting pass nothing of the G-buffer would ever reach the screen.
+	for (const char* pShader : { kLightingVertexShader, kLightingFragmentShader }) {
+		if (!std::filesystem::exists(pShader)) {
+			LOG_F(FATAL, "Shader '%s' does not exist, build the shaders of the project first.", pShader);
+			return false;
+		}
+	}
+	PipelineDescription lightingDescription;
+	lightingDescription.setShader(kLightingVertexShader, ShaderStage::Vertex);
+	lightingDescription.setShader(kLightingFragmentShader, ShaderStage::Fragment);
+	lightingDescription.vertexLayout = VertexLayout::eNone;
+	lightingDescription.drawPass = DrawPass::eLighting;
+	m_pLightingPipeline = m_pPipelineStates->acquire(lightingDescription);
+
+	if (m_Headless ? !createOffscreenImages() : !createSwapchain()) {
+		LOG_F(FATAL, "Failed to create the images to render to.");
+		return false;
+	}
+
+	// Compile everything the previous sessions drew before the first frame.
+	m_pPipelineStates->warmUp(m_pPipelineManifest->load());
+
+	if (!createFrameTasks()) {
+		LOG_F(FATAL, "Failed to create the task graph of a frame.");
+		return false;
+	}
+
+	LOG_F(INFO, "Vulkan driver was successfully initialized.");
+	return true;
+}
+
+bool DriverVk::createSwapchain() {
+	// A minimized window has no area to present to, wait until it is restored.
+	vk::SurfaceCapabilitiesKHR surfaceCapabilities = m_PhysicalDevice.getSurfaceCapabilitiesKHR(m_pSurface.get());
+	m_SurfaceDimensions = surfaceCapabilities.currentExtent;
+	if (m_SurfaceDimensions.width == UINT32_MAX) {
+		m_SurfaceDimensions = m_WindowDimensions;
+		if (m_SurfaceDimensions.width == 0 && m_SurfaceDimensions.height == 0) {
+			int width, height;
+			SDL_GetWindowSize(const_cast<SDL_Window*>(getWindow()), &width, &height);
+			m_SurfaceDimensions = vk::Extent2D(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+		}
+	}
+	if (m_SurfaceDimensions.width == 0 || m_SurfaceDimensions.height == 0)
+		return false;
+
+	// The previous swapchain may still own images which are queued for presentation, hand
+	// it to the new one and keep it alive until the last frame using it has completed.
+	vk::UniqueSwapchainKHR pSwapchain = HelperVk::createSwapchain(m_pDevice.get(), m_pSurface.get(), m_SurfaceDimensions, 
+		getConfig().getGraphicsFramesInFlight(), m_ColorFormat, m_PresentMode, m_pSwapchain.get());
+	if (m_pSwapchain) {
+		RetiredSwapchain retired;
+		retired.pSwapchain = std::move(m_pSwapchain);
+		retired.pColorImageViews = std::move(m_pColorImageViews);
+		retired.pRenderFinished = std::move(m_pRenderFinished);
+		retired.frameNumber = m_FrameNumber;
+		m_RetiredSwapchains.push_back(std::move(retired));
+	}
+	m_pSwapchain = std::move(pSwapchain);
+
+	// Grab image views for color buffer. The swapchain may have created more images than asked for.
+	m_pColorImageViews = std::move(HelperVk::createImageViews(m_pDevice.get(), m_pSwapchain.get(), nullptr, m_ColorFormat));
+	if (m_pColorImageViews.empty())
+		return false;
+	m_SwapchainImages = m_pDevice->getSwapchainImagesKHR(m_pSwapchain.get());
+	m_ImageCount = static_cast<uint32_t>(m_pColorImageViews.size());
+	m_pRenderFinished.clear();
+	for (uint32_t i = 0; i < m_ImageCount; i++)
+		m_pRenderFinished.push_back(m_pDevice->createSemaphoreUnique(vk::SemaphoreCreateInfo()));
+	if (!m_pFrameGraph->resize(m_SurfaceDimensions, m_FrameNumber))
+		return false;
+
+	m_SwapchainOutdated = false;
+	LOG_F(INFO, "Created a %ux%u swapchain with %u images.", m_SurfaceDimensions.width, m_SurfaceDimensions.height, m_ImageCount);
+	return true;
+}
+
+bool DriverVk::createOffscreenImages() {
+	m_SurfaceDimensions = vk::Extent2D(static_cast<uint32_t>(getConfig().getWindowWidth()), 
+		static_cast<uint32_t>(getConfig().getWindowHeight()));
 
-	// Create image for our depth stencil view.
+	// One image per frame context, a frame only renders over an image once the frame which last
+	// used it has completed.
+	m_ImageCount = static_cast<uint32_t>(m_Frames.size());
 	vk::ImageCreateInfo imageInfo;
-	imageInfo.format = m_DepthStencilFormat;
+	imageInfo.format = m_ColorFormat;
 	imageInfo.imageType = vk::ImageType::e2D;
 	imageInfo.extent = vk::Extent3D(m_SurfaceDimensions, 1);
 	imageInfo.mipLevels = 1;
 	imageInfo.arrayLayers = 1;
 	imageInfo.samples = vk::SampleCountFlagBits::e1;
-	imageInfo.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferSrc;
-	m_pDepthStencilImage = m_pDevice->createImage(imageInfo);
-
-	vk::MemoryRequirements memoryRequirements = m_pDevice->getImageMemoryRequirements(m_pDepthStencilImage);
-	// Parameters for allocating image to memory.
-	vk::MemoryAllocateInfo memoryAllocateInfo;
-	memoryAllocateInfo.allocationSize = memoryRequirements.size;
-	if (auto memoryTypeIndex = HelperVk::getMemoryTypeIndex(physicalDevice, memoryRequirements.memoryTypeBits,
-		vk::MemoryPropertyFlagBits::eDeviceLocal); memoryTypeIndex.has_value()) {
-		memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex.value();
+	imageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+	m_pColorImageViews.clear();
+	for (uint32_t i = 0; i < m_ImageCount; i++) {
+		vk::Image image = m_pDevice->createImage(imageInfo);
+		std::optional<AllocationVk> allocation = m_pAllocator->allocateForImage(image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		if (!allocation.has_value()) {
+			m_pDevice->destroyImage(image);
+			LOG_F(FATAL, "Failed to allocate memory for an offscreen image.");
+			return false;
+		}
+		m_OffscreenImages.push_back(image);
+		m_OffscreenAllocations.push_back(allocation.value());
+		m_pColorImageViews.push_back(HelperVk::createImageView(m_pDevice.get(), image, m_ColorFormat));
 	}
-	else {
-		LOG_F(FATAL, "Failed to find the memory type index associated with the depth-stencil image.");
+	if (!m_pFrameGraph->resize(m_SurfaceDimensions, m_FrameNumber))
 		return false;
+
+	LOG_F(INFO, "Rendering headless into %u %ux%u offscreen images.", m_ImageCount, m_SurfaceDimensions.width, 
+		m_SurfaceDimensions.height);
+	return true;
+}
+
+bool DriverVk::createFrameGraph() {
+	m_pFrameGraph = std::make_unique<RenderGraphVk>(m_pDevice.get(), m_pAllocator.get());
+	RenderGraph& graph = m_pFrameGraph->getGraph();
+
+	// Offscreen images are left ready to be copied out by a capture.
+	RenderTextureDescription color;
+	color.format = static_cast<uint32_t>(m_ColorFormat);
+	color.clearValue = m_ClearColor;
+	m_Backbuffer = graph.importTexture("Backbuffer", color, RenderAccess::eUndefined, 
+		m_Headless ? RenderAccess::eTransferSource : RenderAccess::ePresent);
+	RenderTextureDescription albedo;
+	albedo.format = static_cast<uint32_t>(vk::Format::eR8G8B8A8Unorm);
+	albedo.clearValue = m_ClearColor;
+	RenderTextureDescription normal;
+	normal.format = static_cast<uint32_t>(vk::Format::eA2B10G10R10UnormPack32);
+	RenderTextureDescription depth;
+	depth.format = static_cast<uint32_t>(m_DepthStencilFormat);
+	depth.depthStencil = true;
+	depth.clearValue = { 1.0f, 0.0f, 0.0f, 0.0f };
+	m_GBuffer = { graph.createTexture("Albedo", albedo), graph.createTexture("Normal", normal), 
+		graph.createTexture("Depth", depth) };
+
+	// Geometry, lighting and forward passes only ever read the pixel they shade, so the graph
+	// merges them into subpasses of one render pass and the G-buffer never leaves tile memory.
+	m_GeometryPass = graph.addPass("Geometry");
+	graph.write(m_GeometryPass, m_GBuffer[0], RenderAccess::eColorAttachment, RenderLoad::eClear);
+	graph.write(m_GeometryPass, m_GBuffer[1], RenderAccess::eColorAttachment, RenderLoad::eClear);
+	graph.write(m_GeometryPass, m_GBuffer[2], RenderAccess::eDepthAttachment, RenderLoad::eClear);
+	m_pFrameGraph->setExecute(m_GeometryPass, [this](const RenderPassContextVk& context) {
+		recordScene(context, DrawPass::eGeometry);
+	});
+
+	m_LightingPass = graph.addPass("Lighting");
+	for (RenderGraph::ResourceId resource : m_GBuffer)
+		graph.read(m_LightingPass, resource, RenderAccess::eInputAttachment);
+	graph.write(m_LightingPass, m_Backbuffer, RenderAccess::eColorAttachment, RenderLoad::eDontCare);
+	m_pFrameGraph->setExecute(m_LightingPass, [this](const RenderPassContextVk& context) {
+		recordLighting(context);
+	});
+
+	// Anything the G-buffer cannot describe, such as blended geometry, is drawn over the lit image.
+	m_ForwardPass = graph.addPass("Forward");
+	graph.write(m_ForwardPass, m_Backbuffer, RenderAccess::eColorAttachment, RenderLoad::eLoad);
+	graph.write(m_ForwardPass, m_GBuffer[2], RenderAccess::eDepthAttachment, RenderLoad::eLoad);
+	m_pFrameGraph->setExecute(m_ForwardPass, [this](const RenderPassContextVk& context) {
+		recordScene(context, DrawPass::eForward);
+	});
+	return m_pFrameGraph->compile();
+}
+
+RenderGraph::PassId DriverVk::getGraphPass(DrawPass drawPass) const {
+	switch (drawPass) {
+	case DrawPass::eGeometry: return m_GeometryPass;
+	case DrawPass::eLighting: return m_LightingPass;
+	default: return m_ForwardPass;
 	}
+}
 
-	// Bind image to memory and create a view for it.
-	m_pDepthStencilImageView = m_pDevice->allocateMemoryUnique(memoryAllocateInfo);
-	m_pDevice->bindImageMemory(m_pDepthStencilImage, m_pDepthStencilImageView.get(), 0);
-	m_pDepthStencilView = std::move(HelperVk::createImageViews(m_pDevice.get(), m_pSwapchain.get(), m_pDepthStencilImage, m_DepthStencilFormat,
-		vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil).front());
+void DriverVk::releaseSwapchains(uint64_t completedFrameNumber) {
+	for (auto it = m_RetiredSwapchains.begin(); it != m_RetiredSwapchains.end();) {
+		if (it->frameNumber > completedFrameNumber) {
+			++it;
+			continue;
+		}
+		it->pColorImageViews.clear();
+		it->pRenderFinished.clear();
+		it = m_RetiredSwapchains.erase(it);
+	}
+	if (m_pFrameGraph)
+		m_pFrameGraph->release(completedFrameNumber);
+}
 
-	// Grab a queue related to our device.
-	m_Queue = m_pDevice->getQueue(m_QueueFamilyIndex, 0);
+void DriverVk::recordScene(const RenderPassContextVk& context, DrawPass drawPass) {
+	vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(context.extent.width), static_cast<float>(context.extent.height), 0.0f, 1.0f);
+	vk::Rect2D scissor(vk::Offset2D(0, 0), context.extent);
+	context.commandBuffer.setViewport(0, 1, &viewport);
+	context.commandBuffer.setScissor(0, 1, &scissor);
+	context.commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_pPipelineLayout.get(), 0, 
+		m_pBindless->getDescriptorSet(m_FrameIndex), nullptr);
+	m_pScene->draw(context.commandBuffer, drawPass, m_pPipelineLayout.get());
+}
 
-	// Create the command pool to store our command buffers: both primary and secondary.
-	vk::CommandPoolCreateInfo poolInfo;
-	poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
-	poolInfo.queueFamilyIndex = m_QueueFamilyIndex;
-	m_pCommandPool = m_pDevice->createCommandPoolUnique(poolInfo);
+void DriverVk::recordLighting(const RenderPassContextVk& context) {
+	vk::Rect2D scissor(vk::Offset2D(0, 0), context.extent);
+	if (m_pLightingPipeline->isFailed())
+		LOG_F(FATAL, "Failed to create the lighting pipeline.");
+	if (!m_pLightingPipeline->isReady()) {
+		// Nothing would be written until the pipeline has compiled, show the clear color instead.
+		vk::ClearAttachment clearAttachment(vk::ImageAspectFlagBits::eColor, 0, vk::ClearColorValue(m_ClearColor));
+		vk::ClearRect clearRect(scissor, 0, 1);
+		context.commandBuffer.clearAttachments(1, &clearAttachment, 1, &clearRect);
+		return;
+	}
 
-	// Allocate primary command buffer.
-	vk::CommandBufferAllocateInfo allocateInfo;
-	allocateInfo.commandBufferCount = 1;
-	allocateInfo.commandPool = m_pCommandPool.get();
-	allocateInfo.level = vk::CommandBufferLevel::ePrimary;
-	m_pCommandBuffer = std::move(m_pDevice->allocateCommandBuffersUnique(allocateInfo).front());
-
-	// 0: color, 1: depth-stencil
-	std::array<vk::AttachmentDescription, 2> attachmentDescs;
-	attachmentDescs[0].format = m_ColorFormat;
-	attachmentDescs[0].samples = vk::SampleCountFlagBits::e1;
-	attachmentDescs[0].loadOp = vk::AttachmentLoadOp::eClear;
-	attachmentDescs[0].storeOp = vk::AttachmentStoreOp::eStore;
-	attachmentDescs[0].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-	attachmentDescs[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-	attachmentDescs[0].initialLayout = vk::ImageLayout::eUndefined;
-	attachmentDescs[0].finalLayout = vk::ImageLayout::ePresentSrcKHR;
-
-	attachmentDescs[1].format = m_DepthStencilFormat;
-	attachmentDescs[1].samples = vk::SampleCountFlagBits::e1;
-	attachmentDescs[1].loadOp = vk::AttachmentLoadOp::eClear;
-	attachmentDescs[1].initialLayout = vk::ImageLayout::eUndefined;
-	attachmentDescs[1].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-	attachmentDescs[1].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-	attachmentDescs[1].initialLayout = vk::ImageLayout::eUndefined;
-	attachmentDescs[1].finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-
-	// Reference for color attachment.
-	vk::AttachmentReference colorRef;
-	colorRef.attachment = 0;
-	colorRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
-
-	// Reference for depth attachment.
-	vk::AttachmentReference depthStencilRef;
-	depthStencilRef.attachment = 1;
-	depthStencilRef.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
-
-	// Create the subpass descriptor.
-	vk::SubpassDescription subpassDesc;
-	subpassDesc.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-	subpassDesc.colorAttachmentCount = 1;
-	subpassDesc.pColorAttachments = &colorRef;
-	subpassDesc.pDepthStencilAttachment = &depthStencilRef;
-
-	// Create the render pass.
-	vk::RenderPassCreateInfo passInfo;
-	passInfo.attachmentCount = attachmentDescs.size();
-	passInfo.pAttachments = attachmentDescs.data();
-	passInfo.subpassCount = 1;
-	passInfo.pSubpasses = &subpassDesc;
-	m_pRenderPass = m_pDevice->createRenderPassUnique(passInfo);
-
-	// Create a framebuffer for each image image in the swapchain.
-	vk::FramebufferCreateInfo framebufferInfo;
-	framebufferInfo.renderPass = m_pRenderPass.get();
-	framebufferInfo.width = m_SurfaceDimensions.width;
-	framebufferInfo.height = m_SurfaceDimensions.height;
-	framebufferInfo.layers = 1;
-	for (uint32_t i = 0; i < m_ImageCount; i++) {
-		std::array<vk::ImageView, 2> attachmentViews;
-		attachmentViews[0] = m_pColorImageViews[i].get();
-		attachmentViews[1] = m_pDepthStencilView.get();
+	// Views change whenever the graph is resized, the set is only rewritten while its frame is not in flight.
+	vk::DescriptorSet inputSet = m_Frames[m_FrameIndex].inputAttachmentSet;
+	std::array<vk::DescriptorImageInfo, 3> imageInfos;
+	std::array<vk::WriteDescriptorSet, 3> writes;
+	for (uint32_t i = 0; i < m_GBuffer.size(); i++) {
+		bool depth = m_pFrameGraph->getGraph().getResourceDescription(m_GBuffer[i]).depthStencil;
+		imageInfos[i] = vk::DescriptorImageInfo(vk::Sampler(), m_pFrameGraph->getReadView(m_GBuffer[i]), 
+			depth ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eShaderReadOnlyOptimal);
+		writes[i] = vk::WriteDescriptorSet(inputSet, i, 0, 1, vk::DescriptorType::eInputAttachment, &imageInfos[i]);
+	}
+	m_pDevice->updateDescriptorSets(writes, nullptr);
+
+	vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(context.extent.width), static_cast<float>(context.extent.height), 0.0f, 1.0f);
+	context.commandBuffer.setViewport(0, 1, &viewport);
+	context.commandBuffer.setScissor(0, 1, &scissor);
+	context.commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pLightingPipeline->get().get());
+	context.commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_pPipelineLayout.get(), 1, inputSet, nullptr);
+	context.commandBuffer.draw(3, 1, 0, 0);
+}
 
-		framebufferInfo.attachmentCount = attachmentViews.size();
-		framebufferInfo.pAttachments = attachmentViews.data();
-		m_pFramebuffers[i] = std::move(m_pDevice->createFramebufferUnique(framebufferInfo));
+vk::UniquePipeline DriverVk::createPipeline(const PipelineDescription& description) {
+	for (const ShaderDescription* pShader : { &description.vertexShader, &description.fragmentShader }) {
+		if (!std::filesystem::exists(pShader->path)) {
+			LOG_F(ERROR, "Shader '%s' does not exist.", pShader->path.c_str());
+			return vk::UniquePipeline();
+		}
 	}
 
-	vk::FenceCreateInfo fenceInfo;
-	m_pFence = m_pDevice->createFenceUnique(fenceInfo);
+	try {
+		vk::UniqueShaderModule pVertexModule = HelperVk::createShaderModule(m_pDevice.get(), description.vertexShader.path.c_str());
+		vk::UniqueShaderModule pFragmentModule = HelperVk::createShaderModule(m_pDevice.get(), description.fragmentShader.path.c_str());
+		std::array<vk::PipelineShaderStageCreateInfo, 2> stageInfos;
+		stageInfos[0].stage = vk::ShaderStageFlagBits::eVertex;
+		stageInfos[0].module = pVertexModule.get();
+		stageInfos[0].pName = description.vertexShader.entryPoint.c_str();
+		stageInfos[1].stage = vk::ShaderStageFlagBits::eFragment;
+		stageInfos[1].module = pFragmentModule.get();
+		stageInfos[1].pName = description.fragmentShader.entryPoint.c_str();
+
+		// VertexLayout::ePositionColor, full screen passes generate their vertices from the index.
+		vk::VertexInputBindingDescription bindingDesc(0, sizeof(Vertex), vk::VertexInputRate::eVertex);
+		std::array<vk::VertexInputAttributeDescription, 2> attributeDescs = {
+			vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, position)),
+			vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(Vertex, color)),
+		};
+		vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
+		if (description.vertexLayout != VertexLayout::eNone) {
+			vertexInputInfo.vertexBindingDescriptionCount = 1;
+			vertexInputInfo.pVertexBindingDescriptions = &bindingDesc;
+			vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescs.size());
+			vertexInputInfo.pVertexAttributeDescriptions = attributeDescs.data();
+		}
 
-	vk::SemaphoreCreateInfo semaphoreInfo;
-	m_pSemaphore = m_pDevice->createSemaphoreUnique(semaphoreInfo);
+		vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
+		switch (description.topology) {
+		case PrimitiveTopology::eTriangleList: inputAssemblyInfo.topology = vk::PrimitiveTopology::eTriangleList; break;
+		case PrimitiveTopology::eTriangleStrip: inputAssemblyInfo.topology = vk::PrimitiveTopology::eTriangleStrip; break;
+		case PrimitiveTopology::eLineList: inputAssemblyInfo.topology = vk::PrimitiveTopology::eLineList; break;
+		case PrimitiveTopology::ePointList: inputAssemblyInfo.topology = vk::PrimitiveTopology::ePointList; break;
+		}
 
-	LOG_F(INFO, "Vulkan driver was successfully initialized.");
-	return true;
+		// Viewport and scissor follow the swapchain, so they are set while recording.
+		vk::PipelineViewportStateCreateInfo viewportInfo;
+		viewportInfo.viewportCount = 1;
+		viewportInfo.scissorCount = 1;
+		std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+		vk::PipelineDynamicStateCreateInfo dynamicInfo;
+		dynamicInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+		dynamicInfo.pDynamicStates = dynamicStates.data();
+
+		vk::PipelineRasterizationStateCreateInfo rasterizationInfo;
+		rasterizationInfo.polygonMode = vk::PolygonMode::eFill;
+		rasterizationInfo.frontFace = vk::FrontFace::eClockwise;
+		rasterizationInfo.lineWidth = 1.0f;
+		switch (description.cullMode) {
+		case CullMode::eNone: rasterizationInfo.cullMode = vk::CullModeFlagBits::eNone; break;
+		case CullMode::eFront: rasterizationInfo.cullMode = vk::CullModeFlagBits::eFront; break;
+		case CullMode::eBack: rasterizationInfo.cullMode = vk::CullModeFlagBits::eBack; break;
+		}
+
+		vk::PipelineMultisampleStateCreateInfo multisampleInfo;
+		multisampleInfo.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+		vk::PipelineDepthStencilStateCreateInfo depthStencilInfo;
+		depthStencilInfo.depthTestEnable = description.depthTest;
+		depthStencilInfo.depthWriteEnable = description.depthWrite;
+		depthStencilInfo.depthCompareOp = vk::CompareOp::eLessOrEqual;
+
+		vk::PipelineColorBlendAttachmentState blendAttachment;
+		blendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+			vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+		if (description.blendMode != BlendMode::eOpaque) {
+			blendAttachment.blendEnable = true;
+			blendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+			blendAttachment.dstColorBlendFactor = description.blendMode == BlendMode::eAlpha ? 
+				vk::BlendFactor::eOneMinusSrcAlpha : vk::BlendFactor::eOne;
+			blendAttachment.colorBlendOp = vk::BlendOp::eAdd;
+			blendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+			blendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+			blendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
+		}
+		// Every color attachment written by the pass shares the same blend state.
+		RenderGraph::PassId pass = getGraphPass(description.drawPass);
+		std::vector<vk::PipelineColorBlendAttachmentState> blendAttachments;
+		for (const RenderGraph::Use& use : m_pFrameGraph->getGraph().getPassUses(pass)) {
+			if (use.access == RenderAccess::eColorAttachment)
+				blendAttachments.push_back(blendAttachment);
+		}
+		vk::PipelineColorBlendStateCreateInfo blendInfo;
+		blendInfo.attachmentCount = static_cast<uint32_t>(blendAttachments.size());
+		blendInfo.pAttachments = blendAttachments.data();
+
+		vk::GraphicsPipelineCreateInfo pipelineInfo;
+		pipelineInfo.stageCount = static_cast<uint32_t>(stageInfos.size());
+		pipelineInfo.pStages = stageInfos.data();
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+		pipelineInfo.pViewportState = &viewportInfo;
+		pipelineInfo.pRasterizationState = &rasterizationInfo;
+		pipelineInfo.pMultisampleState = &multisampleInfo;
+		pipelineInfo.pDepthStencilState = &depthStencilInfo;
+		pipelineInfo.pColorBlendState = &blendInfo;
+		pipelineInfo.pDynamicState = &dynamicInfo;
+		pipelineInfo.layout = m_pPipelineLayout.get();
+		pipelineInfo.renderPass = m_pFrameGraph->getRenderPass(pass);
+		pipelineInfo.subpass = m_pFrameGraph->getSubpass(pass);
+		return m_pPipelineCache->createGraphicsPipeline(pipelineInfo);
+	}
+	catch (const vk::SystemError& error) {
+		LOG_F(ERROR, "Failed to create pipeline: %s", error.what());
+		return vk::UniquePipeline();
+	}
+}
+
+void DriverVk::resize(uint32_t width, uint32_t height) {
+	m_WindowDimensions = vk::Extent2D(width, height);
+	m_SwapchainOutdated = true;
 }
 
 bool DriverVk::prepareFrame() {
-	auto acquireResult = m_pDevice->acquireNextImageKHR(m_pSwapchain.get(), UINT64_MAX, m_pSemaphore.get(), nullptr);
-	if (acquireResult.result != vk::Result::eSuccess) {
-		LOG_F(WARNING, "Failed to grab available swapchain image.");
+	// Only block once the GPU is a full set of frames behind.
+	FrameContext& frame = m_Frames[m_FrameIndex];
+	m_pGraphicsTimeline->wait(frame.timelineValue);
+
+	// Everything submitted up to this context's last frame has now finished on the GPU.
+	m_pUpload->collect();
+	releaseSwapchains(frame.frameNumber);
+
+	// Rebuild the swapchain once the window has changed, which fails while it is minimized.
+	if (m_SwapchainOutdated && !createSwapchain())
 		return false;
+
+	// Offscreen images belong to the frame contexts, the context's fence guards its image.
+	if (m_Headless)
+		m_CurrentImage = m_FrameIndex;
+	else {
+		try {
+			auto acquireResult = m_pDevice->acquireNextImageKHR(m_pSwapchain.get(), UINT64_MAX, frame.pImageAcquired.get(), nullptr);
+			if (acquireResult.result == vk::Result::eSuboptimalKHR)
+				m_SwapchainOutdated = true;
+			m_CurrentImage = acquireResult.value;
+		}
+		catch (const vk::OutOfDateKHRError&) {
+			// Nothing was acquired, so the frame is skipped and the swapchain rebuilt next frame.
+			m_SwapchainOutdated = true;
+			return false;
+		}
 	}
-	else
-		m_CurrentImage = acquireResult.value;
 
-	// Begin recording.
-	vk::CommandBufferBeginInfo beginInfo;
-	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
-	m_pCommandBuffer->begin(beginInfo);
+	// The frame is going ahead, so its arenas advance in step with the frame contexts.
+	reportThreadPoolStatistics();
+	getFrameArenas()->beginFrame();
+	getFrameGraph()->execute();
+	return true;
+}
 
-	std::array<vk::ClearValue, 2> clearValue;
-	clearValue[0].color.setFloat32(m_ClearColor);
-	clearValue[1].depthStencil = { 1.0f, 0 };
+bool DriverVk::createFrameTasks() {
+	// The bindless table and the scene both retire into the upload and deletion queues, so they 
+	// run in sequence, while saving the pipeline cache overlaps with both and the recording.
+	TaskGraph* pTasks = getFrameGraph();
+	pTasks->addNode("Pipeline cache", [this] { m_pPipelineCache->update(getThreadPool()); });
+	TaskGraph::NodeId bindless = pTasks->addNode("Bindless", [this] {
+		m_pBindless->beginFrame(m_FrameIndex, m_FrameNumber + 1, m_Frames[m_FrameIndex].frameNumber);
+	});
+	TaskGraph::NodeId scene = pTasks->addNode("Scene", [this] {
+		m_pScene->beginFrame(m_FrameNumber + 1, m_Frames[m_FrameIndex].frameNumber);
+	});
+	TaskGraph::NodeId record = pTasks->addNode("Record", [this] { recordFrame(); });
+	pTasks->addEdge(bindless, scene);
+	pTasks->addEdge(scene, record);
+	return pTasks->compile();
+}
 
-	vk::RenderPassBeginInfo passBeginInfo;
-	passBeginInfo.clearValueCount = clearValue.size();
-	passBeginInfo.pClearValues = clearValue.data();
-	passBeginInfo.framebuffer = m_pFramebuffers[m_CurrentImage].get();
-	passBeginInfo.renderPass = m_pRenderPass.get();
-	// TODO: update render area based on swapchain dimensions when resized.
-	passBeginInfo.renderArea = vk::Rect2D(vk::Offset2D(0, 0), vk::Extent2D(1024, 768));
+void DriverVk::recordFrame() {
+	FrameContext& frame = m_Frames[m_FrameIndex];
 
-	m_pCommandBuffer->beginRenderPass(passBeginInfo, vk::SubpassContents::eInline);
-	m_pCommandBuffer->endRenderPass();
+	// Begin recording.
+	m_pDevice->resetCommandPool(frame.pCommandPool.get(), vk::CommandPoolResetFlags());
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	frame.pCommandBuffer->begin(beginInfo);
+	m_pProfiler->beginFrame(frame.pCommandBuffer.get(), m_FrameIndex);
+	m_pProfiler->reportTimings();
+	uint32_t frameScope = m_pProfiler->beginScope(frame.pCommandBuffer.get(), "Frame");
+
+	// Draws of the scene are generated before any pass begins, then every pass records into the 
+	// primary buffer.
+	m_pScene->cull(frame.pCommandBuffer.get(), m_pProfiler.get());
+	vk::Image image = m_Headless ? m_OffscreenImages[m_CurrentImage] : m_SwapchainImages[m_CurrentImage];
+	m_pFrameGraph->setImportedImage(m_Backbuffer, image, m_pColorImageViews[m_CurrentImage].get());
+	m_pFrameGraph->execute(frame.pCommandBuffer.get(), m_pProfiler.get());
+	m_pProfiler->endScope(frame.pCommandBuffer.get(), frameScope);
 
 	// Stop recording.
-	m_pCommandBuffer->end();
-	return true;
+	frame.pCommandBuffer->end();
 }
 
 bool DriverVk::presentFrame() {
-	const std::vector<vk::PipelineStageFlags> waitStages = {
-				vk::PipelineStageFlagBits::eAllGraphics
-	};
+	FrameContext& frame = m_Frames[m_FrameIndex];
+	frame.frameNumber = ++m_FrameNumber;
+
+	// Send out the copies queued during the frame, drawing waits on them as it reads vertices.
+	m_pUpload->flush();
+	// Only a swapchain image has to be waited on, headless frames render straight away.
+	std::array<vk::Semaphore, 1> waitSemaphores = { frame.pImageAcquired.get() };
+	std::array<vk::PipelineStageFlags, 1> waitStages = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+	uint32_t waitCount = m_Headless ? 0 : static_cast<uint32_t>(waitSemaphores.size());
+	std::array<TimelineWaitVk, 1> timelineWaits = { {
+		{ m_pUpload->getTimeline(), m_pUpload->getSubmittedValue(), vk::PipelineStageFlagBits::eVertexInput }
+	} };
 
 	// We are only submitting the primary command list.
 	vk::SubmitInfo submitInfo;
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &m_pCommandBuffer.get();
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = &m_pSemaphore.get();
+	submitInfo.pCommandBuffers = &frame.pCommandBuffer.get();
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
 	submitInfo.pWaitDstStageMask = waitStages.data();
-	m_Queue.submit(submitInfo, m_pFence.get());
+	vk::Semaphore renderFinished = m_Headless ? vk::Semaphore() : m_pRenderFinished[m_CurrentImage].get();
+	submitInfo.signalSemaphoreCount = m_Headless ? 0 : 1;
+	submitInfo.pSignalSemaphores = &renderFinished;
 
 	// Preprare to present to the queue.
 	vk::PresentInfoKHR presentInfo;
 	presentInfo.pImageIndices = &m_CurrentImage;
 	presentInfo.swapchainCount = 1;
 	presentInfo.pSwapchains = &m_pSwapchain.get();
-	m_Queue.presentKHR(presentInfo);
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = &renderFinished;
+	{
+		// The upload manager may be sharing this queue.
+		std::lock_guard<std::mutex> lock(m_pUpload->getQueueMutex());
+		frame.timelineValue = m_pGraphicsTimeline->submit(m_Queue, submitInfo, timelineWaits.data(), 
+			static_cast<uint32_t>(timelineWaits.size()));
+		try {
+			if (!m_Headless && m_Queue.presentKHR(presentInfo) == vk::Result::eSuboptimalKHR)
+				m_SwapchainOutdated = true;
+		}
+		catch (const vk::OutOfDateKHRError&) {
+			m_SwapchainOutdated = true;
+		}
+	}
 
-	m_pDevice->waitForFences(m_pFence.get(), true, UINT64_MAX);
-	m_pDevice->resetFences(m_pFence.get());
+	m_FrameIndex = (m_FrameIndex + 1) % static_cast<uint32_t>(m_Frames.size());
+
+	// Continue any coroutines waiting on GPU work which has since completed.
+	m_pFenceWatcher->poll();
 	return true;
 }
 
+bool DriverVk::captureFrame(const std::string& path) {
+	// Swapchain images are not created for use as a copy source.
+	if (!m_Headless) {
+		LOG_F(WARNING, "Frames can only be captured while rendering headless.");
+		return false;
+	}
+	if (m_FrameNumber == 0)
+		return false;
+
+	CaptureVk capture;
+	capture.path = path;
+	capture.extent = m_SurfaceDimensions;
+	vk::BufferCreateInfo bufferInfo;
+	bufferInfo.size = static_cast<vk::DeviceSize>(m_SurfaceDimensions.width) * m_SurfaceDimensions.height * 4;
+	bufferInfo.usage = vk::BufferUsageFlagBits::eTransferDst;
+	capture.buffer = m_pDevice->createBuffer(bufferInfo);
+	if (auto allocation = m_pAllocator->allocateForBuffer(capture.buffer, vk::MemoryPropertyFlagBits::eHostVisible | 
+		vk::MemoryPropertyFlagBits::eHostCoherent); allocation.has_value())
+		capture.allocation = allocation.value();
+	else {
+		m_pDevice->destroyBuffer(capture.buffer);
+		LOG_F(ERROR, "Failed to allocate memory for a frame capture.");
+		return false;
+	}
+
+	// The capture is destroyed on a worker, so it brings its own pool.
+	vk::CommandPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+	poolInfo.queueFamilyIndex = m_QueueFamilyIndex;
+	capture.pCommandPool = m_pDevice->createCommandPoolUnique(poolInfo);
+	vk::CommandBufferAllocateInfo allocateInfo;
+	allocateInfo.commandBufferCount = 1;
+	allocateInfo.commandPool = capture.pCommandPool.get();
+	allocateInfo.level = vk::CommandBufferLevel::ePrimary;
+	capture.pCommandBuffer = std::move(m_pDevice->allocateCommandBuffersUnique(allocateInfo).front());
+
+	// Submitted after the frame, whose render pass leaves the image as a copy source and makes
+	// its writes visible to transfers.
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	capture.pCommandBuffer->begin(beginInfo);
+	vk::BufferImageCopy region;
+	region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+	region.imageExtent = vk::Extent3D(m_SurfaceDimensions, 1);
+	capture.pCommandBuffer->copyImageToBuffer(m_OffscreenImages[m_CurrentImage], vk::ImageLayout::eTransferSrcOptimal, 
+		capture.buffer, region);
+	vk::BufferMemoryBarrier bufferBarrier;
+	bufferBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	bufferBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+	bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferBarrier.buffer = capture.buffer;
+	bufferBarrier.size = VK_WHOLE_SIZE;
+	capture.pCommandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+		vk::DependencyFlags(), nullptr, bufferBarrier, nullptr);
+	capture.pCommandBuffer->end();
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &capture.pCommandBuffer.get();
+	{
+		std::lock_guard<std::mutex> lock(m_pUpload->getQueueMutex());
+		capture.value = m_pGraphicsTimeline->submit(m_Queue, submitInfo);
+	}
+
+	m_Captures.add();
+	writeCapture(std::move(capture)).start(getThreadPool(), TaskPriority::eBackground);
+	return true;
+}
+
+AsyncTask<void> DriverVk::writeCapture(CaptureVk capture) {
+	co_await m_pFenceWatcher->wait(m_pGraphicsTimeline.get(), capture.value);
+	co_await resumeOn(getThreadPool(), TaskPriority::eBackground);
+
+	// PPM has no alpha channel.
+	const uint8_t* pPixels = static_cast<const uint8_t*>(capture.allocation.pMapped);
+	std::vector<char> row(capture.extent.width * 3);
+	std::ofstream stream(capture.path, std::ios::binary);
+	stream << "P6\n" << capture.extent.width << " " << capture.extent.height << "\n255\n";
+	for (uint32_t y = 0; y < capture.extent.height && stream; y++) {
+		const uint8_t* pRow = pPixels + static_cast<size_t>(y) * capture.extent.width * 4;
+		for (uint32_t x = 0; x < capture.extent.width; x++) {
+			row[x * 3 + 0] = static_cast<char>(pRow[x * 4 + 0]);
+			row[x * 3 + 1] = static_cast<char>(pRow[x * 4 + 1]);
+			row[x * 3 + 2] = static_cast<char>(pRow[x * 4 + 2]);
+		}
+		stream.write(row.data(), row.size());
+	}
+	if (stream)
+		LOG_F(INFO, "Wrote a %ux%u frame capture to '%s'.", capture.extent.width, capture.extent.height, capture.path.c_str());
+	else
+		LOG_F(ERROR, "Failed to write the frame capture to '%s'.", capture.path.c_str());
+
+	// The coroutine frame outlives done(), after which the device may be destroyed, so every 
+	// Vulkan object of the capture is released first.
+	capture.pCommandBuffer.reset();
+	capture.pCommandPool.reset();
+	m_pDevice->destroyBuffer(capture.buffer);
+	m_pAllocator->free(capture.allocation);
+	m_Captures.done();
+}
+
+void DriverVk::finish() {
+	m_pDevice->waitIdle();
+
+	// Captures continue once the fence watcher sees their timeline value, which only happens as frames
+	// are presented, so poll it here until every capture has been written.
+	while (!m_Captures.isComplete()) {
+		m_pFenceWatcher->poll();
+		if (!getThreadPool()->runPendingTask())
+			std::this_thread::yield();
+	}
+}
+
+std::unique_ptr<Renderable> DriverVk::createRenderable() {
+	auto pRenderable = std::make_unique<RenderableVk>(this);
+	pRenderable->attachShader(kGeometryVertexShader, ShaderStage::Vertex);
+	pRenderable->attachShader(kGeometryFragmentShader, ShaderStage::Fragment);
+	pRenderable->setDrawPass(DrawPass::eGeometry);
+	return pRenderable;
+}
+
 const vk::UniqueDevice& DriverVk::getDevice() const {
     return m_pDevice;
 }
@@ -318,17 +928,57 @@ const vk::UniqueCommandPool & DriverVk::getCommandPool() const {
 }
 
 const vk::UniqueCommandBuffer& DriverVk::getCommandBuffer() const {
-    return m_pCommandBuffer;
+    return m_Frames[m_FrameIndex].pCommandBuffer;
 }
 
-const vk::UniqueFramebuffer & DriverVk::getCurrentFramebuffer() const {
-	return m_pFramebuffers[m_CurrentImage];
+vk::Framebuffer DriverVk::getCurrentFramebuffer() const {
+	return m_pFrameGraph->getFramebuffer(m_ForwardPass);
 }
 
-const vk::UniqueRenderPass & DriverVk::getRenderPass() const {
-	return m_pRenderPass;
+vk::RenderPass DriverVk::getRenderPass() const {
+	return m_pFrameGraph->getRenderPass(m_ForwardPass);
 }
 
 const vk::UniqueSwapchainKHR& DriverVk::getSwapchain() const {
     return m_pSwapchain;
+}
+
+FenceWatcherVk* DriverVk::getFenceWatcher() const {
+	return m_pFenceWatcher.get();
+}
+
+AllocatorVk* DriverVk::getAllocator() const {
+	return m_pAllocator.get();
+}
+
+UploadVk* DriverVk::getUpload() const {
+	return m_pUpload.get();
+}
+
+PipelineCacheVk* DriverVk::getPipelineCache() const {
+	return m_pPipelineCache.get();
+}
+
+BindlessVk* DriverVk::getBindless() const {
+	return m_pBindless.get();
+}
+
+GpuSceneVk* DriverVk::getScene() const {
+	return m_pScene.get();
+}
+
+GpuProfilerVk* DriverVk::getProfiler() const {
+	return m_pProfiler.get();
+}
+
+GpuTimelineVk* DriverVk::getGraphicsTimeline() const {
+	return m_pGraphicsTimeline.get();
+}
+
+vk::PipelineLayout DriverVk::getPipelineLayout() const {
+	return m_pPipelineLayout.get();
+}
+
+PipelineStateCacheVk* DriverVk::getPipelineStates() const {
+	return m_pPipelineStates.get();
 }
\ No newline at end of file
@@ -26,17 +26,32 @@ SOFTWARE.
 
 #include <array>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 #include <vulkan/vulkan.hpp>
 
 #include "renderer/driver.hpp"
+#include "renderer/pipeline_state_cache.hpp"
+#include "util/async_task.hpp"
+#include "util/wait_group.hpp"
+#include "allocator_vk.hpp"
+#include "bindless_vk.hpp"
+#include "fence_watcher_vk.hpp"
+#include "gpu_profiler_vk.hpp"
+#include "gpu_scene_vk.hpp"
+#include "gpu_timeline_vk.hpp"
+#include "pipeline_cache_vk.hpp"
+#include "render_graph_vk.hpp"
+#include "upload_vk.hpp"
+
+using PipelineStateVk = PipelineState<vk::UniquePipeline>;
+using PipelineStateCacheVk = PipelineStateCache<vk::UniquePipeline>;
 
 class DriverVk : public Driver {
 public:
-	DriverVk() = default;
-    DriverVk(const SDL_Window* pWindow);
+    DriverVk(const SDL_Window* pWindow, const Config& config);
 	~DriverVk();
 
     // Inherited via IDriver
@@ -44,36 +59,153 @@ public:
     bool selectGpu(uint32_t id) override;
 	bool prepareFrame() override;
     bool presentFrame() override;
+	void resize(uint32_t width, uint32_t height) override;
+	bool captureFrame(const std::string& path) override;
+	void finish() override;
+	std::unique_ptr<Renderable> createRenderable() override;
     const vk::UniqueDevice& getDevice() const;
 	const vk::UniqueCommandPool& getCommandPool() const;
     const vk::UniqueCommandBuffer& getCommandBuffer() const;
-	const vk::UniqueFramebuffer& getCurrentFramebuffer() const;
-	const vk::UniqueRenderPass& getRenderPass() const;
+	vk::Framebuffer getCurrentFramebuffer() const;
+	/// Render pass the renderables are drawn in.
+	vk::RenderPass getRenderPass() const;
     const vk::UniqueSwapchainKHR& getSwapchain() const;
+	FenceWatcherVk* getFenceWatcher() const;
+	AllocatorVk* getAllocator() const;
+	UploadVk* getUpload() const;
+	PipelineCacheVk* getPipelineCache() const;
+	BindlessVk* getBindless() const;
+	/// GPU timings of the frame's passes, available a few frames after they were recorded.
+	GpuProfilerVk* getProfiler() const;
+	/// Timeline of the graphics queue, every frame and capture advances it by one.
+	GpuTimelineVk* getGraphicsTimeline() const;
+	/// Layout shared by every graphics pipeline: the bindless set and the draw constants.
+	vk::PipelineLayout getPipelineLayout() const;
+	/// Pipelines shared between renderables, compiled on the threadpool.
+	PipelineStateCacheVk* getPipelineStates() const;
+	/// Meshes and instances of every built renderable, culled and drawn on the GPU.
+	GpuSceneVk* getScene() const;
 private:
+
+	/// Everything a frame needs while it is being recorded and executed. The CPU only waits
+	/// for a frame once it comes back around to the same context.
+	struct FrameContext {
+		vk::UniqueCommandPool pCommandPool;
+		vk::UniqueCommandBuffer pCommandBuffer;
+		vk::UniqueSemaphore pImageAcquired;
+		/// Number of the last frame submitted from this context.
+		uint64_t frameNumber = 0;
+		/// Graphics timeline value signaled once that frame has completed.
+		uint64_t timelineValue = 0;
+		/// G-buffer read by the lighting pass, rewritten every frame as resizes replace it.
+		vk::DescriptorSet inputAttachmentSet;
+	};
+
+	/// Swapchain replaced by a resize. Destroyed once the last frame which rendered to it has completed.
+	struct RetiredSwapchain {
+		vk::UniqueSwapchainKHR pSwapchain;
+		std::vector<vk::UniqueImageView> pColorImageViews;
+		std::vector<vk::UniqueSemaphore> pRenderFinished;
+		uint64_t frameNumber = 0;
+	};
+
+	/// Copy of a presented image on its way back to the host.
+	struct CaptureVk {
+		std::string path;
+		vk::UniqueCommandPool pCommandPool;
+		vk::UniqueCommandBuffer pCommandBuffer;
+		/// Graphics timeline value signaled once the copy has completed.
+		uint64_t value = 0;
+		vk::Buffer buffer;
+		AllocationVk allocation;
+		vk::Extent2D extent;
+	};
+
+	/// Creates the swapchain and resizes the frame graph to match, retiring the previous ones.
+	/// Returns false while the window has no area.
+	bool createSwapchain();
+	/// Creates the offscreen color images rendered to in place of a swapchain when headless.
+	bool createOffscreenImages();
+	/// Declares and compiles the passes of a frame. Runs once, resizes only recreate the textures.
+	bool createFrameGraph();
+	/// Adds the CPU work of a frame to the driver's task graph, executed by prepareFrame.
+	bool createFrameTasks();
+	/// Records the command buffer of the current frame context. Runs as a frame task.
+	void recordFrame();
+	/// Waits for the copy of a capture to complete and writes it out on a background worker.
+	AsyncTask<void> writeCapture(CaptureVk capture);
+	void releaseSwapchains(uint64_t completedFrameNumber);
+	/// Draws the batches of the scene belonging to drawPass.
+	void recordScene(const RenderPassContextVk& context, DrawPass drawPass);
+	/// Shades the G-buffer into the backbuffer with a full screen triangle.
+	void recordLighting(const RenderPassContextVk& context);
+	/// Pass of the frame graph pipelines for drawPass are compiled against.
+	RenderGraph::PassId getGraphPass(DrawPass drawPass) const;
+	/// Compiles the pipeline for a description against its pass of the frame graph. Called on
+	/// threadpool workers by the pipeline state cache.
+	vk::UniquePipeline createPipeline(const PipelineDescription& description);
+
     vk::UniqueInstance m_pInstance;
     std::vector<vk::PhysicalDevice> m_PhysicalDevices;
+	vk::PhysicalDevice m_PhysicalDevice;
     vk::UniqueSurfaceKHR m_pSurface;
     vk::UniqueDevice m_pDevice;
-    vk::UniqueFence m_pFence;
-	vk::UniqueSemaphore m_pSemaphore;
+	std::unique_ptr<AllocatorVk> m_pAllocator;
     vk::UniqueSwapchainKHR m_pSwapchain;
+	/// Whether frames are rendered into m_OffscreenImages rather than a swapchain.
+	bool m_Headless;
+	std::vector<vk::Image> m_OffscreenImages;
+	std::vector<AllocationVk> m_OffscreenAllocations;
+	/// Raised for every capture which has not been written yet.
+	WaitGroup m_Captures;
+	std::vector<vk::Image> m_SwapchainImages;
 	std::vector<vk::UniqueImageView> m_pColorImageViews;
-	vk::UniqueImageView m_pDepthStencilView;
-	vk::Image m_pDepthStencilImage;
-	vk::UniqueDeviceMemory m_pDepthStencilImageView;
+	/// Signaled by the frame rendering each swapchain image and waited on by its present. Kept per 
+	/// image rather than per frame, as a semaphore can only be signaled again once the image it
+	/// was presented with has been acquired again.
+	std::vector<vk::UniqueSemaphore> m_pRenderFinished;
 	vk::Queue m_Queue;
 	vk::UniqueCommandPool m_pCommandPool;
-	vk::UniqueCommandBuffer m_pCommandBuffer;
-	std::vector<vk::UniqueFramebuffer> m_pFramebuffers;
-	vk::UniqueRenderPass m_pRenderPass;
+	/// Passes of a frame, rendering into the swapchain or offscreen image as m_Backbuffer.
+	std::unique_ptr<RenderGraphVk> m_pFrameGraph;
+	RenderGraph::ResourceId m_Backbuffer;
+	/// Albedo, normal and depth, in the order the lighting pass reads them.
+	std::array<RenderGraph::ResourceId, 3> m_GBuffer;
+	RenderGraph::PassId m_GeometryPass;
+	RenderGraph::PassId m_LightingPass;
+	RenderGraph::PassId m_ForwardPass;
+	vk::UniqueDescriptorSetLayout m_pInputAttachmentLayout;
+	vk::UniqueDescriptorPool m_pInputAttachmentPool;
+	std::shared_ptr<const PipelineStateVk> m_pLightingPipeline;
+	vk::UniquePipelineLayout m_pPipelineLayout;
     uint32_t m_QueueFamilyIndex;
 	vk::Format m_ColorFormat;
 	vk::Format m_DepthStencilFormat;
 	vk::Extent2D m_SurfaceDimensions;
+	/// Size of the window from the last resize, used when the surface leaves the extent to the
+	/// swapchain. Zero until the first resize.
+	vk::Extent2D m_WindowDimensions;
+	vk::PresentModeKHR m_PresentMode;
+	bool m_SwapchainOutdated;
+	std::vector<RetiredSwapchain> m_RetiredSwapchains;
+	/// Whether samplers may filter anisotropically, and up to which level.
     bool anisotropy;
     float maxAnisotropy;
 	uint32_t m_ImageCount;
 	uint32_t m_CurrentImage;
 	std::array<float, 4> m_ClearColor;
+	std::unique_ptr<GpuTimelineVk> m_pGraphicsTimeline;
+	/// Null when transfers go through the graphics queue and share its timeline.
+	std::unique_ptr<GpuTimelineVk> m_pTransferTimeline;
+	std::unique_ptr<FenceWatcherVk> m_pFenceWatcher;
+	std::unique_ptr<UploadVk> m_pUpload;
+	std::unique_ptr<PipelineCacheVk> m_pPipelineCache;
+	std::unique_ptr<BindlessVk> m_pBindless;
+	std::unique_ptr<GpuProfilerVk> m_pProfiler;
+	std::unique_ptr<PipelineManifest> m_pPipelineManifest;
+	std::unique_ptr<PipelineStateCacheVk> m_pPipelineStates;
+	std::unique_ptr<GpuSceneVk> m_pScene;
+	std::vector<FrameContext> m_Frames;
+	uint32_t m_FrameIndex;
+	uint64_t m_FrameNumber;
 };
\ No newline at end of file
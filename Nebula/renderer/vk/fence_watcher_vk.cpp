@@ -0,0 +1,63 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "fence_watcher_vk.hpp"
+
+FenceWatcherVk::FenceWatcherVk(vk::Device device, ThreadPool* pPool) : m_Device(device), m_pPool(pPool) {}
+
+bool FenceWatcherVk::Awaiter::await_ready() const {
+	return pWatcher->isSignaled(*this);
+}
+
+void FenceWatcherVk::Awaiter::await_suspend(std::coroutine_handle<> handle) {
+	std::lock_guard<std::mutex> lock(pWatcher->m_Mutex);
+	pWatcher->m_Waiting.emplace_back(*this, handle);
+}
+
+FenceWatcherVk::Awaiter FenceWatcherVk::wait(vk::Fence fence) {
+	return Awaiter{ this, fence, nullptr, 0 };
+}
+
+FenceWatcherVk::Awaiter FenceWatcherVk::wait(GpuTimelineVk* pTimeline, uint64_t value) {
+	return Awaiter{ this, nullptr, pTimeline, value };
+}
+
+void FenceWatcherVk::poll() {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (size_t i = 0; i < m_Waiting.size();) {
+		if (isSignaled(m_Waiting[i].first)) {
+			std::coroutine_handle<> handle = m_Waiting[i].second;
+			m_pPool->enqueue([handle] { handle.resume(); }, TaskPriority::eNormal);
+			m_Waiting[i] = m_Waiting.back();
+			m_Waiting.pop_back();
+		} else
+			i++;
+	}
+}
+
+bool FenceWatcherVk::isSignaled(const Awaiter& awaiter) const {
+	if (awaiter.pTimeline)
+		return awaiter.pTimeline->isComplete(awaiter.value);
+	return m_Device.getFenceStatus(awaiter.fence) == vk::Result::eSuccess;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <coroutine>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "util/thread_pool.hpp"
+#include "gpu_timeline_vk.hpp"
+
+/// Lets coroutines wait on Vulkan fences and timeline values without blocking a thread. Awaiting
+/// a fence or value which has not signaled yet parks the coroutine in the watcher, and poll() 
+/// resumes every parked coroutine whose wait is over on the threadpool. The driver polls once 
+/// per frame.
+class FenceWatcherVk {
+public:
+	FenceWatcherVk(vk::Device device, ThreadPool* pPool);
+
+	struct Awaiter {
+		FenceWatcherVk* pWatcher;
+		vk::Fence fence;
+		GpuTimelineVk* pTimeline;
+		uint64_t value;
+
+		bool await_ready() const;
+		void await_suspend(std::coroutine_handle<> handle);
+		void await_resume() const noexcept {}
+	};
+
+	/// Returns an awaitable which completes once fence has been signaled.
+	Awaiter wait(vk::Fence fence);
+	/// Returns an awaitable which completes once value has completed on pTimeline.
+	Awaiter wait(GpuTimelineVk* pTimeline, uint64_t value);
+
+	/// Resumes every waiting coroutine whose fence has been signaled.
+	void poll();
+private:
+	bool isSignaled(const Awaiter& awaiter) const;
+
+	vk::Device m_Device;
+	ThreadPool* m_pPool;
+	std::mutex m_Mutex;
+	std::vector<std::pair<Awaiter, std::coroutine_handle<>>> m_Waiting;
+};
@@ -0,0 +1,152 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gpu_profiler_vk.hpp"
+
+#include <algorithm>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+GpuProfilerVk::Scope::Scope(GpuProfilerVk* pProfiler, vk::CommandBuffer commandBuffer, const char* pName) : m_pProfiler(pProfiler),
+	m_CommandBuffer(commandBuffer) {
+	m_Scope = m_pProfiler->beginScope(m_CommandBuffer, pName);
+}
+
+GpuProfilerVk::Scope::~Scope() {
+	m_pProfiler->endScope(m_CommandBuffer, m_Scope);
+}
+
+GpuProfilerVk::GpuProfilerVk(vk::PhysicalDevice physicalDevice, vk::Device device, uint32_t queueFamilyIndex, uint32_t frameCount,
+	uint32_t maxScopes) : m_Device(device), m_MaxScopes(maxScopes), m_FrameCount(frameCount), m_FrameIndex(0) {
+	vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+	uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+	m_Supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+	m_TimestampPeriod = properties.limits.timestampPeriod;
+	m_TimestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+	m_ReportedAt = std::chrono::steady_clock::now();
+	if (!m_Supported) {
+		LOG_F(WARNING, "Queue family %u does not support timestamps, GPU profiling is disabled.", queueFamilyIndex);
+		return;
+	}
+
+	// Every scope takes a pair of queries.
+	vk::QueryPoolCreateInfo poolInfo;
+	poolInfo.queryType = vk::QueryType::eTimestamp;
+	poolInfo.queryCount = frameCount * maxScopes * 2;
+	m_pQueryPool = m_Device.createQueryPoolUnique(poolInfo);
+
+	m_pFrames = std::make_unique<FrameQueries[]>(frameCount);
+	for (uint32_t i = 0; i < frameCount; i++) {
+		m_pFrames[i].pScopes = std::make_unique<ScopeRecord[]>(maxScopes);
+		m_pFrames[i].scopeCount = 0;
+		m_pFrames[i].recorded = false;
+	}
+	m_Results.resize(maxScopes * 2);
+}
+
+bool GpuProfilerVk::isSupported() const {
+	return m_Supported;
+}
+
+void GpuProfilerVk::beginFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex) {
+	if (!m_Supported)
+		return;
+
+	m_FrameIndex = frameIndex;
+	FrameQueries& frame = m_pFrames[frameIndex];
+	uint32_t firstQuery = frameIndex * m_MaxScopes * 2;
+	if (frame.recorded)
+		resolve(frame, firstQuery);
+
+	commandBuffer.resetQueryPool(m_pQueryPool.get(), firstQuery, m_MaxScopes * 2);
+	frame.scopeCount = 0;
+	frame.recorded = true;
+}
+
+uint32_t GpuProfilerVk::beginScope(vk::CommandBuffer commandBuffer, const char* pName, vk::PipelineStageFlagBits stage) {
+	if (!m_Supported)
+		return kInvalidScope;
+
+	FrameQueries& frame = m_pFrames[m_FrameIndex];
+	uint32_t scope = frame.scopeCount.fetch_add(1, std::memory_order_relaxed);
+	if (scope >= m_MaxScopes)
+		return kInvalidScope;
+	frame.pScopes[scope].pName = pName;
+	commandBuffer.writeTimestamp(stage, m_pQueryPool.get(), (m_FrameIndex * m_MaxScopes + scope) * 2);
+	return scope;
+}
+
+void GpuProfilerVk::endScope(vk::CommandBuffer commandBuffer, uint32_t scope, vk::PipelineStageFlagBits stage) {
+	if (scope == kInvalidScope)
+		return;
+	commandBuffer.writeTimestamp(stage, m_pQueryPool.get(), (m_FrameIndex * m_MaxScopes + scope) * 2 + 1);
+}
+
+void GpuProfilerVk::resolve(FrameQueries& frame, uint32_t firstQuery) {
+	uint32_t scopeCount = std::min(frame.scopeCount.load(std::memory_order_relaxed), m_MaxScopes);
+	m_Timings.clear();
+	if (scopeCount == 0)
+		return;
+
+	// The frame has completed, so every query is available and this does not wait.
+	vk::Result result = m_Device.getQueryPoolResults(m_pQueryPool.get(), firstQuery, scopeCount * 2, 
+		scopeCount * 2 * sizeof(uint64_t), m_Results.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+	if (result != vk::Result::eSuccess)
+		return;
+
+	for (uint32_t i = 0; i < scopeCount; i++) {
+		uint64_t ticks = (m_Results[i * 2 + 1] - m_Results[i * 2]) & m_TimestampMask;
+		double milliseconds = static_cast<double>(ticks) * m_TimestampPeriod / 1000000.0;
+		const char* pName = frame.pScopes[i].pName;
+		m_Timings.push_back({ pName, milliseconds, addSample(pName, milliseconds) });
+	}
+}
+
+double GpuProfilerVk::addSample(const char* pName, double milliseconds) {
+	Average& average = m_Averages[pName];
+	if (average.samples.size() < kAverageWindow)
+		average.samples.push_back(milliseconds);
+	else {
+		average.sum -= average.samples[average.next];
+		average.samples[average.next] = milliseconds;
+	}
+	average.next = (average.next + 1) % kAverageWindow;
+	average.sum += milliseconds;
+	return average.sum / static_cast<double>(average.samples.size());
+}
+
+const std::vector<GpuTimingVk>& GpuProfilerVk::getTimings() const {
+	return m_Timings;
+}
+
+void GpuProfilerVk::reportTimings() {
+	auto now = std::chrono::steady_clock::now();
+	if (!m_Supported || m_Timings.empty() || now - m_ReportedAt < std::chrono::seconds(5))
+		return;
+	m_ReportedAt = now;
+
+	LOG_F(INFO, "GPU timings:");
+	for (const GpuTimingVk& timing : m_Timings)
+		LOG_F(INFO, "\t%-24s %7.3fms (average %7.3fms)", timing.name.c_str(), timing.milliseconds, timing.averageMilliseconds);
+}
@@ -0,0 +1,124 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+/// Timing of a single scope from the most recently resolved frame.
+struct GpuTimingVk {
+	std::string name;
+	double milliseconds;
+	/// Average over the last kAverageWindow frames in which the scope was recorded.
+	double averageMilliseconds;
+};
+
+/// Measures GPU time spent in passes and named regions with timestamp queries. Every frame in
+/// flight owns a range of the query pool, and a frame's results are read back when its context
+/// comes around again. Its last frame has been waited on by then, so reading never stalls, and the
+/// timings lag the CPU by the number of frames in flight.
+class GpuProfilerVk {
+public:
+	static constexpr uint32_t kInvalidScope = UINT32_MAX;
+	static constexpr size_t kAverageWindow = 64;
+
+	/// Opens a scope on construction and closes it on destruction.
+	class Scope {
+	public:
+		Scope(GpuProfilerVk* pProfiler, vk::CommandBuffer commandBuffer, const char* pName);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		GpuProfilerVk* m_pProfiler;
+		vk::CommandBuffer m_CommandBuffer;
+		uint32_t m_Scope;
+	};
+
+	/// maxScopes bounds the scopes recorded in a single frame, any more are ignored.
+	GpuProfilerVk(vk::PhysicalDevice physicalDevice, vk::Device device, uint32_t queueFamilyIndex, uint32_t frameCount, 
+		uint32_t maxScopes = 256);
+
+	/// Returns false when the queue cannot write timestamps, in which case every call is a no-op.
+	bool isSupported() const;
+
+	/// Resolves the frame which last used the context and resets its queries. Must be called 
+	/// after the context's previous frame has completed, outside of a render pass, before any 
+	/// scope of the frame is recorded.
+	void beginFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex);
+
+	/// Writes the starting timestamp of a scope. pName must outlive the frame. Safe to call
+	/// from multiple threads while recording secondary command buffers.
+	uint32_t beginScope(vk::CommandBuffer commandBuffer, const char* pName, 
+		vk::PipelineStageFlagBits stage = vk::PipelineStageFlagBits::eTopOfPipe);
+	void endScope(vk::CommandBuffer commandBuffer, uint32_t scope, 
+		vk::PipelineStageFlagBits stage = vk::PipelineStageFlagBits::eBottomOfPipe);
+
+	/// Returns the scopes of the most recently resolved frame in the order they were begun.
+	const std::vector<GpuTimingVk>& getTimings() const;
+
+	/// Logs the latest timings and their averages every few seconds. Called once per frame.
+	void reportTimings();
+private:
+	struct ScopeRecord {
+		const char* pName;
+	};
+
+	struct FrameQueries {
+		std::unique_ptr<ScopeRecord[]> pScopes;
+		std::atomic<uint32_t> scopeCount;
+		bool recorded;
+	};
+
+	struct Average {
+		std::vector<double> samples;
+		size_t next = 0;
+		double sum = 0.0;
+	};
+
+	void resolve(FrameQueries& frame, uint32_t firstQuery);
+	double addSample(const char* pName, double milliseconds);
+
+	vk::Device m_Device;
+	vk::UniqueQueryPool m_pQueryPool;
+	bool m_Supported;
+	double m_TimestampPeriod;
+	uint64_t m_TimestampMask;
+	uint32_t m_MaxScopes;
+	std::unique_ptr<FrameQueries[]> m_pFrames;
+	uint32_t m_FrameCount;
+	uint32_t m_FrameIndex;
+	std::vector<GpuTimingVk> m_Timings;
+	std::unordered_map<std::string, Average> m_Averages;
+	std::vector<uint64_t> m_Results;
+	std::chrono::steady_clock::time_point m_ReportedAt;
+};
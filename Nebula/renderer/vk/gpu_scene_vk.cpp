@@ -0,0 +1,496 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gpu_scene_vk.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+#include "helper_vk.hpp"
+
+namespace {
+	/// Compiled from shaders/cull.hlsl.
+	constexpr const char* kCullShader = "shaders/cull.cs.spv";
+	constexpr uint32_t kCullGroupSize = 64;
+	constexpr uint32_t kMaxInstances = 1024 * 1024;
+	constexpr uint32_t kInitialInstanceCapacity = 1024;
+	constexpr uint32_t kInitialBatchCapacity = 64;
+	/// vkCmdUpdateBuffer writes at most 64KB at a time.
+	constexpr vk::DeviceSize kMaxUpdateSize = 65536;
+	/// Tables are only replaced while growing, so few sets are ever alive at once.
+	constexpr uint32_t kMaxTableSets = 8;
+
+	/// Push constants of the culling shader.
+	struct CullConstants {
+		std::array<glm::fvec4, 6> planes;
+		uint32_t instanceCount;
+		uint32_t reserved[3];
+	};
+	static_assert(sizeof(CullConstants) <= 128, "CullConstants must fit the minimum push constant size.");
+}
+
+GpuSceneVk::GpuSceneVk(vk::PhysicalDevice physicalDevice, vk::Device device, AllocatorVk* pAllocator, UploadVk* pUpload,
+	BindlessVk* pBindless, PipelineCacheVk* pPipelineCache, bool drawIndirectCount, uint32_t vertexCapacity, 
+	uint32_t indexCapacity) : m_Device(device), m_pAllocator(pAllocator), m_pUpload(pUpload), m_pBindless(pBindless), 
+	m_DrawIndirectCount(false), m_VertexRanges(vertexCapacity), m_IndexRanges(indexCapacity), m_InstanceSlots(kMaxInstances), 
+	m_SlotCount(0), m_InstanceCount(0), m_BatchesDirty(false), m_Culled(false), m_RecordingFrameNumber(0) {
+	// Without multiDrawIndirect every indirect draw covers a single command.
+	m_MultiDrawIndirect = physicalDevice.getFeatures().multiDrawIndirect;
+	m_MaxDrawIndirectCount = m_MultiDrawIndirect ? physicalDevice.getProperties().limits.maxDrawIndirectCount : 1;
+#ifdef VK_KHR_draw_indirect_count
+	// Entry points of device extensions are not exported by the loader.
+	m_pDrawIndexedIndirectCount = nullptr;
+	if (drawIndirectCount)
+		m_pDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+			m_Device.getProcAddr("vkCmdDrawIndexedIndirectCountKHR"));
+	// A count draws at most maxDrawIndirectCount commands, which is one without multiDrawIndirect,
+	// so only the first visible instance of each batch would be drawn.
+	m_DrawIndirectCount = m_pDrawIndexedIndirectCount != nullptr && m_MultiDrawIndirect;
+#endif
+	if (m_DrawIndirectCount)
+		LOG_F(INFO, "Drawing the scene with vkCmdDrawIndexedIndirectCountKHR.");
+	else if (m_MultiDrawIndirect)
+		LOG_F(INFO, "Drawing the scene with multiDrawIndirect.");
+	else
+		LOG_F(WARNING, "multiDrawIndirect is not supported, recording one draw per instance.");
+
+	if (!createGeometryBuffer(static_cast<vk::DeviceSize>(vertexCapacity) * sizeof(Vertex), vk::BufferUsageFlagBits::eVertexBuffer,
+		m_pVertexBuffer, m_VertexAllocation) || !createGeometryBuffer(static_cast<vk::DeviceSize>(indexCapacity) * sizeof(uint16_t),
+		vk::BufferUsageFlagBits::eIndexBuffer, m_pIndexBuffer, m_IndexAllocation))
+		LOG_F(ERROR, "Failed to allocate the scene's geometry buffers.");
+
+	// Instances, batch offsets, draw commands and draw counts.
+	std::array<vk::DescriptorSetLayoutBinding, 4> bindings;
+	for (uint32_t i = 0; i < bindings.size(); i++)
+		bindings[i] = vk::DescriptorSetLayoutBinding(i, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute);
+	vk::DescriptorSetLayoutCreateInfo setLayoutInfo;
+	setLayoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	setLayoutInfo.pBindings = bindings.data();
+	m_pCullSetLayout = m_Device.createDescriptorSetLayoutUnique(setLayoutInfo);
+	vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>(bindings.size()) * kMaxTableSets);
+	vk::DescriptorPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
+	poolInfo.maxSets = kMaxTableSets;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	m_pCullPool = m_Device.createDescriptorPoolUnique(poolInfo);
+	vk::PushConstantRange constantRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullConstants));
+	vk::PipelineLayoutCreateInfo layoutInfo;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &m_pCullSetLayout.get();
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &constantRange;
+	m_pCullLayout = m_Device.createPipelineLayoutUnique(layoutInfo);
+
+	if (!std::filesystem::exists(kCullShader))
+		LOG_F(FATAL, "Shader '%s' does not exist, build the shaders of the project first.", kCullShader);
+	else {
+		try {
+			vk::UniqueShaderModule pModule = HelperVk::createShaderModule(m_Device, kCullShader);
+			vk::ComputePipelineCreateInfo pipelineInfo;
+			pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+			pipelineInfo.stage.module = pModule.get();
+			pipelineInfo.stage.pName = "CSMain";
+			pipelineInfo.layout = m_pCullLayout.get();
+			m_pCullPipeline = pPipelineCache->createComputePipeline(pipelineInfo);
+		}
+		catch (const vk::SystemError& error) {
+			LOG_F(FATAL, "Failed to create the culling pipeline: %s", error.what());
+		}
+	}
+	setViewProjection(glm::fmat4(1.0f));
+}
+
+GpuSceneVk::~GpuSceneVk() {
+	// The driver has finished every frame by now.
+	for (std::unique_ptr<Tables>& pTables : m_RetiredTables)
+		destroyTables(*pTables);
+	if (m_pTables) {
+		m_pBindless->remove(BindlessResourceType::eBuffer, m_pTables->bindlessIndex);
+		destroyTables(*m_pTables);
+	}
+	m_pVertexBuffer.reset();
+	m_pIndexBuffer.reset();
+	m_pAllocator->free(m_VertexAllocation);
+	m_pAllocator->free(m_IndexAllocation);
+}
+
+std::optional<uint32_t> GpuSceneVk::addVertices(const std::vector<Vertex>& vertices) {
+	if (vertices.empty() || !m_pVertexBuffer)
+		return std::nullopt;
+	std::optional<uint64_t> offset = m_VertexRanges.allocate(vertices.size());
+	if (!offset.has_value()) {
+		LOG_F(ERROR, "The scene has no room for %zu more vertices.", vertices.size());
+		return std::nullopt;
+	}
+	m_pUpload->uploadBuffer(m_pVertexBuffer.get(), vertices.data(), sizeof(Vertex) * vertices.size(), sizeof(Vertex) * offset.value());
+	return static_cast<uint32_t>(offset.value());
+}
+
+std::optional<uint32_t> GpuSceneVk::addIndices(const std::vector<uint16_t>& indices) {
+	if (indices.empty() || !m_pIndexBuffer)
+		return std::nullopt;
+	std::optional<uint64_t> offset = m_IndexRanges.allocate(indices.size());
+	if (!offset.has_value()) {
+		LOG_F(ERROR, "The scene has no room for %zu more indices.", indices.size());
+		return std::nullopt;
+	}
+	m_pUpload->uploadBuffer(m_pIndexBuffer.get(), indices.data(), sizeof(uint16_t) * indices.size(), sizeof(uint16_t) * offset.value());
+	return static_cast<uint32_t>(offset.value());
+}
+
+void GpuSceneVk::freeVertices(uint32_t offset) {
+	m_RetiredRanges.push_back({ &m_VertexRanges, offset, m_RecordingFrameNumber });
+}
+
+void GpuSceneVk::freeIndices(uint32_t offset) {
+	m_RetiredRanges.push_back({ &m_IndexRanges, offset, m_RecordingFrameNumber });
+}
+
+uint32_t GpuSceneVk::addInstance(std::shared_ptr<const PipelineState<vk::UniquePipeline>> pPipeline, const GpuInstanceVk& instance) {
+	if (!pPipeline || instance.indexCount == 0)
+		return kInvalidInstance;
+	std::optional<uint32_t> slot = m_InstanceSlots.allocate();
+	if (!slot.has_value()) {
+		LOG_F(ERROR, "The scene is full at %u instances.", m_InstanceSlots.getCapacity());
+		return kInvalidInstance;
+	}
+
+	uint32_t batch;
+	if (auto it = m_BatchIndices.find(pPipeline.get()); it != m_BatchIndices.end())
+		batch = it->second;
+	else {
+		// Batches are never removed, there is one per pipeline and pipelines live as long as the cache.
+		batch = static_cast<uint32_t>(m_Batches.size());
+		m_BatchIndices.emplace(pPipeline.get(), batch);
+		Batch newBatch;
+		newBatch.pass = pPipeline->getDescription().drawPass;
+		newBatch.pPipeline = std::move(pPipeline);
+		m_Batches.push_back(std::move(newBatch));
+	}
+	m_Batches[batch].instanceCount++;
+	m_BatchesDirty = true;
+
+	uint32_t index = slot.value();
+	if (index >= m_Instances.size()) {
+		m_Instances.resize(index + 1);
+		m_Dirty.resize(index + 1, false);
+	}
+	m_Instances[index] = instance;
+	m_Instances[index].batch = batch;
+	m_SlotCount = std::max(m_SlotCount, index + 1);
+	m_InstanceCount++;
+	markDirty(index);
+	return index;
+}
+
+void GpuSceneVk::setInstanceConstants(uint32_t instance, const DrawConstants& constants) {
+	if (instance >= m_Instances.size() || m_Instances[instance].indexCount == 0)
+		return;
+	m_Instances[instance].constants = constants;
+	markDirty(instance);
+}
+
+void GpuSceneVk::removeInstance(uint32_t instance) {
+	if (instance >= m_Instances.size() || m_Instances[instance].indexCount == 0)
+		return;
+	// Empty slots are skipped by the culling shader.
+	m_Batches[m_Instances[instance].batch].instanceCount--;
+	m_BatchesDirty = true;
+	m_Instances[instance] = GpuInstanceVk();
+	markDirty(instance);
+	m_InstanceSlots.free(instance, m_RecordingFrameNumber);
+	m_InstanceCount--;
+}
+
+void GpuSceneVk::setViewProjection(const glm::fmat4& viewProjection) {
+	// Planes of the clip volume, -w <= x, y <= w and 0 <= z <= w, pointing inwards.
+	glm::fvec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	glm::fvec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	glm::fvec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	glm::fvec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	m_FrustumPlanes = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2 };
+	for (glm::fvec4& plane : m_FrustumPlanes)
+		plane /= glm::length(glm::fvec3(plane));
+}
+
+void GpuSceneVk::beginFrame(uint64_t recordingFrameNumber, uint64_t completedFrameNumber) {
+	m_RecordingFrameNumber = recordingFrameNumber;
+	m_InstanceSlots.collect(completedFrameNumber);
+	while (!m_RetiredRanges.empty() && m_RetiredRanges.front().frameNumber <= completedFrameNumber) {
+		m_RetiredRanges.front().pRanges->free(m_RetiredRanges.front().offset);
+		m_RetiredRanges.pop_front();
+	}
+	for (auto it = m_RetiredTables.begin(); it != m_RetiredTables.end();) {
+		if ((*it)->frameNumber > completedFrameNumber) {
+			++it;
+			continue;
+		}
+		destroyTables(**it);
+		it = m_RetiredTables.erase(it);
+	}
+}
+
+void GpuSceneVk::cull(vk::CommandBuffer commandBuffer, GpuProfilerVk* pProfiler) {
+	m_Culled = false;
+	if (!m_pCullPipeline || m_SlotCount == 0)
+		return;
+	GpuProfilerVk::Scope scope(pProfiler, commandBuffer, "Culling");
+
+	// Tables are replaced rather than resized, frames in flight keep reading the old ones.
+	uint32_t batchCount = static_cast<uint32_t>(m_Batches.size());
+	if (!m_pTables || m_SlotCount > m_pTables->instanceCapacity || batchCount > m_pTables->batchCapacity) {
+		uint32_t instanceCapacity = m_pTables ? m_pTables->instanceCapacity : kInitialInstanceCapacity;
+		while (instanceCapacity < m_SlotCount)
+			instanceCapacity *= 2;
+		uint32_t batchCapacity = m_pTables ? m_pTables->batchCapacity : kInitialBatchCapacity;
+		while (batchCapacity < batchCount)
+			batchCapacity *= 2;
+		std::unique_ptr<Tables> pTables = createTables(instanceCapacity, batchCapacity);
+		if (!pTables)
+			return;
+		if (m_pTables) {
+			m_pBindless->remove(BindlessResourceType::eBuffer, m_pTables->bindlessIndex);
+			m_pTables->frameNumber = m_RecordingFrameNumber;
+			m_RetiredTables.push_back(std::move(m_pTables));
+		}
+		m_pTables = std::move(pTables);
+		LOG_F(INFO, "Scene tables sized for %u instances in %u batches.", instanceCapacity, batchCapacity);
+
+		// The new tables start out empty.
+		for (uint32_t i = 0; i < m_SlotCount; i++)
+			markDirty(i);
+		m_BatchesDirty = true;
+	}
+
+	// Earlier frames may still be reading the tables which are about to be written.
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader | 
+		vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, 
+		vk::DependencyFlags(), nullptr, nullptr, nullptr);
+
+	// Only changed instances are written, updates are recorded into the frame so that they stay
+	// in order with the frames reading the table. Neighbouring slots share a single update.
+	std::sort(m_DirtyInstances.begin(), m_DirtyInstances.end());
+	constexpr uint32_t kMaxUpdateInstances = static_cast<uint32_t>(kMaxUpdateSize / sizeof(GpuInstanceVk));
+	for (size_t i = 0; i < m_DirtyInstances.size();) {
+		uint32_t first = m_DirtyInstances[i];
+		uint32_t count = 1;
+		while (i + count < m_DirtyInstances.size() && m_DirtyInstances[i + count] == first + count && count < kMaxUpdateInstances)
+			count++;
+		commandBuffer.updateBuffer(m_pTables->pInstances.get(), sizeof(GpuInstanceVk) * first, sizeof(GpuInstanceVk) * count,
+			&m_Instances[first]);
+		i += count;
+	}
+	for (uint32_t instance : m_DirtyInstances)
+		m_Dirty[instance] = false;
+	m_DirtyInstances.clear();
+
+	if (m_BatchesDirty) {
+		layoutBatches();
+		std::vector<uint32_t> firstCommands;
+		firstCommands.reserve(m_Batches.size());
+		for (const Batch& batch : m_Batches)
+			firstCommands.push_back(batch.firstCommand);
+		constexpr size_t kMaxUpdateBatches = static_cast<size_t>(kMaxUpdateSize / sizeof(uint32_t));
+		for (size_t first = 0; first < firstCommands.size(); first += kMaxUpdateBatches) {
+			size_t count = std::min(firstCommands.size() - first, kMaxUpdateBatches);
+			commandBuffer.updateBuffer(m_pTables->pBatches.get(), sizeof(uint32_t) * first, sizeof(uint32_t) * count, 
+				&firstCommands[first]);
+		}
+		m_BatchesDirty = false;
+	}
+
+	// Draws are appended behind a count, without one the commands which are not written must be empty.
+	commandBuffer.fillBuffer(m_pTables->pCounts.get(), 0, VK_WHOLE_SIZE, 0);
+	if (!m_DrawIndirectCount)
+		commandBuffer.fillBuffer(m_pTables->pCommands.get(), 0, VK_WHOLE_SIZE, 0);
+	vk::MemoryBarrier uploadBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, vk::DependencyFlags(),
+		uploadBarrier, nullptr, nullptr);
+
+	CullConstants constants = {};
+	constants.planes = m_FrustumPlanes;
+	constants.instanceCount = m_SlotCount;
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_pCullPipeline.get());
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_pCullLayout.get(), 0, m_pTables->pDescriptorSet.get(), nullptr);
+	commandBuffer.pushConstants(m_pCullLayout.get(), vk::ShaderStageFlagBits::eCompute, 0, static_cast<uint32_t>(sizeof(constants)), 
+		&constants);
+	commandBuffer.dispatch((m_SlotCount + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+
+	// Vertex and fragment shaders read the instances written by the updates.
+	vk::MemoryBarrier drawBarrier(vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+		vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer, 
+		vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader,
+		vk::DependencyFlags(), drawBarrier, nullptr, nullptr);
+	m_Culled = true;
+}
+
+void GpuSceneVk::draw(vk::CommandBuffer commandBuffer, DrawPass pass, vk::PipelineLayout pipelineLayout) const {
+	if (!m_Culled)
+		return;
+
+	constexpr vk::DeviceSize kStride = sizeof(vk::DrawIndexedIndirectCommand);
+	bool bound = false;
+	for (uint32_t i = 0; i < m_Batches.size(); i++) {
+		const Batch& batch = m_Batches[i];
+		if (batch.pass != pass || batch.instanceCount == 0 || !batch.pPipeline->isReady())
+			continue;
+		if (!bound) {
+			vk::DeviceSize offset = 0;
+			commandBuffer.bindVertexBuffers(0, 1, &m_pVertexBuffer.get(), &offset);
+			commandBuffer.bindIndexBuffer(m_pIndexBuffer.get(), 0, vk::IndexType::eUint16);
+			bound = true;
+		}
+
+		// Shaders reach their own constants through the instance table.
+		DrawConstants constants;
+		constants.instanceIndex = m_pTables->bindlessIndex;
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, batch.pPipeline->get().get());
+		commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eAllGraphics, 0, 
+			static_cast<uint32_t>(sizeof(DrawConstants)), &constants);
+		vk::DeviceSize commandOffset = kStride * batch.firstCommand;
+#ifdef VK_KHR_draw_indirect_count
+		if (m_DrawIndirectCount) {
+			m_pDrawIndexedIndirectCount(static_cast<VkCommandBuffer>(commandBuffer), static_cast<VkBuffer>(m_pTables->pCommands.get()), 
+				commandOffset, static_cast<VkBuffer>(m_pTables->pCounts.get()), sizeof(uint32_t) * i, 
+				std::min(batch.instanceCount, m_MaxDrawIndirectCount), static_cast<uint32_t>(kStride));
+			continue;
+		}
+#endif
+		// Commands past the visible instances of the batch were cleared and draw nothing.
+		for (uint32_t first = 0; first < batch.instanceCount; first += m_MaxDrawIndirectCount) {
+			uint32_t count = std::min(batch.instanceCount - first, m_MaxDrawIndirectCount);
+			commandBuffer.drawIndexedIndirect(m_pTables->pCommands.get(), commandOffset + kStride * first, count, 
+				static_cast<uint32_t>(kStride));
+		}
+	}
+}
+
+uint32_t GpuSceneVk::getInstanceCount() const {
+	return m_InstanceCount;
+}
+
+bool GpuSceneVk::createGeometryBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::UniqueBuffer& pBuffer, 
+	AllocationVk& allocation) {
+	// Readable by the graphics queue without an ownership transfer when uploads come from a
+	// separate transfer queue.
+	const std::vector<uint32_t>& queueFamilyIndices = m_pUpload->getQueueFamilyIndices();
+	vk::BufferCreateInfo bufferInfo;
+	bufferInfo.sharingMode = queueFamilyIndices.size() > 1 ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive;
+	bufferInfo.queueFamilyIndexCount = queueFamilyIndices.size() > 1 ? static_cast<uint32_t>(queueFamilyIndices.size()) : 0;
+	bufferInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+	bufferInfo.usage = usage | vk::BufferUsageFlagBits::eTransferDst;
+	bufferInfo.size = size;
+	pBuffer = m_Device.createBufferUnique(bufferInfo);
+	if (auto bufferAllocation = m_pAllocator->allocateForBuffer(pBuffer.get(), vk::MemoryPropertyFlagBits::eDeviceLocal);
+		bufferAllocation.has_value())
+		allocation = bufferAllocation.value();
+	else {
+		pBuffer.reset();
+		return false;
+	}
+	return true;
+}
+
+std::unique_ptr<GpuSceneVk::Tables> GpuSceneVk::createTables(uint32_t instanceCapacity, uint32_t batchCapacity) {
+	auto pTables = std::make_unique<Tables>();
+	pTables->instanceCapacity = instanceCapacity;
+	pTables->batchCapacity = batchCapacity;
+
+	// Only ever touched by the graphics queue.
+	struct TableBuffer {
+		vk::UniqueBuffer* pBuffer;
+		vk::DeviceSize size;
+		vk::BufferUsageFlags usage;
+	};
+	std::array<TableBuffer, 4> buffers = {
+		TableBuffer{ &pTables->pInstances, sizeof(GpuInstanceVk) * instanceCapacity, vk::BufferUsageFlagBits::eStorageBuffer },
+		TableBuffer{ &pTables->pBatches, sizeof(uint32_t) * batchCapacity, vk::BufferUsageFlagBits::eStorageBuffer },
+		TableBuffer{ &pTables->pCommands, sizeof(vk::DrawIndexedIndirectCommand) * instanceCapacity, 
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer },
+		TableBuffer{ &pTables->pCounts, sizeof(uint32_t) * batchCapacity, 
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer },
+	};
+	std::array<vk::DescriptorBufferInfo, 4> bufferInfos;
+	for (size_t i = 0; i < buffers.size(); i++) {
+		vk::BufferCreateInfo bufferInfo;
+		bufferInfo.size = buffers[i].size;
+		bufferInfo.usage = buffers[i].usage | vk::BufferUsageFlagBits::eTransferDst;
+		*buffers[i].pBuffer = m_Device.createBufferUnique(bufferInfo);
+		if (auto allocation = m_pAllocator->allocateForBuffer(buffers[i].pBuffer->get(), vk::MemoryPropertyFlagBits::eDeviceLocal);
+			allocation.has_value())
+			pTables->allocations[i] = allocation.value();
+		else {
+			LOG_F(ERROR, "Failed to allocate scene tables for %u instances.", instanceCapacity);
+			destroyTables(*pTables);
+			return nullptr;
+		}
+		bufferInfos[i] = vk::DescriptorBufferInfo(buffers[i].pBuffer->get(), 0, VK_WHOLE_SIZE);
+	}
+
+	if (auto index = m_pBindless->addBuffer(pTables->pInstances.get()); index.has_value())
+		pTables->bindlessIndex = index.value();
+	else {
+		LOG_F(ERROR, "The bindless buffer table is full, the scene tables cannot be registered.");
+		destroyTables(*pTables);
+		return nullptr;
+	}
+
+	vk::DescriptorSetAllocateInfo setInfo(m_pCullPool.get(), 1, &m_pCullSetLayout.get());
+	pTables->pDescriptorSet = std::move(m_Device.allocateDescriptorSetsUnique(setInfo).front());
+	std::array<vk::WriteDescriptorSet, 4> writes;
+	for (uint32_t i = 0; i < writes.size(); i++)
+		writes[i] = vk::WriteDescriptorSet(pTables->pDescriptorSet.get(), i, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, 
+			&bufferInfos[i]);
+	m_Device.updateDescriptorSets(writes, nullptr);
+	return pTables;
+}
+
+void GpuSceneVk::destroyTables(Tables& tables) {
+	// Buffers must be gone before their memory is handed back to the allocator.
+	tables.pDescriptorSet.reset();
+	for (vk::UniqueBuffer* pBuffer : { &tables.pInstances, &tables.pBatches, &tables.pCommands, &tables.pCounts })
+		pBuffer->reset();
+	for (const AllocationVk& allocation : tables.allocations)
+		m_pAllocator->free(allocation);
+	tables.allocations = {};
+}
+
+void GpuSceneVk::markDirty(uint32_t instance) {
+	if (m_Dirty[instance])
+		return;
+	m_Dirty[instance] = true;
+	m_DirtyInstances.push_back(instance);
+}
+
+void GpuSceneVk::layoutBatches() {
+	uint32_t firstCommand = 0;
+	for (Batch& batch : m_Batches) {
+		batch.firstCommand = firstCommand;
+		firstCommand += batch.instanceCount;
+	}
+}
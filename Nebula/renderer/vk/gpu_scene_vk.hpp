@@ -0,0 +1,203 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "thirdparty/glm/glm.hpp"
+#include "renderer/bindless.hpp"
+#include "renderer/pipeline_state_cache.hpp"
+#include "renderer/renderable.hpp"
+#include "util/index_allocator.hpp"
+#include "util/range_allocator.hpp"
+#include "allocator_vk.hpp"
+#include "bindless_vk.hpp"
+#include "gpu_profiler_vk.hpp"
+#include "pipeline_cache_vk.hpp"
+#include "upload_vk.hpp"
+
+/// Everything the GPU needs to cull and draw one instance. Must match shaders/gpu_scene.hlsli.
+struct GpuInstanceVk {
+	/// Axis aligned bounds of the mesh, in the space the vertex shader receives positions.
+	glm::fvec3 boundsCenter = glm::fvec3(0.0f);
+	uint32_t batch = 0;
+	glm::fvec3 boundsExtent = glm::fvec3(0.0f);
+	/// Zero for slots which hold no instance.
+	uint32_t indexCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t reserved[2] = {};
+	DrawConstants constants;
+};
+static_assert(sizeof(GpuInstanceVk) == 64, "GpuInstanceVk must match the shader declaration.");
+
+/// Every mesh and instance of the scene, kept on the GPU so that the CPU cost of a frame does
+/// not grow with the number of objects.
+///
+/// Meshes are packed into one shared vertex buffer and one shared index buffer. Instances live 
+/// in a storage buffer which is only written where they change. Each frame a compute pass tests
+/// every instance against the frustum and appends an indexed indirect draw for the visible ones
+/// to the region of its batch, the instances sharing a pipeline, counting them as it goes. Each
+/// batch is then drawn with a single vkCmdDrawIndexedIndirectCountKHR, which also needs
+/// multiDrawIndirect. Without VK_KHR_draw_indirect_count the regions are cleared first and 
+/// drawn whole with multiDrawIndirect, where empty commands draw nothing, and without 
+/// multiDrawIndirect one indirect draw is recorded per instance.
+///
+/// Vertex shaders find their instance through SV_InstanceID, which starts at firstInstance,
+/// in the buffer table entry passed as DrawConstants::instanceIndex. Must be used from the
+/// thread recording frames.
+class GpuSceneVk {
+public:
+	static constexpr uint32_t kInvalidInstance = UINT32_MAX;
+
+	/// Capacities of the shared vertex and index buffers are in vertices and indices.
+	GpuSceneVk(vk::PhysicalDevice physicalDevice, vk::Device device, AllocatorVk* pAllocator, UploadVk* pUpload, 
+		BindlessVk* pBindless, PipelineCacheVk* pPipelineCache, bool drawIndirectCount, uint32_t vertexCapacity = 1024 * 1024, 
+		uint32_t indexCapacity = 4 * 1024 * 1024);
+	~GpuSceneVk();
+	GpuSceneVk(const GpuSceneVk&) = delete;
+	GpuSceneVk& operator=(const GpuSceneVk&) = delete;
+
+	/// Uploads vertices into the shared vertex buffer, returning the offset of the first one.
+	std::optional<uint32_t> addVertices(const std::vector<Vertex>& vertices);
+	/// Uploads indices into the shared index buffer, returning the offset of the first one.
+	std::optional<uint32_t> addIndices(const std::vector<uint16_t>& indices);
+	/// Releases vertices or indices returned by addVertices and addIndices once the frames which
+	/// may draw them have completed.
+	void freeVertices(uint32_t offset);
+	void freeIndices(uint32_t offset);
+
+	/// Adds an instance drawn with pPipeline in its pass from the next frame on. The batch
+	/// of instance is filled in. Returns kInvalidInstance once the scene is full.
+	uint32_t addInstance(std::shared_ptr<const PipelineState<vk::UniquePipeline>> pPipeline, const GpuInstanceVk& instance);
+	void setInstanceConstants(uint32_t instance, const DrawConstants& constants);
+	void removeInstance(uint32_t instance);
+
+	/// Culls against the planes of a clip space frustum, the identity when the vertices are
+	/// already in clip space.
+	void setViewProjection(const glm::fmat4& viewProjection);
+
+	/// Releases memory no longer referenced by frames up to completedFrameNumber. 
+	/// recordingFrameNumber is the number the frame about to be recorded will be submitted with.
+	void beginFrame(uint64_t recordingFrameNumber, uint64_t completedFrameNumber);
+
+	/// Writes the instances changed since the last frame and generates the frame's draws. Must be
+	/// recorded outside of a render pass, before any draw.
+	void cull(vk::CommandBuffer commandBuffer, GpuProfilerVk* pProfiler);
+
+	/// Draws every batch of pass whose pipeline has compiled. The bindless set must be bound with
+	/// pipelineLayout, which must have push constants for DrawConstants.
+	void draw(vk::CommandBuffer commandBuffer, DrawPass pass, vk::PipelineLayout pipelineLayout) const;
+
+	uint32_t getInstanceCount() const;
+private:
+	/// Instances sharing a pipeline, whose draws are generated into one region of the command buffer.
+	struct Batch {
+		std::shared_ptr<const PipelineState<vk::UniquePipeline>> pPipeline;
+		DrawPass pass = DrawPass::eForward;
+		uint32_t instanceCount = 0;
+		/// Index of the first draw command of the batch, updated as batches change size.
+		uint32_t firstCommand = 0;
+	};
+
+	/// Buffers sized to the instance and batch capacities, replaced as a whole when either grows.
+	struct Tables {
+		uint32_t instanceCapacity = 0;
+		uint32_t batchCapacity = 0;
+		vk::UniqueBuffer pInstances;
+		vk::UniqueBuffer pBatches;
+		vk::UniqueBuffer pCommands;
+		vk::UniqueBuffer pCounts;
+		std::array<AllocationVk, 4> allocations;
+		vk::UniqueDescriptorSet pDescriptorSet;
+		uint32_t bindlessIndex = kInvalidBindlessIndex;
+		/// Number of the last frame which may use the tables once they have been replaced.
+		uint64_t frameNumber = 0;
+	};
+
+	/// Range of the shared vertex or index buffer released by a frame.
+	struct RetiredRange {
+		RangeAllocator* pRanges;
+		uint64_t offset;
+		uint64_t frameNumber;
+	};
+
+	bool createGeometryBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::UniqueBuffer& pBuffer, AllocationVk& allocation);
+	std::unique_ptr<Tables> createTables(uint32_t instanceCapacity, uint32_t batchCapacity);
+	void destroyTables(Tables& tables);
+	void markDirty(uint32_t instance);
+	/// Lays the batches out one after the other in the command buffer.
+	void layoutBatches();
+
+	vk::Device m_Device;
+	AllocatorVk* m_pAllocator;
+	UploadVk* m_pUpload;
+	BindlessVk* m_pBindless;
+	bool m_DrawIndirectCount;
+	bool m_MultiDrawIndirect;
+	uint32_t m_MaxDrawIndirectCount;
+#ifdef VK_KHR_draw_indirect_count
+	PFN_vkCmdDrawIndexedIndirectCountKHR m_pDrawIndexedIndirectCount;
+#endif
+
+	vk::UniqueBuffer m_pVertexBuffer;
+	vk::UniqueBuffer m_pIndexBuffer;
+	AllocationVk m_VertexAllocation;
+	AllocationVk m_IndexAllocation;
+	RangeAllocator m_VertexRanges;
+	RangeAllocator m_IndexRanges;
+	std::deque<RetiredRange> m_RetiredRanges;
+
+	vk::UniqueDescriptorSetLayout m_pCullSetLayout;
+	vk::UniqueDescriptorPool m_pCullPool;
+	vk::UniquePipelineLayout m_pCullLayout;
+	vk::UniquePipeline m_pCullPipeline;
+	std::array<glm::fvec4, 6> m_FrustumPlanes;
+
+	/// CPU copy of every slot, written to the GPU as slots change.
+	std::vector<GpuInstanceVk> m_Instances;
+	IndexAllocator m_InstanceSlots;
+	/// Slots below this have held an instance at some point and are culled every frame.
+	uint32_t m_SlotCount;
+	uint32_t m_InstanceCount;
+	std::vector<uint32_t> m_DirtyInstances;
+	std::vector<bool> m_Dirty;
+	bool m_BatchesDirty;
+	std::vector<Batch> m_Batches;
+	std::unordered_map<const PipelineState<vk::UniquePipeline>*, uint32_t> m_BatchIndices;
+	std::unique_ptr<Tables> m_pTables;
+	/// Whether this frame's draws were generated, draw records nothing otherwise.
+	bool m_Culled;
+	std::vector<std::unique_ptr<Tables>> m_RetiredTables;
+	uint64_t m_RecordingFrameNumber;
+};
@@ -0,0 +1,211 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gpu_timeline_vk.hpp"
+
+#include <algorithm>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+GpuTimelineVk::GpuTimelineVk(vk::Device device, bool timelineSemaphore) : m_Device(device), m_TimelineSemaphore(false), 
+	m_SubmittedValue(0), m_CompletedValue(0) {
+#ifdef VK_KHR_timeline_semaphore
+	// Entry points of device extensions are not exported by the loader.
+	m_pGetSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+		m_Device.getProcAddr("vkGetSemaphoreCounterValueKHR"));
+	m_pWaitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(m_Device.getProcAddr("vkWaitSemaphoresKHR"));
+	if (timelineSemaphore && m_pGetSemaphoreCounterValue && m_pWaitSemaphores) {
+		vk::SemaphoreTypeCreateInfoKHR typeInfo;
+		typeInfo.semaphoreType = vk::SemaphoreTypeKHR::eTimeline;
+		typeInfo.initialValue = 0;
+		vk::SemaphoreCreateInfo semaphoreInfo;
+		semaphoreInfo.pNext = &typeInfo;
+		m_pSemaphore = m_Device.createSemaphoreUnique(semaphoreInfo);
+		m_TimelineSemaphore = true;
+	}
+#endif
+}
+
+GpuTimelineVk::~GpuTimelineVk() {
+	// Fences and semaphores must not be destroyed while a submission still uses them.
+	wait(m_SubmittedValue);
+}
+
+uint64_t GpuTimelineVk::submit(vk::Queue queue, vk::SubmitInfo submitInfo, const TimelineWaitVk* pWaits, uint32_t waitCount, bool waitable) {
+	uint64_t value = m_SubmittedValue + 1;
+
+	m_WaitSemaphores.assign(submitInfo.pWaitSemaphores, submitInfo.pWaitSemaphores + submitInfo.waitSemaphoreCount);
+	m_WaitStages.assign(submitInfo.pWaitDstStageMask, submitInfo.pWaitDstStageMask + submitInfo.waitSemaphoreCount);
+	m_WaitValues.assign(m_WaitSemaphores.size(), 0);
+	for (uint32_t i = 0; i < waitCount; i++) {
+		const TimelineWaitVk& timelineWait = pWaits[i];
+		if (timelineWait.pTimeline->getCompletedValue() >= timelineWait.value)
+			continue;
+		if (m_TimelineSemaphore && timelineWait.pTimeline->m_TimelineSemaphore) {
+			m_WaitSemaphores.push_back(timelineWait.pTimeline->m_pSemaphore.get());
+			m_WaitStages.push_back(timelineWait.stage);
+			m_WaitValues.push_back(timelineWait.value);
+		} else {
+			timelineWait.pTimeline->takeSemaphores(timelineWait.value, this, value, m_WaitSemaphores);
+			m_WaitStages.resize(m_WaitSemaphores.size(), timelineWait.stage);
+			m_WaitValues.resize(m_WaitSemaphores.size(), 0);
+		}
+	}
+
+	m_SignalSemaphores.assign(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+	m_SignalValues.assign(m_SignalSemaphores.size(), 0);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	vk::Fence fence;
+#ifdef VK_KHR_timeline_semaphore
+	vk::TimelineSemaphoreSubmitInfoKHR timelineInfo;
+	if (m_TimelineSemaphore) {
+		m_SignalSemaphores.push_back(m_pSemaphore.get());
+		m_SignalValues.push_back(value);
+		timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(m_WaitValues.size());
+		timelineInfo.pWaitSemaphoreValues = m_WaitValues.data();
+		timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(m_SignalValues.size());
+		timelineInfo.pSignalSemaphoreValues = m_SignalValues.data();
+		submitInfo.pNext = &timelineInfo;
+	}
+#endif
+	if (!m_TimelineSemaphore) {
+		Submission submission;
+		submission.value = value;
+		if (!m_FreeFences.empty()) {
+			submission.pFence = std::move(m_FreeFences.back());
+			m_FreeFences.pop_back();
+		} else
+			submission.pFence = m_Device.createFenceUnique(vk::FenceCreateInfo());
+		fence = submission.pFence.get();
+		m_Submissions.push_back(std::move(submission));
+
+		if (waitable) {
+			Signal signal;
+			signal.value = value;
+			if (!m_FreeSemaphores.empty()) {
+				signal.pSemaphore = std::move(m_FreeSemaphores.back());
+				m_FreeSemaphores.pop_back();
+			} else
+				signal.pSemaphore = m_Device.createSemaphoreUnique(vk::SemaphoreCreateInfo());
+			m_SignalSemaphores.push_back(signal.pSemaphore.get());
+			m_Signals.push_back(std::move(signal));
+		}
+	}
+
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(m_WaitSemaphores.size());
+	submitInfo.pWaitSemaphores = m_WaitSemaphores.data();
+	submitInfo.pWaitDstStageMask = m_WaitStages.data();
+	submitInfo.signalSemaphoreCount = static_cast<uint32_t>(m_SignalSemaphores.size());
+	submitInfo.pSignalSemaphores = m_SignalSemaphores.data();
+	queue.submit(submitInfo, fence);
+	m_SubmittedValue = value;
+	return value;
+}
+
+bool GpuTimelineVk::isComplete(uint64_t value) {
+	return value <= m_CompletedValue || value <= getCompletedValue();
+}
+
+uint64_t GpuTimelineVk::getCompletedValue() {
+#ifdef VK_KHR_timeline_semaphore
+	if (m_TimelineSemaphore) {
+		uint64_t value = 0;
+		m_pGetSemaphoreCounterValue(m_Device, m_pSemaphore.get(), &value);
+		advanceCompleted(value);
+		return m_CompletedValue;
+	}
+#endif
+	// Someone else is already polling or waiting, their result is as good as ours.
+	std::unique_lock<std::mutex> lock(m_Mutex, std::try_to_lock);
+	if (lock.owns_lock())
+		pollFences();
+	return m_CompletedValue;
+}
+
+uint64_t GpuTimelineVk::getSubmittedValue() const {
+	return m_SubmittedValue;
+}
+
+void GpuTimelineVk::wait(uint64_t value) {
+	if (value == 0 || value <= m_CompletedValue)
+		return;
+
+#ifdef VK_KHR_timeline_semaphore
+	if (m_TimelineSemaphore) {
+		vk::Semaphore semaphore = m_pSemaphore.get();
+		vk::SemaphoreWaitInfoKHR waitInfo;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &value;
+		m_pWaitSemaphores(m_Device, reinterpret_cast<const VkSemaphoreWaitInfoKHR*>(&waitInfo), UINT64_MAX);
+		advanceCompleted(value);
+		return;
+	}
+#endif
+	// Fences are only recycled by pollFences, which needs the lock, so hold it while waiting.
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (const Submission& submission : m_Submissions) {
+		if (submission.value >= value) {
+			m_Device.waitForFences(submission.pFence.get(), true, UINT64_MAX);
+			break;
+		}
+	}
+	pollFences();
+}
+
+bool GpuTimelineVk::hasTimelineSemaphore() const {
+	return m_TimelineSemaphore;
+}
+
+void GpuTimelineVk::takeSemaphores(uint64_t value, GpuTimelineVk* pWaiter, uint64_t waiterValue, std::vector<vk::Semaphore>& semaphores) {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto it = m_Signals.begin(); it != m_Signals.end();) {
+		// A semaphore can be signaled again once the submission which waited on it has completed.
+		if (it->pWaiter && it->waiterValue <= it->pWaiter->m_CompletedValue) {
+			m_FreeSemaphores.push_back(std::move(it->pSemaphore));
+			it = m_Signals.erase(it);
+			continue;
+		}
+		if (!it->pWaiter && it->value <= value) {
+			it->pWaiter = pWaiter;
+			it->waiterValue = waiterValue;
+			semaphores.push_back(it->pSemaphore.get());
+		}
+		++it;
+	}
+}
+
+void GpuTimelineVk::pollFences() {
+	while (!m_Submissions.empty() && m_Device.getFenceStatus(m_Submissions.front().pFence.get()) == vk::Result::eSuccess) {
+		advanceCompleted(m_Submissions.front().value);
+		m_Device.resetFences(m_Submissions.front().pFence.get());
+		m_FreeFences.push_back(std::move(m_Submissions.front().pFence));
+		m_Submissions.pop_front();
+	}
+}
+
+void GpuTimelineVk::advanceCompleted(uint64_t value) {
+	uint64_t completed = m_CompletedValue;
+	while (completed < value && !m_CompletedValue.compare_exchange_weak(completed, value));
+}
@@ -0,0 +1,116 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+class GpuTimelineVk;
+
+/// Point on another timeline a submission waits for before the given stages execute.
+struct TimelineWaitVk {
+	GpuTimelineVk* pTimeline;
+	uint64_t value;
+	vk::PipelineStageFlags stage;
+};
+
+/// Counts the work submitted to a queue. Every submission made through the timeline signals
+/// the next value once it completes, so anything which remembers the value of its submission
+/// can later ask whether it is done without blocking. Backed by a timeline semaphore when the 
+/// device supports VK_KHR_timeline_semaphore. Otherwise every submission signals a fence, and 
+/// submissions which other queues wait on also signal a binary semaphore which is handed to 
+/// the first submission waiting on it.
+class GpuTimelineVk {
+public:
+	GpuTimelineVk(vk::Device device, bool timelineSemaphore);
+	~GpuTimelineVk();
+
+	/// Submits to queue, signaling the returned value once the work has completed. The semaphores
+	/// in submitInfo must be binary semaphores, the waitCount waits in pWaits are added to them.
+	/// Set waitable when other submissions will wait on the value. The caller must hold the mutex
+	/// guarding queue, which also keeps the values in submission order.
+	uint64_t submit(vk::Queue queue, vk::SubmitInfo submitInfo, const TimelineWaitVk* pWaits = nullptr, 
+		uint32_t waitCount = 0, bool waitable = false);
+
+	/// Returns true when the work which signals value has completed. Never blocks.
+	bool isComplete(uint64_t value);
+	/// Returns the highest value known to have completed. Never blocks.
+	uint64_t getCompletedValue();
+	/// Returns the value of the most recent submission.
+	uint64_t getSubmittedValue() const;
+	/// Blocks until value has completed.
+	void wait(uint64_t value);
+
+	/// Whether the timeline is backed by a timeline semaphore rather than fences.
+	bool hasTimelineSemaphore() const;
+private:
+	struct Submission {
+		uint64_t value;
+		vk::UniqueFence pFence;
+	};
+
+	/// Binary semaphore signaled by a waitable submission, until it has been waited on and
+	/// the submission waiting on it has completed.
+	struct Signal {
+		uint64_t value;
+		vk::UniqueSemaphore pSemaphore;
+		GpuTimelineVk* pWaiter = nullptr;
+		uint64_t waiterValue = 0;
+	};
+
+	/// Hands out the binary semaphores of submissions up to value which nothing has waited on
+	/// yet. The submission waiting on them signals waiterValue on pWaiter.
+	void takeSemaphores(uint64_t value, GpuTimelineVk* pWaiter, uint64_t waiterValue, std::vector<vk::Semaphore>& semaphores);
+	/// Fence fallback, retires the submissions whose fence has signaled. Requires m_Mutex.
+	void pollFences();
+	void advanceCompleted(uint64_t value);
+
+	vk::Device m_Device;
+	bool m_TimelineSemaphore;
+	vk::UniqueSemaphore m_pSemaphore;
+#ifdef VK_KHR_timeline_semaphore
+	PFN_vkGetSemaphoreCounterValueKHR m_pGetSemaphoreCounterValue;
+	PFN_vkWaitSemaphoresKHR m_pWaitSemaphores;
+#endif
+	std::atomic<uint64_t> m_SubmittedValue;
+	std::atomic<uint64_t> m_CompletedValue;
+	std::mutex m_Mutex;
+	std::deque<Submission> m_Submissions;
+	std::vector<vk::UniqueFence> m_FreeFences;
+	std::vector<Signal> m_Signals;
+	std::vector<vk::UniqueSemaphore> m_FreeSemaphores;
+	/// Semaphores and values of the submission being built, kept so that submitting does not
+	/// allocate once they have grown. Guarded by the queue mutex held during submit.
+	std::vector<vk::Semaphore> m_WaitSemaphores;
+	std::vector<vk::PipelineStageFlags> m_WaitStages;
+	std::vector<uint64_t> m_WaitValues;
+	std::vector<vk::Semaphore> m_SignalSemaphores;
+	std::vector<uint64_t> m_SignalValues;
+};
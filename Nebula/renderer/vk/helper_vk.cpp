@@ -1,5 +1,7 @@
 #include "helper_vk.hpp"
 
+#include <array>
+#include <cstring>
 #include <fstream>
 #include <streambuf>
 
@@ -34,7 +36,7 @@ bool HelperVk::hasRequiredInstanceExtensions() {
 	return true;
 }
 
-bool HelperVk::hasRequiredDeviceExtensionsAndFeatures(vk::PhysicalDevice physicalDevice) {
+bool HelperVk::hasRequiredDeviceExtensionsAndFeatures(vk::PhysicalDevice physicalDevice, bool presenting) {
 	// Grabbing for logging purposes.
 	vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
 
@@ -105,16 +107,26 @@ bool HelperVk::hasRequiredDeviceExtensionsAndFeatures(vk::PhysicalDevice physica
 			swapchainKHRSupport = true;
 	}
 
-	if (!features.samplerAnisotropy && !swapchainKHRSupport)
+	if (presenting && !swapchainKHRSupport) {
+		LOG_F(WARNING, "[%s] does not support %s.", properties.deviceName, VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 		return false;
+	}
+
+	// Draws generated by culling find their instance through firstInstance.
+	if (!features.drawIndirectFirstInstance) {
+		LOG_F(WARNING, "[%s] does not support drawIndirectFirstInstance.", properties.deviceName);
+		return false;
+	}
 	return true;
 }
 
-vk::UniqueInstance HelperVk::createInstance(SDL_SysWMinfo wmInfo) {
+vk::UniqueInstance HelperVk::createInstance(const SDL_SysWMinfo* pWmInfo) {
 	std::vector<vk::LayerProperties> layerProperties = vk::enumerateInstanceLayerProperties();
 
+	// 1.1 is needed to query extension features, but a 1.0 loader refuses to create the 
+	// instance when asked for it.
 	vk::ApplicationInfo appInfo;
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	appInfo.apiVersion = getInstanceVersion() >= VK_API_VERSION_1_1 ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0;
 
 	std::vector<const char*> instanceExtensions;
 	std::vector<const char*> instanceLayers;
@@ -124,18 +136,21 @@ vk::UniqueInstance HelperVk::createInstance(SDL_SysWMinfo wmInfo) {
 	instanceLayers.push_back("VK_LAYER_LUNARG_standard_validation");
 #endif
 
-	instanceExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+	// Headless instances render offscreen and never create a surface.
+	if (pWmInfo) {
+		instanceExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 
-	switch (wmInfo.subsystem) {
+		switch (pWmInfo->subsystem) {
 #ifdef VK_USE_PLATFORM_MIR_KHR
-	case SDL_SYSWM_MIR: instanceExtensions.push_back(VK_KHR_MIR_SURFACE_EXTENSION_NAME); break;
+		case SDL_SYSWM_MIR: instanceExtensions.push_back(VK_KHR_MIR_SURFACE_EXTENSION_NAME); break;
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
-	case SDL_SYSWM_WAYLAND: instanceExtensions.push_back(VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME); break;
+		case SDL_SYSWM_WAYLAND: instanceExtensions.push_back(VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME); break;
 #elif defined(VK_USE_PLATFORM_WIN32_KHR)
-	case SDL_SYSWM_WINDOWS: instanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME); break;
+		case SDL_SYSWM_WINDOWS: instanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME); break;
 #elif defined(VK_USE_PLATFORM_XLIB_KHR)
-	case SDL_SYSWM_X11: instanceExtensions.push_back(VK_KHR_XLIB_SURFACE_EXTENSION_NAME); break;
+		case SDL_SYSWM_X11: instanceExtensions.push_back(VK_KHR_XLIB_SURFACE_EXTENSION_NAME); break;
 #endif
+		}
 	}
 
 	vk::InstanceCreateInfo instanceInfo;
@@ -171,24 +186,95 @@ vk::UniqueSurfaceKHR HelperVk::createSurface(vk::Instance instance, SDL_SysWMinf
 #endif
 }
 
-vk::UniqueDevice HelperVk::createDevice(vk::PhysicalDevice physicalDevice, uint32_t queueIndex) {
+bool HelperVk::hasDeviceExtension(vk::PhysicalDevice physicalDevice, const char* pExtensionName) {
+	for (const vk::ExtensionProperties& extension : physicalDevice.enumerateDeviceExtensionProperties()) {
+		if (std::strcmp(extension.extensionName, pExtensionName) == 0)
+			return true;
+	}
+	return false;
+}
+
+uint32_t HelperVk::getInstanceVersion() {
+	uint32_t version = VK_API_VERSION_1_0;
+#ifdef VK_VERSION_1_1
+	// Looked up at runtime, linking against it directly would fail to load on 1.0 loaders.
+	auto pEnumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+		vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+	if (pEnumerateInstanceVersion)
+		pEnumerateInstanceVersion(&version);
+#endif
+	return version;
+}
+
+bool HelperVk::supportsDescriptorIndexing(vk::PhysicalDevice physicalDevice) {
+#ifdef VK_EXT_descriptor_indexing
+	if (getInstanceVersion() < VK_API_VERSION_1_1 || physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_1 ||
+		!hasDeviceExtension(physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))
+		return false;
+
+	auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDescriptorIndexingFeaturesEXT>();
+	const auto& indexing = features.get<vk::PhysicalDeviceDescriptorIndexingFeaturesEXT>();
+	return indexing.runtimeDescriptorArray && indexing.descriptorBindingPartiallyBound && 
+		indexing.descriptorBindingUpdateUnusedWhilePending && indexing.descriptorBindingSampledImageUpdateAfterBind && 
+		indexing.descriptorBindingStorageBufferUpdateAfterBind && indexing.shaderSampledImageArrayNonUniformIndexing && 
+		indexing.shaderStorageBufferArrayNonUniformIndexing;
+#else
+	return false;
+#endif
+}
+
+bool HelperVk::supportsDrawIndirectCount(vk::PhysicalDevice physicalDevice) {
+#ifdef VK_KHR_draw_indirect_count
+	return hasDeviceExtension(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+#else
+	return false;
+#endif
+}
+
+bool HelperVk::supportsTimelineSemaphore(vk::PhysicalDevice physicalDevice) {
+#ifdef VK_KHR_timeline_semaphore
+	if (getInstanceVersion() < VK_API_VERSION_1_1 || physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_1 ||
+		!hasDeviceExtension(physicalDevice, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+		return false;
+
+	auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR>();
+	return features.get<vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR>().timelineSemaphore;
+#else
+	return false;
+#endif
+}
+
+vk::UniqueDevice HelperVk::createDevice(vk::PhysicalDevice physicalDevice, uint32_t queueIndex, std::optional<uint32_t> transferQueueIndex,
+	const std::vector<const char*>& extensions, const void* pFeatureChain) {
 	float priority = 1.0f;
-	vk::DeviceQueueCreateInfo deviceQueueInfo;
-	deviceQueueInfo.queueCount = 1;
-	deviceQueueInfo.queueFamilyIndex = queueIndex;
-	deviceQueueInfo.pQueuePriorities = &priority;
+	std::array<vk::DeviceQueueCreateInfo, 2> deviceQueueInfos;
+	deviceQueueInfos[0].queueCount = 1;
+	deviceQueueInfos[0].queueFamilyIndex = queueIndex;
+	deviceQueueInfos[0].pQueuePriorities = &priority;
+
+	// Optional second queue for copies which run alongside graphics work.
+	deviceQueueInfos[1] = deviceQueueInfos[0];
+	if (transferQueueIndex.has_value())
+		deviceQueueInfos[1].queueFamilyIndex = transferQueueIndex.value();
 	
-	std::vector<const char*> enabledDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
-	vk::PhysicalDeviceFeatures enabledFeatures = { enabledFeatures.samplerAnisotropy = VK_TRUE };
+	// Indirect draws start at the instance they were generated for, and several are issued per 
+	// call where the device allows it. Anisotropic filtering is only enabled where supported, 
+	// samplers must check for it.
+	vk::PhysicalDeviceFeatures supportedFeatures = physicalDevice.getFeatures();
+	vk::PhysicalDeviceFeatures enabledFeatures;
+	enabledFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+	enabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
 
 	// Create device.
 	vk::DeviceCreateInfo deviceInfo;
+	deviceInfo.pNext = pFeatureChain;
 	deviceInfo.pEnabledFeatures = &enabledFeatures;
 	deviceInfo.enabledLayerCount = 0;
-	deviceInfo.ppEnabledExtensionNames = enabledDeviceExtensions.data();
-	deviceInfo.enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions.size());
-	deviceInfo.pQueueCreateInfos = &deviceQueueInfo;
-	deviceInfo.queueCreateInfoCount = 1;
+	deviceInfo.ppEnabledExtensionNames = extensions.data();
+	deviceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	deviceInfo.pQueueCreateInfos = deviceQueueInfos.data();
+	deviceInfo.queueCreateInfoCount = transferQueueIndex.has_value() ? 2 : 1;
 	return std::move(physicalDevice.createDeviceUnique(deviceInfo));
 }
 
@@ -241,12 +327,27 @@ std::optional<uint32_t> HelperVk::selectQueueFamilyIndex(vk::PhysicalDevice phys
 	std::vector<vk::QueueFamilyProperties> queueFamilies = physicalDevice.getQueueFamilyProperties();
 	for (uint32_t i = 0; i < static_cast<uint32_t>(queueFamilies.size()); i++) {
 		// Must be both a graphics queue, and support presenting to a surface.
-		if (queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics && physicalDevice.getSurfaceSupportKHR(i, surface))
+		if (queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics && (!surface || physicalDevice.getSurfaceSupportKHR(i, surface)))
 			return i;
 	}
 	return {};
 }
 
+std::optional<uint32_t> HelperVk::selectTransferQueueFamilyIndex(vk::PhysicalDevice physicalDevice, uint32_t graphicsQueueIndex) {
+	std::vector<vk::QueueFamilyProperties> queueFamilies = physicalDevice.getQueueFamilyProperties();
+	std::optional<uint32_t> selected;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(queueFamilies.size()); i++) {
+		if (i == graphicsQueueIndex || !(queueFamilies[i].queueFlags & vk::QueueFlagBits::eTransfer))
+			continue;
+		// Prefer the copy engine, a family which only supports transfers, over async compute.
+		if (!(queueFamilies[i].queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)))
+			return i;
+		if (!selected.has_value() && !(queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics))
+			selected = i;
+	}
+	return selected;
+}
+
 vk::Format HelperVk::selectColorFormat(vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface) {
 	// Grab all available surface formats;
 	auto surfaceFormats = physicalDevice.getSurfaceFormatsKHR(surface);
@@ -340,6 +441,19 @@ std::optional<uint32_t> HelperVk::getMemoryTypeIndex(vk::PhysicalDevice physical
 	return {};
 }
 
+vk::UniqueImageView HelperVk::createImageView(vk::Device device, vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags) {
+	vk::ImageViewCreateInfo viewInfo;
+	viewInfo.image = image;
+	viewInfo.viewType = vk::ImageViewType::e2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = aspectFlags;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+	return std::move(device.createImageViewUnique(viewInfo));
+}
+
 vk::UniqueShaderModule HelperVk::createShaderModule(vk::Device device, const char* pFilePath) {
 	std::ifstream shaderStream(pFilePath, std::ios::binary);
 	std::string shaderContent((std::istreambuf_iterator<char>(shaderStream)),
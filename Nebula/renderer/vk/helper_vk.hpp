@@ -20,17 +20,39 @@
 struct HelperVk {
 public:
 	static bool hasRequiredInstanceExtensions();
-	static bool hasRequiredDeviceExtensionsAndFeatures(vk::PhysicalDevice physicalDevice);
-	static vk::UniqueInstance createInstance(SDL_SysWMinfo wmInfo);
+	/// Returns true when the device can run the driver. VK_KHR_swapchain is only required when 
+	/// presenting, headless rendering does without it.
+	static bool hasRequiredDeviceExtensionsAndFeatures(vk::PhysicalDevice physicalDevice, bool presenting);
+	static bool hasDeviceExtension(vk::PhysicalDevice physicalDevice, const char* pExtensionName);
+	/// Returns the highest Vulkan version supported by the loader, which is 1.0 on loaders that
+	/// predate vkEnumerateInstanceVersion.
+	static uint32_t getInstanceVersion();
+	/// Returns true when VK_EXT_descriptor_indexing has every feature the bindless tables use.
+	static bool supportsDescriptorIndexing(vk::PhysicalDevice physicalDevice);
+	/// Returns true when VK_KHR_draw_indirect_count is available.
+	static bool supportsDrawIndirectCount(vk::PhysicalDevice physicalDevice);
+	/// Returns true when VK_KHR_timeline_semaphore is available and its feature supported.
+	static bool supportsTimelineSemaphore(vk::PhysicalDevice physicalDevice);
+	/// Creates the instance with the surface extensions of the window system, or none of them
+	/// when pWmInfo is null for rendering headless.
+	static vk::UniqueInstance createInstance(const SDL_SysWMinfo* pWmInfo);
 	static vk::UniqueSurfaceKHR createSurface(vk::Instance instance, SDL_SysWMinfo wmInfo);
-	static vk::UniqueDevice createDevice(vk::PhysicalDevice physicalDevice, uint32_t queueIndex);
+	/// Creates the device with the given extensions, VK_KHR_swapchain must be among them unless
+	/// rendering headless.
+	static vk::UniqueDevice createDevice(vk::PhysicalDevice physicalDevice, uint32_t queueIndex, std::optional<uint32_t> transferQueueIndex = {},
+		const std::vector<const char*>& extensions = {}, const void* pFeatureChain = nullptr);
 	static vk::UniqueSwapchainKHR createSwapchain(vk::Device device, vk::SurfaceKHR surface, vk::Extent2D extent,
 		uint32_t numImages, vk::Format format = vk::Format::eR8G8B8A8Unorm, vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo,
 		vk::SwapchainKHR previousSwapchain = nullptr);
 	static std::vector<vk::UniqueImageView> createImageViews(vk::Device device, vk::SwapchainKHR swapchain, vk::Image image = nullptr, vk::Format format = vk::Format::eR8G8B8A8Unorm,
 		vk::ImageAspectFlags aspectFlags = vk::ImageAspectFlagBits::eColor);
+	static vk::UniqueImageView createImageView(vk::Device device, vk::Image image, vk::Format format, 
+		vk::ImageAspectFlags aspectFlags = vk::ImageAspectFlagBits::eColor);
 	static vk::UniqueShaderModule createShaderModule(vk::Device device, const char* pFilePath);
+	/// Selects a graphics queue family which can present to surface, any graphics queue family
+	/// when surface is null.
 	static std::optional<uint32_t> selectQueueFamilyIndex(vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface);
+	static std::optional<uint32_t> selectTransferQueueFamilyIndex(vk::PhysicalDevice physicalDevice, uint32_t graphicsQueueIndex);
 	static vk::Format selectColorFormat(vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface);
 	static std::optional<vk::Format> selectDepthStencilFormat(vk::PhysicalDevice physicalDevice);
 	static vk::PresentModeKHR selectPresentMode(vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, bool vsync = true, bool tripleBuffering = false, 
@@ -0,0 +1,245 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "pipeline_cache_vk.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+namespace {
+	constexpr uint32_t kFileMagic = 0x4350424e; // "NBPC"
+	constexpr uint32_t kFileVersion = 1;
+	constexpr auto kSaveInterval = std::chrono::seconds(60);
+
+	/// Size of VkPipelineCacheHeaderVersionOne, which starts the driver's cache data.
+	constexpr size_t kDriverHeaderSize = 16 + VK_UUID_SIZE;
+
+	uint64_t hashBytes(const uint8_t* pData, size_t size) {
+		// FNV-1a, only used to catch truncated or corrupted files.
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= pData[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	uint32_t readUint32(const uint8_t* pData) {
+		return static_cast<uint32_t>(pData[0]) | static_cast<uint32_t>(pData[1]) << 8 |
+			static_cast<uint32_t>(pData[2]) << 16 | static_cast<uint32_t>(pData[3]) << 24;
+	}
+}
+
+PipelineCacheVk::PipelineCacheVk(vk::PhysicalDevice physicalDevice, vk::Device device, bool creationFeedback) : m_Device(device),
+	m_CreationFeedback(creationFeedback), m_LoadedSize(0), m_PipelineCount(0), m_HitCount(0), m_CreationTime(0), 
+	m_UnsavedCount(0), m_pPool(nullptr) {
+	m_Properties = physicalDevice.getProperties();
+
+	char uuid[VK_UUID_SIZE * 2 + 1];
+	for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+		std::snprintf(uuid + i * 2, 3, "%02x", m_Properties.pipelineCacheUUID[i]);
+	char filename[128];
+	std::snprintf(filename, sizeof(filename), "pipeline_cache_%04x_%04x_%08x_%s.bin", m_Properties.vendorID, 
+		m_Properties.deviceID, m_Properties.driverVersion, uuid);
+	m_Filename = filename;
+
+	std::vector<uint8_t> data = load();
+	vk::PipelineCacheCreateInfo cacheInfo;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+	m_pCache = m_Device.createPipelineCacheUnique(cacheInfo);
+	m_LoadedSize = data.size();
+	m_SavedAt = std::chrono::steady_clock::now();
+	if (m_LoadedSize > 0)
+		LOG_F(INFO, "Loaded %zu bytes of pipeline cache from %s.", m_LoadedSize, m_Filename.c_str());
+	else
+		LOG_F(INFO, "Starting with an empty pipeline cache.");
+}
+
+PipelineCacheVk::~PipelineCacheVk() {
+	// A background save may still be running against the cache.
+	if (m_pPool)
+		m_pPool->wait(m_SaveGroup);
+	logStatistics();
+	if (m_UnsavedCount > 0)
+		save();
+}
+
+vk::PipelineCache PipelineCacheVk::getCache() const {
+	return m_pCache.get();
+}
+
+vk::UniquePipeline PipelineCacheVk::createGraphicsPipeline(vk::GraphicsPipelineCreateInfo pipelineInfo) {
+#ifdef VK_EXT_pipeline_creation_feedback
+	// Ask the driver whether the pipeline came out of the cache.
+	vk::PipelineCreationFeedbackEXT feedback;
+	vk::PipelineCreationFeedbackCreateInfoEXT feedbackInfo;
+	feedbackInfo.pPipelineCreationFeedback = &feedback;
+	if (m_CreationFeedback) {
+		feedbackInfo.pNext = pipelineInfo.pNext;
+		pipelineInfo.pNext = &feedbackInfo;
+	}
+#endif
+
+	auto start = std::chrono::steady_clock::now();
+	vk::UniquePipeline pPipeline = m_Device.createGraphicsPipelineUnique(m_pCache.get(), pipelineInfo);
+	bool cacheHit = false;
+#ifdef VK_EXT_pipeline_creation_feedback
+	cacheHit = m_CreationFeedback && (feedback.flags & vk::PipelineCreationFeedbackFlagBitsEXT::eApplicationPipelineCacheHit);
+#endif
+	recordCreation(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start), cacheHit);
+	return pPipeline;
+}
+
+vk::UniquePipeline PipelineCacheVk::createComputePipeline(vk::ComputePipelineCreateInfo pipelineInfo) {
+#ifdef VK_EXT_pipeline_creation_feedback
+	vk::PipelineCreationFeedbackEXT feedback;
+	vk::PipelineCreationFeedbackCreateInfoEXT feedbackInfo;
+	feedbackInfo.pPipelineCreationFeedback = &feedback;
+	if (m_CreationFeedback) {
+		feedbackInfo.pNext = pipelineInfo.pNext;
+		pipelineInfo.pNext = &feedbackInfo;
+	}
+#endif
+
+	auto start = std::chrono::steady_clock::now();
+	vk::UniquePipeline pPipeline = m_Device.createComputePipelineUnique(m_pCache.get(), pipelineInfo);
+	bool cacheHit = false;
+#ifdef VK_EXT_pipeline_creation_feedback
+	cacheHit = m_CreationFeedback && (feedback.flags & vk::PipelineCreationFeedbackFlagBitsEXT::eApplicationPipelineCacheHit);
+#endif
+	recordCreation(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start), cacheHit);
+	return pPipeline;
+}
+
+void PipelineCacheVk::recordCreation(std::chrono::microseconds elapsed, bool cacheHit) {
+	m_PipelineCount++;
+	m_UnsavedCount++;
+	m_CreationTime += static_cast<uint64_t>(elapsed.count());
+	if (cacheHit)
+		m_HitCount++;
+}
+
+bool PipelineCacheVk::save() {
+	std::lock_guard<std::mutex> lock(m_SaveMutex);
+	m_UnsavedCount = 0;
+	std::vector<uint8_t> data = m_Device.getPipelineCacheData(m_pCache.get());
+
+	FileHeader header = {};
+	header.magic = kFileMagic;
+	header.version = kFileVersion;
+	header.driverVersion = m_Properties.driverVersion;
+	header.dataSize = data.size();
+	header.checksum = hashBytes(data.data(), data.size());
+
+	// Write everything to a temporary file first so that a crash mid-write leaves the 
+	// previous cache intact.
+	std::string temporary = m_Filename + ".tmp";
+	{
+		std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		if (!stream) {
+			LOG_F(WARNING, "Failed to write pipeline cache to %s.", temporary.c_str());
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, m_Filename, error);
+	if (error) {
+		LOG_F(WARNING, "Failed to replace %s: %s", m_Filename.c_str(), error.message().c_str());
+		return false;
+	}
+	LOG_F(INFO, "Saved %zu bytes of pipeline cache to %s.", data.size(), m_Filename.c_str());
+	return true;
+}
+
+void PipelineCacheVk::update(ThreadPool* pPool) {
+	auto now = std::chrono::steady_clock::now();
+	if (m_UnsavedCount == 0 || now - m_SavedAt < kSaveInterval || !m_SaveGroup.isComplete())
+		return;
+
+	m_SavedAt = now;
+	m_pPool = pPool;
+	pPool->enqueue([this] { save(); }, m_SaveGroup, TaskPriority::eBackground);
+}
+
+void PipelineCacheVk::logStatistics() const {
+	uint32_t pipelines = m_PipelineCount;
+	double milliseconds = m_CreationTime / 1000.0;
+	if (m_CreationFeedback) {
+		LOG_F(INFO, "Pipeline cache: %u pipelines created, %u cache hits, %.1fms spent creating (%.2fms average).",
+			pipelines, m_HitCount.load(), milliseconds, pipelines ? milliseconds / pipelines : 0.0);
+	}
+	else {
+		LOG_F(INFO, "Pipeline cache: %u pipelines created, %.1fms spent creating (%.2fms average), started with %zu bytes.",
+			pipelines, milliseconds, pipelines ? milliseconds / pipelines : 0.0, m_LoadedSize);
+	}
+}
+
+std::vector<uint8_t> PipelineCacheVk::load() const {
+	std::ifstream stream(m_Filename, std::ios::binary | std::ios::ate);
+	if (!stream)
+		return {};
+
+	std::streamoff fileSize = stream.tellg();
+	stream.seekg(0);
+	FileHeader header = {};
+	if (fileSize < static_cast<std::streamoff>(sizeof(header)) || !stream.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return {};
+	if (header.magic != kFileMagic || header.version != kFileVersion || header.driverVersion != m_Properties.driverVersion ||
+		header.dataSize != static_cast<uint64_t>(fileSize) - sizeof(header)) {
+		LOG_F(WARNING, "Ignoring pipeline cache %s with a mismatched header.", m_Filename.c_str());
+		return {};
+	}
+
+	std::vector<uint8_t> data(static_cast<size_t>(header.dataSize));
+	if (!stream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())) ||
+		hashBytes(data.data(), data.size()) != header.checksum) {
+		LOG_F(WARNING, "Ignoring corrupted pipeline cache %s.", m_Filename.c_str());
+		return {};
+	}
+	if (!isCompatible(data)) {
+		LOG_F(WARNING, "Ignoring pipeline cache %s which was written by another device or driver.", m_Filename.c_str());
+		return {};
+	}
+	return data;
+}
+
+bool PipelineCacheVk::isCompatible(const std::vector<uint8_t>& data) const {
+	// Validate VkPipelineCacheHeaderVersionOne, drivers are not required to reject data 
+	// which was produced by someone else.
+	if (data.size() < kDriverHeaderSize)
+		return false;
+	uint32_t headerSize = readUint32(data.data());
+	uint32_t headerVersion = readUint32(data.data() + 4);
+	return headerSize >= kDriverHeaderSize && headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		readUint32(data.data() + 8) == m_Properties.vendorID && readUint32(data.data() + 12) == m_Properties.deviceID &&
+		std::memcmp(data.data() + 16, m_Properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "util/thread_pool.hpp"
+#include "util/wait_group.hpp"
+
+/// Owns the VkPipelineCache of a device and persists it between runs. The cache file is 
+/// named after the vendor, device, driver version and pipelineCacheUUID, so a driver update
+/// or a different GPU starts from an empty cache instead of feeding it incompatible data.
+/// Pipelines should be created through this class so that their creation can be measured.
+class PipelineCacheVk {
+public:
+	/// creationFeedback enables per-pipeline cache hit reporting and requires the device to
+	/// have been created with VK_EXT_pipeline_creation_feedback.
+	PipelineCacheVk(vk::PhysicalDevice physicalDevice, vk::Device device, bool creationFeedback);
+	~PipelineCacheVk();
+
+	vk::PipelineCache getCache() const;
+
+	/// Creates a graphics pipeline through the cache. Safe to call from multiple threads.
+	vk::UniquePipeline createGraphicsPipeline(vk::GraphicsPipelineCreateInfo pipelineInfo);
+	/// Creates a compute pipeline through the cache. Safe to call from multiple threads.
+	vk::UniquePipeline createComputePipeline(vk::ComputePipelineCreateInfo pipelineInfo);
+
+	/// Writes the cache to disk, replacing the previous file only once the new one is complete.
+	bool save();
+
+	/// Saves the cache on the background lane of pPool every so often, provided pipelines 
+	/// were created since the previous save. Called once per frame.
+	void update(ThreadPool* pPool);
+
+	/// Logs how many pipelines were created, how many hit the cache and the time spent.
+	void logStatistics() const;
+private:
+	/// Precedes the driver's cache data in the file.
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t driverVersion;
+		uint32_t reserved;
+		uint64_t dataSize;
+		uint64_t checksum;
+	};
+
+	/// Counts a created pipeline towards the statistics.
+	void recordCreation(std::chrono::microseconds elapsed, bool cacheHit);
+	std::vector<uint8_t> load() const;
+	bool isCompatible(const std::vector<uint8_t>& data) const;
+
+	vk::Device m_Device;
+	vk::PhysicalDeviceProperties m_Properties;
+	vk::UniquePipelineCache m_pCache;
+	std::string m_Filename;
+	bool m_CreationFeedback;
+	size_t m_LoadedSize;
+	std::atomic<uint32_t> m_PipelineCount;
+	std::atomic<uint32_t> m_HitCount;
+	std::atomic<uint64_t> m_CreationTime;
+	std::atomic<uint32_t> m_UnsavedCount;
+	std::chrono::steady_clock::time_point m_SavedAt;
+	std::mutex m_SaveMutex;
+	ThreadPool* m_pPool;
+	WaitGroup m_SaveGroup;
+};
@@ -0,0 +1,570 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "render_graph_vk.hpp"
+
+#include <algorithm>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+#include "gpu_profiler_vk.hpp"
+#include "helper_vk.hpp"
+
+namespace {
+	/// How an access looks to the device.
+	struct AccessInfoVk {
+		vk::ImageLayout layout;
+		vk::PipelineStageFlags stages;
+		vk::AccessFlags access;
+	};
+
+	AccessInfoVk getAccessInfo(RenderAccess access, bool depthStencil) {
+		using Stage = vk::PipelineStageFlagBits;
+		using Access = vk::AccessFlagBits;
+		vk::ImageLayout readOnly = depthStencil ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eShaderReadOnlyOptimal;
+		switch (access) {
+		case RenderAccess::eColorAttachment: 
+			return { vk::ImageLayout::eColorAttachmentOptimal, Stage::eColorAttachmentOutput, 
+				Access::eColorAttachmentRead | Access::eColorAttachmentWrite };
+		case RenderAccess::eDepthAttachment: 
+			return { vk::ImageLayout::eDepthStencilAttachmentOptimal, Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, 
+				Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite };
+		case RenderAccess::eDepthRead: 
+			return { vk::ImageLayout::eDepthStencilReadOnlyOptimal, Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, 
+				Access::eDepthStencilAttachmentRead };
+		case RenderAccess::eInputAttachment: 
+			return { readOnly, Stage::eFragmentShader, Access::eInputAttachmentRead };
+		case RenderAccess::eSampled: 
+			return { readOnly, Stage::eFragmentShader | Stage::eComputeShader, Access::eShaderRead };
+		case RenderAccess::eStorageRead: 
+			return { vk::ImageLayout::eGeneral, Stage::eFragmentShader | Stage::eComputeShader, Access::eShaderRead };
+		case RenderAccess::eStorageWrite: 
+			return { vk::ImageLayout::eGeneral, Stage::eFragmentShader | Stage::eComputeShader, 
+				Access::eShaderRead | Access::eShaderWrite };
+		case RenderAccess::eTransferSource: 
+			return { vk::ImageLayout::eTransferSrcOptimal, Stage::eTransfer, Access::eTransferRead };
+		case RenderAccess::eTransferDestination: 
+			return { vk::ImageLayout::eTransferDstOptimal, Stage::eTransfer, Access::eTransferWrite };
+		case RenderAccess::ePresent:
+			// Presentation waits on a semaphore, the image is acquired again at this stage.
+			return { vk::ImageLayout::ePresentSrcKHR, Stage::eColorAttachmentOutput, vk::AccessFlags() };
+		default:
+			return { vk::ImageLayout::eUndefined, Stage::eTopOfPipe, vk::AccessFlags() };
+		}
+	}
+
+	vk::ImageUsageFlags getUsage(RenderAccess access) {
+		switch (access) {
+		case RenderAccess::eColorAttachment: return vk::ImageUsageFlagBits::eColorAttachment;
+		case RenderAccess::eDepthAttachment:
+		case RenderAccess::eDepthRead: return vk::ImageUsageFlagBits::eDepthStencilAttachment;
+		case RenderAccess::eInputAttachment: return vk::ImageUsageFlagBits::eInputAttachment;
+		case RenderAccess::eSampled: return vk::ImageUsageFlagBits::eSampled;
+		case RenderAccess::eStorageRead:
+		case RenderAccess::eStorageWrite: return vk::ImageUsageFlagBits::eStorage;
+		case RenderAccess::eTransferSource: return vk::ImageUsageFlagBits::eTransferSrc;
+		case RenderAccess::eTransferDestination: return vk::ImageUsageFlagBits::eTransferDst;
+		default: return vk::ImageUsageFlags();
+		}
+	}
+
+	/// Bytes per pixel of the formats used for render targets, only used to estimate bandwidth.
+	uint32_t getFormatSize(vk::Format format) {
+		switch (format) {
+		case vk::Format::eD16Unorm: return 2;
+		case vk::Format::eR16G16B16A16Sfloat:
+		case vk::Format::eD32SfloatS8Uint: return 8;
+		case vk::Format::eR32G32B32A32Sfloat: return 16;
+		default: return 4;
+		}
+	}
+
+	bool hasStencil(vk::Format format) {
+		return format == vk::Format::eD16UnormS8Uint || format == vk::Format::eD24UnormS8Uint || 
+			format == vk::Format::eD32SfloatS8Uint || format == vk::Format::eS8Uint;
+	}
+}
+
+RenderGraphVk::RenderGraphVk(vk::Device device, AllocatorVk* pAllocator) : m_Device(device), m_pAllocator(pAllocator) {}
+
+RenderGraphVk::~RenderGraphVk() {
+	release(UINT64_MAX);
+	if (m_pResources)
+		destroyResources(*m_pResources);
+}
+
+RenderGraph& RenderGraphVk::getGraph() {
+	return m_Graph;
+}
+
+void RenderGraphVk::setExecute(RenderGraph::PassId pass, Execute execute, vk::SubpassContents contents) {
+	if (pass >= m_Executes.size()) {
+		m_Executes.resize(pass + 1);
+		m_Contents.resize(pass + 1, vk::SubpassContents::eInline);
+	}
+	m_Executes[pass] = std::move(execute);
+	m_Contents[pass] = contents;
+}
+
+bool RenderGraphVk::compile() {
+	if (!m_Graph.compile())
+		return false;
+
+	m_Executes.resize(m_Graph.getPassCount());
+	m_Contents.resize(m_Graph.getPassCount(), vk::SubpassContents::eInline);
+	m_ImportedImages.resize(m_Graph.getResourceCount());
+	m_ImportedViews.resize(m_Graph.getResourceCount());
+	m_pRenderPasses.clear();
+	m_ClearValues.clear();
+	for (uint32_t i = 0; i < m_Graph.getGroups().size(); i++)
+		createRenderPass(i);
+	return true;
+}
+
+void RenderGraphVk::createRenderPass(uint32_t groupIndex) {
+	const RenderGraph::Group& group = m_Graph.getGroups()[groupIndex];
+	m_pRenderPasses.emplace_back();
+	m_ClearValues.emplace_back();
+	if (!group.renderPass)
+		return;
+
+	std::vector<vk::AttachmentDescription> descriptions;
+	for (const RenderGraph::Attachment& attachment : group.attachments) {
+		const RenderTextureDescription& texture = m_Graph.getResourceDescription(attachment.resource);
+		vk::AttachmentDescription description;
+		description.format = static_cast<vk::Format>(texture.format);
+		description.samples = vk::SampleCountFlagBits::e1;
+		switch (attachment.load) {
+		case RenderLoad::eLoad: 
+			description.loadOp = attachment.initialAccess == RenderAccess::eUndefined ? vk::AttachmentLoadOp::eDontCare : 
+				vk::AttachmentLoadOp::eLoad; 
+			break;
+		case RenderLoad::eClear: description.loadOp = vk::AttachmentLoadOp::eClear; break;
+		case RenderLoad::eDontCare: description.loadOp = vk::AttachmentLoadOp::eDontCare; break;
+		}
+		description.storeOp = attachment.store ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+		description.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+		description.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+		description.initialLayout = getAccessInfo(attachment.initialAccess, texture.depthStencil).layout;
+		description.finalLayout = getAccessInfo(attachment.finalAccess, texture.depthStencil).layout;
+		descriptions.push_back(description);
+
+		vk::ClearValue clearValue;
+		if (texture.depthStencil)
+			clearValue.depthStencil = vk::ClearDepthStencilValue(texture.clearValue[0], static_cast<uint32_t>(texture.clearValue[1]));
+		else
+			clearValue.color.setFloat32(texture.clearValue);
+		m_ClearValues.back().push_back(clearValue);
+	}
+
+	// Dependencies between the same pair of subpasses are combined into one.
+	std::vector<vk::SubpassDependency> dependencies;
+	auto addDependency = [&](uint32_t src, uint32_t dst, const AccessInfoVk& before, const AccessInfoVk& after) {
+		auto it = std::find_if(dependencies.begin(), dependencies.end(), [&](const vk::SubpassDependency& dependency) {
+			return dependency.srcSubpass == src && dependency.dstSubpass == dst;
+		});
+		if (it == dependencies.end()) {
+			vk::SubpassDependency dependency;
+			dependency.srcSubpass = src;
+			dependency.dstSubpass = dst;
+			// Subpasses only ever read the same pixel of an input attachment.
+			if (src != VK_SUBPASS_EXTERNAL && dst != VK_SUBPASS_EXTERNAL)
+				dependency.dependencyFlags = vk::DependencyFlagBits::eByRegion;
+			it = dependencies.insert(dependencies.end(), dependency);
+		}
+		it->srcStageMask |= before.stages;
+		it->dstStageMask |= after.stages;
+		it->srcAccessMask |= before.access;
+		it->dstAccessMask |= after.access;
+	};
+
+	size_t attachmentCount = group.attachments.size();
+	size_t subpassCount = group.passes.size();
+	std::vector<std::vector<vk::AttachmentReference>> colorRefs(subpassCount);
+	std::vector<std::vector<vk::AttachmentReference>> inputRefs(subpassCount);
+	std::vector<vk::AttachmentReference> depthRefs(subpassCount);
+	std::vector<std::vector<uint32_t>> preserves(subpassCount);
+	std::vector<std::vector<bool>> used(subpassCount, std::vector<bool>(attachmentCount, false));
+	std::vector<uint32_t> firstSubpass(attachmentCount, RenderGraph::kInvalid);
+	std::vector<uint32_t> lastSubpass(attachmentCount, 0);
+	std::vector<RenderAccess> lastAccess(attachmentCount, RenderAccess::eUndefined);
+	std::vector<vk::SubpassDescription> subpasses(subpassCount);
+	for (uint32_t subpass = 0; subpass < subpassCount; subpass++) {
+		for (const RenderGraph::Use& use : m_Graph.getPassUses(group.passes[subpass])) {
+			if (!RenderGraph::isAttachmentAccess(use.access))
+				continue;
+
+			auto it = std::find_if(group.attachments.begin(), group.attachments.end(), 
+				[&](const RenderGraph::Attachment& attachment) { return attachment.resource == use.resource; });
+			uint32_t index = static_cast<uint32_t>(it - group.attachments.begin());
+			bool depthStencil = m_Graph.getResourceDescription(use.resource).depthStencil;
+			AccessInfoVk info = getAccessInfo(use.access, depthStencil);
+			vk::AttachmentReference reference(index, info.layout);
+			switch (use.access) {
+			case RenderAccess::eColorAttachment: colorRefs[subpass].push_back(reference); break;
+			case RenderAccess::eInputAttachment: inputRefs[subpass].push_back(reference); break;
+			default: depthRefs[subpass] = reference; subpasses[subpass].pDepthStencilAttachment = &depthRefs[subpass]; break;
+			}
+
+			// The first subpass waits for whatever used the texture before the render pass, which
+			// for discarded contents is the end of the previous frame.
+			if (firstSubpass[index] == RenderGraph::kInvalid) {
+				RenderAccess before = it->initialAccess != RenderAccess::eUndefined ? it->initialAccess : 
+					m_Graph.getLastAccess(use.resource);
+				addDependency(VK_SUBPASS_EXTERNAL, subpass, getAccessInfo(before, depthStencil), info);
+				firstSubpass[index] = subpass;
+			}
+			else if (lastSubpass[index] != subpass)
+				addDependency(lastSubpass[index], subpass, getAccessInfo(lastAccess[index], depthStencil), info);
+			lastSubpass[index] = subpass;
+			lastAccess[index] = use.access;
+			used[subpass][index] = true;
+		}
+	}
+
+	for (uint32_t index = 0; index < attachmentCount; index++) {
+		// Contents needed by a later subpass survive the subpasses in between.
+		for (uint32_t subpass = firstSubpass[index] + 1; subpass < lastSubpass[index]; subpass++) {
+			if (!used[subpass][index])
+				preserves[subpass].push_back(index);
+		}
+
+		// Transitions made by the render pass itself are finished before anything after it.
+		const RenderGraph::Attachment& attachment = group.attachments[index];
+		if (attachment.finalAccess != lastAccess[index]) {
+			bool depthStencil = m_Graph.getResourceDescription(attachment.resource).depthStencil;
+			addDependency(lastSubpass[index], VK_SUBPASS_EXTERNAL, getAccessInfo(lastAccess[index], depthStencil), 
+				getAccessInfo(attachment.finalAccess, depthStencil));
+		}
+	}
+
+	for (uint32_t subpass = 0; subpass < subpassCount; subpass++) {
+		subpasses[subpass].pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+		subpasses[subpass].colorAttachmentCount = static_cast<uint32_t>(colorRefs[subpass].size());
+		subpasses[subpass].pColorAttachments = colorRefs[subpass].data();
+		subpasses[subpass].inputAttachmentCount = static_cast<uint32_t>(inputRefs[subpass].size());
+		subpasses[subpass].pInputAttachments = inputRefs[subpass].data();
+		subpasses[subpass].preserveAttachmentCount = static_cast<uint32_t>(preserves[subpass].size());
+		subpasses[subpass].pPreserveAttachments = preserves[subpass].data();
+	}
+
+	vk::RenderPassCreateInfo passInfo;
+	passInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+	passInfo.pAttachments = descriptions.data();
+	passInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+	passInfo.pSubpasses = subpasses.data();
+	passInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	passInfo.pDependencies = dependencies.data();
+	m_pRenderPasses.back() = m_Device.createRenderPassUnique(passInfo);
+}
+
+bool RenderGraphVk::resize(vk::Extent2D extent, uint64_t frameNumber) {
+	if (m_pResources) {
+		m_pResources->frameNumber = frameNumber;
+		m_Retired.push_back(std::move(m_pResources));
+	}
+
+	auto pResources = std::make_unique<Resources>();
+	pResources->extent = extent;
+	uint32_t resourceCount = m_Graph.getResourceCount();
+	pResources->images.resize(resourceCount);
+	pResources->pViews.resize(resourceCount);
+	pResources->pReadViews.resize(resourceCount);
+	pResources->pFramebuffers.resize(m_Graph.getGroups().size());
+	std::vector<vk::MemoryRequirements> requirements(resourceCount);
+	for (RenderGraph::ResourceId i = 0; i < resourceCount; i++) {
+		if (m_Graph.isResourceImported(i) || !m_Graph.isResourceUsed(i))
+			continue;
+
+		const RenderTextureDescription& texture = m_Graph.getResourceDescription(i);
+		vk::ImageCreateInfo imageInfo;
+		imageInfo.format = static_cast<vk::Format>(texture.format);
+		imageInfo.imageType = vk::ImageType::e2D;
+		imageInfo.extent = vk::Extent3D(texture.width ? texture.width : extent.width, texture.height ? texture.height : extent.height, 1);
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = vk::SampleCountFlagBits::e1;
+		for (RenderAccess access : m_Graph.getResourceAccesses(i))
+			imageInfo.usage |= getUsage(access);
+		if (m_Graph.isResourceTileLocal(i))
+			imageInfo.usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+		pResources->images[i] = m_Device.createImage(imageInfo);
+		requirements[i] = m_Device.getImageMemoryRequirements(pResources->images[i]);
+	}
+
+	// Textures are bound once the graph has decided which of them share memory. Imported textures
+	// are only sized for the bandwidth estimate.
+	m_Graph.alias([&](RenderGraph::ResourceId resource) {
+		if (m_Graph.isResourceImported(resource)) {
+			uint32_t size = getFormatSize(static_cast<vk::Format>(m_Graph.getResourceDescription(resource).format));
+			return RenderMemoryRequirements{ static_cast<uint64_t>(extent.width) * extent.height * size, 1, UINT32_MAX };
+		}
+		return RenderMemoryRequirements{ requirements[resource].size, requirements[resource].alignment, 
+			requirements[resource].memoryTypeBits };
+	});
+	uint32_t lazyCount = 0;
+	for (const RenderGraph::MemorySlot& slot : m_Graph.getMemorySlots()) {
+		vk::MemoryRequirements slotRequirements;
+		slotRequirements.size = slot.requirements.size;
+		slotRequirements.alignment = slot.requirements.alignment;
+		slotRequirements.memoryTypeBits = slot.requirements.typeBits;
+
+		// Tiled GPUs only back lazily allocated memory when an attachment has to leave tile memory,
+		// which tile local textures never do. Other devices have no such memory type.
+		std::optional<AllocationVk> allocation;
+		vk::MemoryPropertyFlags lazy = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eLazilyAllocated;
+		if (m_Graph.isResourceTileLocal(slot.resources.front()) && m_pAllocator->hasMemoryType(slot.requirements.typeBits, lazy)) {
+			allocation = m_pAllocator->allocate(slotRequirements, lazy, ResourceTilingVk::eOptimal);
+			if (allocation.has_value())
+				lazyCount++;
+		}
+		if (!allocation.has_value())
+			allocation = m_pAllocator->allocate(slotRequirements, vk::MemoryPropertyFlagBits::eDeviceLocal, ResourceTilingVk::eOptimal);
+		if (!allocation.has_value()) {
+			LOG_F(ERROR, "Failed to allocate memory for the transient textures of the render graph.");
+			destroyResources(*pResources);
+			return false;
+		}
+		pResources->allocations.push_back(allocation.value());
+		for (RenderGraph::ResourceId resource : slot.resources)
+			m_Device.bindImageMemory(pResources->images[resource], allocation->memory, allocation->offset);
+	}
+	for (RenderGraph::ResourceId i = 0; i < resourceCount; i++) {
+		if (!pResources->images[i])
+			continue;
+		vk::Format format = static_cast<vk::Format>(m_Graph.getResourceDescription(i).format);
+		pResources->pViews[i] = HelperVk::createImageView(m_Device, pResources->images[i], format, getAspect(i));
+		if (getAspect(i) == (vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil))
+			pResources->pReadViews[i] = HelperVk::createImageView(m_Device, pResources->images[i], format, 
+				vk::ImageAspectFlagBits::eDepth);
+	}
+
+	// A texture sharing memory waits for the previous one in its slot before the group which first
+	// uses it. Its contents are discarded, so an execution dependency is all it needs.
+	size_t groupCount = m_Graph.getGroups().size();
+	pResources->aliasSrcStages.resize(groupCount);
+	pResources->aliasDstStages.resize(groupCount);
+	pResources->aliasSrcAccess.resize(groupCount);
+	pResources->aliasDstAccess.resize(groupCount);
+	for (const RenderGraph::MemorySlot& slot : m_Graph.getMemorySlots()) {
+		if (slot.resources.size() < 2)
+			continue;
+		for (RenderGraph::ResourceId resource : slot.resources) {
+			uint32_t group = m_Graph.getResourceFirstGroup(resource);
+			bool depthStencil = m_Graph.getResourceDescription(resource).depthStencil;
+			AccessInfoVk before = getAccessInfo(m_Graph.getPreviousAccess(resource), depthStencil);
+			pResources->aliasSrcStages[group] |= before.stages;
+			pResources->aliasSrcAccess[group] |= before.access;
+			for (RenderAccess access : m_Graph.getResourceAccesses(resource)) {
+				AccessInfoVk after = getAccessInfo(access, depthStencil);
+				pResources->aliasDstStages[group] |= after.stages;
+				pResources->aliasDstAccess[group] |= after.access;
+			}
+		}
+	}
+
+	m_pResources = std::move(pResources);
+	m_Graph.logStatistics();
+	if (lazyCount > 0)
+		LOG_F(INFO, "Render graph: %u memory slots are lazily allocated.", lazyCount);
+	return true;
+}
+
+void RenderGraphVk::release(uint64_t completedFrameNumber) {
+	for (auto it = m_Retired.begin(); it != m_Retired.end();) {
+		if ((*it)->frameNumber > completedFrameNumber) {
+			++it;
+			continue;
+		}
+		destroyResources(**it);
+		it = m_Retired.erase(it);
+	}
+}
+
+void RenderGraphVk::destroyResources(Resources& resources) {
+	resources.pFramebuffers.clear();
+	resources.pViews.clear();
+	resources.pReadViews.clear();
+	for (vk::Image image : resources.images) {
+		if (image)
+			m_Device.destroyImage(image);
+	}
+	resources.images.clear();
+	for (const AllocationVk& allocation : resources.allocations)
+		m_pAllocator->free(allocation);
+	resources.allocations.clear();
+}
+
+void RenderGraphVk::setImportedImage(RenderGraph::ResourceId resource, vk::Image image, vk::ImageView view) {
+	if (resource >= m_ImportedImages.size()) {
+		m_ImportedImages.resize(resource + 1);
+		m_ImportedViews.resize(resource + 1);
+	}
+	m_ImportedImages[resource] = image;
+	m_ImportedViews[resource] = view;
+}
+
+vk::Image RenderGraphVk::getImage(RenderGraph::ResourceId resource) const {
+	return m_Graph.isResourceImported(resource) ? m_ImportedImages[resource] : m_pResources->images[resource];
+}
+
+vk::ImageView RenderGraphVk::getView(RenderGraph::ResourceId resource) const {
+	return m_Graph.isResourceImported(resource) ? m_ImportedViews[resource] : m_pResources->pViews[resource].get();
+}
+
+vk::ImageView RenderGraphVk::getReadView(RenderGraph::ResourceId resource) const {
+	if (m_pResources->pReadViews[resource])
+		return m_pResources->pReadViews[resource].get();
+	return getView(resource);
+}
+
+vk::ImageAspectFlags RenderGraphVk::getAspect(RenderGraph::ResourceId resource) const {
+	const RenderTextureDescription& texture = m_Graph.getResourceDescription(resource);
+	if (!texture.depthStencil)
+		return vk::ImageAspectFlagBits::eColor;
+	if (hasStencil(static_cast<vk::Format>(texture.format)))
+		return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+	return vk::ImageAspectFlagBits::eDepth;
+}
+
+void RenderGraphVk::recordBarriers(vk::CommandBuffer commandBuffer, const std::vector<RenderGraph::Barrier>& barriers, 
+	uint32_t groupIndex) {
+	vk::PipelineStageFlags srcStages;
+	vk::PipelineStageFlags dstStages;
+	std::vector<vk::MemoryBarrier> memoryBarriers;
+	if (groupIndex != RenderGraph::kInvalid && m_pResources->aliasSrcStages[groupIndex]) {
+		srcStages |= m_pResources->aliasSrcStages[groupIndex];
+		dstStages |= m_pResources->aliasDstStages[groupIndex];
+		memoryBarriers.push_back(vk::MemoryBarrier(m_pResources->aliasSrcAccess[groupIndex], m_pResources->aliasDstAccess[groupIndex]));
+	}
+
+	std::vector<vk::ImageMemoryBarrier> imageBarriers;
+	for (const RenderGraph::Barrier& barrier : barriers) {
+		bool depthStencil = m_Graph.getResourceDescription(barrier.resource).depthStencil;
+		bool discard = barrier.before == RenderAccess::eUndefined;
+		AccessInfoVk before = getAccessInfo(discard ? m_Graph.getPreviousAccess(barrier.resource) : barrier.before, depthStencil);
+		AccessInfoVk after = getAccessInfo(barrier.after, depthStencil);
+		vk::ImageMemoryBarrier imageBarrier;
+		imageBarrier.srcAccessMask = before.access;
+		imageBarrier.dstAccessMask = after.access;
+		imageBarrier.oldLayout = discard ? vk::ImageLayout::eUndefined : before.layout;
+		imageBarrier.newLayout = after.layout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = getImage(barrier.resource);
+		imageBarrier.subresourceRange = vk::ImageSubresourceRange(getAspect(barrier.resource), 0, 1, 0, 1);
+		imageBarriers.push_back(imageBarrier);
+		srcStages |= before.stages;
+		dstStages |= after.stages;
+	}
+
+	if (memoryBarriers.empty() && imageBarriers.empty())
+		return;
+	commandBuffer.pipelineBarrier(srcStages, dstStages, vk::DependencyFlags(), memoryBarriers, nullptr, imageBarriers);
+}
+
+vk::Framebuffer RenderGraphVk::getFramebuffer(RenderGraph::PassId pass) const {
+	uint32_t groupIndex = m_Graph.getPassGroup(pass);
+	const RenderGraph::Group& group = m_Graph.getGroups()[groupIndex];
+	if (!group.renderPass)
+		return nullptr;
+
+	std::vector<VkImageView> views;
+	for (const RenderGraph::Attachment& attachment : group.attachments)
+		views.push_back(static_cast<VkImageView>(getView(attachment.resource)));
+	vk::UniqueFramebuffer& pFramebuffer = m_pResources->pFramebuffers[groupIndex][views];
+	if (!pFramebuffer) {
+		std::vector<vk::ImageView> attachmentViews(views.begin(), views.end());
+		const RenderTextureDescription& texture = m_Graph.getResourceDescription(group.attachments.front().resource);
+		vk::FramebufferCreateInfo framebufferInfo;
+		framebufferInfo.renderPass = m_pRenderPasses[groupIndex].get();
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachmentViews.size());
+		framebufferInfo.pAttachments = attachmentViews.data();
+		framebufferInfo.width = texture.width ? texture.width : m_pResources->extent.width;
+		framebufferInfo.height = texture.height ? texture.height : m_pResources->extent.height;
+		framebufferInfo.layers = 1;
+		pFramebuffer = m_Device.createFramebufferUnique(framebufferInfo);
+	}
+	return pFramebuffer.get();
+}
+
+void RenderGraphVk::execute(vk::CommandBuffer commandBuffer, GpuProfilerVk* pProfiler) {
+	const std::vector<RenderGraph::Group>& groups = m_Graph.getGroups();
+	for (uint32_t i = 0; i < groups.size(); i++) {
+		const RenderGraph::Group& group = groups[i];
+		uint32_t scope = GpuProfilerVk::kInvalidScope;
+		if (pProfiler)
+			scope = pProfiler->beginScope(commandBuffer, m_Graph.getPassName(group.passes.front()).c_str());
+		recordBarriers(commandBuffer, group.barriers, i);
+
+		RenderPassContextVk context;
+		context.commandBuffer = commandBuffer;
+		context.extent = m_pResources->extent;
+		if (!group.renderPass) {
+			if (m_Executes[group.passes.front()])
+				m_Executes[group.passes.front()](context);
+		}
+		else {
+			context.renderPass = m_pRenderPasses[i].get();
+			context.framebuffer = getFramebuffer(group.passes.front());
+			const RenderTextureDescription& texture = m_Graph.getResourceDescription(group.attachments.front().resource);
+			if (texture.width && texture.height)
+				context.extent = vk::Extent2D(texture.width, texture.height);
+
+			vk::RenderPassBeginInfo beginInfo;
+			beginInfo.renderPass = context.renderPass;
+			beginInfo.framebuffer = context.framebuffer;
+			beginInfo.renderArea = vk::Rect2D(vk::Offset2D(0, 0), context.extent);
+			beginInfo.clearValueCount = static_cast<uint32_t>(m_ClearValues[i].size());
+			beginInfo.pClearValues = m_ClearValues[i].data();
+			for (uint32_t subpass = 0; subpass < group.passes.size(); subpass++) {
+				RenderGraph::PassId pass = group.passes[subpass];
+				if (subpass == 0)
+					commandBuffer.beginRenderPass(beginInfo, m_Contents[pass]);
+				else
+					commandBuffer.nextSubpass(m_Contents[pass]);
+				context.subpass = subpass;
+				if (m_Executes[pass])
+					m_Executes[pass](context);
+			}
+			commandBuffer.endRenderPass();
+		}
+
+		if (pProfiler)
+			pProfiler->endScope(commandBuffer, scope);
+	}
+	recordBarriers(commandBuffer, m_Graph.getFinalBarriers(), RenderGraph::kInvalid);
+}
+
+vk::RenderPass RenderGraphVk::getRenderPass(RenderGraph::PassId pass) const {
+	return m_pRenderPasses[m_Graph.getPassGroup(pass)].get();
+}
+
+uint32_t RenderGraphVk::getSubpass(RenderGraph::PassId pass) const {
+	return m_Graph.getPassSubpass(pass);
+}
+
+vk::Extent2D RenderGraphVk::getExtent() const {
+	return m_pResources ? m_pResources->extent : vk::Extent2D();
+}
@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "renderer/render_graph.hpp"
+#include "allocator_vk.hpp"
+
+class GpuProfilerVk;
+
+/// Everything a pass needs to record its commands.
+struct RenderPassContextVk {
+	vk::CommandBuffer commandBuffer;
+	/// Null for passes without attachments, which are recorded outside of any render pass.
+	vk::RenderPass renderPass;
+	uint32_t subpass = 0;
+	vk::Framebuffer framebuffer;
+	vk::Extent2D extent;
+};
+
+/// Executes a RenderGraph on Vulkan. Each group of passes with attachments becomes a render 
+/// pass with a subpass per pass, whose attachment layouts and subpass dependencies perform the
+/// transitions between them. Transient textures are created for the extent the graph is 
+/// rendered at, with textures sharing a memory slot bound to the same allocation. Tile local
+/// textures are transient attachments placed in lazily allocated memory where the device has it.
+class RenderGraphVk {
+public:
+	using Execute = std::function<void(const RenderPassContextVk&)>;
+
+	RenderGraphVk(vk::Device device, AllocatorVk* pAllocator);
+	~RenderGraphVk();
+	RenderGraphVk(const RenderGraphVk&) = delete;
+	RenderGraphVk& operator=(const RenderGraphVk&) = delete;
+
+	/// Passes and textures are declared on the graph before compiling it.
+	RenderGraph& getGraph();
+
+	/// Sets what a pass records. Passes executing secondary command buffers inside a render pass
+	/// must ask for SubpassContents::eSecondaryCommandBuffers.
+	void setExecute(RenderGraph::PassId pass, Execute execute, vk::SubpassContents contents = vk::SubpassContents::eInline);
+
+	/// Compiles the graph and creates its render passes, which stay valid for the lifetime of the graph.
+	bool compile();
+
+	/// Creates the transient textures for extent. Textures of the previous extent are kept until
+	/// frameNumber has completed.
+	bool resize(vk::Extent2D extent, uint64_t frameNumber);
+
+	/// Destroys the textures retired by resizes once the frames using them have completed.
+	void release(uint64_t completedFrameNumber);
+
+	/// Sets the image backing an imported texture for the frames recorded from now on.
+	void setImportedImage(RenderGraph::ResourceId resource, vk::Image image, vk::ImageView view);
+
+	/// Records every pass which survived culling, with a profiler scope around each group.
+	void execute(vk::CommandBuffer commandBuffer, GpuProfilerVk* pProfiler = nullptr);
+
+	/// Render pass and subpass a pass is recorded in, for creating pipelines and secondary command 
+	/// buffers. Only valid for passes which survived culling.
+	vk::RenderPass getRenderPass(RenderGraph::PassId pass) const;
+	uint32_t getSubpass(RenderGraph::PassId pass) const;
+	/// View of a texture at the current extent, or the view set for an imported texture.
+	vk::ImageView getView(RenderGraph::ResourceId resource) const;
+	/// View for reading a transient texture in shaders. Covers only the depth aspect of 
+	/// depth-stencil textures, as descriptors cannot refer to both.
+	vk::ImageView getReadView(RenderGraph::ResourceId resource) const;
+	/// Framebuffer the group of pass will use with the current imported images.
+	vk::Framebuffer getFramebuffer(RenderGraph::PassId pass) const;
+	vk::Extent2D getExtent() const;
+private:
+	/// Transient textures and framebuffers for a single extent.
+	struct Resources {
+		vk::Extent2D extent;
+		/// Indexed by resource, null for imported and unused textures.
+		std::vector<vk::Image> images;
+		std::vector<vk::UniqueImageView> pViews;
+		/// Depth only views of depth-stencil textures read by shaders.
+		std::vector<vk::UniqueImageView> pReadViews;
+		/// Indexed by memory slot.
+		std::vector<AllocationVk> allocations;
+		/// Framebuffers of each group, keyed by the views of their attachments.
+		std::vector<std::map<std::vector<VkImageView>, vk::UniqueFramebuffer>> pFramebuffers;
+		/// Waits for the previous user of a memory slot before each group, keyed by group.
+		std::vector<vk::PipelineStageFlags> aliasSrcStages;
+		std::vector<vk::PipelineStageFlags> aliasDstStages;
+		std::vector<vk::AccessFlags> aliasSrcAccess;
+		std::vector<vk::AccessFlags> aliasDstAccess;
+		uint64_t frameNumber = 0;
+	};
+
+	void createRenderPass(uint32_t groupIndex);
+	void destroyResources(Resources& resources);
+	vk::Image getImage(RenderGraph::ResourceId resource) const;
+	vk::ImageAspectFlags getAspect(RenderGraph::ResourceId resource) const;
+	/// Records the barriers in front of a group, or after the last one when barriers are the final barriers.
+	void recordBarriers(vk::CommandBuffer commandBuffer, const std::vector<RenderGraph::Barrier>& barriers, uint32_t groupIndex);
+
+	vk::Device m_Device;
+	AllocatorVk* m_pAllocator;
+	RenderGraph m_Graph;
+	std::vector<Execute> m_Executes;
+	std::vector<vk::SubpassContents> m_Contents;
+	/// Indexed by group, null for groups without attachments.
+	std::vector<vk::UniqueRenderPass> m_pRenderPasses;
+	std::vector<std::vector<vk::ClearValue>> m_ClearValues;
+	std::vector<vk::Image> m_ImportedImages;
+	std::vector<vk::ImageView> m_ImportedViews;
+	std::unique_ptr<Resources> m_pResources;
+	std::vector<std::unique_ptr<Resources>> m_Retired;
+};
@@ -24,50 +24,123 @@ SOFTWARE.
 
 #include "renderable_vk.hpp"
 
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+#include "util/parallel.hpp"
 #include "driver_vk.hpp"
 
-RenderableVk::RenderableVk(DriverVk* pDriver) : m_pDriver(pDriver) {}
+namespace {
+	/// Fewest vertices a thread folds into the bounds at once.
+	constexpr size_t kBoundsGrain = 16 * 1024;
+}
 
-RenderableVk::~RenderableVk() {}
+RenderableVk::RenderableVk(DriverVk* pDriver) : m_pDriver(pDriver), m_IndexCount(0), m_VertexCount(0), m_BoundsMin(0.0f), 
+	m_BoundsMax(0.0f), m_Instance(GpuSceneVk::kInvalidInstance) {}
+
+RenderableVk::~RenderableVk() {
+	m_pDriver->getScene()->removeInstance(m_Instance);
+	releaseIndices();
+	releaseVertices();
+}
 
 bool RenderableVk::build() {
-	vk::CommandBufferAllocateInfo allocateInfo;
-	allocateInfo.commandPool = m_pDriver->getCommandPool().get();
-	allocateInfo.commandBufferCount = 1;
-	allocateInfo.level = vk::CommandBufferLevel::eSecondary;
-	m_pSecondaryBuffer = std::move(m_pDriver->getDevice()->allocateCommandBuffersUnique(allocateInfo).front());
-	
-	vk::CommandBufferInheritanceInfo inheritInfo;
-	inheritInfo.framebuffer = m_pDriver->getCurrentFramebuffer().get();
-	inheritInfo.renderPass = m_pDriver->getRenderPass().get();
-
-	vk::CommandBufferBeginInfo beginInfo;
-	beginInfo.pInheritanceInfo = &inheritInfo;
-	m_pSecondaryBuffer->begin(beginInfo);
-
-	m_pSecondaryBuffer->end();
-	return false;
+	// Drawn without indices, every vertex is referenced in order.
+	if (!m_FirstIndex.has_value() && m_VertexCount > 0) {
+		if (m_VertexCount > UINT16_MAX + 1u) {
+			LOG_F(ERROR, "Renderables of %u vertices need indices.", m_VertexCount);
+			return false;
+		}
+		std::vector<uint16_t> indices(m_VertexCount);
+		std::iota(indices.begin(), indices.end(), static_cast<uint16_t>(0));
+		if (!setIndices(std::move(indices)))
+			return false;
+	}
+	if (!m_FirstIndex.has_value() || !m_FirstVertex.has_value())
+		return false;
+
+	// The pipeline is shared with every other renderable using the same state, and every
+	// instance using it is drawn by one indirect draw.
+	m_pPipelineState = m_pDriver->getPipelineStates()->acquire(m_PipelineDescription);
+	if (m_pPipelineState->isFailed())
+		return false;
+
+	GpuInstanceVk instance;
+	instance.boundsCenter = (m_BoundsMin + m_BoundsMax) * 0.5f;
+	instance.boundsExtent = (m_BoundsMax - m_BoundsMin) * 0.5f;
+	instance.indexCount = m_IndexCount;
+	instance.firstIndex = m_FirstIndex.value();
+	instance.vertexOffset = static_cast<int32_t>(m_FirstVertex.value());
+	instance.constants = m_DrawConstants;
+	m_pDriver->getScene()->removeInstance(m_Instance);
+	m_Instance = m_pDriver->getScene()->addInstance(m_pPipelineState, instance);
+	return m_Instance != GpuSceneVk::kInvalidInstance;
 }
 
 bool RenderableVk::attachShader(const char* pFilename, ShaderStage stage) {
-    return true;
+	m_PipelineDescription.setShader(pFilename, stage);
+	return true;
 }
 
 bool RenderableVk::setIndices(std::vector<uint16_t> indices) {
-    return false;
+	releaseIndices();
+	m_FirstIndex = m_pDriver->getScene()->addIndices(indices);
+	m_IndexCount = m_FirstIndex.has_value() ? static_cast<uint32_t>(indices.size()) : 0;
+	return m_FirstIndex.has_value();
 }
 
 bool RenderableVk::setVertices(std::vector<Vertex> vertices) {
-	vk::BufferCreateInfo bufferInfo;
-	bufferInfo.sharingMode = vk::SharingMode::eExclusive;
-	bufferInfo.usage = vk::BufferUsageFlagBits::eVertexBuffer;
-	bufferInfo.size = static_cast<vk::DeviceSize>(sizeof Vertex * vertices.size());
-	m_pVertexBuffer = m_pDriver->getDevice()->createBufferUnique(bufferInfo);
-
-	vk::MemoryRequirements memoryRequirements = m_pDriver->getDevice()->getBufferMemoryRequirements(m_pVertexBuffer.get());
-	vk::MemoryAllocateInfo allocateInfo;
-	allocateInfo.allocationSize = memoryRequirements.size;
-	
-	m_pDriver->getDevice()->allocateMemoryUnique(allocateInfo);
-    return false;
+	releaseVertices();
+	m_FirstVertex = m_pDriver->getScene()->addVertices(vertices);
+	if (!m_FirstVertex.has_value())
+		return false;
+	m_VertexCount = static_cast<uint32_t>(vertices.size());
+
+	// Culling tests the bounds of the vertices as the vertex shader receives them. Large meshes
+	// are split across the threadpool, small ones stay on the calling thread.
+	using Bounds = std::pair<glm::vec3, glm::vec3>;
+	Bounds identity(vertices.front().position, vertices.front().position);
+	Bounds bounds = Parallel::reduce(m_pDriver->getThreadPool(), vertices.size(), identity,
+		[&vertices](size_t begin, size_t end, Bounds bounds) {
+			for (size_t i = begin; i < end; i++) {
+				bounds.first = glm::min(bounds.first, vertices[i].position);
+				bounds.second = glm::max(bounds.second, vertices[i].position);
+			}
+			return bounds;
+		}, [](const Bounds& a, const Bounds& b) {
+			return Bounds(glm::min(a.first, b.first), glm::max(a.second, b.second));
+		}, kBoundsGrain);
+	m_BoundsMin = bounds.first;
+	m_BoundsMax = bounds.second;
+	return true;
+}
+
+void RenderableVk::setDrawPass(DrawPass pass) {
+	m_PipelineDescription.drawPass = pass;
+}
+
+DrawPass RenderableVk::getDrawPass() const {
+	return m_PipelineDescription.drawPass;
+}
+
+void RenderableVk::setDrawConstants(const DrawConstants& constants) {
+	m_DrawConstants = constants;
+	m_pDriver->getScene()->setInstanceConstants(m_Instance, constants);
+}
+
+void RenderableVk::releaseIndices() {
+	if (m_FirstIndex.has_value())
+		m_pDriver->getScene()->freeIndices(m_FirstIndex.value());
+	m_FirstIndex.reset();
+	m_IndexCount = 0;
+}
+
+void RenderableVk::releaseVertices() {
+	if (m_FirstVertex.has_value())
+		m_pDriver->getScene()->freeVertices(m_FirstVertex.value());
+	m_FirstVertex.reset();
+	m_VertexCount = 0;
 }
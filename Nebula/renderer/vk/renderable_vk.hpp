@@ -25,15 +25,20 @@ SOFTWARE.
 #pragma once
 
 #include <memory>
-#include <unordered_map>
+#include <optional>
 #include <vector>
 
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.hpp>
 
+#include "renderer/pipeline_description.hpp"
+#include "renderer/pipeline_state_cache.hpp"
 #include "renderer/renderable.hpp"
+#include "gpu_scene_vk.hpp"
 
 class DriverVk;
+/// Mesh and instance in the driver's GpuSceneVk. Once built it is culled and drawn by the GPU
+/// every frame until it is destroyed, without any work on the CPU.
 class RenderableVk : public Renderable {
 public:
     RenderableVk(DriverVk* pDriver);
@@ -42,14 +47,22 @@ public:
     bool attachShader(const char* pFilename, ShaderStage stage) override;
     bool setIndices(std::vector<uint16_t> indices) override;
     bool setVertices(std::vector<Vertex> vertices) override;
+	void setDrawConstants(const DrawConstants& constants) override;
+	void setDrawPass(DrawPass pass) override;
+	DrawPass getDrawPass() const;
 private:
+	void releaseIndices();
+	void releaseVertices();
+
     DriverVk* m_pDriver;
-	vk::UniqueCommandBuffer m_pSecondaryBuffer;
-	vk::UniqueBuffer m_pIndexBuffer;
-	vk::UniqueBuffer m_pVertexBuffer;
-	vk::UniqueDeviceMemory m_pIndexBufferMemory;
-	vk::UniqueDeviceMemory m_pVertexBufferMemory;
-    vk::UniquePipeline m_pPipeline;
-    vk::UniqueRenderPass m_pRenderPass;
-    std::vector<vk::PipelineShaderStageCreateInfo> m_ShaderStages;
+	std::optional<uint32_t> m_FirstIndex;
+	std::optional<uint32_t> m_FirstVertex;
+	uint32_t m_IndexCount;
+	uint32_t m_VertexCount;
+	glm::fvec3 m_BoundsMin;
+	glm::fvec3 m_BoundsMax;
+	DrawConstants m_DrawConstants;
+	PipelineDescription m_PipelineDescription;
+	std::shared_ptr<const PipelineState<vk::UniquePipeline>> m_pPipelineState;
+	uint32_t m_Instance;
 };
\ No newline at end of file
@@ -0,0 +1,208 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "upload_vk.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+UploadVk::UploadVk(vk::Device device, AllocatorVk* pAllocator, vk::Queue transferQueue, uint32_t transferQueueFamilyIndex,
+	uint32_t graphicsQueueFamilyIndex, GpuTimelineVk* pTimeline, vk::DeviceSize ringSize) : m_Device(device), m_pAllocator(pAllocator), 
+	m_Queue(transferQueue), m_pTimeline(pTimeline), m_RingSize(ringSize), m_RingHead(0), m_RingUsed(0), m_PendingBytes(0), 
+	m_NextSerial(1), m_CompletedSerial(0), m_SubmittedValue(0) {
+	m_QueueFamilyIndices.push_back(graphicsQueueFamilyIndex);
+	if (transferQueueFamilyIndex != graphicsQueueFamilyIndex)
+		m_QueueFamilyIndices.push_back(transferQueueFamilyIndex);
+
+	vk::CommandPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient;
+	poolInfo.queueFamilyIndex = transferQueueFamilyIndex;
+	m_pCommandPool = m_Device.createCommandPoolUnique(poolInfo);
+
+	vk::BufferCreateInfo bufferInfo;
+	bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+	bufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+	bufferInfo.size = m_RingSize;
+	m_pRing = m_Device.createBufferUnique(bufferInfo);
+	if (auto allocation = m_pAllocator->allocateForBuffer(m_pRing.get(), 
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent); allocation.has_value())
+		m_RingAllocation = allocation.value();
+	else
+		LOG_F(FATAL, "Failed to allocate the %llu byte staging ring.", static_cast<unsigned long long>(m_RingSize));
+}
+
+UploadVk::~UploadVk() {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	while (retireOldest(true));
+	m_pRing.reset();
+	m_pAllocator->free(m_RingAllocation);
+}
+
+uint64_t UploadVk::uploadBuffer(vk::Buffer buffer, const void* pData, vk::DeviceSize size, vk::DeviceSize offset) {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	const std::byte* pSource = static_cast<const std::byte*>(pData);
+	while (size > 0) {
+		// Split large uploads so that a single one can never need the whole ring.
+		vk::DeviceSize chunk = std::min(size, m_RingSize / 4);
+		vk::DeviceSize ringOffset;
+		while (!reserve(chunk, ringOffset)) {
+			// Out of space, push out what is queued and wait for the oldest batch to finish.
+			if (!m_PendingCopies.empty())
+				submitPending();
+			retireOldest(true);
+		}
+
+		std::memcpy(static_cast<std::byte*>(m_RingAllocation.pMapped) + ringOffset, pSource, static_cast<size_t>(chunk));
+		m_PendingCopies.push_back({ buffer, vk::BufferCopy(ringOffset, offset, chunk) });
+		pSource += chunk;
+		offset += chunk;
+		size -= chunk;
+	}
+	return m_NextSerial;
+}
+
+void UploadVk::flush() {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (!m_PendingCopies.empty())
+		submitPending();
+}
+
+GpuTimelineVk* UploadVk::getTimeline() const {
+	return m_pTimeline;
+}
+
+uint64_t UploadVk::getSubmittedValue() {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_SubmittedValue;
+}
+
+void UploadVk::collect() {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	while (retireOldest(false));
+}
+
+bool UploadVk::isComplete(uint64_t serial) {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	while (retireOldest(false));
+	return serial <= m_CompletedSerial;
+}
+
+const std::vector<uint32_t>& UploadVk::getQueueFamilyIndices() const {
+	return m_QueueFamilyIndices;
+}
+
+std::mutex& UploadVk::getQueueMutex() {
+	return m_QueueMutex;
+}
+
+bool UploadVk::reserve(vk::DeviceSize size, vk::DeviceSize& offset) {
+	if (m_RingUsed == 0)
+		m_RingHead = 0;
+
+	// Copies are placed back to back, wrapping to the start when the end is reached. The bytes
+	// skipped at the end count as used until the batch that skipped them retires.
+	vk::DeviceSize start = (m_RingHead + 15) & ~vk::DeviceSize(15);
+	vk::DeviceSize skipped = start - m_RingHead;
+	if (start + size > m_RingSize) {
+		skipped = m_RingSize - m_RingHead;
+		start = 0;
+	}
+	if (m_RingUsed + skipped + size > m_RingSize)
+		return false;
+
+	m_RingUsed += skipped + size;
+	m_PendingBytes += skipped + size;
+	m_RingHead = start + size;
+	offset = start;
+	return true;
+}
+
+void UploadVk::submitPending() {
+	std::unique_ptr<Batch> pBatch = acquireBatch();
+	pBatch->serial = m_NextSerial++;
+	pBatch->ringBytes = m_PendingBytes;
+	m_PendingBytes = 0;
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	pBatch->pCommandBuffer->begin(beginInfo);
+
+	// Copies into the same buffer are usually queued together, record those as one command.
+	std::vector<vk::BufferCopy> regions;
+	for (size_t i = 0; i < m_PendingCopies.size(); i++) {
+		regions.push_back(m_PendingCopies[i].region);
+		if (i + 1 == m_PendingCopies.size() || m_PendingCopies[i + 1].buffer != m_PendingCopies[i].buffer) {
+			pBatch->pCommandBuffer->copyBuffer(m_pRing.get(), m_PendingCopies[i].buffer, regions);
+			regions.clear();
+		}
+	}
+	pBatch->pCommandBuffer->end();
+	m_PendingCopies.clear();
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &pBatch->pCommandBuffer.get();
+	{
+		std::lock_guard<std::mutex> queueLock(m_QueueMutex);
+		pBatch->value = m_pTimeline->submit(m_Queue, submitInfo, nullptr, 0, true);
+	}
+
+	m_SubmittedValue = pBatch->value;
+	m_InFlight.push_back(std::move(pBatch));
+}
+
+bool UploadVk::retireOldest(bool wait) {
+	if (m_InFlight.empty())
+		return false;
+
+	Batch& batch = *m_InFlight.front();
+	if (wait)
+		m_pTimeline->wait(batch.value);
+	else if (!m_pTimeline->isComplete(batch.value))
+		return false;
+
+	m_RingUsed -= batch.ringBytes;
+	m_CompletedSerial = batch.serial;
+	m_FreeBatches.push_back(std::move(m_InFlight.front()));
+	m_InFlight.pop_front();
+	return true;
+}
+
+std::unique_ptr<UploadVk::Batch> UploadVk::acquireBatch() {
+	if (!m_FreeBatches.empty()) {
+		std::unique_ptr<Batch> pBatch = std::move(m_FreeBatches.back());
+		m_FreeBatches.pop_back();
+		return pBatch;
+	}
+
+	auto pBatch = std::make_unique<Batch>();
+	vk::CommandBufferAllocateInfo allocateInfo;
+	allocateInfo.commandPool = m_pCommandPool.get();
+	allocateInfo.commandBufferCount = 1;
+	allocateInfo.level = vk::CommandBufferLevel::ePrimary;
+	pBatch->pCommandBuffer = std::move(m_Device.allocateCommandBuffersUnique(allocateInfo).front());
+	return pBatch;
+}
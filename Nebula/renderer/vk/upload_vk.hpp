@@ -0,0 +1,114 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "allocator_vk.hpp"
+#include "gpu_timeline_vk.hpp"
+
+/// Moves buffer data into device local memory through a persistently mapped staging ring.
+/// Uploads are copied into the ring straight away and the copies are batched until flush(),
+/// which records them into a single command buffer for the transfer queue. Each submitted
+/// batch advances the timeline of the transfer queue, graphics submissions wait on its latest
+/// value, and a batch returns its part of the ring once its value has completed.
+class UploadVk {
+public:
+	UploadVk(vk::Device device, AllocatorVk* pAllocator, vk::Queue transferQueue, uint32_t transferQueueFamilyIndex,
+		uint32_t graphicsQueueFamilyIndex, GpuTimelineVk* pTimeline, vk::DeviceSize ringSize = 32 * 1024 * 1024);
+	~UploadVk();
+
+	/// Queues a copy of size bytes from pData into buffer at offset. The data is copied into
+	/// the ring before this returns. Returns the serial of the batch the copy belongs to.
+	uint64_t uploadBuffer(vk::Buffer buffer, const void* pData, vk::DeviceSize size, vk::DeviceSize offset = 0);
+
+	/// Submits every queued copy to the transfer queue.
+	void flush();
+
+	/// Timeline of the transfer queue, shared with graphics when they use the same queue.
+	GpuTimelineVk* getTimeline() const;
+	/// Timeline value of the latest batch, graphics work reading uploaded data waits on it.
+	uint64_t getSubmittedValue();
+
+	/// Reclaims the ring space and batches of finished copies.
+	void collect();
+
+	/// Returns whether the copies of the batch with the given serial have completed.
+	bool isComplete(uint64_t serial);
+
+	/// Queue families which need access to uploaded buffers. Buffers must be created with 
+	/// concurrent sharing between these when there is more than one.
+	const std::vector<uint32_t>& getQueueFamilyIndices() const;
+
+	/// Guards the transfer queue, which may be the graphics queue. Hold it when submitting to 
+	/// the graphics queue or presenting.
+	std::mutex& getQueueMutex();
+private:
+	struct Copy {
+		vk::Buffer buffer;
+		vk::BufferCopy region;
+	};
+
+	struct Batch {
+		uint64_t serial = 0;
+		/// Timeline value signaled once the copies have completed.
+		uint64_t value = 0;
+		vk::DeviceSize ringBytes = 0;
+		vk::UniqueCommandBuffer pCommandBuffer;
+	};
+
+	bool reserve(vk::DeviceSize size, vk::DeviceSize& offset);
+	void submitPending();
+	bool retireOldest(bool wait);
+	std::unique_ptr<Batch> acquireBatch();
+
+	vk::Device m_Device;
+	AllocatorVk* m_pAllocator;
+	vk::Queue m_Queue;
+	GpuTimelineVk* m_pTimeline;
+	std::vector<uint32_t> m_QueueFamilyIndices;
+	vk::UniqueCommandPool m_pCommandPool;
+	vk::UniqueBuffer m_pRing;
+	AllocationVk m_RingAllocation;
+	vk::DeviceSize m_RingSize;
+	vk::DeviceSize m_RingHead;
+	vk::DeviceSize m_RingUsed;
+	vk::DeviceSize m_PendingBytes;
+	std::vector<Copy> m_PendingCopies;
+	uint64_t m_NextSerial;
+	uint64_t m_CompletedSerial;
+	uint64_t m_SubmittedValue;
+	/// Submitted batches in submission order, still holding ring space.
+	std::deque<std::unique_ptr<Batch>> m_InFlight;
+	std::vector<std::unique_ptr<Batch>> m_FreeBatches;
+	std::mutex m_Mutex;
+	std::mutex m_QueueMutex;
+};
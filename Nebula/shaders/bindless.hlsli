@@ -0,0 +1,29 @@
+// Declarations of the bindless resource tables, shared by every shader. Must match 
+// renderer/bindless.hpp and the layouts built by BindlessVk and BindlessDX12.
+//
+// Vulkan:      set 0, binding 0 textures, binding 1 samplers, binding 2 buffers.
+//              DrawConstants are push constants.
+// DirectX 12:  textures t0 space0, buffers t0 space1, samplers s0 space0.
+//              DrawConstants are root constants at b0.
+//
+// Indices may differ between draws in the same wave, so wrap them in NonUniformResourceIndex.
+
+static const uint kInvalidBindlessIndex = 0xffffffff;
+
+struct DrawConstants
+{
+	uint materialIndex;
+	uint textureIndex;
+	uint samplerIndex;
+	uint instanceIndex;
+};
+
+#ifdef __spirv__
+[[vk::push_constant]] ConstantBuffer<DrawConstants> g_Draw;
+#else
+ConstantBuffer<DrawConstants> g_Draw : register(b0);
+#endif
+
+[[vk::binding(0, 0)]] Texture2D g_Textures[] : register(t0, space0);
+[[vk::binding(1, 0)]] SamplerState g_Samplers[] : register(s0, space0);
+[[vk::binding(2, 0)]] ByteAddressBuffer g_Buffers[] : register(t0, space1);
@@ -0,0 +1,63 @@
+// Frustum culling of the GPU driven scene. Every instance which is visible appends an indexed
+// indirect draw to the region of its batch and bumps the batch's draw count. See GpuSceneVk.
+//
+// Built by the project, or by hand with:
+//
+// dxc -spirv -T cs_6_0 -E CSMain shaders/cull.hlsl -Fo shaders/cull.cs.spv
+
+#include "gpu_scene.hlsli"
+
+struct CullConstants
+{
+	// Clip volume planes pointing inwards.
+	float4 planes[6];
+	uint instanceCount;
+	uint3 reserved;
+};
+
+struct DrawIndexedIndirectCommand
+{
+	uint indexCount;
+	uint instanceCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint firstInstance;
+};
+
+[[vk::push_constant]] ConstantBuffer<CullConstants> g_Cull;
+[[vk::binding(0, 0)]] StructuredBuffer<GpuInstance> g_Instances;
+[[vk::binding(1, 0)]] StructuredBuffer<uint> g_BatchFirstCommands;
+[[vk::binding(2, 0)]] RWStructuredBuffer<DrawIndexedIndirectCommand> g_Commands;
+[[vk::binding(3, 0)]] RWStructuredBuffer<uint> g_Counts;
+
+bool IsVisible(float3 center, float3 extent)
+{
+	[unroll]
+	for (uint i = 0; i < 6; i++) {
+		float4 plane = g_Cull.planes[i];
+		if (dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extent) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+[numthreads(64, 1, 1)]
+void CSMain(uint3 dispatchId : SV_DispatchThreadID)
+{
+	uint instanceId = dispatchId.x;
+	if (instanceId >= g_Cull.instanceCount)
+		return;
+	GpuInstance instance = g_Instances[instanceId];
+	if (instance.indexCount == 0 || !IsVisible(instance.boundsCenter, instance.boundsExtent))
+		return;
+
+	uint slot;
+	InterlockedAdd(g_Counts[instance.batch], 1, slot);
+	DrawIndexedIndirectCommand command;
+	command.indexCount = instance.indexCount;
+	command.instanceCount = 1;
+	command.firstIndex = instance.firstIndex;
+	command.vertexOffset = instance.vertexOffset;
+	command.firstInstance = instanceId;
+	g_Commands[g_BatchFirstCommands[instance.batch] + slot] = command;
+}
@@ -0,0 +1,61 @@
+// Geometry pass of the deferred frame, used by renderables drawn with DrawPass::eGeometry.
+// Writes albedo to the first render target and an encoded normal to the second, which are
+// shaded by lighting.hlsl.
+//
+// Built by the project, or by hand with:
+//
+// dxc -spirv -T vs_6_0 -fvk-support-nonzero-base-instance -E VSMain shaders/gbuffer.hlsl -Fo shaders/gbuffer.vs.spv
+// dxc -spirv -T ps_6_0 -E PSMain shaders/gbuffer.hlsl -Fo shaders/gbuffer.ps.spv
+
+#include "bindless.hlsli"
+#include "gpu_scene.hlsli"
+
+// Layout of the buffer at DrawConstants::materialIndex.
+struct MaterialParameters
+{
+	float4 albedo;
+};
+
+struct PSInput
+{
+	float4 position : SV_POSITION;
+	float3 worldPosition : POSITION;
+	float4 color : COLOR;
+};
+
+struct PSOutput
+{
+	float4 albedo : SV_TARGET0;
+	float4 normal : SV_TARGET1;
+};
+
+PSInput VSMain(float4 position : POSITION, float4 color : COLOR, uint instanceId : SV_InstanceID)
+{
+	PSInput result;
+
+	// Every draw of the scene covers a single instance, its own constants are in the instance
+	// table rather than the push constants shared by the batch.
+	GpuInstance instance = LoadInstance(g_Buffers[g_Draw.instanceIndex], instanceId);
+	uint materialIndex = instance.constants.x;
+	float4 albedo = float4(1.0f, 1.0f, 1.0f, 1.0f);
+	if (materialIndex != kInvalidBindlessIndex)
+		albedo = g_Buffers[NonUniformResourceIndex(materialIndex)].Load<MaterialParameters>(0).albedo;
+
+	result.position = position;
+	result.worldPosition = position.xyz;
+	result.color = color * albedo;
+
+	return result;
+}
+
+PSOutput PSMain(PSInput input)
+{
+	PSOutput output;
+
+	// Vertices carry no normals, so use the face normal from the screen space derivatives.
+	float3 normal = normalize(cross(ddy(input.worldPosition), ddx(input.worldPosition)));
+	output.albedo = input.color;
+	output.normal = float4(normal * 0.5f + 0.5f, 1.0f);
+
+	return output;
+}
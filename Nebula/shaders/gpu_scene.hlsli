@@ -0,0 +1,27 @@
+// Instance table of the GPU driven scene. Must match GpuInstanceVk in renderer/vk/gpu_scene_vk.hpp.
+//
+// Draws of the scene push DrawConstants whose instanceIndex is the buffer table entry of the
+// instance table, and each indirect draw starts at its instance through firstInstance. Compile
+// vertex shaders with -fvk-support-nonzero-base-instance so that SV_InstanceID includes it, then
+// read the instance with LoadInstance(g_Buffers[g_Draw.instanceIndex], instanceId).
+
+struct GpuInstance
+{
+	float3 boundsCenter;
+	uint batch;
+	float3 boundsExtent;
+	// Zero for slots which hold no instance.
+	uint indexCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint2 reserved;
+	// DrawConstants of the instance, in declaration order.
+	uint4 constants;
+};
+
+static const uint kGpuInstanceSize = 64;
+
+GpuInstance LoadInstance(ByteAddressBuffer instances, uint instanceId)
+{
+	return instances.Load<GpuInstance>(instanceId * kGpuInstanceSize);
+}
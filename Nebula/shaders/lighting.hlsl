@@ -0,0 +1,42 @@
+// Full screen lighting pass of the deferred frame, reading the G-buffer written by gbuffer.hlsl
+// from tile memory through input attachments. Vulkan only, bound as set 1 of the pipeline layout
+// built by DriverVk.
+//
+// Built by the project, or by hand with:
+//
+// dxc -spirv -T vs_6_0 -E VSMain shaders/lighting.hlsl -Fo shaders/lighting.vs.spv
+// dxc -spirv -T ps_6_0 -E PSMain shaders/lighting.hlsl -Fo shaders/lighting.ps.spv
+
+[[vk::input_attachment_index(0)]] [[vk::binding(0, 1)]] SubpassInput g_Albedo;
+[[vk::input_attachment_index(1)]] [[vk::binding(1, 1)]] SubpassInput g_Normal;
+[[vk::input_attachment_index(2)]] [[vk::binding(2, 1)]] SubpassInput<float> g_Depth;
+
+static const float3 kLightDirection = normalize(float3(0.4f, 0.8f, -0.4f));
+static const float3 kLightColor = float3(1.0f, 0.95f, 0.9f);
+static const float3 kAmbient = float3(0.2f, 0.22f, 0.25f);
+
+struct PSInput
+{
+	float4 position : SV_POSITION;
+};
+
+// One triangle covering the screen, generated from the vertex index.
+PSInput VSMain(uint vertexId : SV_VertexID)
+{
+	PSInput result;
+	float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+	result.position = float4(uv * 2.0f - 1.0f, 0.0f, 1.0f);
+	return result;
+}
+
+float4 PSMain(PSInput input) : SV_TARGET
+{
+	float4 albedo = g_Albedo.SubpassLoad();
+	// Nothing was drawn here, the albedo still holds the clear color.
+	if (g_Depth.SubpassLoad() >= 1.0f)
+		return albedo;
+
+	float3 normal = normalize(g_Normal.SubpassLoad().xyz * 2.0f - 1.0f);
+	float diffuse = saturate(dot(normal, kLightDirection));
+	return float4(albedo.rgb * (kAmbient + kLightColor * diffuse), albedo.a);
+}
@@ -0,0 +1,69 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+/// Helpers shared by the benchmark executables. Each benchmark takes an optional problem size
+/// on the command line, ctest runs them with a small one so they keep building and running.
+namespace benchmark {
+    /// Returns the problem size passed as the first argument, or fallback.
+    inline size_t getSize(int argc, char** argv, size_t fallback) {
+        if (argc > 1) {
+            size_t size = std::strtoull(argv[1], nullptr, 10);
+            if (size > 0)
+                return size;
+        }
+        return fallback;
+    }
+
+    /// Thread counts to measure, doubling from one up to the hardware concurrency.
+    inline std::vector<uint32_t> getThreadCounts() {
+        uint32_t maximum = std::max(std::thread::hardware_concurrency(), 1u);
+        std::vector<uint32_t> counts;
+        for (uint32_t count = 1; count < maximum; count *= 2)
+            counts.push_back(count);
+        counts.push_back(maximum);
+        return counts;
+    }
+
+    /// Runs function repeats times and returns the fastest run in milliseconds.
+    template<typename Function>
+    double measure(int repeats, Function&& function) {
+        double best = 0.0;
+        for (int i = 0; i < repeats; i++) {
+            auto start = std::chrono::steady_clock::now();
+            function();
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            best = i == 0 ? milliseconds : std::min(best, milliseconds);
+        }
+        return best;
+    }
+}
@@ -0,0 +1,107 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "util/frame_arena.hpp"
+
+#include <cstdint>
+
+#include "test.hpp"
+
+static void testAlignment() {
+    FrameArena arena(1024);
+    void* pFirst = arena.allocate(3, 1);
+    void* pSecond = arena.allocate(16, 16);
+    CHECK(reinterpret_cast<uintptr_t>(pSecond) % 16 == 0);
+    CHECK(pSecond > pFirst);
+    CHECK(arena.getUsed() >= 19);
+    CHECK(arena.getUsed() <= 3 + 15 + 16);
+    CHECK_EQUAL(arena.getCapacity(), size_t(1024));
+
+    arena.reset();
+    CHECK_EQUAL(arena.getUsed(), size_t(0));
+    CHECK_EQUAL(arena.allocate(3, 1), pFirst);
+}
+
+static void testOverflowThenReset() {
+    // Every allocation overflows the block before it, the spilled bytes must still count
+    // towards the high-water mark.
+    FrameArena arena(1024);
+    for (int i = 0; i < 3; i++)
+        arena.allocate(1000);
+    CHECK(arena.getUsed() >= 3000);
+    CHECK_EQUAL(arena.getHighWaterMark(), arena.getUsed());
+    CHECK_EQUAL(arena.getCapacity(), size_t(3 * 1024));
+
+    // The blocks are merged into one large enough for the busiest frame, after which the same
+    // frame fits without adding blocks.
+    arena.reset();
+    size_t capacity = arena.getCapacity();
+    CHECK(capacity >= 3000);
+    CHECK(capacity < size_t(3 * 1024));
+    for (int frame = 0; frame < 4; frame++) {
+        for (int i = 0; i < 3; i++)
+            arena.allocate(1000);
+        CHECK_EQUAL(arena.getCapacity(), capacity);
+        arena.reset();
+        CHECK_EQUAL(arena.getCapacity(), capacity);
+    }
+
+    // A quieter frame keeps the capacity of the busiest one.
+    arena.allocate(100);
+    arena.reset();
+    CHECK_EQUAL(arena.getCapacity(), capacity);
+}
+
+static void testOverflowMidBlock() {
+    FrameArena arena(1024);
+    arena.allocate(600);
+    arena.allocate(600);
+    CHECK(arena.getUsed() >= 1200);
+    arena.reset();
+    size_t capacity = arena.getCapacity();
+    CHECK(capacity >= 1200);
+    arena.allocate(600);
+    arena.allocate(600);
+    CHECK_EQUAL(arena.getCapacity(), capacity);
+}
+
+static void testFrameVector() {
+    FrameArena arena(256);
+    FrameVector<uint32_t> values{ ArenaAllocator<uint32_t>(arena) };
+    for (uint32_t i = 0; i < 1000; i++)
+        values.push_back(i);
+    bool ordered = true;
+    for (uint32_t i = 0; i < values.size(); i++)
+        ordered = ordered && values[i] == i;
+    CHECK(ordered);
+    CHECK(arena.getHighWaterMark() >= 1000 * sizeof(uint32_t));
+}
+
+int main() {
+    testAlignment();
+    testOverflowThenReset();
+    testOverflowMidBlock();
+    testFrameVector();
+    return test::report("frame_arena_test");
+}
@@ -0,0 +1,120 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "util/parallel.hpp"
+
+#include <cmath>
+#include <random>
+
+#include "benchmark.hpp"
+
+namespace {
+    struct Transform {
+        float position[3];
+        float velocity[3];
+    };
+
+    struct Bounds {
+        float minimum[3] = { INFINITY, INFINITY, INFINITY };
+        float maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+    };
+
+    Bounds merge(Bounds a, const Bounds& b) {
+        for (int axis = 0; axis < 3; axis++) {
+            a.minimum[axis] = std::min(a.minimum[axis], b.minimum[axis]);
+            a.maximum[axis] = std::max(a.maximum[axis], b.maximum[axis]);
+        }
+        return a;
+    }
+
+    /// Integrates positions, a per-entity update loop.
+    void integrate(std::vector<Transform>& transforms, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            for (int axis = 0; axis < 3; axis++)
+                transforms[i].position[axis] += transforms[i].velocity[axis] * (1.0f / 60.0f);
+        }
+    }
+
+    /// Grows bounds by the positions in [begin, end), a bounds computation.
+    Bounds accumulate(const std::vector<Transform>& transforms, size_t begin, size_t end, Bounds bounds) {
+        for (size_t i = begin; i < end; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                bounds.minimum[axis] = std::min(bounds.minimum[axis], transforms[i].position[axis]);
+                bounds.maximum[axis] = std::max(bounds.maximum[axis], transforms[i].position[axis]);
+            }
+        }
+        return bounds;
+    }
+}
+
+int main(int argc, char** argv) {
+    const size_t count = benchmark::getSize(argc, argv, 1000000);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+    std::vector<Transform> transforms(count);
+    for (Transform& transform : transforms) {
+        for (int axis = 0; axis < 3; axis++) {
+            transform.position[axis] = distribution(random);
+            transform.velocity[axis] = distribution(random);
+        }
+    }
+    std::vector<uint32_t> keys(count);
+    for (uint32_t& key : keys)
+        key = random();
+    std::vector<uint32_t> sorted;
+
+    // The serial loops the helpers replace, every speedup is relative to them.
+    double serialFor = benchmark::measure(5, [&] { integrate(transforms, 0, count); });
+    Bounds bounds;
+    double serialReduce = benchmark::measure(5, [&] { bounds = accumulate(transforms, 0, count, Bounds()); });
+    double serialSort = benchmark::measure(5, [&] {
+        sorted = keys;
+        std::sort(sorted.begin(), sorted.end());
+    });
+
+    std::printf("%zu elements, best of 5 runs, milliseconds (speedup over the serial loop). The calling thread\n"
+        "works alongside the pool's workers.\n", count);
+    std::printf("%8s %18s %18s %18s\n", "workers", "forRange", "reduce", "sort");
+    std::printf("%8s %10.2f         %10.2f         %10.2f\n", "serial", serialFor, serialReduce, serialSort);
+    for (uint32_t threadCount : benchmark::getThreadCounts()) {
+        ThreadPool pool(threadCount);
+        double forMs = benchmark::measure(5, [&] {
+            Parallel::forRange(&pool, count, [&](size_t begin, size_t end) { integrate(transforms, begin, end); });
+        });
+        double reduceMs = benchmark::measure(5, [&] {
+            bounds = Parallel::reduce(&pool, count, Bounds(), [&](size_t begin, size_t end, Bounds bounds) {
+                return accumulate(transforms, begin, end, bounds);
+            }, merge);
+        });
+        double sortMs = benchmark::measure(5, [&] {
+            sorted = keys;
+            Parallel::sort(&pool, sorted.begin(), sorted.end());
+        });
+        std::printf("%8u %10.2f (%4.1fx) %10.2f (%4.1fx) %10.2f (%4.1fx)\n", threadCount, forMs, serialFor / forMs, 
+            reduceMs, serialReduce / reduceMs, sortMs, serialSort / sortMs);
+    }
+    // Using the results keeps the loops from being optimized away.
+    bool valid = std::is_sorted(sorted.begin(), sorted.end()) && bounds.minimum[0] <= bounds.maximum[0];
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "util/parallel.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "test.hpp"
+
+static void testForEach() {
+    ThreadPool pool(4);
+    std::vector<uint32_t> visits(100000, 0);
+    Parallel::forEach(&pool, visits.size(), [&](size_t i) { visits[i]++; }, 64);
+    CHECK(std::all_of(visits.begin(), visits.end(), [](uint32_t count) { return count == 1; }));
+}
+
+static void testReduce() {
+    ThreadPool pool(4);
+    const size_t count = 1000000;
+    uint64_t sum = Parallel::reduce(&pool, count, uint64_t(0), [](size_t begin, size_t end, uint64_t value) {
+        for (size_t i = begin; i < end; i++)
+            value += i;
+        return value;
+    }, [](uint64_t a, uint64_t b) { return a + b; });
+    CHECK_EQUAL(sum, uint64_t(count) * (count - 1) / 2);
+}
+
+static void testSort() {
+    ThreadPool pool(4);
+    std::mt19937 random(7);
+    // Sizes around the grain, odd block counts and heavy duplication all go through different 
+    // splits of the merge rounds.
+    for (size_t count : { size_t(0), size_t(1), size_t(4095), size_t(4097), size_t(12289), size_t(100000), size_t(1000003) }) {
+        for (uint32_t range : { 16u, UINT32_MAX }) {
+            std::vector<uint32_t> values(count);
+            for (uint32_t& value : values)
+                value = random() % range;
+            std::vector<uint32_t> expected = values;
+            std::sort(expected.begin(), expected.end());
+            Parallel::sort(&pool, values.begin(), values.end());
+            CHECK(values == expected);
+        }
+    }
+
+    // Descending order through a custom comparison.
+    std::vector<uint32_t> values(50000);
+    for (uint32_t& value : values)
+        value = random();
+    Parallel::sort(&pool, values.begin(), values.end(), std::greater<>(), 1024);
+    CHECK(std::is_sorted(values.begin(), values.end(), std::greater<>()));
+}
+
+int main() {
+    testForEach();
+    testReduce();
+    testSort();
+    return test::report("parallel_test");
+}
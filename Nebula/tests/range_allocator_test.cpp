@@ -0,0 +1,202 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "util/range_allocator.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "test.hpp"
+
+static void testAllocateAndFree() {
+    RangeAllocator allocator(1024);
+    CHECK_EQUAL(allocator.getSize(), uint64_t(1024));
+    CHECK_EQUAL(allocator.getFreeRegionCount(), uint32_t(1));
+    CHECK_EQUAL(allocator.getLargestFreeRegion(), uint64_t(1024));
+
+    std::optional<uint64_t> first = allocator.allocate(100);
+    std::optional<uint64_t> second = allocator.allocate(200);
+    CHECK(first && second);
+    CHECK_EQUAL(*first, uint64_t(0));
+    CHECK_EQUAL(*second, uint64_t(100));
+    CHECK_EQUAL(allocator.getAllocationCount(), uint32_t(2));
+    CHECK_EQUAL(allocator.getUsed(), uint64_t(300));
+    CHECK_EQUAL(allocator.getWasted(), uint64_t(0));
+    CHECK_EQUAL(allocator.getLargestFreeRegion(), uint64_t(724));
+
+    allocator.free(*first);
+    allocator.free(*second);
+    CHECK_EQUAL(allocator.getAllocationCount(), uint32_t(0));
+    CHECK_EQUAL(allocator.getUsed(), uint64_t(0));
+    CHECK_EQUAL(allocator.getFreeRegionCount(), uint32_t(1));
+    CHECK_EQUAL(allocator.getLargestFreeRegion(), uint64_t(1024));
+
+    // Freeing an offset which was never returned changes nothing.
+    allocator.free(512);
+    CHECK_EQUAL(allocator.getFreeRegionCount(), uint32_t(1));
+}
+
+static void testCoalesce() {
+    RangeAllocator allocator(1024);
+    uint64_t a = *allocator.allocate(256);
+    uint64_t b = *allocator.allocate(256);
+    uint64_t c = *allocator.allocate(256);
+    CHECK_EQUAL(allocator.getFreeRegionCount(), uint32_t(1));
+
+    // c merges with the free tail, a has no free neighbour.
+    allocator.free(a);
+    allocator.free(c);
+    CHECK_EQUAL(allocator.getFreeRegionCount(), uint32_t(2));
+    CHECK_EQUAL(allocator.getLargestFreeRegion(), uint64_t(512));
+
+    // b joins both of its neighbours.
+    allocator.free(b);
+    CHECK_EQUAL(allocator.getFreeRegionCount(), uint32_t(1));
+    CHECK_EQUAL(allocator.getLargestFreeRegion(), uint64_t(1024));
+    CHECK_EQUAL(*allocator.allocate(1024), uint64_t(0));
+}
+
+static void testFragmentation() {
+    RangeAllocator allocator(1024);
+    std::vector<uint64_t> offsets;
+    for (int i = 0; i < 16; i++)
+        offsets.push_back(*allocator.allocate(64));
+    CHECK_EQUAL(allocator.getFreeRegionCount(), uint32_t(0));
+    CHECK_EQUAL(allocator.getLargestFreeRegion(), uint64_t(0));
+
+    // Half of the range is free but no two free blocks touch.
+    for (size_t i = 0; i < offsets.size(); i += 2)
+        allocator.free(offsets[i]);
+    CHECK_EQUAL(allocator.getFreeRegionCount(), uint32_t(8));
+    CHECK_EQUAL(allocator.getLargestFreeRegion(), uint64_t(64));
+    CHECK(!allocator.allocate(128));
+    std::optional<uint64_t> small = allocator.allocate(64);
+    CHECK(small && *small % 128 == 0);
+    allocator.free(*small);
+
+    for (size_t i = 1; i < offsets.size(); i += 2)
+        allocator.free(offsets[i]);
+    CHECK_EQUAL(allocator.getFreeRegionCount(), uint32_t(1));
+    CHECK_EQUAL(allocator.getLargestFreeRegion(), uint64_t(1024));
+}
+
+static void testExhaustion() {
+    RangeAllocator allocator(1024);
+    CHECK(!allocator.allocate(1025));
+    CHECK(!allocator.allocate(1, 2048));
+    std::optional<uint64_t> all = allocator.allocate(1024);
+    CHECK(all && *all == 0);
+    CHECK(!allocator.allocate(1));
+    CHECK_EQUAL(allocator.getUsed(), uint64_t(1024));
+
+    allocator.free(*all);
+    CHECK(allocator.allocate(1));
+
+    // Leftovers too small to be worth a region of their own stay with the allocation.
+    RangeAllocator tight(1010);
+    std::optional<uint64_t> most = tight.allocate(1000);
+    CHECK(most && *most == 0);
+    CHECK_EQUAL(tight.getUsed(), uint64_t(1010));
+    CHECK_EQUAL(tight.getWasted(), uint64_t(10));
+    CHECK_EQUAL(tight.getFreeRegionCount(), uint32_t(0));
+    tight.free(*most);
+    CHECK_EQUAL(tight.getUsed(), uint64_t(0));
+    CHECK_EQUAL(tight.getWasted(), uint64_t(0));
+}
+
+static void testAlignment() {
+    RangeAllocator allocator(4096);
+    CHECK_EQUAL(*allocator.allocate(3), uint64_t(0));
+    std::vector<uint64_t> offsets;
+    for (uint64_t alignment = 1; alignment <= 512; alignment *= 2) {
+        std::optional<uint64_t> offset = allocator.allocate(24, alignment);
+        CHECK(offset.has_value());
+        if (offset) {
+            CHECK_EQUAL(*offset % alignment, uint64_t(0));
+            offsets.push_back(*offset);
+        }
+    }
+
+    // The padding skipped in front of aligned allocations is returned to the free lists.
+    CHECK(allocator.getFreeRegionCount() > 1);
+    allocator.free(0);
+    for (uint64_t offset : offsets)
+        allocator.free(offset);
+    CHECK_EQUAL(allocator.getFreeRegionCount(), uint32_t(1));
+    CHECK_EQUAL(allocator.getLargestFreeRegion(), uint64_t(4096));
+}
+
+static void testRandom() {
+    // Live allocations never overlap and the counters always agree with them.
+    constexpr uint64_t kSize = 1 << 20;
+    RangeAllocator allocator(kSize);
+    std::map<uint64_t, uint64_t> live;
+    std::mt19937 random(7);
+    for (int i = 0; i < 20000; i++) {
+        if (live.empty() || random() % 3 != 0) {
+            uint64_t size = 1 + random() % 4096;
+            uint64_t alignment = uint64_t(1) << (random() % 9);
+            std::optional<uint64_t> offset = allocator.allocate(size, alignment);
+            if (!offset)
+                continue;
+            CHECK_EQUAL(*offset % alignment, uint64_t(0));
+            CHECK(*offset + size <= kSize);
+            auto next = live.lower_bound(*offset);
+            CHECK(next == live.end() || *offset + size <= next->first);
+            CHECK(next == live.begin() || std::prev(next)->first + std::prev(next)->second <= *offset);
+            live[*offset] = size;
+        }
+        else {
+            auto it = std::next(live.begin(), random() % live.size());
+            allocator.free(it->first);
+            live.erase(it);
+        }
+        CHECK_EQUAL(allocator.getAllocationCount(), uint32_t(live.size()));
+    }
+
+    uint64_t requested = 0;
+    for (const auto& allocation : live)
+        requested += allocation.second;
+    CHECK_EQUAL(allocator.getUsed() - allocator.getWasted(), requested);
+    for (const auto& allocation : live)
+        allocator.free(allocation.first);
+    CHECK_EQUAL(allocator.getUsed(), uint64_t(0));
+    CHECK_EQUAL(allocator.getFreeRegionCount(), uint32_t(1));
+    CHECK_EQUAL(allocator.getLargestFreeRegion(), kSize);
+}
+
+int main() {
+    testAllocateAndFree();
+    testCoalesce();
+    testFragmentation();
+    testExhaustion();
+    testAlignment();
+    testRandom();
+    return test::report("range_allocator_test");
+}
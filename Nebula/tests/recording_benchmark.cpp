@@ -0,0 +1,149 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "renderer/bindless.hpp"
+#include "util/parallel.hpp"
+
+#include <cstring>
+
+#include "benchmark.hpp"
+
+namespace {
+    /// Fewest draws recorded into one secondary command buffer, as when draws were recorded
+    /// across the threadpool.
+    constexpr size_t kDrawGrain = 128;
+
+    enum class Opcode : uint32_t {
+        eBindPipeline,
+        ePushConstants,
+        eDrawIndexed,
+    };
+
+    /// Stand-in for a command written into a command buffer, about the size the driver records
+    /// for the commands of a draw.
+    struct Command {
+        Opcode opcode;
+        uint32_t arguments[7];
+    };
+
+    /// A draw as a renderable recorded it, with its pipeline, constants and mesh ranges.
+    struct Draw {
+        uint32_t pipeline;
+        DrawConstants constants;
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+    };
+
+    /// Stand-in for a secondary command buffer, reused between frames like the real ones.
+    struct CommandBuffer {
+        std::vector<Command> commands;
+    };
+
+    /// Command buffers of one thread, as the per-worker command pools handed them out.
+    struct RecordingSlot {
+        std::vector<CommandBuffer> buffers;
+        size_t usedCount = 0;
+        std::vector<std::pair<size_t, CommandBuffer*>> recorded;
+    };
+
+    void record(CommandBuffer& buffer, const Draw* pDraws, size_t begin, size_t end) {
+        buffer.commands.clear();
+        uint32_t boundPipeline = UINT32_MAX;
+        for (size_t i = begin; i < end; i++) {
+            const Draw& draw = pDraws[i];
+            if (draw.pipeline != boundPipeline) {
+                buffer.commands.push_back({ Opcode::eBindPipeline, { draw.pipeline } });
+                boundPipeline = draw.pipeline;
+            }
+            Command constants = { Opcode::ePushConstants, {} };
+            std::memcpy(constants.arguments, &draw.constants, sizeof(DrawConstants));
+            buffer.commands.push_back(constants);
+            buffer.commands.push_back({ Opcode::eDrawIndexed, { draw.indexCount, 1, draw.firstIndex, 
+                static_cast<uint32_t>(draw.vertexOffset), 0 } });
+        }
+    }
+
+    /// Records the draws split across the pool and returns the buffers in draw order.
+    void recordFrame(ThreadPool& pool, std::vector<RecordingSlot>& slots, const std::vector<Draw>& draws, 
+        std::vector<CommandBuffer*>& ordered) {
+        for (RecordingSlot& slot : slots)
+            slot.usedCount = 0;
+        Parallel::forRange(&pool, draws.size(), [&](size_t begin, size_t end) {
+            RecordingSlot& slot = slots[pool.getWorkerIndex()];
+            if (slot.usedCount == slot.buffers.size())
+                slot.buffers.emplace_back();
+            CommandBuffer& buffer = slot.buffers[slot.usedCount++];
+            record(buffer, draws.data(), begin, end);
+            slot.recorded.emplace_back(begin, &buffer);
+        }, kDrawGrain);
+
+        // Chunks are claimed in no particular order, put them back in draw order.
+        std::vector<std::pair<size_t, CommandBuffer*>> recorded;
+        for (RecordingSlot& slot : slots) {
+            recorded.insert(recorded.end(), slot.recorded.begin(), slot.recorded.end());
+            slot.recorded.clear();
+        }
+        std::sort(recorded.begin(), recorded.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        ordered.clear();
+        for (const auto& entry : recorded)
+            ordered.push_back(entry.second);
+    }
+}
+
+int main(int argc, char** argv) {
+    // The CPU side of recording draws into secondary command buffers across the threadpool:
+    // splitting the draws, recording each chunk into a buffer owned by the recording thread and 
+    // restoring draw order. The commands are written to memory instead of a device, so this 
+    // measures the scheduling and recording overhead rather than the driver's.
+    const size_t maximumDraws = benchmark::getSize(argc, argv, 100000);
+    std::printf("Best of 10 frames, milliseconds per frame. The calling thread records alongside the pool's workers.\n");
+    std::printf("%8s", "workers");
+    std::vector<size_t> drawCounts;
+    for (size_t drawCount : { maximumDraws / 10, maximumDraws * 3 / 10, maximumDraws }) {
+        drawCounts.push_back(std::max<size_t>(drawCount, 1));
+        std::printf(" %10zu draws", drawCounts.back());
+    }
+    std::printf("\n");
+
+    size_t recordedCommands = 0;
+    for (uint32_t threadCount : benchmark::getThreadCounts()) {
+        ThreadPool pool(threadCount);
+        std::printf("%8u", threadCount);
+        for (size_t drawCount : drawCounts) {
+            std::vector<Draw> draws(drawCount);
+            for (size_t i = 0; i < drawCount; i++)
+                draws[i] = { static_cast<uint32_t>(i / 64), DrawConstants(), 36, static_cast<uint32_t>(i * 36), 0 };
+            std::vector<RecordingSlot> slots(pool.getThreadCount() + 1);
+            std::vector<CommandBuffer*> ordered;
+            recordFrame(pool, slots, draws, ordered);
+            double milliseconds = benchmark::measure(10, [&] { recordFrame(pool, slots, draws, ordered); });
+            for (const CommandBuffer* pBuffer : ordered)
+                recordedCommands += pBuffer->commands.size();
+            std::printf(" %16.3f", milliseconds);
+        }
+        std::printf("\n");
+    }
+    return recordedCommands > 0 ? 0 : 1;
+}
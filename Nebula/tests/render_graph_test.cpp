@@ -0,0 +1,365 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "renderer/render_graph.hpp"
+
+#include <algorithm>
+
+#include "test.hpp"
+
+namespace {
+    constexpr uint64_t kTextureSize = 1 << 20;
+
+    RenderTextureDescription colorTexture() {
+        RenderTextureDescription description;
+        description.format = 1;
+        return description;
+    }
+
+    RenderTextureDescription depthTexture() {
+        RenderTextureDescription description;
+        description.format = 2;
+        description.depthStencil = true;
+        return description;
+    }
+
+    /// Every texture takes the same memory, so only lifetimes and tile locality decide aliasing.
+    RenderMemoryRequirements sameRequirements(RenderGraph::ResourceId) {
+        RenderMemoryRequirements requirements;
+        requirements.size = kTextureSize;
+        requirements.alignment = 256;
+        requirements.typeBits = 1;
+        return requirements;
+    }
+
+    const RenderGraph::Attachment* findAttachment(const RenderGraph::Group& group, RenderGraph::ResourceId resource) {
+        auto it = std::find_if(group.attachments.begin(), group.attachments.end(),
+            [&](const RenderGraph::Attachment& attachment) { return attachment.resource == resource; });
+        return it != group.attachments.end() ? &*it : nullptr;
+    }
+
+    bool hasBarrier(const std::vector<RenderGraph::Barrier>& barriers, RenderGraph::ResourceId resource,
+        RenderAccess before, RenderAccess after) {
+        return std::any_of(barriers.begin(), barriers.end(), [&](const RenderGraph::Barrier& barrier) {
+            return barrier.resource == resource && barrier.before == before && barrier.after == after;
+        });
+    }
+}
+
+static void testGBuffer() {
+    // The deferred frame, a geometry pass filling the G-buffer which the lighting pass reads as
+    // input attachments while shading into the backbuffer.
+    RenderGraph graph;
+    auto backbuffer = graph.importTexture("Backbuffer", colorTexture(), RenderAccess::eUndefined, RenderAccess::ePresent);
+    auto depth = graph.createTexture("Depth", depthTexture());
+    auto albedo = graph.createTexture("Albedo", colorTexture());
+    auto normal = graph.createTexture("Normal", colorTexture());
+
+    auto geometry = graph.addPass("Geometry");
+    graph.write(geometry, albedo, RenderAccess::eColorAttachment, RenderLoad::eClear);
+    graph.write(geometry, normal, RenderAccess::eColorAttachment, RenderLoad::eClear);
+    graph.write(geometry, depth, RenderAccess::eDepthAttachment, RenderLoad::eClear);
+    auto lighting = graph.addPass("Lighting");
+    graph.read(lighting, albedo, RenderAccess::eInputAttachment);
+    graph.read(lighting, normal, RenderAccess::eInputAttachment);
+    graph.write(lighting, backbuffer, RenderAccess::eColorAttachment, RenderLoad::eDontCare);
+
+    CHECK(graph.compile());
+    graph.alias(sameRequirements);
+
+    // Both passes become subpasses of a single render pass, needing no barriers at all.
+    const auto& groups = graph.getGroups();
+    CHECK_EQUAL(groups.size(), size_t(1));
+    CHECK(groups[0].renderPass);
+    CHECK_EQUAL(groups[0].passes.size(), size_t(2));
+    CHECK(groups[0].barriers.empty());
+    CHECK(graph.getFinalBarriers().empty());
+    CHECK_EQUAL(graph.getPassGroup(geometry), 0u);
+    CHECK_EQUAL(graph.getPassSubpass(geometry), 0u);
+    CHECK_EQUAL(graph.getPassSubpass(lighting), 1u);
+
+    // The G-buffer never leaves the render pass, the backbuffer is stored and presented.
+    CHECK_EQUAL(groups[0].attachments.size(), size_t(4));
+    for (auto resource : { albedo, normal }) {
+        const RenderGraph::Attachment* pAttachment = findAttachment(groups[0], resource);
+        CHECK(pAttachment != nullptr);
+        if (!pAttachment)
+            continue;
+        CHECK(pAttachment->initialAccess == RenderAccess::eUndefined);
+        CHECK(pAttachment->finalAccess == RenderAccess::eInputAttachment);
+        CHECK(pAttachment->load == RenderLoad::eClear);
+        CHECK(!pAttachment->store);
+        CHECK(graph.isResourceTileLocal(resource));
+    }
+    const RenderGraph::Attachment* pDepth = findAttachment(groups[0], depth);
+    CHECK(pDepth && !pDepth->store && pDepth->finalAccess == RenderAccess::eDepthAttachment);
+    CHECK(graph.isResourceTileLocal(depth));
+    const RenderGraph::Attachment* pBackbuffer = findAttachment(groups[0], backbuffer);
+    CHECK(pBackbuffer && pBackbuffer->store && pBackbuffer->finalAccess == RenderAccess::ePresent);
+    CHECK(pBackbuffer && pBackbuffer->load == RenderLoad::eDontCare);
+    CHECK(!graph.isResourceTileLocal(backbuffer));
+
+    // Every transient is alive for the whole render pass, so none of them share memory, and the
+    // imported backbuffer has no slot.
+    CHECK_EQUAL(graph.getMemorySlots().size(), size_t(3));
+    CHECK(graph.getResourceSlot(albedo) != graph.getResourceSlot(normal));
+    CHECK(graph.getResourceSlot(albedo) != graph.getResourceSlot(depth));
+    CHECK_EQUAL(graph.getResourceSlot(backbuffer), RenderGraph::kInvalid);
+
+    const RenderGraph::Statistics& statistics = graph.getStatistics();
+    CHECK_EQUAL(statistics.passCount, 2u);
+    CHECK_EQUAL(statistics.culledPassCount, 0u);
+    CHECK_EQUAL(statistics.renderPassCount, 1u);
+    CHECK_EQUAL(statistics.subpassCount, 2u);
+    CHECK_EQUAL(statistics.barrierCount, 0u);
+    CHECK_EQUAL(statistics.transientCount, 3u);
+    CHECK_EQUAL(statistics.tileLocalCount, 3u);
+    CHECK(statistics.bandwidthBytes < statistics.unmergedBandwidthBytes);
+}
+
+static void testCulledPass() {
+    RenderGraph graph;
+    auto backbuffer = graph.importTexture("Backbuffer", colorTexture(), RenderAccess::eUndefined, RenderAccess::ePresent);
+    auto unused = graph.createTexture("Unused", colorTexture());
+    auto debug = graph.addPass("Debug");
+    graph.write(debug, unused, RenderAccess::eColorAttachment, RenderLoad::eClear);
+    auto forward = graph.addPass("Forward");
+    graph.write(forward, backbuffer, RenderAccess::eColorAttachment, RenderLoad::eClear);
+
+    CHECK(graph.compile());
+    graph.alias(sameRequirements);
+    CHECK(graph.isPassCulled(debug));
+    CHECK(!graph.isPassCulled(forward));
+    CHECK_EQUAL(graph.getPassGroup(debug), RenderGraph::kInvalid);
+    CHECK_EQUAL(graph.getGroups().size(), size_t(1));
+    CHECK(!graph.isResourceUsed(unused));
+    CHECK_EQUAL(graph.getResourceSlot(unused), RenderGraph::kInvalid);
+    CHECK(graph.getMemorySlots().empty());
+    CHECK_EQUAL(graph.getStatistics().culledPassCount, 1u);
+
+    // Passes with side effects survive even when nothing reads what they write.
+    graph.setSideEffects(debug);
+    CHECK(graph.compile());
+    CHECK(!graph.isPassCulled(debug));
+    CHECK(graph.isResourceUsed(unused));
+    CHECK_EQUAL(graph.getStatistics().culledPassCount, 0u);
+}
+
+static void testNonOverlappingTransients() {
+    // A chain of compute passes, each reading what the one before wrote. The first and the 
+    // last intermediate texture are never alive at the same time.
+    RenderGraph graph;
+    auto output = graph.importTexture("Output", colorTexture(), RenderAccess::eUndefined, RenderAccess::eSampled);
+    auto first = graph.createTexture("First", colorTexture());
+    auto second = graph.createTexture("Second", colorTexture());
+    auto third = graph.createTexture("Third", colorTexture());
+
+    auto a = graph.addPass("A");
+    graph.write(a, first, RenderAccess::eStorageWrite, RenderLoad::eDontCare);
+    auto b = graph.addPass("B");
+    graph.read(b, first, RenderAccess::eSampled);
+    graph.write(b, second, RenderAccess::eStorageWrite, RenderLoad::eDontCare);
+    auto c = graph.addPass("C");
+    graph.read(c, second, RenderAccess::eSampled);
+    graph.write(c, third, RenderAccess::eStorageWrite, RenderLoad::eDontCare);
+    auto d = graph.addPass("D");
+    graph.read(d, third, RenderAccess::eStorageRead);
+    graph.write(d, output, RenderAccess::eStorageWrite, RenderLoad::eDontCare);
+
+    CHECK(graph.compile());
+    graph.alias(sameRequirements);
+
+    const auto& groups = graph.getGroups();
+    CHECK_EQUAL(groups.size(), size_t(4));
+    for (const RenderGraph::Group& group : groups) {
+        CHECK(!group.renderPass);
+        CHECK(group.attachments.empty());
+    }
+    CHECK(hasBarrier(groups[0].barriers, first, RenderAccess::eUndefined, RenderAccess::eStorageWrite));
+    CHECK(hasBarrier(groups[1].barriers, first, RenderAccess::eStorageWrite, RenderAccess::eSampled));
+    CHECK(hasBarrier(groups[1].barriers, second, RenderAccess::eUndefined, RenderAccess::eStorageWrite));
+    CHECK(hasBarrier(groups[3].barriers, third, RenderAccess::eStorageWrite, RenderAccess::eStorageRead));
+    CHECK_EQUAL(graph.getResourceFirstGroup(first), 0u);
+    CHECK_EQUAL(graph.getResourceLastGroup(first), 1u);
+    CHECK_EQUAL(graph.getResourceFirstGroup(third), 2u);
+
+    // First and Third share memory, Second overlaps both.
+    CHECK_EQUAL(graph.getMemorySlots().size(), size_t(2));
+    CHECK_EQUAL(graph.getResourceSlot(first), graph.getResourceSlot(third));
+    CHECK(graph.getResourceSlot(second) != graph.getResourceSlot(first));
+    CHECK_EQUAL(graph.getStatistics().unaliasedBytes, 3 * kTextureSize);
+    CHECK_EQUAL(graph.getStatistics().aliasedBytes, 2 * kTextureSize);
+
+    // Each texture waits for the one before it in its slot, and the first of a slot for the
+    // last of the previous frame.
+    CHECK(graph.getPreviousAccess(third) == RenderAccess::eSampled);
+    CHECK(graph.getPreviousAccess(first) == RenderAccess::eStorageRead);
+    CHECK(graph.getPreviousAccess(second) == RenderAccess::eSampled);
+    CHECK(graph.getPreviousAccess(output) == RenderAccess::eSampled);
+
+    // Textures which cannot live in the same memory types never share a slot.
+    graph.alias([&](RenderGraph::ResourceId resource) {
+        RenderMemoryRequirements requirements = sameRequirements(resource);
+        if (resource == third)
+            requirements.typeBits = 2;
+        return requirements;
+    });
+    CHECK_EQUAL(graph.getMemorySlots().size(), size_t(3));
+    CHECK(graph.getResourceSlot(first) != graph.getResourceSlot(third));
+}
+
+static void testReadBeforeWrite() {
+    {
+        RenderGraph graph;
+        auto texture = graph.createTexture("Texture", colorTexture());
+        auto pass = graph.addPass("Read");
+        graph.read(pass, texture, RenderAccess::eSampled);
+        graph.setSideEffects(pass);
+        CHECK(!graph.compile());
+    }
+    {
+        // Loading the previous contents of a transient reads it too.
+        RenderGraph graph;
+        auto texture = graph.createTexture("Texture", colorTexture());
+        auto pass = graph.addPass("Load");
+        graph.write(pass, texture, RenderAccess::eColorAttachment, RenderLoad::eLoad);
+        graph.setSideEffects(pass);
+        CHECK(!graph.compile());
+    }
+    {
+        // Reads which come after the write, declared in a later pass, are fine.
+        RenderGraph graph;
+        auto texture = graph.createTexture("Texture", colorTexture());
+        auto write = graph.addPass("Write");
+        graph.write(write, texture, RenderAccess::eStorageWrite, RenderLoad::eDontCare);
+        auto read = graph.addPass("Read");
+        graph.read(read, texture, RenderAccess::eSampled);
+        graph.setSideEffects(read);
+        CHECK(graph.compile());
+    }
+    {
+        // Imported textures hold their contents from before the frame.
+        RenderGraph graph;
+        auto history = graph.importTexture("History", colorTexture(), RenderAccess::eSampled, RenderAccess::eSampled);
+        auto pass = graph.addPass("Read");
+        graph.read(pass, history, RenderAccess::eSampled);
+        graph.setSideEffects(pass);
+        CHECK(graph.compile());
+    }
+}
+
+static void testImportedFinalTransitions() {
+    RenderGraph graph;
+    auto backbuffer = graph.importTexture("Backbuffer", colorTexture(), RenderAccess::eUndefined, RenderAccess::ePresent);
+    auto history = graph.importTexture("History", colorTexture(), RenderAccess::eSampled, RenderAccess::eSampled);
+    auto readback = graph.importTexture("Readback", colorTexture(), RenderAccess::eUndefined, RenderAccess::eTransferSource);
+
+    auto resolve = graph.addPass("Resolve");
+    graph.read(resolve, history, RenderAccess::eSampled);
+    graph.write(resolve, readback, RenderAccess::eStorageWrite, RenderLoad::eDontCare);
+    auto update = graph.addPass("Update");
+    graph.write(update, history, RenderAccess::eStorageWrite, RenderLoad::eDontCare);
+    auto present = graph.addPass("Present");
+    graph.write(present, backbuffer, RenderAccess::eColorAttachment, RenderLoad::eClear);
+
+    CHECK(graph.compile());
+    graph.alias(sameRequirements);
+
+    // Reading History in the state it was imported in needs no barrier.
+    const auto& groups = graph.getGroups();
+    CHECK_EQUAL(groups.size(), size_t(3));
+    CHECK(!hasBarrier(groups[0].barriers, history, RenderAccess::eSampled, RenderAccess::eSampled));
+    CHECK(hasBarrier(groups[0].barriers, readback, RenderAccess::eUndefined, RenderAccess::eStorageWrite));
+
+    // Textures last used outside a render pass are moved into their final access after the 
+    // last group, the render pass presenting the backbuffer transitions it itself.
+    const auto& finalBarriers = graph.getFinalBarriers();
+    CHECK_EQUAL(finalBarriers.size(), size_t(2));
+    CHECK(hasBarrier(finalBarriers, history, RenderAccess::eStorageWrite, RenderAccess::eSampled));
+    CHECK(hasBarrier(finalBarriers, readback, RenderAccess::eStorageWrite, RenderAccess::eTransferSource));
+    const RenderGraph::Attachment* pBackbuffer = findAttachment(groups[2], backbuffer);
+    CHECK(pBackbuffer && pBackbuffer->finalAccess == RenderAccess::ePresent && pBackbuffer->store);
+
+    // The next frame starts from the final accesses.
+    CHECK(graph.getLastAccess(history) == RenderAccess::eSampled);
+    CHECK(graph.getPreviousAccess(history) == RenderAccess::eSampled);
+    CHECK(graph.getPreviousAccess(backbuffer) == RenderAccess::ePresent);
+    CHECK(graph.getMemorySlots().empty());
+}
+
+static void testTileLocalAliasing() {
+    // Two render passes with depth buffers that never leave tile memory, separated by a compute
+    // pass. The depth buffers share a slot, the stored textures never join it even though their
+    // lifetimes would allow it.
+    RenderGraph graph;
+    auto backbuffer = graph.importTexture("Backbuffer", colorTexture(), RenderAccess::eUndefined, RenderAccess::ePresent);
+    auto firstDepth = graph.createTexture("First depth", depthTexture());
+    auto color = graph.createTexture("Color", colorTexture());
+    auto blurred = graph.createTexture("Blurred", colorTexture());
+    auto secondDepth = graph.createTexture("Second depth", depthTexture());
+
+    auto first = graph.addPass("First");
+    graph.write(first, firstDepth, RenderAccess::eDepthAttachment, RenderLoad::eClear);
+    graph.write(first, color, RenderAccess::eColorAttachment, RenderLoad::eClear);
+    auto blur = graph.addPass("Blur");
+    graph.read(blur, color, RenderAccess::eSampled);
+    graph.write(blur, blurred, RenderAccess::eStorageWrite, RenderLoad::eDontCare);
+    auto second = graph.addPass("Second");
+    graph.read(second, blurred, RenderAccess::eSampled);
+    graph.write(second, secondDepth, RenderAccess::eDepthAttachment, RenderLoad::eClear);
+    graph.write(second, backbuffer, RenderAccess::eColorAttachment, RenderLoad::eClear);
+
+    CHECK(graph.compile());
+    graph.alias(sameRequirements);
+
+    const auto& groups = graph.getGroups();
+    CHECK_EQUAL(groups.size(), size_t(3));
+    CHECK(groups[0].renderPass && !groups[1].renderPass && groups[2].renderPass);
+    const RenderGraph::Attachment* pColor = findAttachment(groups[0], color);
+    CHECK(pColor && pColor->store);
+    CHECK(hasBarrier(groups[1].barriers, color, RenderAccess::eColorAttachment, RenderAccess::eSampled));
+    CHECK(hasBarrier(groups[2].barriers, blurred, RenderAccess::eStorageWrite, RenderAccess::eSampled));
+
+    CHECK(graph.isResourceTileLocal(firstDepth));
+    CHECK(graph.isResourceTileLocal(secondDepth));
+    CHECK(!graph.isResourceTileLocal(color));
+    CHECK(!graph.isResourceTileLocal(blurred));
+    CHECK_EQUAL(graph.getStatistics().tileLocalCount, 2u);
+
+    CHECK_EQUAL(graph.getMemorySlots().size(), size_t(3));
+    CHECK_EQUAL(graph.getResourceSlot(firstDepth), graph.getResourceSlot(secondDepth));
+    CHECK(graph.getResourceSlot(blurred) != graph.getResourceSlot(firstDepth));
+    CHECK(graph.getResourceSlot(color) != graph.getResourceSlot(secondDepth));
+    CHECK(graph.getResourceSlot(color) != graph.getResourceSlot(blurred));
+}
+
+int main() {
+    testGBuffer();
+    testCulledPass();
+    testNonOverlappingTransients();
+    testReadBeforeWrite();
+    testImportedFinalTransitions();
+    testTileLocalAliasing();
+    return test::report("render_graph_test");
+}
@@ -0,0 +1,54 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdio>
+
+/// Minimal checks for the unit tests of engine code which does not need a device. Every 
+/// failed check is printed and counted, and each test executable returns the count from main
+/// so that ctest reports it as failed.
+namespace test {
+    inline int& failureCount() {
+        static int count = 0;
+        return count;
+    }
+
+    inline void fail(const char* expression, const char* file, int line) {
+        std::printf("%s(%d): check failed: %s\n", file, line, expression);
+        failureCount()++;
+    }
+
+    /// Prints a summary and returns the exit code of the test executable.
+    inline int report(const char* name) {
+        if (failureCount() == 0)
+            std::printf("%s: all checks passed.\n", name);
+        else
+            std::printf("%s: %d checks failed.\n", name, failureCount());
+        return failureCount() == 0 ? 0 : 1;
+    }
+}
+
+#define CHECK(expression) ((expression) ? (void)0 : test::fail(#expression, __FILE__, __LINE__))
+#define CHECK_EQUAL(actual, expected) CHECK((actual) == (expected))
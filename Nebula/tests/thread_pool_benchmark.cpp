@@ -0,0 +1,146 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "util/thread_pool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+
+#include "benchmark.hpp"
+
+namespace {
+    /// The single-mutex pool the work-stealing scheduler replaced, kept as the baseline. Every
+    /// task goes through one queue and runs while its lock is still held.
+    class MutexPool {
+    public:
+        explicit MutexPool(uint32_t threadCount) : m_Complete(false) {
+            for (uint32_t i = 0; i < threadCount; i++) {
+                m_Threads.emplace_back([this] {
+                    while (true) {
+                        std::unique_lock<std::mutex> lock(m_Mutex);
+                        m_Condition.wait(lock, [this] { return m_Complete || !m_Queue.empty(); });
+                        if (m_Complete && m_Queue.empty())
+                            return;
+                        std::function<void()> function = std::move(m_Queue.front());
+                        m_Queue.pop();
+                        function();
+                        m_Condition.notify_one();
+                    }
+                });
+            }
+        }
+
+        ~MutexPool() {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Complete = true;
+            }
+            m_Condition.notify_all();
+            for (std::thread& thread : m_Threads)
+                thread.join();
+        }
+
+        void enqueue(std::function<void()> function) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Queue.push(std::move(function));
+            m_Condition.notify_one();
+        }
+    private:
+        std::vector<std::thread> m_Threads;
+        std::queue<std::function<void()>> m_Queue;
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        bool m_Complete;
+    };
+
+    /// A few hundred nanoseconds of work, about the size of a per-draw task.
+    void work(std::atomic<uint64_t>& sink) {
+        uint64_t value = 0;
+        for (uint32_t i = 0; i < 64; i++)
+            value = value * 6364136223846793005ull + i;
+        sink.fetch_add(value & 1, std::memory_order_relaxed);
+    }
+}
+
+int main(int argc, char** argv) {
+    const size_t taskCount = benchmark::getSize(argc, argv, 1000000);
+    std::atomic<uint64_t> sink(0);
+    std::printf("%zu tasks per run, best of 3 runs, in millions of tasks per second.\n", taskCount);
+    std::printf("%8s %12s %12s %12s %14s\n", "threads", "mutex", "stealing", "fan out", "steal rate");
+
+    for (uint32_t threadCount : benchmark::getThreadCounts()) {
+        // Baseline, every task submitted from the main thread into the single queue.
+        double mutexMs;
+        {
+            MutexPool pool(threadCount);
+            mutexMs = benchmark::measure(3, [&] {
+                std::atomic<size_t> remaining(taskCount);
+                for (size_t i = 0; i < taskCount; i++)
+                    pool.enqueue([&] { work(sink); remaining--; });
+                while (remaining > 0)
+                    std::this_thread::yield();
+            });
+        }
+
+        // The same submission pattern through the shared submission queue of the new pool.
+        ThreadPool pool(threadCount);
+        double stealingMs = benchmark::measure(3, [&] {
+            WaitGroup group;
+            for (size_t i = 0; i < taskCount; i++)
+                pool.enqueue([&] { work(sink); }, group);
+            pool.wait(group);
+        });
+
+        // Tasks spawned by a few workers and spread by stealing, as when recording fans out.
+        std::vector<WorkerStatistics> before = pool.getStatistics();
+        double fanOutMs = benchmark::measure(3, [&] {
+            WaitGroup group;
+            const size_t rootCount = 4;
+            for (size_t root = 0; root < rootCount; root++) {
+                pool.enqueue([&, root] {
+                    size_t first = taskCount * root / rootCount;
+                    size_t last = taskCount * (root + 1) / rootCount;
+                    for (size_t i = first; i < last; i++)
+                        pool.enqueue([&] { work(sink); }, group);
+                }, group);
+            }
+            pool.wait(group);
+        });
+        std::vector<WorkerStatistics> after = pool.getStatistics();
+        uint64_t attempts = 0;
+        uint64_t successes = 0;
+        for (size_t i = 0; i < after.size(); i++) {
+            attempts += after[i].stealAttempts - before[i].stealAttempts;
+            successes += after[i].stealSuccesses - before[i].stealSuccesses;
+        }
+
+        auto rate = [&](double milliseconds) { return taskCount / milliseconds / 1000.0; };
+        std::printf("%8u %12.2f %12.2f %12.2f %13.1f%%\n", threadCount, rate(mutexMs), rate(stealingMs), 
+            rate(fanOutMs), attempts ? 100.0 * successes / attempts : 0.0);
+    }
+    return 0;
+}
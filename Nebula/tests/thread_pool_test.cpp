@@ -0,0 +1,135 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "util/thread_pool.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "test.hpp"
+
+static void testStealingUnderLoad() {
+    // Tasks fan out from the workers while the others steal from them. Once everything has 
+    // finished the queued counters must be back at zero, a counter which wrapped around would
+    // leave shouldYield() raised forever.
+    ThreadPool pool(4);
+    std::atomic<uint32_t> executed(0);
+    for (int round = 0; round < 200; round++) {
+        WaitGroup group;
+        for (int i = 0; i < 64; i++) {
+            pool.enqueue([&] {
+                for (int j = 0; j < 4; j++)
+                    pool.enqueue([&] { executed++; }, group, TaskPriority::eCritical);
+                executed++;
+            }, group, TaskPriority::eCritical);
+        }
+        pool.wait(group);
+    }
+    CHECK_EQUAL(executed.load(), 200u * 64u * 5u);
+    CHECK(!pool.shouldYield());
+}
+
+static void testShutdownDrainsBackground() {
+    // More background tasks than the concurrency limit allows at once are still queued when the 
+    // pool is destroyed, every one of them must run before the workers exit.
+    std::atomic<uint32_t> executed(0);
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 16; i++) {
+            pool.enqueue([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                executed++;
+            }, TaskPriority::eBackground);
+        }
+    }
+    CHECK_EQUAL(executed.load(), 16u);
+}
+
+static void testContinuations() {
+    ThreadPool pool(2);
+    WaitGroup group;
+    WaitGroup continued;
+    std::atomic<uint32_t> executed(0);
+    std::atomic<bool> ranAfter(false);
+    continued.add();
+    for (int i = 0; i < 32; i++)
+        pool.enqueue([&] { executed++; }, group);
+    group.then(&pool, [&] {
+        ranAfter = executed == 32;
+        continued.done();
+    });
+    pool.wait(continued);
+    CHECK(ranAfter);
+
+    // A completed group runs its continuation straight away.
+    continued.add();
+    group.then(&pool, [&] { continued.done(); });
+    pool.wait(continued);
+    CHECK(continued.isComplete());
+}
+
+static void testSteadyStateAllocations() {
+    // A frame's worth of tasks, each capture too large for the inline storage of a task, with a
+    // continuation registered on the group. Once the first frames have grown the queues and the
+    // task storage, further frames must not touch the heap at all.
+    ThreadPool pool(4);
+    std::array<Task, 256> tasks;
+    std::atomic<uint64_t> sink(0);
+    auto runFrame = [&] {
+        WaitGroup group;
+        WaitGroup continued;
+        for (Task& task : tasks) {
+            std::array<uint64_t, 16> payload = {};
+            payload[0] = 1;
+            task = [&sink, payload] { sink += payload[0]; };
+        }
+        // Held open so that the continuation is queued on the group rather than run straight away.
+        group.add();
+        continued.add();
+        group.then(&pool, [&] { continued.done(); });
+        pool.submit(tasks.data(), tasks.size(), group, TaskPriority::eCritical);
+        group.done();
+        pool.wait(group);
+        pool.wait(continued);
+    };
+
+    for (int frame = 0; frame < 10; frame++)
+        runFrame();
+    uint64_t allocations = ThreadPool::getHeapAllocationCount();
+    for (int frame = 0; frame < 200; frame++)
+        runFrame();
+    CHECK_EQUAL(ThreadPool::getHeapAllocationCount(), allocations);
+    CHECK_EQUAL(sink.load(), 210u * 256u);
+}
+
+int main() {
+    testStealingUnderLoad();
+    testShutdownDrainsBackground();
+    testContinuations();
+    testSteadyStateAllocations();
+    return test::report("thread_pool_test");
+}
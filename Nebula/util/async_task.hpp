@@ -0,0 +1,215 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+template<typename T>
+class AsyncTask;
+
+namespace AsyncDetail {
+    /// Resumes whoever awaited the coroutine, or destroys the frame of a detached coroutine.
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            auto& promise = handle.promise();
+            if (promise.continuation)
+                return promise.continuation;
+            if (promise.detached)
+                handle.destroy();
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    struct PromiseBase {
+        std::coroutine_handle<> continuation;
+        bool detached = false;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    template<typename T>
+    struct Promise : PromiseBase {
+        std::optional<T> value;
+
+        AsyncTask<T> get_return_object();
+        void return_value(T result) { value = std::move(result); }
+        T takeResult() { return std::move(*value); }
+    };
+
+    template<>
+    struct Promise<void> : PromiseBase {
+        AsyncTask<void> get_return_object();
+        void return_void() {}
+        void takeResult() {}
+    };
+}
+
+/// Lazily started coroutine producing a T. The coroutine begins executing when it is first
+/// awaited, or when it is handed to start() to run detached on a threadpool. Use resumeOn() 
+/// inside of the coroutine to move it onto the threadpool, and the awaitables below to wait 
+/// on other work without blocking a worker thread.
+template<typename T = void>
+class AsyncTask {
+public:
+    using promise_type = AsyncDetail::Promise<T>;
+
+    AsyncTask() = default;
+    explicit AsyncTask(std::coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+    AsyncTask(AsyncTask&& other) noexcept : m_Handle(std::exchange(other.m_Handle, nullptr)) {}
+    AsyncTask& operator=(AsyncTask&& other) noexcept {
+        if (this != &other) {
+            if (m_Handle)
+                m_Handle.destroy();
+            m_Handle = std::exchange(other.m_Handle, nullptr);
+        }
+        return *this;
+    }
+    AsyncTask(const AsyncTask&) = delete;
+    AsyncTask& operator=(const AsyncTask&) = delete;
+
+    ~AsyncTask() {
+        if (m_Handle)
+            m_Handle.destroy();
+    }
+
+    /// Starts the coroutine on pPool without anyone awaiting it. The coroutine frame is 
+    /// destroyed when it completes and the result, if any, is discarded.
+    void start(ThreadPool* pPool, TaskPriority priority = TaskPriority::eNormal) {
+        auto handle = std::exchange(m_Handle, nullptr);
+        handle.promise().detached = true;
+        pPool->enqueue([handle] { handle.resume(); }, priority);
+    }
+
+    bool isDone() const {
+        return !m_Handle || m_Handle.done();
+    }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept { 
+                return handle.done(); 
+            }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() {
+                return handle.promise().takeResult();
+            }
+        };
+        return Awaiter{ m_Handle };
+    }
+private:
+    std::coroutine_handle<promise_type> m_Handle;
+};
+
+template<typename T>
+AsyncTask<T> AsyncDetail::Promise<T>::get_return_object() {
+    return AsyncTask<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline AsyncTask<void> AsyncDetail::Promise<void>::get_return_object() {
+    return AsyncTask<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+/// Suspends the coroutine and continues it on a worker of pPool.
+inline auto resumeOn(ThreadPool* pPool, TaskPriority priority = TaskPriority::eNormal) {
+    struct Awaiter {
+        ThreadPool* pPool;
+        TaskPriority priority;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            pPool->enqueue([handle] { handle.resume(); }, priority);
+        }
+        void await_resume() noexcept {}
+    };
+    return Awaiter{ pPool, priority };
+}
+
+/// Suspends the coroutine until every task in group has finished, continuing it on pPool.
+inline auto waitFor(ThreadPool* pPool, WaitGroup& group) {
+    struct Awaiter {
+        ThreadPool* pPool;
+        WaitGroup& group;
+
+        bool await_ready() const noexcept { return group.isComplete(); }
+        void await_suspend(std::coroutine_handle<> handle) {
+            group.then(pPool, [handle] { handle.resume(); });
+        }
+        void await_resume() noexcept {}
+    };
+    return Awaiter{ pPool, group };
+}
+
+/// Reads an entire file on the background lane of pPool. The read itself is a regular
+/// blocking read, but it only occupies a background worker, leaving the frame lanes free.
+AsyncTask<std::optional<std::vector<char>>> readFileAsync(ThreadPool* pPool, std::string path);
+
+namespace AsyncDetail {
+    template<typename T>
+    AsyncTask<void> signalWhenDone(AsyncTask<T> task, std::optional<T>* pResult, WaitGroup* pGroup) {
+        *pResult = co_await std::move(task);
+        pGroup->done();
+    }
+
+    inline AsyncTask<void> signalWhenDone(AsyncTask<void> task, WaitGroup* pGroup) {
+        co_await std::move(task);
+        pGroup->done();
+    }
+}
+
+/// Runs task to completion from a thread which is not a coroutine, such as the main thread,
+/// executing pending threadpool work while it waits.
+template<typename T>
+T syncWait(ThreadPool* pPool, AsyncTask<T> task) {
+    WaitGroup group;
+    group.add();
+    if constexpr (std::is_void_v<T>) {
+        AsyncDetail::signalWhenDone(std::move(task), &group).start(pPool, TaskPriority::eCritical);
+        pPool->wait(group);
+    } else {
+        std::optional<T> result;
+        AsyncDetail::signalWhenDone(std::move(task), &result, &group).start(pPool, TaskPriority::eCritical);
+        pPool->wait(group);
+        return std::move(*result);
+    }
+}
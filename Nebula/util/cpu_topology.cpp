@@ -0,0 +1,263 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "cpu_topology.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    /// Processors of a group are numbered from group * kGroupSize upwards.
+    constexpr uint32_t kGroupSize = sizeof(KAFFINITY) * 8;
+
+    bool contains(const GROUP_AFFINITY& affinity, uint32_t id) {
+        return affinity.Group == id / kGroupSize && (affinity.Mask & (KAFFINITY(1) << (id % kGroupSize)));
+    }
+#elif defined(__linux__)
+    bool readValue(const std::string& path, uint32_t& value) {
+        std::ifstream stream(path);
+        return static_cast<bool>(stream >> value);
+    }
+
+    /// Parses a kernel cpu list such as "0-3,8-11".
+    std::vector<uint32_t> readList(const std::string& path) {
+        std::vector<uint32_t> values;
+        std::ifstream stream(path);
+        std::string range;
+        while (std::getline(stream, range, ',')) {
+            uint32_t first = 0, last = 0;
+            char separator = 0;
+            std::istringstream rangeStream(range);
+            if (!(rangeStream >> first))
+                continue;
+            last = first;
+            if (rangeStream >> separator && separator == '-')
+                rangeStream >> last;
+            for (uint32_t i = first; i <= last; i++)
+                values.push_back(i);
+        }
+        return values;
+    }
+#endif
+}
+
+CpuTopology CpuTopology::query() {
+    CpuTopology topology;
+#ifdef __linux__
+    for (uint32_t id : readList("/sys/devices/system/cpu/online")) {
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(id) + "/topology/";
+        LogicalProcessor processor = { id, id, 0, 0 };
+        readValue(base + "core_id", processor.coreId);
+        readValue(base + "physical_package_id", processor.packageId);
+        topology.m_Processors.push_back(processor);
+    }
+    // Cpusets of containers and taskset limit the process to some of the online processors,
+    // workers placed on the others would never be scheduled there.
+    if (!topology.m_Processors.empty()) {
+        uint32_t count = std::max_element(topology.m_Processors.begin(), topology.m_Processors.end(), 
+            [](const LogicalProcessor& a, const LogicalProcessor& b) { return a.id < b.id; })->id + 1;
+        cpu_set_t* pAllowed = CPU_ALLOC(count);
+        size_t size = CPU_ALLOC_SIZE(count);
+        if (pAllowed) {
+            CPU_ZERO_S(size, pAllowed);
+            if (sched_getaffinity(0, size, pAllowed) == 0) {
+                topology.m_Processors.erase(std::remove_if(topology.m_Processors.begin(), topology.m_Processors.end(), 
+                    [pAllowed, size](const LogicalProcessor& processor) { return !CPU_ISSET_S(processor.id, size, pAllowed); }), 
+                    topology.m_Processors.end());
+            }
+            CPU_FREE(pAllowed);
+        }
+    }
+    // NUMA nodes list their processors, which is cheaper than probing each cpu for a nodeN link.
+    for (uint32_t node : readList("/sys/devices/system/node/online")) {
+        for (uint32_t id : readList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist")) {
+            for (LogicalProcessor& processor : topology.m_Processors)
+                if (processor.id == id)
+                    processor.numaNode = node;
+        }
+    }
+#elif defined(_WIN32)
+    // Unlike GetLogicalProcessorInformation, the Ex variant reports every processor group and
+    // not only the one of the calling thread, which matters past 64 logical processors.
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+    std::vector<uint8_t> buffer(length);
+    if (!buffer.empty() && GetLogicalProcessorInformationEx(RelationAll, 
+        reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data()), &length)) {
+        std::vector<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*> infos;
+        for (DWORD offset = 0; offset < length; ) {
+            infos.push_back(reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset));
+            offset += infos.back()->Size;
+        }
+
+        uint32_t coreId = 0;
+        for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* pInfo : infos) {
+            if (pInfo->Relationship != RelationProcessorCore)
+                continue;
+            // A core never spans groups.
+            const GROUP_AFFINITY& affinity = pInfo->Processor.GroupMask[0];
+            for (uint32_t bit = 0; bit < kGroupSize; bit++)
+                if (affinity.Mask & (KAFFINITY(1) << bit))
+                    topology.m_Processors.push_back({ affinity.Group * kGroupSize + bit, coreId, 0, 0 });
+            coreId++;
+        }
+        uint32_t packageId = 0;
+        for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* pInfo : infos) {
+            for (LogicalProcessor& processor : topology.m_Processors) {
+                if (pInfo->Relationship == RelationNumaNode && contains(pInfo->NumaNode.GroupMask, processor.id))
+                    processor.numaNode = pInfo->NumaNode.NodeNumber;
+                if (pInfo->Relationship != RelationProcessorPackage)
+                    continue;
+                for (WORD group = 0; group < pInfo->Processor.GroupCount; group++)
+                    if (contains(pInfo->Processor.GroupMask[group], processor.id))
+                        processor.packageId = packageId;
+            }
+            if (pInfo->Relationship == RelationProcessorPackage)
+                packageId++;
+        }
+    }
+#endif
+
+    if (topology.m_Processors.empty()) {
+        uint32_t count = std::max(1u, std::thread::hardware_concurrency());
+        for (uint32_t id = 0; id < count; id++)
+            topology.m_Processors.push_back({ id, id, 0, 0 });
+    }
+
+    // Keep processors of the same node, package and core next to each other so that
+    // consecutive workers share as much of the cache hierarchy as possible.
+    std::sort(topology.m_Processors.begin(), topology.m_Processors.end(), [](const LogicalProcessor& a, const LogicalProcessor& b) {
+        return std::tie(a.numaNode, a.packageId, a.coreId, a.id) < std::tie(b.numaNode, b.packageId, b.coreId, b.id);
+    });
+    return topology;
+}
+
+std::vector<uint32_t> CpuTopology::selectWorkers(const WorkerPolicy& policy) const {
+    uint32_t mainProcessor = getCurrentProcessor();
+    const LogicalProcessor* pMain = nullptr;
+    for (const LogicalProcessor& processor : m_Processors)
+        if (processor.id == mainProcessor)
+            pMain = &processor;
+
+    std::vector<const LogicalProcessor*> candidates;
+    std::set<std::tuple<uint32_t, uint32_t, uint32_t>> usedCores;
+    for (const LogicalProcessor& processor : m_Processors) {
+        if (policy.numaLocal && pMain && processor.numaNode != pMain->numaNode)
+            continue;
+        if (policy.physicalCoresOnly && !usedCores.insert({ processor.numaNode, processor.packageId, processor.coreId }).second)
+            continue;
+        candidates.push_back(&processor);
+    }
+
+    // Drop the core of the main thread, as long as that leaves at least one worker.
+    if (policy.reserveMainThread && pMain && candidates.size() > 1) {
+        auto it = std::find_if(candidates.begin(), candidates.end(), [pMain](const LogicalProcessor* pProcessor) {
+            return pProcessor->packageId == pMain->packageId && pProcessor->coreId == pMain->coreId;
+        });
+        if (it != candidates.end())
+            candidates.erase(it);
+        else
+            candidates.pop_back();
+    }
+
+    std::vector<uint32_t> workers;
+    for (const LogicalProcessor* pProcessor : candidates)
+        workers.push_back(pProcessor->id);
+    if (workers.empty())
+        workers.push_back(m_Processors.front().id);
+    return workers;
+}
+
+std::string CpuTopology::describe(const std::vector<uint32_t>& workers) const {
+    std::ostringstream stream;
+    stream << m_Processors.size() << " logical processors, " << getCoreCount() << " cores, "
+        << getNumaNodeCount() << " NUMA nodes; " << workers.size() << " workers on [";
+    for (size_t i = 0; i < workers.size(); i++)
+        stream << (i ? "," : "") << workers[i];
+    stream << "]";
+    return stream.str();
+}
+
+const std::vector<LogicalProcessor>& CpuTopology::getProcessors() const {
+    return m_Processors;
+}
+
+uint32_t CpuTopology::getCoreCount() const {
+    std::set<std::tuple<uint32_t, uint32_t, uint32_t>> cores;
+    for (const LogicalProcessor& processor : m_Processors)
+        cores.insert({ processor.numaNode, processor.packageId, processor.coreId });
+    return static_cast<uint32_t>(cores.size());
+}
+
+uint32_t CpuTopology::getNumaNodeCount() const {
+    std::set<uint32_t> nodes;
+    for (const LogicalProcessor& processor : m_Processors)
+        nodes.insert(processor.numaNode);
+    return static_cast<uint32_t>(nodes.size());
+}
+
+uint32_t CpuTopology::getCurrentProcessor() {
+#ifdef _WIN32
+    PROCESSOR_NUMBER number;
+    GetCurrentProcessorNumberEx(&number);
+    return number.Group * kGroupSize + number.Number;
+#elif defined(__linux__)
+    int processor = sched_getcpu();
+    return processor < 0 ? 0 : static_cast<uint32_t>(processor);
+#else
+    return 0;
+#endif
+}
+
+bool CpuTopology::pinCurrentThread(uint32_t processor) {
+#ifdef _WIN32
+    GROUP_AFFINITY affinity = {};
+    affinity.Group = static_cast<WORD>(processor / kGroupSize);
+    affinity.Mask = KAFFINITY(1) << (processor % kGroupSize);
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(processor, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,79 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Controls how threadpool workers are laid out across the processors of the machine.
+struct WorkerPolicy {
+    /// Only place a single worker on each physical core, ignoring SMT siblings.
+    bool physicalCoresOnly = true;
+    /// Leave the core the calling thread is running on free for the main/SDL thread.
+    bool reserveMainThread = true;
+    /// Pin every worker to the logical processor it was assigned.
+    bool pinThreads = false;
+    /// Only use processors on the NUMA node the calling thread is running on.
+    bool numaLocal = false;
+};
+
+/// A single logical processor as reported by the operating system.
+struct LogicalProcessor {
+    uint32_t id;
+    uint32_t coreId;
+    uint32_t packageId;
+    uint32_t numaNode;
+};
+
+/// Describes the processors available to the process. On Linux this is read from 
+/// /sys/devices/system/cpu and limited to the affinity mask of the process, on Windows it
+/// comes from GetLogicalProcessorInformationEx and covers every processor group, numbering
+/// processor n of group g as g * 64 + n (g * 32 + n in 32-bit builds). On other platforms, or if the query fails, every
+/// logical processor is treated as its own core.
+class CpuTopology {
+public:
+    /// Queries the topology of the machine the process is running on.
+    static CpuTopology query();
+
+    /// Selects the logical processors workers should be placed on for the given policy,
+    /// one entry per worker. Always returns at least one processor.
+    std::vector<uint32_t> selectWorkers(const WorkerPolicy& policy) const;
+
+    /// Returns a human readable summary of the topology and of the selected workers.
+    std::string describe(const std::vector<uint32_t>& workers) const;
+
+    const std::vector<LogicalProcessor>& getProcessors() const;
+    uint32_t getCoreCount() const;
+    uint32_t getNumaNodeCount() const;
+
+    /// Returns the logical processor the calling thread is currently running on.
+    static uint32_t getCurrentProcessor();
+
+    /// Pins the calling thread to a single logical processor. Returns false on failure.
+    static bool pinCurrentThread(uint32_t processor);
+private:
+    std::vector<LogicalProcessor> m_Processors;
+};
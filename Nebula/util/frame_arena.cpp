@@ -0,0 +1,123 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "frame_arena.hpp"
+
+#include <algorithm>
+
+#include "thread_pool.hpp"
+
+FrameArena::FrameArena(size_t blockSize) : m_Offset(0), m_Used(0), m_HighWaterMark(0), m_BlockSize(blockSize) {
+    m_Blocks.push_back({ std::make_unique<std::byte[]>(blockSize), blockSize });
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    Block* pBlock = &m_Blocks.back();
+    uintptr_t base = reinterpret_cast<uintptr_t>(pBlock->pData.get());
+    uintptr_t aligned = (base + m_Offset + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    if (aligned + size > base + pBlock->size) {
+        size_t blockSize = std::max(m_BlockSize, size + alignment);
+        m_Blocks.push_back({ std::make_unique<std::byte[]>(blockSize), blockSize });
+        pBlock = &m_Blocks.back();
+        base = reinterpret_cast<uintptr_t>(pBlock->pData.get());
+        aligned = (base + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        // Once the blocks are merged this allocation no longer starts a block, so it is counted
+        // with the padding it may need there.
+        m_Used += alignment - 1;
+        m_Offset = 0;
+    }
+
+    size_t end = static_cast<size_t>(aligned - base) + size;
+    m_Used += end - std::min(m_Offset, end);
+    m_Offset = end;
+    m_HighWaterMark = std::max(m_HighWaterMark, m_Used);
+    return reinterpret_cast<void*>(aligned);
+}
+
+void FrameArena::reset() {
+    // Replace overflow blocks with a single block large enough for the busiest frame seen.
+    if (m_Blocks.size() > 1) {
+        size_t capacity = std::max(m_HighWaterMark, m_BlockSize);
+        m_Blocks.clear();
+        m_Blocks.push_back({ std::make_unique<std::byte[]>(capacity), capacity });
+    }
+    m_Offset = 0;
+    m_Used = 0;
+}
+
+size_t FrameArena::getUsed() const {
+    return m_Used;
+}
+
+size_t FrameArena::getCapacity() const {
+    size_t capacity = 0;
+    for (const Block& block : m_Blocks)
+        capacity += block.size;
+    return capacity;
+}
+
+size_t FrameArena::getHighWaterMark() const {
+    return m_HighWaterMark;
+}
+
+FrameArenas::FrameArenas(ThreadPool* pPool, uint32_t framesInFlight) : m_pPool(pPool), 
+    m_ThreadSlots(pPool->getThreadCount() + 1), m_FramesInFlight(0), m_FrameIndex(0) {
+    setFramesInFlight(framesInFlight);
+}
+
+void FrameArenas::beginFrame() {
+    m_FrameIndex = (m_FrameIndex + 1) % m_FramesInFlight;
+    for (uint32_t i = 0; i < m_ThreadSlots; i++)
+        m_Arenas[m_FrameIndex * m_ThreadSlots + i]->reset();
+}
+
+void FrameArenas::setFramesInFlight(uint32_t framesInFlight) {
+    m_FramesInFlight = std::max(framesInFlight, 1u);
+    m_FrameIndex = 0;
+    m_Arenas.resize(m_FramesInFlight * m_ThreadSlots);
+    for (auto& pArena : m_Arenas) {
+        if (pArena)
+            pArena->reset();
+        else
+            pArena = std::make_unique<FrameArena>();
+    }
+}
+
+FrameArena& FrameArenas::getArena() {
+    return *m_Arenas[m_FrameIndex * m_ThreadSlots + m_pPool->getWorkerIndex()];
+}
+
+size_t FrameArenas::getHighWaterMark() const {
+    size_t highWaterMark = 0;
+    for (const auto& pArena : m_Arenas)
+        highWaterMark = std::max(highWaterMark, pArena->getHighWaterMark());
+    return highWaterMark;
+}
+
+size_t FrameArenas::getCapacity() const {
+    size_t capacity = 0;
+    for (const auto& pArena : m_Arenas)
+        capacity += pArena->getCapacity();
+    return capacity;
+}
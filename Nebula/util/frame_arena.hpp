@@ -0,0 +1,131 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+/// Linear allocator for transient data. Allocations bump a pointer through a block of memory
+/// and are never freed individually, instead the whole arena is reset at once. If a frame
+/// needs more than the arena holds, another block is added and the blocks are merged into a 
+/// single block on the next reset, so an arena stops allocating once it has seen its peak.
+class FrameArena {
+public:
+    explicit FrameArena(size_t blockSize = 64 * 1024);
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    /// Returns size bytes aligned to alignment which remain valid until the next reset.
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    /// Releases every allocation made from the arena.
+    void reset();
+
+    /// Returns the number of bytes handed out since the last reset, including alignment padding.
+    size_t getUsed() const;
+
+    /// Returns the total size of the blocks owned by the arena.
+    size_t getCapacity() const;
+
+    /// Returns the largest number of bytes that were in use at once.
+    size_t getHighWaterMark() const;
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> pData;
+        size_t size;
+    };
+
+    std::vector<Block> m_Blocks;
+    size_t m_Offset;
+    size_t m_Used;
+    size_t m_HighWaterMark;
+    size_t m_BlockSize;
+};
+
+/// STL allocator which places container storage in a FrameArena. Deallocation is a no-op,
+/// so containers using it must not outlive the frame their arena belongs to.
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(FrameArena& arena) noexcept : m_pArena(&arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_pArena(other.getArena()) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(m_pArena->allocate(count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) noexcept {}
+
+    FrameArena* getArena() const noexcept {
+        return m_pArena;
+    }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return m_pArena == other.getArena(); }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return m_pArena != other.getArena(); }
+private:
+    FrameArena* m_pArena;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+/// One FrameArena per threadpool worker and per frame in flight, plus one for the main
+/// thread. Memory handed out during a frame stays valid until that frame's slot comes 
+/// around again, which is after the GPU has finished with it.
+class FrameArenas {
+public:
+    FrameArenas(ThreadPool* pPool, uint32_t framesInFlight);
+
+    /// Advances to the next frame slot and resets the arenas belonging to it. Must be called
+    /// from the main thread while no other thread is allocating.
+    void beginFrame();
+
+    /// Changes the number of buffered frames, resetting every arena.
+    void setFramesInFlight(uint32_t framesInFlight);
+
+    /// Returns the arena of the calling thread for the current frame. Threads outside of the
+    /// pool share a single arena, so only the main thread may call this outside the pool.
+    FrameArena& getArena();
+
+    /// Returns the largest high-water mark of any arena.
+    size_t getHighWaterMark() const;
+
+    /// Returns the combined capacity of every arena.
+    size_t getCapacity() const;
+private:
+    ThreadPool* m_pPool;
+    uint32_t m_ThreadSlots;
+    uint32_t m_FramesInFlight;
+    uint32_t m_FrameIndex;
+    std::vector<std::unique_ptr<FrameArena>> m_Arenas;
+};
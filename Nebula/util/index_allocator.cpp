@@ -0,0 +1,69 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "index_allocator.hpp"
+
+#include <algorithm>
+#include <functional>
+
+IndexAllocator::IndexAllocator(uint32_t capacity) : m_Capacity(capacity), m_HighWaterMark(0), m_AllocatedCount(0) {}
+
+std::optional<uint32_t> IndexAllocator::allocate() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    uint32_t index;
+    if (!m_Free.empty()) {
+        std::pop_heap(m_Free.begin(), m_Free.end(), std::greater<uint32_t>());
+        index = m_Free.back();
+        m_Free.pop_back();
+    } else if (m_HighWaterMark < m_Capacity)
+        index = m_HighWaterMark++;
+    else
+        return std::nullopt;
+    m_AllocatedCount++;
+    return index;
+}
+
+void IndexAllocator::free(uint32_t index, uint64_t frameNumber) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Retired.emplace_back(frameNumber, index);
+}
+
+void IndexAllocator::collect(uint64_t completedFrameNumber) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    while (!m_Retired.empty() && m_Retired.front().first <= completedFrameNumber) {
+        m_Free.push_back(m_Retired.front().second);
+        std::push_heap(m_Free.begin(), m_Free.end(), std::greater<uint32_t>());
+        m_Retired.pop_front();
+        m_AllocatedCount--;
+    }
+}
+
+uint32_t IndexAllocator::getCapacity() const {
+    return m_Capacity;
+}
+
+uint32_t IndexAllocator::getAllocatedCount() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_AllocatedCount;
+}
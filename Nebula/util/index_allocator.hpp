@@ -0,0 +1,66 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/// Hands out stable indices in [0, capacity) from a free list, for tables which are indexed
+/// from the GPU. A freed index is only handed out again once the frame which freed it has
+/// completed, so work already submitted never sees a slot change underneath it. Safe to use
+/// from multiple threads.
+class IndexAllocator {
+public:
+    explicit IndexAllocator(uint32_t capacity);
+
+    /// Returns the lowest recycled index, or a fresh one when nothing has been recycled. 
+    /// Returns nothing once every index is in use.
+    std::optional<uint32_t> allocate();
+
+    /// Releases an index which may still be referenced by frames up to frameNumber.
+    void free(uint32_t index, uint64_t frameNumber);
+
+    /// Recycles every index released by frames up to completedFrameNumber.
+    void collect(uint64_t completedFrameNumber);
+
+    uint32_t getCapacity() const;
+
+    /// Returns the number of indices which are allocated or waiting to be recycled.
+    uint32_t getAllocatedCount() const;
+private:
+    mutable std::mutex m_Mutex;
+    uint32_t m_Capacity;
+    /// Indices below this have been handed out at least once.
+    uint32_t m_HighWaterMark;
+    uint32_t m_AllocatedCount;
+    /// Min-heap, so that tables stay densely packed towards the start.
+    std::vector<uint32_t> m_Free;
+    /// Released indices along with the frame releasing them, in frame order.
+    std::deque<std::pair<uint64_t, uint32_t>> m_Retired;
+};
@@ -0,0 +1,264 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+/// Data-parallel helpers built on top of ThreadPool. Work is handed out with guided 
+/// scheduling: every participating thread repeatedly claims a chunk of the remaining range, 
+/// where the chunk size shrinks as the range is consumed. Large chunks early on keep the 
+/// scheduling overhead low, while small chunks at the end keep the threads balanced. The 
+/// calling thread participates in the work and every helper returns once the range is done.
+namespace Parallel {
+    /// Smallest number of elements a thread will claim at once unless a grain is given.
+    constexpr size_t kDefaultGrain = 256;
+
+    namespace Detail {
+        /// Shared cursor over [0, count) from which threads claim chunks.
+        class ChunkCursor {
+        public:
+            ChunkCursor(size_t count, size_t grain, size_t threads) : m_Next(0), m_Count(count), 
+                m_Grain(std::max<size_t>(grain, 1)), m_Divisor(threads * 2) {}
+
+            /// Claims the next chunk, returning false once the range has been consumed.
+            bool claim(size_t& begin, size_t& end) {
+                size_t next = m_Next.load(std::memory_order_relaxed);
+                while (next < m_Count) {
+                    size_t size = std::max((m_Count - next) / m_Divisor, m_Grain);
+                    size_t last = std::min(next + size, m_Count);
+                    if (m_Next.compare_exchange_weak(next, last, std::memory_order_relaxed)) {
+                        begin = next;
+                        end = last;
+                        return true;
+                    }
+                }
+                return false;
+            }
+        private:
+            std::atomic<size_t> m_Next;
+            size_t m_Count;
+            size_t m_Grain;
+            size_t m_Divisor;
+        };
+
+        /// Splits the merge of the sorted ranges a and b at output position diagonal, returning
+        /// how many elements of a come before it. Ties are taken from a first, as std::merge does.
+        template<typename It, typename Compare>
+        size_t findMergeSplit(It a, size_t aCount, It b, size_t bCount, size_t diagonal, Compare& compare) {
+            size_t low = diagonal > bCount ? diagonal - bCount : 0;
+            size_t high = std::min(diagonal, aCount);
+            while (low < high) {
+                size_t middle = (low + high) / 2;
+                if (!compare(b[diagonal - middle - 1], a[middle]))
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+            return low;
+        }
+
+        /// Number of threads worth splitting count elements across.
+        inline size_t getParticipants(ThreadPool* pPool, size_t count, size_t grain) {
+            size_t participants = static_cast<size_t>(pPool->getThreadCount()) + 1;
+            return std::max<size_t>(1, std::min(participants, (count + grain - 1) / std::max<size_t>(grain, 1)));
+        }
+    }
+
+    /// Invokes function(begin, end) over disjoint sub-ranges which together cover [0, count).
+    template<typename Function>
+    void forRange(ThreadPool* pPool, size_t count, Function&& function, size_t grain = kDefaultGrain) {
+        if (count == 0)
+            return;
+        size_t participants = Detail::getParticipants(pPool, count, grain);
+        if (participants == 1) {
+            function(size_t(0), count);
+            return;
+        }
+
+        Detail::ChunkCursor cursor(count, grain, participants);
+        auto worker = [&cursor, &function] {
+            size_t begin, end;
+            while (cursor.claim(begin, end))
+                function(begin, end);
+        };
+
+        WaitGroup group;
+        for (size_t i = 1; i < participants; i++)
+            pPool->enqueue(worker, group);
+        worker();
+        pPool->wait(group);
+    }
+
+    /// Invokes function(i) for every index in [0, count).
+    template<typename Function>
+    void forEach(ThreadPool* pPool, size_t count, Function&& function, size_t grain = kDefaultGrain) {
+        forRange(pPool, count, [&function](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                function(i);
+        }, grain);
+    }
+
+    namespace Detail {
+        /// One round of Parallel::sort, merging neighbouring blocks width blocks apart from source
+        /// into destination. Every pair is cut into pieces in proportion to its size, about two 
+        /// per participating thread across the round, and the pieces are merged in parallel.
+        template<typename SourceIt, typename DestinationIt, typename Compare>
+        void mergeRound(ThreadPool* pPool, SourceIt source, DestinationIt destination, const std::vector<size_t>& bounds,
+            size_t width, size_t blocks, Compare& compare) {
+            /// Output elements [begin, end) of the merge of [first, middle) with [middle, last).
+            struct Piece {
+                size_t first;
+                size_t middle;
+                size_t last;
+                size_t begin;
+                size_t end;
+            };
+
+            const size_t count = bounds[blocks];
+            const size_t targetPieces = (static_cast<size_t>(pPool->getThreadCount()) + 1) * 2;
+            std::vector<Piece> pieces;
+            for (size_t low = 0; low < blocks; low += 2 * width) {
+                size_t first = bounds[low];
+                size_t middle = bounds[std::min(low + width, blocks)];
+                size_t last = bounds[std::min(low + 2 * width, blocks)];
+                size_t size = last - first;
+                size_t pieceCount = std::max<size_t>(1, (size * targetPieces + count - 1) / count);
+                for (size_t i = 0; i < pieceCount; i++)
+                    pieces.push_back({ first, middle, last, size * i / pieceCount, size * (i + 1) / pieceCount });
+            }
+
+            forEach(pPool, pieces.size(), [&](size_t i) {
+                const Piece& piece = pieces[i];
+                SourceIt a = source + piece.first;
+                SourceIt b = source + piece.middle;
+                size_t aCount = piece.middle - piece.first;
+                size_t bCount = piece.last - piece.middle;
+                size_t aBegin = findMergeSplit(a, aCount, b, bCount, piece.begin, compare);
+                size_t aEnd = findMergeSplit(a, aCount, b, bCount, piece.end, compare);
+                std::merge(std::make_move_iterator(a + aBegin), std::make_move_iterator(a + aEnd),
+                    std::make_move_iterator(b + (piece.begin - aBegin)), std::make_move_iterator(b + (piece.end - aEnd)),
+                    destination + piece.first + piece.begin, compare);
+            }, 1);
+        }
+    }
+
+    /// Reduces [0, count) into a single value. map(begin, end, value) folds a sub-range into
+    /// the accumulator value and returns it, combine(a, b) merges two partial results. Chunks
+    /// are claimed in no particular order, so combine must be associative and commutative.
+    template<typename T, typename Map, typename Combine>
+    T reduce(ThreadPool* pPool, size_t count, T identity, Map&& map, Combine&& combine, size_t grain = kDefaultGrain) {
+        if (count == 0)
+            return identity;
+        size_t participants = Detail::getParticipants(pPool, count, grain);
+        if (participants == 1)
+            return map(size_t(0), count, identity);
+
+        // Each participant's partial result sits on a cache line of its own, so the threads
+        // storing them do not invalidate each other's lines.
+        struct alignas(64) Partial {
+            T value;
+        };
+        Detail::ChunkCursor cursor(count, grain, participants);
+        std::vector<Partial> partials(participants, Partial{ identity });
+        auto worker = [&cursor, &map, &partials](size_t slot) {
+            T value = partials[slot].value;
+            size_t begin, end;
+            while (cursor.claim(begin, end))
+                value = map(begin, end, value);
+            partials[slot].value = value;
+        };
+
+        WaitGroup group;
+        for (size_t i = 1; i < participants; i++)
+            pPool->enqueue([&worker, i] { worker(i); }, group);
+        worker(0);
+        pPool->wait(group);
+
+        T result = identity;
+        for (const Partial& partial : partials)
+            result = combine(result, partial.value);
+        return result;
+    }
+
+    /// Sorts [first, last) by sorting one block per thread in parallel and then merging 
+    /// neighbouring blocks in rounds until a single block remains. Every merge is split into
+    /// pieces along its merge path, so even the final merge of the whole range runs on every
+    /// thread. Merges go through a buffer of count elements, so the element type must be
+    /// default constructible and movable.
+    template<typename RandomIt, typename Compare = std::less<>>
+    void sort(ThreadPool* pPool, RandomIt first, RandomIt last, Compare compare = Compare(), size_t grain = 4096) {
+        using Value = typename std::iterator_traits<RandomIt>::value_type;
+        size_t count = static_cast<size_t>(std::distance(first, last));
+        size_t blocks = Detail::getParticipants(pPool, count, grain);
+        if (blocks == 1) {
+            std::sort(first, last, compare);
+            return;
+        }
+
+        std::vector<size_t> bounds(blocks + 1);
+        for (size_t i = 0; i <= blocks; i++)
+            bounds[i] = count * i / blocks;
+
+        forEach(pPool, blocks, [&](size_t i) {
+            std::sort(first + bounds[i], first + bounds[i + 1], compare);
+        }, 1);
+
+        // Rounds alternate between the range and the buffer.
+        std::vector<Value> buffer(count);
+        bool inBuffer = false;
+        for (size_t width = 1; width < blocks; width *= 2) {
+            if (inBuffer)
+                Detail::mergeRound(pPool, buffer.begin(), first, bounds, width, blocks, compare);
+            else
+                Detail::mergeRound(pPool, first, buffer.begin(), bounds, width, blocks, compare);
+            inBuffer = !inBuffer;
+        }
+        if (inBuffer) {
+            forRange(pPool, count, [&](size_t begin, size_t end) {
+                std::move(buffer.begin() + begin, buffer.begin() + end, first + begin);
+            });
+        }
+    }
+
+    /// Invokes function(entity) for every entity in an entt view. The view must provide random 
+    /// access through data() and size(), which holds for single component and persistent views.
+    /// The function may access the components of its own entity, but must not add or remove
+    /// components while the loop is running.
+    template<typename View, typename Function>
+    void forEachEntity(ThreadPool* pPool, const View& view, Function&& function, size_t grain = kDefaultGrain) {
+        auto pEntities = view.data();
+        forRange(pPool, view.size(), [pEntities, &function](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                function(pEntities[i]);
+        }, grain);
+    }
+}
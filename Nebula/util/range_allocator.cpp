@@ -0,0 +1,238 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "range_allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include "thirdparty/loguru/loguru.hpp"
+
+namespace {
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+RangeAllocator::RangeAllocator(uint64_t size) : m_Size(size), m_Used(0), m_Wasted(0), m_FreeRegionCount(0), 
+    m_FirstLevelBitmap(0) {
+    m_SecondLevelBitmaps.fill(0);
+    for (auto& lists : m_FreeLists)
+        lists.fill(nullptr);
+
+    m_pFirst = new Region{ 0, size, 0, true, nullptr, nullptr, nullptr, nullptr };
+    insertFree(m_pFirst);
+}
+
+RangeAllocator::~RangeAllocator() {
+    Region* pRegion = m_pFirst;
+    while (pRegion) {
+        Region* pNext = pRegion->pNext;
+        delete pRegion;
+        pRegion = pNext;
+    }
+}
+
+std::optional<uint64_t> RangeAllocator::allocate(uint64_t size, uint64_t alignment) {
+    size = std::max<uint64_t>(size, 1);
+    alignment = std::max<uint64_t>(alignment, 1);
+    if (size > m_Size || alignment > m_Size)
+        return std::nullopt;
+
+    Region* pRegion = findFree(size + alignment - 1);
+    if (!pRegion) {
+        // Every region in the list holding this size class may still be large enough, it
+        // is just not guaranteed to be. Check them before giving up.
+        uint32_t firstLevel, secondLevel;
+        getIndices(size, firstLevel, secondLevel);
+        for (Region* pCandidate = m_FreeLists[firstLevel][secondLevel]; pCandidate; pCandidate = pCandidate->pNextFree) {
+            if (alignUp(pCandidate->offset, alignment) + size <= pCandidate->offset + pCandidate->size) {
+                pRegion = pCandidate;
+                break;
+            }
+        }
+        if (!pRegion)
+            return std::nullopt;
+    }
+    removeFree(pRegion);
+
+    // Return the padding in front of the aligned offset to the free lists.
+    uint64_t offset = alignUp(pRegion->offset, alignment);
+    if (offset != pRegion->offset) {
+        Region* pAligned = split(pRegion, offset - pRegion->offset);
+        insertFree(pRegion);
+        pRegion = pAligned;
+    }
+    if (pRegion->size - size >= kMinimumSplit)
+        insertFree(split(pRegion, size));
+
+    pRegion->free = false;
+    pRegion->requested = size;
+    m_Used += pRegion->size;
+    m_Wasted += pRegion->size - size;
+    m_Allocations[offset] = pRegion;
+    return offset;
+}
+
+void RangeAllocator::free(uint64_t offset) {
+    auto it = m_Allocations.find(offset);
+    if (it == m_Allocations.end()) {
+        LOG_F(ERROR, "Attempted to free unknown range offset %llu.", static_cast<unsigned long long>(offset));
+        return;
+    }
+    Region* pRegion = it->second;
+    m_Allocations.erase(it);
+    m_Used -= pRegion->size;
+    m_Wasted -= pRegion->size - pRegion->requested;
+    pRegion->free = true;
+
+    if (pRegion->pPrevious && pRegion->pPrevious->free) {
+        Region* pPrevious = pRegion->pPrevious;
+        removeFree(pPrevious);
+        merge(pPrevious, pRegion);
+        pRegion = pPrevious;
+    }
+    if (pRegion->pNext && pRegion->pNext->free) {
+        removeFree(pRegion->pNext);
+        merge(pRegion, pRegion->pNext);
+    }
+    insertFree(pRegion);
+}
+
+uint64_t RangeAllocator::getSize() const {
+    return m_Size;
+}
+
+uint64_t RangeAllocator::getUsed() const {
+    return m_Used;
+}
+
+uint64_t RangeAllocator::getWasted() const {
+    return m_Wasted;
+}
+
+uint64_t RangeAllocator::getLargestFreeRegion() const {
+    if (!m_FirstLevelBitmap)
+        return 0;
+    uint32_t firstLevel = 63 - std::countl_zero(m_FirstLevelBitmap);
+    uint32_t secondLevel = 31 - std::countl_zero(m_SecondLevelBitmaps[firstLevel]);
+    uint64_t largest = 0;
+    for (Region* pRegion = m_FreeLists[firstLevel][secondLevel]; pRegion; pRegion = pRegion->pNextFree)
+        largest = std::max(largest, pRegion->size);
+    return largest;
+}
+
+uint32_t RangeAllocator::getFreeRegionCount() const {
+    return m_FreeRegionCount;
+}
+
+uint32_t RangeAllocator::getAllocationCount() const {
+    return static_cast<uint32_t>(m_Allocations.size());
+}
+
+void RangeAllocator::getIndices(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) {
+    // Sizes below the second level count get a list each, above that every power of two
+    // is split into kSecondLevelCount linearly spaced lists.
+    if (size < kSecondLevelCount) {
+        firstLevel = 0;
+        secondLevel = static_cast<uint32_t>(size);
+        return;
+    }
+    uint32_t highestBit = static_cast<uint32_t>(std::bit_width(size)) - 1;
+    firstLevel = highestBit - kSecondLevelBits + 1;
+    secondLevel = static_cast<uint32_t>(size >> (highestBit - kSecondLevelBits)) - kSecondLevelCount;
+}
+
+RangeAllocator::Region* RangeAllocator::findFree(uint64_t size) {
+    // Round up to the next list boundary so that any region found is large enough.
+    if (size >= kSecondLevelCount) {
+        uint64_t round = (uint64_t(1) << (std::bit_width(size) - 1 - kSecondLevelBits)) - 1;
+        if (size > UINT64_MAX - round)
+            return nullptr;
+        size += round;
+    }
+
+    uint32_t firstLevel, secondLevel;
+    getIndices(size, firstLevel, secondLevel);
+    uint32_t secondLevelMap = m_SecondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (!secondLevelMap) {
+        uint64_t firstLevelMap = firstLevel + 1 < 64 ? m_FirstLevelBitmap & (~uint64_t(0) << (firstLevel + 1)) : 0;
+        if (!firstLevelMap)
+            return nullptr;
+        firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+        secondLevelMap = m_SecondLevelBitmaps[firstLevel];
+    }
+    secondLevel = static_cast<uint32_t>(std::countr_zero(secondLevelMap));
+    return m_FreeLists[firstLevel][secondLevel];
+}
+
+void RangeAllocator::insertFree(Region* pRegion) {
+    uint32_t firstLevel, secondLevel;
+    getIndices(pRegion->size, firstLevel, secondLevel);
+    Region*& pHead = m_FreeLists[firstLevel][secondLevel];
+    pRegion->free = true;
+    pRegion->pPreviousFree = nullptr;
+    pRegion->pNextFree = pHead;
+    if (pHead)
+        pHead->pPreviousFree = pRegion;
+    pHead = pRegion;
+    m_FirstLevelBitmap |= uint64_t(1) << firstLevel;
+    m_SecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+    m_FreeRegionCount++;
+}
+
+void RangeAllocator::removeFree(Region* pRegion) {
+    uint32_t firstLevel, secondLevel;
+    getIndices(pRegion->size, firstLevel, secondLevel);
+    if (pRegion->pPreviousFree)
+        pRegion->pPreviousFree->pNextFree = pRegion->pNextFree;
+    else
+        m_FreeLists[firstLevel][secondLevel] = pRegion->pNextFree;
+    if (pRegion->pNextFree)
+        pRegion->pNextFree->pPreviousFree = pRegion->pPreviousFree;
+
+    if (!m_FreeLists[firstLevel][secondLevel]) {
+        m_SecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (!m_SecondLevelBitmaps[firstLevel])
+            m_FirstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+    }
+    m_FreeRegionCount--;
+}
+
+RangeAllocator::Region* RangeAllocator::split(Region* pRegion, uint64_t size) {
+    Region* pRemainder = new Region{ pRegion->offset + size, pRegion->size - size, 0, true, pRegion, pRegion->pNext, nullptr, nullptr };
+    if (pRegion->pNext)
+        pRegion->pNext->pPrevious = pRemainder;
+    pRegion->pNext = pRemainder;
+    pRegion->size = size;
+    return pRemainder;
+}
+
+void RangeAllocator::merge(Region* pFirst, Region* pSecond) {
+    pFirst->size += pSecond->size;
+    pFirst->pNext = pSecond->pNext;
+    if (pSecond->pNext)
+        pSecond->pNext->pPrevious = pFirst;
+    delete pSecond;
+}
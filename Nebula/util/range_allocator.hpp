@@ -0,0 +1,103 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+/// Two-level segregated fit (TLSF) allocator over an abstract range of offsets. It owns no
+/// memory itself and is used to place sub-allocations inside larger blocks, such as GPU 
+/// memory. Free regions are kept in size-segregated lists indexed by a pair of bitmaps, so
+/// both allocation and freeing run in constant time, and neighbouring free regions are 
+/// merged as soon as they are released.
+class RangeAllocator {
+public:
+    explicit RangeAllocator(uint64_t size);
+    ~RangeAllocator();
+    RangeAllocator(const RangeAllocator&) = delete;
+    RangeAllocator& operator=(const RangeAllocator&) = delete;
+
+    /// Returns the offset of size bytes aligned to alignment, or nothing if no free region
+    /// is large enough. alignment must be a power of two.
+    std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment = 1);
+
+    /// Releases the allocation starting at offset.
+    void free(uint64_t offset);
+
+    /// Returns the size of the range being managed.
+    uint64_t getSize() const;
+
+    /// Returns the number of bytes covered by live allocations, including any bytes lost to
+    /// allocations being rounded up.
+    uint64_t getUsed() const;
+
+    /// Returns the number of bytes which live allocations asked for but did not use.
+    uint64_t getWasted() const;
+
+    /// Returns the size of the largest free region.
+    uint64_t getLargestFreeRegion() const;
+
+    /// Returns the number of separate free regions.
+    uint32_t getFreeRegionCount() const;
+
+    /// Returns the number of live allocations.
+    uint32_t getAllocationCount() const;
+private:
+    static constexpr uint32_t kSecondLevelBits = 4;
+    static constexpr uint32_t kSecondLevelCount = 1 << kSecondLevelBits;
+    static constexpr uint32_t kFirstLevelCount = 64 - kSecondLevelBits + 1;
+    /// Leftovers smaller than this stay attached to an allocation instead of being split off.
+    static constexpr uint64_t kMinimumSplit = 16;
+
+    struct Region {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t requested;
+        bool free;
+        Region* pPrevious;
+        Region* pNext;
+        Region* pPreviousFree;
+        Region* pNextFree;
+    };
+
+    static void getIndices(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+    Region* findFree(uint64_t size);
+    void insertFree(Region* pRegion);
+    void removeFree(Region* pRegion);
+    Region* split(Region* pRegion, uint64_t size);
+    void merge(Region* pFirst, Region* pSecond);
+
+    uint64_t m_Size;
+    uint64_t m_Used;
+    uint64_t m_Wasted;
+    uint32_t m_FreeRegionCount;
+    uint64_t m_FirstLevelBitmap;
+    std::array<uint32_t, kFirstLevelCount> m_SecondLevelBitmaps;
+    std::array<std::array<Region*, kSecondLevelCount>, kFirstLevelCount> m_FreeLists;
+    Region* m_pFirst;
+    std::unordered_map<uint64_t, Region*> m_Allocations;
+};
@@ -0,0 +1,86 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "task.hpp"
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+namespace {
+    constexpr std::array<size_t, 4> kBlockSizes = { 128, 256, 512, 1024 };
+
+    /// Free list for one block size. Blocks are never returned to the heap.
+    struct BlockList {
+        std::mutex mutex;
+        std::vector<void*> blocks;
+    };
+
+    std::array<BlockList, kBlockSizes.size()> g_BlockLists;
+    std::atomic<uint64_t> g_HeapAllocationCount(0);
+
+    size_t getBlockClass(size_t size) {
+        for (size_t i = 0; i < kBlockSizes.size(); i++)
+            if (size <= kBlockSizes[i])
+                return i;
+        return kBlockSizes.size();
+    }
+}
+
+void* TaskStorage::allocate(size_t size) {
+    size_t blockClass = getBlockClass(size);
+    if (blockClass < kBlockSizes.size()) {
+        BlockList& list = g_BlockLists[blockClass];
+        std::lock_guard<std::mutex> lock(list.mutex);
+        if (!list.blocks.empty()) {
+            void* pBlock = list.blocks.back();
+            list.blocks.pop_back();
+            return pBlock;
+        }
+        size = kBlockSizes[blockClass];
+    }
+    g_HeapAllocationCount++;
+    return ::operator new(size);
+}
+
+void TaskStorage::deallocate(void* pBlock, size_t size) {
+    size_t blockClass = getBlockClass(size);
+    if (blockClass == kBlockSizes.size()) {
+        ::operator delete(pBlock);
+        return;
+    }
+    BlockList& list = g_BlockLists[blockClass];
+    std::lock_guard<std::mutex> lock(list.mutex);
+    if (list.blocks.size() == list.blocks.capacity())
+        g_HeapAllocationCount++;
+    list.blocks.push_back(pBlock);
+}
+
+uint64_t TaskStorage::getHeapAllocationCount() {
+    return g_HeapAllocationCount;
+}
+
+void TaskStorage::addHeapAllocation() {
+    g_HeapAllocationCount++;
+}
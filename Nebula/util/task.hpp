@@ -0,0 +1,157 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// Fixed size blocks used by Task for captures which do not fit into its inline storage.
+/// Blocks are recycled through free lists so that once a workload has warmed up, no further
+/// heap allocations are made.
+struct TaskStorage {
+public:
+    static void* allocate(size_t size);
+    static void deallocate(void* pBlock, size_t size);
+
+    /// Returns the number of times the global heap was touched to create task storage.
+    static uint64_t getHeapAllocationCount();
+
+    /// Counts a heap allocation made on behalf of the task system outside of TaskStorage.
+    static void addHeapAllocation();
+};
+
+/// Move-only callable with small-buffer storage, used in place of std::function for
+/// threadpool work. Callables up to kInlineSize bytes are stored inside of the task itself,
+/// anything larger is placed in a pooled block from TaskStorage.
+class Task {
+public:
+    static constexpr size_t kInlineSize = 64 - sizeof(void*);
+
+    Task() noexcept : m_pOperations(nullptr) {}
+
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+    Task(F&& function) {
+        using Function = std::decay_t<F>;
+        static_assert(alignof(Function) <= alignof(std::max_align_t), "Over-aligned callables are not supported.");
+        if constexpr (sizeof(Function) <= kInlineSize && std::is_nothrow_move_constructible_v<Function>) {
+            new (m_Storage) Function(std::forward<F>(function));
+            m_pOperations = &InlineOperations<Function>::table;
+        } else {
+            void* pBlock = TaskStorage::allocate(sizeof(Function));
+            new (pBlock) Function(std::forward<F>(function));
+            *reinterpret_cast<void**>(m_Storage) = pBlock;
+            m_pOperations = &PooledOperations<Function>::table;
+        }
+    }
+
+    Task(Task&& other) noexcept : m_pOperations(other.m_pOperations) {
+        if (m_pOperations)
+            m_pOperations->move(m_Storage, other.m_Storage);
+        other.m_pOperations = nullptr;
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            m_pOperations = other.m_pOperations;
+            if (m_pOperations)
+                m_pOperations->move(m_Storage, other.m_Storage);
+            other.m_pOperations = nullptr;
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        reset();
+    }
+
+    /// Invokes the stored callable. The task must not be empty.
+    void operator()() {
+        m_pOperations->invoke(m_Storage);
+    }
+
+    explicit operator bool() const noexcept {
+        return m_pOperations != nullptr;
+    }
+
+    /// Destroys the stored callable, leaving the task empty.
+    void reset() noexcept {
+        if (m_pOperations) {
+            m_pOperations->destroy(m_Storage);
+            m_pOperations = nullptr;
+        }
+    }
+private:
+    struct Operations {
+        void (*invoke)(void* pStorage);
+        void (*move)(void* pDestination, void* pSource);
+        void (*destroy)(void* pStorage);
+    };
+
+    template<typename Function>
+    struct InlineOperations {
+        static void invoke(void* pStorage) {
+            (*std::launder(reinterpret_cast<Function*>(pStorage)))();
+        }
+        static void move(void* pDestination, void* pSource) {
+            Function* pFunction = std::launder(reinterpret_cast<Function*>(pSource));
+            new (pDestination) Function(std::move(*pFunction));
+            pFunction->~Function();
+        }
+        static void destroy(void* pStorage) {
+            std::launder(reinterpret_cast<Function*>(pStorage))->~Function();
+        }
+        static constexpr Operations table = { &invoke, &move, &destroy };
+    };
+
+    template<typename Function>
+    struct PooledOperations {
+        static Function* get(void* pStorage) {
+            return static_cast<Function*>(*reinterpret_cast<void**>(pStorage));
+        }
+        static void invoke(void* pStorage) {
+            (*get(pStorage))();
+        }
+        static void move(void* pDestination, void* pSource) {
+            *reinterpret_cast<void**>(pDestination) = *reinterpret_cast<void**>(pSource);
+        }
+        static void destroy(void* pStorage) {
+            Function* pFunction = get(pStorage);
+            pFunction->~Function();
+            TaskStorage::deallocate(pFunction, sizeof(Function));
+        }
+        static constexpr Operations table = { &invoke, &move, &destroy };
+    };
+
+    alignas(std::max_align_t) unsigned char m_Storage[kInlineSize];
+    const Operations* m_pOperations;
+};
@@ -0,0 +1,184 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "task_graph.hpp"
+
+#include <algorithm>
+
+#include "thread_pool.hpp"
+#include "thirdparty/loguru/loguru.hpp"
+
+namespace {
+    /// Weight given to the newest sample in the rolling node averages.
+    constexpr double kAverageWeight = 0.1;
+
+    double toMilliseconds(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+TaskGraph::TaskGraph(ThreadPool* pPool) : m_pPool(pPool), m_CriticalPathMs(0.0), 
+    m_ExecutionMs(0.0), m_Compiled(false) {}
+
+TaskGraph::NodeId TaskGraph::addNode(std::string name, std::function<void()> function) {
+    auto pNode = std::make_unique<Node>();
+    pNode->name = std::move(name);
+    pNode->function = std::move(function);
+    m_Nodes.push_back(std::move(pNode));
+    m_Compiled = false;
+    return static_cast<NodeId>(m_Nodes.size() - 1);
+}
+
+void TaskGraph::addEdge(NodeId before, NodeId after) {
+    m_Nodes[before]->successors.push_back(after);
+    m_Nodes[after]->predecessorCount++;
+    m_Compiled = false;
+}
+
+bool TaskGraph::compile() {
+    // Kahn's algorithm, which gives us both the roots and a topological order used
+    // to walk the graph when computing the critical path.
+    m_Order.clear();
+    m_Roots.clear();
+    std::vector<uint32_t> remaining(m_Nodes.size());
+    for (NodeId i = 0; i < m_Nodes.size(); i++) {
+        remaining[i] = m_Nodes[i]->predecessorCount;
+        if (remaining[i] == 0) {
+            m_Roots.push_back(i);
+            m_Order.push_back(i);
+        }
+    }
+    for (size_t i = 0; i < m_Order.size(); i++) {
+        for (NodeId successor : m_Nodes[m_Order[i]]->successors)
+            if (--remaining[successor] == 0)
+                m_Order.push_back(successor);
+    }
+
+    if (m_Order.size() != m_Nodes.size()) {
+        LOG_F(ERROR, "Task graph contains a cycle and cannot be executed.");
+        return false;
+    }
+    m_Compiled = true;
+    return true;
+}
+
+void TaskGraph::execute() {
+    if (!m_Compiled)
+        return;
+
+    for (auto& pNode : m_Nodes)
+        pNode->remaining.store(pNode->predecessorCount, std::memory_order_relaxed);
+
+    m_Start = std::chrono::steady_clock::now();
+    for (NodeId root : m_Roots)
+        m_pPool->enqueue([this, root] { run(root); }, m_Group, TaskPriority::eCritical);
+    m_pPool->wait(m_Group);
+    m_ExecutionMs = toMilliseconds(std::chrono::steady_clock::now() - m_Start);
+    computeCriticalPath();
+}
+
+void TaskGraph::run(NodeId node) {
+    Node& current = *m_Nodes[node];
+    current.start = std::chrono::steady_clock::now();
+    current.function();
+    current.end = std::chrono::steady_clock::now();
+
+    // Successors are added to the group before this node completes, so the group 
+    // can never reach zero while there is still work left in the graph.
+    for (NodeId successor : current.successors) {
+        if (m_Nodes[successor]->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            m_pPool->enqueue([this, successor] { run(successor); }, m_Group, TaskPriority::eCritical);
+    }
+}
+
+void TaskGraph::computeCriticalPath() {
+    // Longest path through the DAG, weighted by the duration of each node.
+    std::vector<double> finish(m_Nodes.size(), 0.0);
+    std::vector<NodeId> previous(m_Nodes.size(), static_cast<NodeId>(-1));
+    for (NodeId node : m_Order) {
+        Node& current = *m_Nodes[node];
+        double duration = toMilliseconds(current.end - current.start);
+        current.timing.lastMs = duration;
+        current.timing.startMs = toMilliseconds(current.start - m_Start);
+        if (current.timing.averageMs == 0.0)
+            current.timing.averageMs = duration;
+        else
+            current.timing.averageMs += (duration - current.timing.averageMs) * kAverageWeight;
+        finish[node] += duration;
+        for (NodeId successor : current.successors) {
+            if (finish[node] > finish[successor]) {
+                finish[successor] = finish[node];
+                previous[successor] = node;
+            }
+        }
+    }
+
+    m_CriticalPath.clear();
+    m_CriticalPathMs = 0.0;
+    if (m_Nodes.empty())
+        return;
+
+    NodeId last = 0;
+    for (NodeId i = 1; i < m_Nodes.size(); i++)
+        if (finish[i] > finish[last])
+            last = i;
+    m_CriticalPathMs = finish[last];
+    for (NodeId node = last; node != static_cast<NodeId>(-1); node = previous[node])
+        m_CriticalPath.insert(m_CriticalPath.begin(), node);
+}
+
+const std::vector<TaskGraph::NodeId>& TaskGraph::getCriticalPath() const {
+    return m_CriticalPath;
+}
+
+double TaskGraph::getCriticalPathMs() const {
+    return m_CriticalPathMs;
+}
+
+double TaskGraph::getExecutionMs() const {
+    return m_ExecutionMs;
+}
+
+const std::string& TaskGraph::getNodeName(NodeId node) const {
+    return m_Nodes[node]->name;
+}
+
+const TaskGraph::NodeTiming& TaskGraph::getNodeTiming(NodeId node) const {
+    return m_Nodes[node]->timing;
+}
+
+uint32_t TaskGraph::getNodeCount() const {
+    return static_cast<uint32_t>(m_Nodes.size());
+}
+
+void TaskGraph::logTimings() const {
+    LOG_F(INFO, "Task graph: %.3fms wall, %.3fms critical path, %u workers", m_ExecutionMs, 
+        m_CriticalPathMs, m_pPool->getThreadCount());
+    for (NodeId i = 0; i < m_Nodes.size(); i++) {
+        bool critical = std::find(m_CriticalPath.begin(), m_CriticalPath.end(), i) != m_CriticalPath.end();
+        const NodeTiming& timing = m_Nodes[i]->timing;
+        LOG_F(INFO, "\t%c %s: %.3fms (avg %.3fms) at +%.3fms", critical ? '*' : ' ', m_Nodes[i]->name.c_str(),
+            timing.lastMs, timing.averageMs, timing.startMs);
+    }
+}
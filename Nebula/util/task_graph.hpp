@@ -0,0 +1,114 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "wait_group.hpp"
+
+class ThreadPool;
+
+/// Describes a frame as a set of nodes with explicit dependencies between them. The graph is
+/// built once and can then be executed any number of times on the threadpool, where each node 
+/// is enqueued as soon as every node it depends on has finished. Timings for each node are 
+/// captured on every execution and used to compute the critical path through the graph.
+class TaskGraph {
+public:
+    using NodeId = uint32_t;
+
+    /// Timing information gathered for a single node.
+    struct NodeTiming {
+        /// Duration of the node in the last execution, in milliseconds.
+        double lastMs;
+        /// Exponential moving average of the duration, in milliseconds.
+        double averageMs;
+        /// Offset from the start of the last execution at which the node started, in milliseconds.
+        double startMs;
+    };
+
+    explicit TaskGraph(ThreadPool* pPool);
+
+    /// Adds a node which will invoke function every time the graph is executed.
+    NodeId addNode(std::string name, std::function<void()> function);
+
+    /// Declares that the node after may only start once the node before has finished.
+    void addEdge(NodeId before, NodeId after);
+
+    /// Validates the graph and computes an execution order. Returns false if the edges
+    /// form a cycle. Must be called after the last node or edge was added and before execute.
+    bool compile();
+
+    /// Executes every node in the graph, blocking until all of them have finished. The
+    /// calling thread will run nodes while it waits.
+    void execute();
+
+    /// Returns the nodes along the longest dependency chain of the last execution, ordered
+    /// from the first node to the last.
+    const std::vector<NodeId>& getCriticalPath() const;
+
+    /// Returns the summed duration of the critical path of the last execution, in milliseconds.
+    double getCriticalPathMs() const;
+
+    /// Returns the wall time of the last execution, in milliseconds.
+    double getExecutionMs() const;
+
+    const std::string& getNodeName(NodeId node) const;
+    const NodeTiming& getNodeTiming(NodeId node) const;
+    uint32_t getNodeCount() const;
+
+    /// Writes the timing of every node to the log, marking the nodes on the critical path.
+    void logTimings() const;
+private:
+    struct Node {
+        std::string name;
+        std::function<void()> function;
+        std::vector<NodeId> successors;
+        uint32_t predecessorCount = 0;
+        std::atomic<uint32_t> remaining;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+        NodeTiming timing = {};
+    };
+
+    void run(NodeId node);
+    void computeCriticalPath();
+
+    ThreadPool* m_pPool;
+    std::vector<std::unique_ptr<Node>> m_Nodes;
+    std::vector<NodeId> m_Order;
+    std::vector<NodeId> m_Roots;
+    std::vector<NodeId> m_CriticalPath;
+    WaitGroup m_Group;
+    std::chrono::steady_clock::time_point m_Start;
+    double m_CriticalPathMs;
+    double m_ExecutionMs;
+    bool m_Compiled;
+};
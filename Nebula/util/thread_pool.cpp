@@ -24,41 +24,379 @@ SOFTWARE.
 
 #include "thread_pool.hpp"
 
-ThreadPool::ThreadPool(uint32_t threadCount) {
-    for (uint32_t i = 0; i < threadCount; i++)
-        m_Threads.emplace_back([this] {
-        while(true) {
-            std::function<void()> function;
-            std::unique_lock<std::mutex> lock(m_Mutex);
-            m_Condition.wait(lock, [this] { return m_Complete || !m_Queue.empty(); });
-            if (m_Complete && m_Queue.empty())
-                return;
-            function = std::move(m_Queue.front());
-            m_Queue.pop();
-            function();
-            m_Condition.notify_one();
+#include <algorithm>
+#include <chrono>
+
+#include "cpu_topology.hpp"
+#include "thirdparty/loguru/loguru.hpp"
+
+namespace {
+    /// Identifies the pool and queue owned by the current thread.
+    struct WorkerContext {
+        const ThreadPool* pPool = nullptr;
+        uint32_t index = 0;
+        uint32_t seed = 0x9E3779B9u;
+    };
+    thread_local WorkerContext t_Context;
+
+    /// Xorshift generator used to select victims, cheap enough to call on every steal.
+    uint32_t nextRandom() {
+        uint32_t x = t_Context.seed;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        t_Context.seed = x;
+        return x;
+    }
+
+    constexpr size_t kBackgroundLane = static_cast<size_t>(TaskPriority::eBackground);
+    /// Jobs every lane has room for from the start, a power of two.
+    constexpr size_t kInitialRingSize = 64;
+
+    uint64_t getTimestamp() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void addCounter(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+}
+
+void ThreadPool::JobRing::pushBack(Job job) {
+    if (count == jobs.size()) {
+        // Grow to the next power of two, unwrapping the ring into the new storage.
+        std::vector<Job> grown(jobs.empty() ? kInitialRingSize : jobs.size() * 2);
+        for (size_t i = 0; i < count; i++)
+            grown[i] = std::move(jobs[(head + i) & (jobs.size() - 1)]);
+        jobs = std::move(grown);
+        head = 0;
+        TaskStorage::addHeapAllocation();
+    }
+    jobs[(head + count) & (jobs.size() - 1)] = std::move(job);
+    count++;
+}
+
+ThreadPool::Job ThreadPool::JobRing::popBack() {
+    count--;
+    return std::move(jobs[(head + count) & (jobs.size() - 1)]);
+}
+
+ThreadPool::Job ThreadPool::JobRing::popFront() {
+    Job job = std::move(jobs[head]);
+    head = (head + 1) & (jobs.size() - 1);
+    count--;
+    return job;
+}
+
+ThreadPool::ThreadPool(uint32_t threadCount) : ThreadPool(std::vector<uint32_t>(std::max(threadCount, 1u)), false) {}
+
+ThreadPool::ThreadPool(const std::vector<uint32_t>& processors, bool pinThreads) : m_QueuedCount(0), 
+    m_OutstandingCount(0), m_RunningBackgroundCount(0), m_SleepingCount(0), m_Complete(false) {
+    uint32_t threadCount = std::max(static_cast<uint32_t>(processors.size()), 1u);
+    for (std::atomic<uint32_t>& queuedCount : m_QueuedCounts)
+        queuedCount = 0;
+    m_BackgroundLimit = threadCount > 1 ? threadCount - 1 : 1;
+    // Every lane starts out with room for a batch of jobs, so the first task a worker pushes 
+    // does not allocate in the middle of a frame.
+    for (uint32_t i = 0; i <= threadCount; i++) {
+        m_Queues.push_back(std::make_unique<WorkQueue>());
+        for (JobRing& ring : m_Queues.back()->lanes) {
+            ring.jobs.resize(kInitialRingSize);
+            TaskStorage::addHeapAllocation();
+        }
+    }
+    m_Counters = std::make_unique<WorkerCounters[]>(threadCount + 1);
+    m_LoggedStatistics.resize(threadCount + 1);
+    m_LoggedAt = getTimestamp();
+    for (uint32_t i = 0; i < threadCount; i++) {
+        uint32_t processor = i < processors.size() ? processors[i] : 0;
+        m_Threads.emplace_back([this, i, processor, pinThreads] { 
+            if (pinThreads)
+                CpuTopology::pinCurrentThread(processor);
+            workerLoop(i); 
+        });
+    }
+}
+
+void ThreadPool::workerLoop(uint32_t index) {
+    t_Context.pPool = this;
+    t_Context.index = index;
+    t_Context.seed = 0x9E3779B9u * (index + 1);
+    while (true) {
+        Job job;
+        size_t lane;
+        if (findJob(index, kBackgroundLane, job, lane)) {
+            execute(index, job, lane);
+            continue;
+        }
+
+        // Nothing to do, sleep until a task is queued. The sleeping counter is published before 
+        // the queued counter is checked so enqueue can never miss a worker going to sleep.
+        // Background work held back by the concurrency limit is picked up when a running
+        // background task finishes and wakes a worker.
+        uint64_t sleptAt = getTimestamp();
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        m_SleepingCount++;
+        m_SleepCondition.wait(lock, [this] { 
+            return m_Complete || m_QueuedCount > m_QueuedCounts[kBackgroundLane] || 
+                (m_QueuedCounts[kBackgroundLane] > 0 && m_RunningBackgroundCount < m_BackgroundLimit); 
+        });
+        m_SleepingCount--;
+        addCounter(m_Counters[index].idleTime, getTimestamp() - sleptAt);
+        if (m_Complete && m_QueuedCount == 0)
+            return;
+    }
+}
+
+uint32_t ThreadPool::getQueueIndex() const {
+    if (t_Context.pPool == this)
+        return t_Context.index;
+    return static_cast<uint32_t>(m_Threads.size());
+}
+
+bool ThreadPool::findJob(uint32_t index, size_t lowestLane, Job& job, size_t& lane) {
+    for (lane = 0; lane <= lowestLane; lane++) {
+        if (m_QueuedCounts[lane] == 0)
+            continue;
+        if (lane == kBackgroundLane) {
+            // Reserve a background slot before taking a job so the limit is never exceeded. Once
+            // the pool is shutting down nothing critical can arrive, so the remaining background
+            // jobs are drained by every worker instead of leaving the others spinning.
+            uint32_t running = m_RunningBackgroundCount;
+            do {
+                if (running >= m_BackgroundLimit && !m_Complete)
+                    return false;
+            } while (!m_RunningBackgroundCount.compare_exchange_weak(running, running + 1));
+            if (popJob(index, lane, job) || stealJob(index, lane, job))
+                return true;
+            m_RunningBackgroundCount--;
+            return false;
+        }
+        if (popJob(index, lane, job) || stealJob(index, lane, job))
+            return true;
+    }
+    return false;
+}
+
+std::unique_lock<std::mutex> ThreadPool::lockQueue(WorkQueue& queue, uint32_t index) {
+    std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        addCounter(m_Counters[index].lockContentions, 1);
+        lock.lock();
+    }
+    return lock;
+}
+
+bool ThreadPool::popJob(uint32_t index, size_t lane, Job& job) {
+    WorkQueue& queue = *m_Queues[index];
+    std::unique_lock<std::mutex> lock = lockQueue(queue, index);
+    if (queue.lanes[lane].count == 0)
+        return false;
+
+    uint64_t depth = 0;
+    for (const JobRing& ring : queue.lanes)
+        depth += ring.count;
+    WorkerCounters& counters = m_Counters[index];
+    addCounter(counters.queueDepthTotal, depth);
+    addCounter(counters.queueDepthSamples, 1);
+    if (depth > counters.queueDepthMax.load(std::memory_order_relaxed))
+        counters.queueDepthMax.store(depth, std::memory_order_relaxed);
+
+    job = queue.lanes[lane].popBack();
+    m_QueuedCounts[lane]--;
+    m_QueuedCount--;
+    return true;
+}
+
+bool ThreadPool::stealJob(uint32_t index, size_t lane, Job& job) {
+    const uint32_t queueCount = static_cast<uint32_t>(m_Queues.size());
+    const uint32_t start = nextRandom() % queueCount;
+    for (uint32_t i = 0; i < queueCount && m_QueuedCounts[lane] > 0; i++) {
+        uint32_t victim = (start + i) % queueCount;
+        if (victim == index)
+            continue;
+        WorkQueue& queue = *m_Queues[victim];
+        addCounter(m_Counters[index].stealAttempts, 1);
+        std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            addCounter(m_Counters[index].lockContentions, 1);
+            continue;
+        }
+        if (queue.lanes[lane].count == 0)
+            continue;
+        job = queue.lanes[lane].popFront();
+        m_QueuedCounts[lane]--;
+        m_QueuedCount--;
+        addCounter(m_Counters[index].stealSuccesses, 1);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::execute(uint32_t index, Job& job, size_t lane) {
+    uint64_t startedAt = getTimestamp();
+    job.task();
+    job.task.reset();
+    WorkerCounters& counters = m_Counters[index];
+    addCounter(counters.busyTime, getTimestamp() - startedAt);
+    addCounter(counters.queuedTime, startedAt - job.queuedAt);
+    addCounter(counters.tasksExecuted, 1);
+    if (job.pGroup)
+        job.pGroup->done();
+    m_OutstandingCount--;
+    if (lane == kBackgroundLane) {
+        m_RunningBackgroundCount--;
+        if (m_QueuedCounts[kBackgroundLane] > 0 && m_SleepingCount > 0) {
+            std::lock_guard<std::mutex> lock(m_SleepMutex);
+            m_SleepCondition.notify_one();
         }
-    });
+    }
+}
+
+void ThreadPool::push(Task* pTasks, size_t count, WaitGroup* pGroup, TaskPriority priority) {
+    const size_t lane = static_cast<size_t>(priority);
+    const uint32_t index = getQueueIndex();
+    const uint64_t queuedAt = getTimestamp();
+    m_OutstandingCount += static_cast<uint32_t>(count);
+    WorkQueue& queue = *m_Queues[index];
+    {
+        // The counters are raised while the jobs are still hidden behind the lock, otherwise a
+        // thief could take one and decrement them first, wrapping them around.
+        std::unique_lock<std::mutex> lock = lockQueue(queue, index);
+        m_QueuedCounts[lane] += static_cast<uint32_t>(count);
+        m_QueuedCount += static_cast<uint32_t>(count);
+        for (size_t i = 0; i < count; i++)
+            queue.lanes[lane].pushBack({ std::move(pTasks[i]), pGroup, queuedAt });
+    }
+    if (m_SleepingCount > 0) {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        if (count > 1)
+            m_SleepCondition.notify_all();
+        else
+            m_SleepCondition.notify_one();
+    }
+}
+
+void ThreadPool::enqueue(Task task, TaskPriority priority) {
+    push(&task, 1, nullptr, priority);
+}
+
+void ThreadPool::enqueue(Task task, WaitGroup& group, TaskPriority priority) {
+    group.add();
+    push(&task, 1, &group, priority);
 }
 
-void ThreadPool::enqueue(std::function<void()> function) {
-    std::unique_lock<std::mutex> lock(m_Mutex);
-    m_Queue.push(std::move(function));
-    m_Condition.notify_one();
+void ThreadPool::submit(Task* pTasks, size_t count, WaitGroup& group, TaskPriority priority) {
+    if (count == 0)
+        return;
+    group.add(static_cast<uint32_t>(count));
+    push(pTasks, count, &group, priority);
+}
+
+bool ThreadPool::runPendingTask(TaskPriority lowestPriority) {
+    uint32_t index = getQueueIndex();
+    Job job;
+    size_t lane;
+    if (findJob(index, static_cast<size_t>(lowestPriority), job, lane)) {
+        execute(index, job, lane);
+        return true;
+    }
+    return false;
 }
 
 void ThreadPool::wait() {
-    for (std::thread& thread : m_Threads) {
-        std::unique_lock<std::mutex> lock(m_Mutex);
-        m_Condition.wait(lock, [this] { return m_Queue.empty(); });
+    while (m_OutstandingCount > 0) {
+        if (!runPendingTask())
+            std::this_thread::yield();
+    }
+}
+
+void ThreadPool::wait(const WaitGroup& group) {
+    while (!group.isComplete()) {
+        if (!runPendingTask(TaskPriority::eNormal))
+            std::this_thread::yield();
+    }
+}
+
+bool ThreadPool::shouldYield() const {
+    return m_QueuedCounts[static_cast<size_t>(TaskPriority::eCritical)] > 0;
+}
+
+uint32_t ThreadPool::getThreadCount() const {
+    return static_cast<uint32_t>(m_Threads.size());
+}
+
+uint32_t ThreadPool::getWorkerIndex() const {
+    return getQueueIndex();
+}
+
+std::vector<WorkerStatistics> ThreadPool::getStatistics() const {
+    std::vector<WorkerStatistics> statistics(m_Queues.size());
+    for (size_t i = 0; i < statistics.size(); i++) {
+        const WorkerCounters& counters = m_Counters[i];
+        WorkerStatistics& worker = statistics[i];
+        worker.busyTime = counters.busyTime.load(std::memory_order_relaxed);
+        worker.idleTime = counters.idleTime.load(std::memory_order_relaxed);
+        worker.tasksExecuted = counters.tasksExecuted.load(std::memory_order_relaxed);
+        worker.queuedTime = counters.queuedTime.load(std::memory_order_relaxed);
+        worker.queueDepthTotal = counters.queueDepthTotal.load(std::memory_order_relaxed);
+        worker.queueDepthSamples = counters.queueDepthSamples.load(std::memory_order_relaxed);
+        worker.queueDepthMax = counters.queueDepthMax.load(std::memory_order_relaxed);
+        worker.lockContentions = counters.lockContentions.load(std::memory_order_relaxed);
+        worker.stealAttempts = counters.stealAttempts.load(std::memory_order_relaxed);
+        worker.stealSuccesses = counters.stealSuccesses.load(std::memory_order_relaxed);
     }
+    return statistics;
+}
+
+void ThreadPool::logStatistics() {
+    std::vector<WorkerStatistics> current = getStatistics();
+    uint64_t now = getTimestamp();
+    double elapsed = static_cast<double>(std::max<uint64_t>(now - m_LoggedAt, 1));
+
+    // Sum the deltas since the last log line across every worker.
+    WorkerStatistics total;
+    double busiest = 0.0;
+    for (size_t i = 0; i < current.size(); i++) {
+        const WorkerStatistics& latest = current[i];
+        const WorkerStatistics& then = m_LoggedStatistics[i];
+        total.busyTime += latest.busyTime - then.busyTime;
+        total.tasksExecuted += latest.tasksExecuted - then.tasksExecuted;
+        total.queuedTime += latest.queuedTime - then.queuedTime;
+        total.queueDepthTotal += latest.queueDepthTotal - then.queueDepthTotal;
+        total.queueDepthSamples += latest.queueDepthSamples - then.queueDepthSamples;
+        total.queueDepthMax = std::max(total.queueDepthMax, latest.queueDepthMax);
+        total.lockContentions += latest.lockContentions - then.lockContentions;
+        total.stealAttempts += latest.stealAttempts - then.stealAttempts;
+        total.stealSuccesses += latest.stealSuccesses - then.stealSuccesses;
+        if (i < m_Threads.size())
+            busiest = std::max(busiest, (latest.busyTime - then.busyTime) / elapsed);
+    }
+
+    double utilization = total.busyTime / (elapsed * std::max<size_t>(m_Threads.size(), 1));
+    double averageQueued = total.tasksExecuted ? total.queuedTime / 1000.0 / total.tasksExecuted : 0.0;
+    double averageDepth = total.queueDepthSamples ? static_cast<double>(total.queueDepthTotal) / total.queueDepthSamples : 0.0;
+    LOG_F(INFO, "Threadpool: %.1f%% utilization (busiest %.1f%%), %llu tasks, %.1fus avg queued, depth %.1f avg %llu max, "
+        "%llu/%llu steals, %llu lock contentions", utilization * 100.0, busiest * 100.0, 
+        static_cast<unsigned long long>(total.tasksExecuted), averageQueued, averageDepth, 
+        static_cast<unsigned long long>(total.queueDepthMax), static_cast<unsigned long long>(total.stealSuccesses),
+        static_cast<unsigned long long>(total.stealAttempts), static_cast<unsigned long long>(total.lockContentions));
+
+    m_LoggedStatistics = std::move(current);
+    m_LoggedAt = now;
+}
+
+uint64_t ThreadPool::getHeapAllocationCount() {
+    return TaskStorage::getHeapAllocationCount();
 }
 
 ThreadPool::~ThreadPool() {
-    m_Mutex.lock();
-    m_Complete = true;
-    m_Mutex.unlock();
-    m_Condition.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_Complete = true;
+    }
+    m_SleepCondition.notify_all();
     for (std::thread& thread : m_Threads) 
         thread.join();
-}
\ No newline at end of file
+}
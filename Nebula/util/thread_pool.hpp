@@ -24,31 +24,180 @@ SOFTWARE.
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 
-/// Simple threadpool implementation. 
+#include "task.hpp"
+#include "wait_group.hpp"
+
+/// Counters gathered by a single worker of the threadpool. Times are in nanoseconds.
+struct WorkerStatistics {
+    /// Time spent executing tasks.
+    uint64_t busyTime = 0;
+    /// Time spent asleep waiting for tasks.
+    uint64_t idleTime = 0;
+    uint64_t tasksExecuted = 0;
+    /// Summed time the executed tasks spent sitting in a queue before they started.
+    uint64_t queuedTime = 0;
+    /// Depth of the worker's own queue, sampled every time it takes a task from it.
+    uint64_t queueDepthTotal = 0;
+    uint64_t queueDepthSamples = 0;
+    uint64_t queueDepthMax = 0;
+    /// Number of times a queue lock was already held when the worker tried to take it.
+    uint64_t lockContentions = 0;
+    uint64_t stealAttempts = 0;
+    uint64_t stealSuccesses = 0;
+};
+
+/// Scheduling lanes of the threadpool, from most to least urgent.
+enum class TaskPriority {
+    /// Work the current frame is waiting on, such as culling and command recording.
+    eCritical,
+    /// General work which should finish soon but does not gate the frame.
+    eNormal,
+    /// Long running work such as asset streaming and shader compilation.
+    eBackground,
+};
+
+/// Work-stealing threadpool. Every worker owns a deque of tasks per priority lane which it 
+/// pushes to and pops from at the back, while idle workers steal from the front of a randomly
+/// chosen victim. Tasks enqueued from threads outside of the pool land in a shared submission
+/// queue which every worker will also steal from.
+///
+/// A thread looking for work always searches every queue for critical tasks before it looks 
+/// at the normal lane, and the normal lane before the background lane. Background tasks are 
+/// never run by more than threadCount - 1 workers at once (one on a single worker pool) so 
+/// that a worker is always free to pick up critical work. Long background tasks should poll
+/// shouldYield() and re-enqueue their remaining work when it returns true.
 class ThreadPool {
 public:
+    static constexpr size_t kPriorityCount = 3;
+
     /// Spawns threadCount threads and has them execute in parallel, waiting until a task 
-    /// is added to the queue a thread will pick up this task and execute it.
+    /// is added to one of the queues a thread will pick up this task and execute it.
     ThreadPool(uint32_t threadCount);
 
+    /// Spawns one thread per entry in processors. When pinThreads is set, each thread is 
+    /// pinned to the logical processor given by its entry.
+    ThreadPool(const std::vector<uint32_t>& processors, bool pinThreads);
+
     /// Ends the threadpool, returning all spawned threads.
     ~ThreadPool();
 
-    /// Adds a funciton to the queue, where a thread will pick up the task and execute it.
-    void enqueue(std::function<void()> function);
+    /// Adds a function to the queue of the calling worker, or to the submission queue when
+    /// called from a thread which does not belong to the pool.
+    void enqueue(Task task, TaskPriority priority = TaskPriority::eNormal);
+
+    /// Adds a function to the queue as with enqueue(Task), marking it as part of group. The
+    /// group must outlive the task.
+    void enqueue(Task task, WaitGroup& group, TaskPriority priority = TaskPriority::eNormal);
 
-    /// Blocks execution on the calling thread until all spawned threads have returned.
+    /// Adds a batch of functions to the queue under a single lock, marking all of them as
+    /// part of group. The tasks are moved out of pTasks.
+    void submit(Task* pTasks, size_t count, WaitGroup& group, TaskPriority priority = TaskPriority::eNormal);
+
+    /// Blocks execution on the calling thread until every enqueued task has finished. The 
+    /// calling thread will execute pending tasks while it waits instead of sleeping.
     void wait();
+
+    /// Blocks execution on the calling thread until every task in group has finished,
+    /// executing pending critical and normal tasks from the pool while it waits. Background
+    /// tasks are left to the workers so a waiting frame is never stuck behind one.
+    void wait(const WaitGroup& group);
+
+    /// Executes a single pending task with at most the given priority on the calling thread 
+    /// if one can be found. Returns false when there was nothing to run.
+    bool runPendingTask(TaskPriority lowestPriority = TaskPriority::eBackground);
+
+    /// Returns true when critical tasks are waiting to be picked up. Background tasks should
+    /// check this at convenient points and re-enqueue their remaining work if it is set.
+    bool shouldYield() const;
+
+    /// Returns the number of worker threads spawned by the pool.
+    uint32_t getThreadCount() const;
+
+    /// Returns the index of the calling worker in [0, getThreadCount()), or getThreadCount()
+    /// when called from a thread which does not belong to the pool.
+    uint32_t getWorkerIndex() const;
+
+    /// Returns a snapshot of the counters of every worker. The final entry holds the counters
+    /// of threads outside the pool which helped with work through wait() or runPendingTask().
+    std::vector<WorkerStatistics> getStatistics() const;
+
+    /// Writes a single line summarizing pool activity since the previous call to the log.
+    void logStatistics();
+
+    /// Returns the number of heap allocations made by the pool and its task storage since
+    /// startup. Once the queues and task storage have warmed up this should stop increasing.
+    static uint64_t getHeapAllocationCount();
 private:
+    /// A queued task along with the group it will signal when finished.
+    struct Job {
+        Task task;
+        WaitGroup* pGroup = nullptr;
+        uint64_t queuedAt = 0;
+    };
+
+    /// Growable ring buffer of jobs. Capacity is kept when jobs are removed, so a queue 
+    /// which has reached its high-water mark no longer allocates.
+    struct JobRing {
+        std::vector<Job> jobs;
+        size_t head = 0;
+        size_t count = 0;
+
+        void pushBack(Job job);
+        Job popBack();
+        Job popFront();
+    };
+
+    /// Queues owned by a single worker, one ring per priority lane.
+    struct WorkQueue {
+        std::mutex mutex;
+        std::array<JobRing, kPriorityCount> lanes;
+    };
+
+    /// Live counters of a worker, kept on their own cache line. Only the owning worker writes
+    /// them, except for the final slot which is shared by all threads outside of the pool.
+    struct alignas(64) WorkerCounters {
+        std::atomic<uint64_t> busyTime{ 0 };
+        std::atomic<uint64_t> idleTime{ 0 };
+        std::atomic<uint64_t> tasksExecuted{ 0 };
+        std::atomic<uint64_t> queuedTime{ 0 };
+        std::atomic<uint64_t> queueDepthTotal{ 0 };
+        std::atomic<uint64_t> queueDepthSamples{ 0 };
+        std::atomic<uint64_t> queueDepthMax{ 0 };
+        std::atomic<uint64_t> lockContentions{ 0 };
+        std::atomic<uint64_t> stealAttempts{ 0 };
+        std::atomic<uint64_t> stealSuccesses{ 0 };
+    };
+
+    void workerLoop(uint32_t index);
+    uint32_t getQueueIndex() const;
+    void push(Task* pTasks, size_t count, WaitGroup* pGroup, TaskPriority priority);
+    bool findJob(uint32_t index, size_t lowestLane, Job& job, size_t& lane);
+    bool popJob(uint32_t index, size_t lane, Job& job);
+    bool stealJob(uint32_t index, size_t lane, Job& job);
+    void execute(uint32_t index, Job& job, size_t lane);
+    std::unique_lock<std::mutex> lockQueue(WorkQueue& queue, uint32_t index);
+
     std::vector<std::thread> m_Threads;
-    std::queue<std::function<void()>> m_Queue;
-    std::mutex m_Mutex;
-    std::condition_variable m_Condition;
-    bool m_Complete;
-};
\ No newline at end of file
+    /// One queue per worker, the last entry is the shared submission queue.
+    std::vector<std::unique_ptr<WorkQueue>> m_Queues;
+    std::unique_ptr<WorkerCounters[]> m_Counters;
+    std::vector<WorkerStatistics> m_LoggedStatistics;
+    uint64_t m_LoggedAt;
+    std::array<std::atomic<uint32_t>, kPriorityCount> m_QueuedCounts;
+    std::atomic<uint32_t> m_QueuedCount;
+    std::atomic<uint32_t> m_OutstandingCount;
+    std::atomic<uint32_t> m_RunningBackgroundCount;
+    uint32_t m_BackgroundLimit;
+    std::atomic<uint32_t> m_SleepingCount;
+    std::mutex m_SleepMutex;
+    std::condition_variable m_SleepCondition;
+    std::atomic<bool> m_Complete;
+};
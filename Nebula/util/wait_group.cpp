@@ -0,0 +1,101 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "wait_group.hpp"
+
+#include <new>
+
+#include "thread_pool.hpp"
+
+WaitGroup::WaitGroup() : m_Count(0), m_pFirstContinuation(nullptr), m_pLastContinuation(nullptr) {}
+
+WaitGroup::~WaitGroup() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // Continuations of a group which never completed are dropped without running.
+    Continuation* pContinuation = m_pFirstContinuation;
+    while (pContinuation) {
+        Continuation* pNext = pContinuation->pNext;
+        pContinuation->~Continuation();
+        TaskStorage::deallocate(pContinuation, sizeof(Continuation));
+        pContinuation = pNext;
+    }
+}
+
+void WaitGroup::add(uint32_t count) {
+    m_Count.fetch_add(count, std::memory_order_relaxed);
+}
+
+void WaitGroup::done() {
+    // Tasks which are not the last in the group only need to lower the counter.
+    uint32_t count = m_Count.load(std::memory_order_relaxed);
+    while (count > 1) {
+        if (m_Count.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel))
+            return;
+    }
+
+    // The final decrement happens under the lock so a concurrent then() either lands in this 
+    // batch or sees the completed counter and enqueues its continuation itself. Once the lock 
+    // is released the group may be destroyed by a waiter, so only locals are touched after.
+    Continuation* pFirst = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            pFirst = m_pFirstContinuation;
+            m_pFirstContinuation = nullptr;
+            m_pLastContinuation = nullptr;
+        }
+    }
+    enqueueAll(pFirst);
+}
+
+bool WaitGroup::isComplete() const {
+    return m_Count.load(std::memory_order_acquire) == 0;
+}
+
+void WaitGroup::then(ThreadPool* pPool, Task continuation) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!isComplete()) {
+            void* pBlock = TaskStorage::allocate(sizeof(Continuation));
+            Continuation* pContinuation = new (pBlock) Continuation{ pPool, std::move(continuation), nullptr };
+            if (m_pLastContinuation)
+                m_pLastContinuation->pNext = pContinuation;
+            else
+                m_pFirstContinuation = pContinuation;
+            m_pLastContinuation = pContinuation;
+            return;
+        }
+    }
+    pPool->enqueue(std::move(continuation));
+}
+
+void WaitGroup::enqueueAll(Continuation* pFirst) {
+    while (pFirst) {
+        Continuation* pNext = pFirst->pNext;
+        pFirst->pPool->enqueue(std::move(pFirst->task));
+        pFirst->~Continuation();
+        TaskStorage::deallocate(pFirst, sizeof(Continuation));
+        pFirst = pNext;
+    }
+}
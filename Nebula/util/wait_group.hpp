@@ -0,0 +1,77 @@
+/*
+MIT License
+
+Copyright (c) 2018 Ben Brown
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "task.hpp"
+
+class ThreadPool;
+
+/// Tracks completion of a group of tasks. The counter is raised when tasks are submitted
+/// against the group and lowered as each of them finishes. Continuations registered through
+/// then() are enqueued once the counter reaches zero. A group may be reused after it completes.
+class WaitGroup {
+public:
+    WaitGroup();
+
+    /// Waits for a task which is still finishing done() to release the group.
+    ~WaitGroup();
+
+    WaitGroup(const WaitGroup&) = delete;
+    WaitGroup& operator=(const WaitGroup&) = delete;
+
+    /// Raises the number of outstanding tasks in the group.
+    void add(uint32_t count = 1);
+
+    /// Marks a single task in the group as finished. The last task to finish will enqueue 
+    /// any registered continuations.
+    void done();
+
+    /// Returns true when every task submitted against the group has finished.
+    bool isComplete() const;
+
+    /// Enqueues the continuation on pPool when the group completes. If the group has already
+    /// completed, the continuation is enqueued immediately.
+    void then(ThreadPool* pPool, Task continuation);
+private:
+    /// Pending continuation, kept in a pooled block from TaskStorage so that registering one
+    /// does not touch the heap once the pool has warmed up.
+    struct Continuation {
+        ThreadPool* pPool;
+        Task task;
+        Continuation* pNext;
+    };
+
+    /// Enqueues every continuation of the list and releases their blocks.
+    static void enqueueAll(Continuation* pFirst);
+
+    std::atomic<uint32_t> m_Count;
+    std::mutex m_Mutex;
+    Continuation* m_pFirstContinuation;
+    Continuation* m_pLastContinuation;
+};